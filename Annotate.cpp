@@ -0,0 +1,214 @@
+#include "GameWorkers.h"
+#include "Pgn.h"
+#include "Search.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+// Usage: annotate [-depth N | -nodes N] [-threads N] [-hash MB] [-inaccuracy P] [-mistake P] [-blunder P]
+//                 <games.pgn> <annotated.pgn>
+//
+// Analyses every position of every game and writes the games back with an
+// [%eval] comment after each move and ?!, ? or ?? on the moves that threw
+// away the most. A move is judged by how much of its side's expected score it
+// lost against the engine's best move: a position's score turns into an
+// expected score with a logistic curve, so giving back two pawns in a
+// dead-won position counts for less than in a level one. The thresholds are
+// in percentage points of expected score (defaults 10, 20, 30).
+//
+// Games are analysed in parallel with RunGameWorkers (GameWorkers.h). Within a game the positions are
+// searched in order against the same transposition table, so each search
+// starts with what the last one learned.
+
+#define DEFAULT_DEPTH 12
+
+struct AnnotateConfig
+{
+    SearchLimits limits;
+    int threads = 1;
+    int hashMegabytes = 16;
+    double inaccuracy = 10, mistake = 20, blunder = 30;
+};
+
+// What one game added: positions searched, then inaccuracies, mistakes, blunders
+struct AnnotateResult
+{
+    size_t counts[4] = {0, 0, 0, 0};
+    bool complete = true;
+};
+
+// [%eval] form of a search score (side to move's view), from White's side:
+// pawns, or #N for a mate, negative when Black mates
+static string EvalText(int score, bool whiteToMove)
+{
+    int sign = whiteToMove ? 1 : -1;
+    char text[32];
+    if (IsMateScore(score))
+        snprintf(text, sizeof(text), "#%d", sign * MateInMoves(score));
+    else
+        snprintf(text, sizeof(text), "%.2f", sign * score / 100.0);
+    return text;
+}
+
+// Annotates game in place; false if a move couldn't be read, in which case
+// the moves from there on are left as they were
+static bool AnnotateGame(Engine &engine, const AnnotateConfig &config, PgnGame &game, size_t counts[4])
+{
+    Position pos;
+    const char *fen = GetPgnTag(game, "FEN");
+    if (!fen)
+        SetStartPosition(pos);
+    else if (!SetFromFen(pos, fen))
+        return false;
+
+    vector<Position> positions(1, pos);
+    vector<Move> moves;
+    for (auto &san : game.moves)
+    {
+        Move m = ParseSanMove(positions.back(), san.c_str());
+        if (m == MOVE_NONE)
+            break;
+        moves.push_back(m);
+        positions.push_back(positions.back());
+        DoMove(positions.back(), m);
+    }
+
+    // One search per position, the last one too, for the score after the last move
+    vector<uint64_t> history;
+    vector<SearchResult> results;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        results.push_back(Search(engine, positions[i], history, config.limits));
+        history.push_back(positions[i].key);
+    }
+    counts[0] += positions.size();
+
+    static const char *glyphs[4] = {"", "?!", "?", "??"};
+    static const char *names[4] = {"", "Inaccuracy", "Mistake", "Blunder"};
+    game.comments.assign(game.moves.size(), string());
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        const Position &before = positions[i];
+        int best = results[i].score;
+        int played = -results[i + 1].score;
+
+        int kind = 0;
+        if (moves[i] != results[i].bestMove)
+        {
+            double lost = ExpectedScore(best) - ExpectedScore(played);
+            kind = lost >= config.blunder ? 3 : lost >= config.mistake ? 2 : lost >= config.inaccuracy ? 1 : 0;
+        }
+
+        game.moves[i] = MoveToSan(before, moves[i]) + glyphs[kind];
+        string comment;
+        // Nothing to evaluate after mate or stalemate
+        if (results[i + 1].bestMove != MOVE_NONE)
+            comment = "[%eval " + EvalText(results[i + 1].score, positions[i + 1].whiteToMove) + "] ";
+        if (kind > 0)
+        {
+            comment += string(names[kind]) + ". " + MoveToSan(before, results[i].bestMove) + " was best (" +
+                       EvalText(best, before.whiteToMove) + ").";
+            counts[kind]++;
+        }
+        if (!comment.empty() && comment.back() == ' ')
+            comment.pop_back();
+        game.comments[i] = comment;
+    }
+    return moves.size() == game.moves.size();
+}
+
+int main(int argc, char **argv)
+{
+    AnnotateConfig config;
+    config.limits.depth = DEFAULT_DEPTH;
+    config.threads = max((int)thread::hardware_concurrency(), 1);
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-depth") == 0)
+            config.limits.depth = atoi(argv[first + 1]);
+        else if (strcmp(argv[first], "-nodes") == 0)
+        {
+            config.limits.nodes = strtoull(argv[first + 1], nullptr, 10);
+            config.limits.depth = 0;
+        }
+        else if (strcmp(argv[first], "-threads") == 0)
+            config.threads = max(atoi(argv[first + 1]), 1);
+        else if (strcmp(argv[first], "-hash") == 0)
+            config.hashMegabytes = max(atoi(argv[first + 1]), 1);
+        else if (strcmp(argv[first], "-inaccuracy") == 0)
+            config.inaccuracy = atof(argv[first + 1]);
+        else if (strcmp(argv[first], "-mistake") == 0)
+            config.mistake = atof(argv[first + 1]);
+        else if (strcmp(argv[first], "-blunder") == 0)
+            config.blunder = atof(argv[first + 1]);
+        else
+            printf("Unknown option %s\n", argv[first]);
+        first += 2;
+    }
+
+    if (argc - first != 2)
+    {
+        printf("Usage: %s [-depth N | -nodes N] [-threads N] [-hash MB] [-inaccuracy P] [-mistake P] [-blunder P] "
+               "<games.pgn> <annotated.pgn>\n",
+               argv[0]);
+        return 1;
+    }
+
+    PgnReader reader;
+    if (!OpenPgn(reader, argv[first]))
+    {
+        printf("Could not open %s\n", argv[first]);
+        return 1;
+    }
+    FILE *out = fopen(argv[first + 1], "w");
+    if (!out)
+    {
+        printf("Could not create %s\n", argv[first + 1]);
+        return 1;
+    }
+
+    string annotator = config.limits.nodes ? "annotate " + to_string(config.limits.nodes) + " nodes"
+                                           : "annotate depth " + to_string(config.limits.depth);
+    AnnotateResult total;
+    size_t failed = 0;
+    steady_clock::time_point start = steady_clock::now();
+    size_t games = RunGameWorkers<AnnotateResult>(
+        reader, config.threads, config.hashMegabytes,
+        [&](Engine &engine, PgnGame &game, size_t)
+        {
+            AnnotateResult result;
+            SetPgnTag(game, "Annotator", annotator);
+            result.complete = AnnotateGame(engine, config, game, result.counts);
+            return result;
+        },
+        [&](PgnGame &game, size_t index, AnnotateResult &result)
+        {
+            for (int i = 0; i < 4; i++)
+                total.counts[i] += result.counts[i];
+            if (!result.complete)
+            {
+                failed++;
+                printf("Game %zu: illegal or unreadable move, annotated up to there\n", index + 1);
+            }
+            WritePgnGame(out, game);
+        });
+    ClosePgn(reader);
+    fclose(out);
+
+    double seconds = duration_cast<milliseconds>(steady_clock::now() - start).count() / 1000.0;
+    size_t positions = total.counts[0];
+    printf("%zu games, %zu positions in %.1f s (%.0f positions/s) on %d threads\n", games, positions, seconds,
+           seconds > 0 ? positions / seconds : 0.0, config.threads);
+    printf("%zu inaccuracies, %zu mistakes, %zu blunders\n", total.counts[1], total.counts[2], total.counts[3]);
+    if (failed)
+        printf("%zu games had a move that couldn't be read\n", failed);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "AssetLoader.h"
+#include <algorithm>
+
+using namespace std;
+
+// LoadImage, ImageResize and LoadWave only touch memory and files, so any
+// thread may run them
+static void DecodeAsset(AssetJob &job)
+{
+    if (job.type == ASSET_WAVE)
+    {
+        job.wave = LoadWave(job.path.c_str());
+        return;
+    }
+
+    job.image = LoadImage(job.path.c_str());
+    if (!job.image.data)
+        return;
+    if (job.scale > 0)
+        ImageResize(&job.image, (int)(job.image.width * job.scale + 0.5f), (int)(job.image.height * job.scale + 0.5f));
+    else if (job.width > 0 && job.height > 0 && (job.image.width != job.width || job.image.height != job.height))
+        ImageResize(&job.image, job.width, job.height);
+}
+
+static void AssetWorker(AssetLoader *loader)
+{
+    while (true)
+    {
+        AssetJob job;
+        {
+            unique_lock<mutex> lock(loader->lock);
+            loader->wake.wait(lock, [loader]
+                              { return loader->stopping || !loader->queued.empty(); });
+            if (loader->stopping)
+                return;
+            job = move(loader->queued.front());
+            loader->queued.pop_front();
+        }
+
+        DecodeAsset(job);
+
+        lock_guard<mutex> lock(loader->lock);
+        loader->loaded.push_back(move(job));
+    }
+}
+
+void StartAssetLoader(AssetLoader &loader, int threads)
+{
+    if (threads <= 0)
+        threads = max(1, (int)thread::hardware_concurrency() - 1);
+    loader.stopping = false;
+    for (int i = 0; i < threads; i++)
+        loader.workers.emplace_back(AssetWorker, &loader);
+}
+
+void StopAssetLoader(AssetLoader &loader)
+{
+    {
+        lock_guard<mutex> lock(loader.lock);
+        loader.stopping = true;
+    }
+    loader.wake.notify_all();
+    for (auto &worker : loader.workers)
+        worker.join();
+    loader.workers.clear();
+
+    for (auto &job : loader.loaded)
+    {
+        if (job.image.data)
+            UnloadImage(job.image);
+        if (job.wave.data)
+            UnloadWave(job.wave);
+    }
+    loader.loaded.clear();
+    loader.queued.clear();
+}
+
+static void QueueJob(AssetLoader &loader, AssetJob &job)
+{
+    {
+        lock_guard<mutex> lock(loader.lock);
+        loader.queued.push_back(move(job));
+        loader.total++;
+    }
+    loader.wake.notify_one();
+}
+
+void QueueImage(AssetLoader &loader, int id, const char *path, int width, int height)
+{
+    AssetJob job;
+    job.id = id;
+    job.type = ASSET_IMAGE;
+    job.path = path;
+    job.width = width;
+    job.height = height;
+    QueueJob(loader, job);
+}
+
+void QueueScaledImage(AssetLoader &loader, int id, const char *path, float scale)
+{
+    AssetJob job;
+    job.id = id;
+    job.type = ASSET_IMAGE;
+    job.path = path;
+    job.scale = scale;
+    QueueJob(loader, job);
+}
+
+void QueueWave(AssetLoader &loader, int id, const char *path)
+{
+    AssetJob job;
+    job.id = id;
+    job.type = ASSET_WAVE;
+    job.path = path;
+    QueueJob(loader, job);
+}
+
+bool TakeLoadedAsset(AssetLoader &loader, AssetJob &job)
+{
+    lock_guard<mutex> lock(loader.lock);
+    if (loader.loaded.empty())
+        return false;
+    job = move(loader.loaded.back());
+    loader.loaded.pop_back();
+    loader.taken++;
+    return true;
+}
+
+void GetAssetProgress(AssetLoader &loader, int &taken, int &total)
+{
+    lock_guard<mutex> lock(loader.lock);
+    taken = loader.taken;
+    total = loader.total;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "raylib.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes images and sounds on worker threads so startup doesn't wait on one
+// file after another. Only the decoding leaves the main thread: textures and
+// sound buffers belong to the GL context and audio device, so the main thread
+// takes finished jobs with TakeLoadedAsset and creates them itself.
+
+enum AssetType
+{
+    ASSET_IMAGE,
+    ASSET_WAVE
+};
+
+struct AssetJob
+{
+    int id;         // Caller's id, handed back with the result
+    AssetType type;
+    std::string path;
+    int width = 0;  // Images: resized to width x height when both are set,
+    int height = 0;
+    float scale = 0; // or by this factor when non-zero
+    Image image = {};
+    Wave wave = {}; // data is null if the file couldn't be read
+};
+
+struct AssetLoader
+{
+    std::vector<std::thread> workers;
+    std::mutex lock; // Guards everything below
+    std::condition_variable wake;
+    std::deque<AssetJob> queued;
+    std::vector<AssetJob> loaded;
+    int total = 0; // Jobs ever queued
+    int taken = 0; // Jobs handed to the main thread
+    bool stopping = false;
+};
+
+// threads = 0 uses one per core, leaving one for the main thread
+void StartAssetLoader(AssetLoader &loader, int threads = 0);
+// Joins the workers; jobs not yet taken are dropped and their data freed
+void StopAssetLoader(AssetLoader &loader);
+
+void QueueImage(AssetLoader &loader, int id, const char *path, int width = 0, int height = 0);
+void QueueScaledImage(AssetLoader &loader, int id, const char *path, float scale);
+void QueueWave(AssetLoader &loader, int id, const char *path);
+
+// Main thread: false when nothing has finished since the last call. The
+// caller owns job.image / job.wave afterwards.
+bool TakeLoadedAsset(AssetLoader &loader, AssetJob &job);
+// Jobs taken so far and jobs queued so far, for a progress bar
+void GetAssetProgress(AssetLoader &loader, int &taken, int &total);
@@ -0,0 +1,95 @@
+#include "BoardFeed.h"
+#include <string.h>
+
+using namespace std;
+
+// Most a single poll reads, so a long backlog is worked off over a few frames
+#define MAX_POLL_BYTES (1 << 20)
+
+bool OpenBoardFeed(BoardFeed &feed, const char *path)
+{
+    CloseBoardFeed(feed);
+    feed.file = fopen(path, "rb");
+    return feed.file != nullptr;
+}
+
+void CloseBoardFeed(BoardFeed &feed)
+{
+    if (feed.file)
+        fclose(feed.file);
+    feed.file = nullptr;
+    feed.partial.clear();
+    feed.boards.clear();
+    feed.index.clear();
+}
+
+bool ApplyFeedLine(BoardFeed &feed, const char *line)
+{
+    const char *space = strchr(line, ' ');
+    if (!space || space == line)
+        return false;
+    string id(line, space - line);
+    const char *rest = space + 1;
+
+    bool ended = strncmp(rest, "end ", 4) == 0;
+    Position pos;
+    if (!ended && !SetFromFen(pos, rest))
+        return false;
+
+    FeedBoard *board;
+    auto found = feed.index.find(id);
+    if (found != feed.index.end())
+        board = &feed.boards[found->second];
+    else
+    {
+        if (ended)
+            return false;
+        feed.index[id] = (int)feed.boards.size();
+        feed.boards.push_back(FeedBoard());
+        board = &feed.boards.back();
+        board->id = id;
+        board->version = 0;
+    }
+
+    if (ended)
+        board->result = rest + 4;
+    else
+    {
+        memcpy(board->board, pos.board, sizeof(board->board));
+        board->whiteToMove = pos.whiteToMove;
+        board->result.clear();
+    }
+    board->version++;
+    return true;
+}
+
+int PollBoardFeed(BoardFeed &feed)
+{
+    if (!feed.file)
+        return 0;
+
+    int changed = 0;
+    char buffer[16384];
+    size_t total = 0, length;
+    while (total < MAX_POLL_BYTES && (length = fread(buffer, 1, sizeof(buffer), feed.file)) > 0)
+    {
+        total += length;
+        size_t start = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (buffer[i] != '\n')
+                continue;
+            feed.partial.append(buffer + start, i - start);
+            if (!feed.partial.empty() && feed.partial.back() == '\r')
+                feed.partial.pop_back();
+            changed += ApplyFeedLine(feed, feed.partial.c_str());
+            feed.partial.clear();
+            start = i + 1;
+        }
+        feed.partial.append(buffer + start, length - start);
+    }
+
+    // Writer hasn't added more yet; clear EOF so the next poll reads again
+    clearerr(feed.file);
+    return changed;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Position.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A text feed of live positions, one update per line:
+//
+//   <board> <fen>          board is any token without spaces; new ones are added as they appear
+//   <board> end <result>   the game on that board is over
+//
+// The feed is read from a file another process keeps appending to (selfplay
+// -feed writes one), picking up only what was added since the last poll.
+
+struct FeedBoard
+{
+    std::string id;
+    int8_t board[64]; // Position::board layout, row 0 = rank 8
+    bool whiteToMove;
+    std::string result; // Empty while the game is running
+    uint32_t version;   // Bumped on every update, so viewers can skip boards that haven't changed
+};
+
+struct BoardFeed
+{
+    FILE *file = nullptr;
+    std::string partial; // Line still being written
+    std::vector<FeedBoard> boards;
+    std::unordered_map<std::string, int> index;
+};
+
+bool OpenBoardFeed(BoardFeed &feed, const char *path);
+void CloseBoardFeed(BoardFeed &feed);
+// Applies the lines appended since the last call; returns how many changed a board
+int PollBoardFeed(BoardFeed &feed);
+// One feed line, from the file or from anywhere else; false if it wasn't understood
+bool ApplyFeedLine(BoardFeed &feed, const char *line);
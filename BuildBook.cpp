@@ -0,0 +1,56 @@
+#include "PolyglotBook.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Usage: buildbook [-plies N] [-min N] <games.pgn> [more.pgn ...] <book.bin>
+int main(int argc, char **argv)
+{
+    PolyglotBookBuilder builder;
+    uint32_t minGames = 1;
+    int first = 1;
+
+    while (first < argc && argv[first][0] == '-' && first + 1 < argc)
+    {
+        if (strcmp(argv[first], "-plies") == 0)
+            builder.maxPlies = atoi(argv[first + 1]);
+        else if (strcmp(argv[first], "-min") == 0)
+            minGames = (uint32_t)atoi(argv[first + 1]);
+        first += 2;
+    }
+
+    if (argc - first < 2)
+    {
+        printf("Usage: %s [-plies N] [-min N] <games.pgn> [more.pgn ...] <book.bin>\n", argv[0]);
+        return 1;
+    }
+
+    if (!CheckPolyglotRandom())
+    {
+        printf("Polyglot Random64 table fails its self-test\n");
+        return 1;
+    }
+
+    size_t games = 0;
+    for (int i = first; i < argc - 1; i++)
+    {
+        PgnReader reader;
+        if (!OpenPgn(reader, argv[i]))
+        {
+            printf("Could not open %s\n", argv[i]);
+            return 1;
+        }
+        PgnGame game;
+        while (ReadPgnGame(reader, game))
+            games += AddBookGame(builder, game);
+        ClosePgn(reader);
+    }
+
+    if (!WritePolyglotBook(builder, argv[argc - 1], minGames))
+    {
+        printf("Could not write %s\n", argv[argc - 1]);
+        return 1;
+    }
+    printf("%zu games, %zu book entries written to %s\n", games, builder.records.size(), argv[argc - 1]);
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "GameDatabase.h"
+#include <stdio.h>
+
+// Usage: builddb <games.pgn> [more.pgn ...] <output.cdb>
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s <games.pgn> [more.pgn ...] <output.cdb>\n", argv[0]);
+        return 1;
+    }
+
+    GameDatabaseBuilder builder;
+    size_t added = 0, skipped = 0;
+
+    for (int i = 1; i < argc - 1; i++)
+    {
+        PgnReader reader;
+        if (!OpenPgn(reader, argv[i]))
+        {
+            printf("Could not open %s\n", argv[i]);
+            return 1;
+        }
+
+        PgnGame game;
+        while (ReadPgnGame(reader, game))
+        {
+            if (AddDatabaseGame(builder, game))
+                added++;
+            else
+                skipped++;
+        }
+        ClosePgn(reader);
+    }
+
+    if (!WriteGameDatabase(builder, argv[argc - 1]))
+    {
+        printf("Could not write %s\n", argv[argc - 1]);
+        return 1;
+    }
+
+    printf("%zu games, %zu positions written to %s (%zu skipped)\n", added, builder.index.size(), argv[argc - 1], skipped);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "EnginePlayer.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+void InitEnginePlayer(EnginePlayer &player, int hashMegabytes, int threads)
+{
+    StopEnginePlayer(player);
+    InitEngine(player.engine, hashMegabytes, threads);
+    player.ready = true;
+}
+
+void StopEnginePlayer(EnginePlayer &player)
+{
+    if (player.worker.joinable())
+    {
+        // Search() clears the stop flag when it starts, so a stop sent before
+        // then is sent again; a ponder search would otherwise wait forever
+        while (!player.finished)
+        {
+            StopSearch(player.engine);
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        player.worker.join();
+    }
+    player.searching = false;
+    player.pondering = false;
+    player.ponderHit = false;
+}
+
+void ClearEnginePlayer(EnginePlayer &player)
+{
+    StopEnginePlayer(player);
+    if (player.ready)
+        ClearEngine(player.engine);
+}
+
+static void RunSearch(EnginePlayer *player)
+{
+    auto report = [player](const SearchInfo &info)
+    {
+        lock_guard<mutex> lock(player->linesLock);
+        player->lines[info.multiPv - 1] = *info.line;
+        player->lineCount = max(player->lineCount, info.multiPv);
+        player->linesVersion++;
+    };
+    player->result = Search(player->engine, player->searchPos, player->history, player->limits, report);
+    player->finished = true;
+}
+
+void StartEngineSearch(EnginePlayer &player, const Position &pos, const vector<uint64_t> &history,
+                       const SearchLimits &limits)
+{
+    StopEnginePlayer(player);
+    player.searchPos = pos;
+    player.history = history;
+    player.limits = limits;
+    {
+        lock_guard<mutex> lock(player.linesLock);
+        player.lineCount = 0;
+        player.linesVersion++;
+    }
+    player.finished = false;
+    player.searching = true;
+    player.worker = thread(RunSearch, &player);
+}
+
+void StartPondering(EnginePlayer &player, const Position &pos, const vector<uint64_t> &history, Move expected,
+                    const SearchLimits &limits)
+{
+    Position next = pos;
+    DoMove(next, expected);
+    vector<uint64_t> keys = history;
+    keys.push_back(pos.key);
+
+    SearchLimits ponderLimits = limits;
+    ponderLimits.ponder = true;
+    StartEngineSearch(player, next, keys, ponderLimits);
+    player.pondering = true;
+}
+
+bool ResolvePonder(EnginePlayer &player, const Position &pos)
+{
+    if (!player.searching || !player.pondering)
+        return false;
+    if (player.ponderHit)
+        return true;
+    if (pos.key != player.searchPos.key)
+    {
+        StopEnginePlayer(player);
+        return false;
+    }
+    player.ponderHit = true;
+    PonderHit(player.engine);
+    return true;
+}
+
+bool IsEngineSearching(const EnginePlayer &player)
+{
+    return player.searching;
+}
+
+bool TakeEngineResult(EnginePlayer &player, SearchResult &result)
+{
+    if (!player.searching || (player.pondering && !player.ponderHit))
+        return false;
+
+    // Search() sets its ponder flag when it starts; a hit that came before that is sent again
+    if (player.pondering && player.engine.pondering)
+        PonderHit(player.engine);
+
+    if (!player.finished)
+        return false;
+    player.worker.join();
+    result = player.result;
+    player.searching = false;
+    player.pondering = false;
+    player.ponderHit = false;
+    return true;
+}
+
+uint32_t GetEngineLines(EnginePlayer &player, SearchLine lines[MAX_MULTI_PV], int &count)
+{
+    lock_guard<mutex> lock(player.linesLock);
+    count = player.lineCount;
+    for (int i = 0; i < count; i++)
+        lines[i] = player.lines[i];
+    return player.linesVersion;
+}
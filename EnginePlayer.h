@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Search.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the engine on its own thread for a front-end that can't block: a
+// search is started, the caller keeps drawing frames and picks the move up
+// when it's there.
+//
+// After its move the engine can ponder: search the position after the reply
+// it expects, on the opponent's time. If that reply is played the same search
+// just carries on, now against the clock (a ponder hit); otherwise it is
+// stopped and the real position searched, with the transposition table still
+// warm from pondering.
+//
+// Every search also publishes its lines as each iteration completes, so a
+// multi-PV analysis can be shown while it runs.
+
+struct EnginePlayer
+{
+    Engine engine;
+    bool ready = false; // Hash allocated
+    std::thread worker;
+    std::atomic<bool> finished{false};
+    bool searching = false;
+    Position searchPos; // Position the running search is for
+    std::vector<uint64_t> history;
+    SearchLimits limits;
+    SearchResult result;
+    bool pondering = false; // Running search is a ponder search
+    bool ponderHit = false; // ... whose expected move was played
+    std::mutex linesLock;   // Guards lines and lineCount, written by the search thread
+    SearchLine lines[MAX_MULTI_PV];
+    int lineCount = 0;
+    std::atomic<uint32_t> linesVersion{0}; // Bumped on every new line
+};
+
+void InitEnginePlayer(EnginePlayer &player, int hashMegabytes, int threads);
+// Stops any search and waits for it; its result is dropped
+void StopEnginePlayer(EnginePlayer &player);
+// New game: stop and forget the transposition table
+void ClearEnginePlayer(EnginePlayer &player);
+
+// history holds the keys of the positions before pos
+void StartEngineSearch(EnginePlayer &player, const Position &pos, const std::vector<uint64_t> &history,
+                       const SearchLimits &limits);
+// Ponders on pos after the expected reply; limits are those the real search would get
+void StartPondering(EnginePlayer &player, const Position &pos, const std::vector<uint64_t> &history, Move expected,
+                    const SearchLimits &limits);
+// The opponent has moved, reaching pos. True on a ponder hit: the running
+// search goes on and its result is the engine's move. Otherwise pondering is
+// stopped and the caller starts a search of its own.
+bool ResolvePonder(EnginePlayer &player, const Position &pos);
+
+bool IsEngineSearching(const EnginePlayer &player);
+// True once the running search (not a ponder search still waiting for its hit) has a move
+bool TakeEngineResult(EnginePlayer &player, SearchResult &result);
+// Newest lines of the running or last search, best first; returns linesVersion
+uint32_t GetEngineLines(EnginePlayer &player, SearchLine lines[MAX_MULTI_PV], int &count);
@@ -0,0 +1,264 @@
+#include "EngineProcess.h"
+#include <chrono>
+
+using namespace std;
+using namespace std::chrono;
+
+// Pulls one complete line out of the pending bytes, dropping the line ending
+static bool TakeLine(EngineProcess &process, string &line)
+{
+    size_t end = process.pending.find('\n');
+    if (end == string::npos)
+        return false;
+    line.assign(process.pending, 0, end);
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    process.pending.erase(0, end + 1);
+    return true;
+}
+
+static int RemainingMs(steady_clock::time_point deadline)
+{
+    return (int)max<int64_t>(0, duration_cast<milliseconds>(deadline - steady_clock::now()).count());
+}
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <vector>
+
+bool StartEngineProcess(EngineProcess &process, const char *command)
+{
+    StopEngineProcess(process);
+
+    SECURITY_ATTRIBUTES security = {sizeof(security), nullptr, TRUE};
+    HANDLE childInput, ourInput, ourOutput, childOutput;
+    if (!CreatePipe(&childInput, &ourInput, &security, 0))
+        return false;
+    if (!CreatePipe(&ourOutput, &childOutput, &security, 0))
+    {
+        CloseHandle(childInput);
+        CloseHandle(ourInput);
+        return false;
+    }
+    SetHandleInformation(ourInput, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(ourOutput, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = childInput;
+    startup.hStdOutput = childOutput;
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    string line = string("cmd.exe /c ") + command;
+    vector<char> commandLine(line.begin(), line.end());
+    commandLine.push_back(0);
+    PROCESS_INFORMATION info = {};
+    bool started = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &startup, &info);
+    CloseHandle(childInput);
+    CloseHandle(childOutput);
+    if (!started)
+    {
+        CloseHandle(ourInput);
+        CloseHandle(ourOutput);
+        return false;
+    }
+
+    CloseHandle(info.hThread);
+    process.processHandle = info.hProcess;
+    process.inputHandle = ourInput;
+    process.outputHandle = ourOutput;
+    process.pending.clear();
+    return true;
+}
+
+bool IsEngineProcessRunning(const EngineProcess &process)
+{
+    return process.processHandle && WaitForSingleObject(process.processHandle, 0) == WAIT_TIMEOUT;
+}
+
+void StopEngineProcess(EngineProcess &process)
+{
+    if (!process.processHandle)
+        return;
+
+    WriteEngineLine(process, "quit");
+    if (WaitForSingleObject(process.processHandle, 1000) != WAIT_OBJECT_0)
+        TerminateProcess(process.processHandle, 1);
+    CloseHandle(process.inputHandle);
+    CloseHandle(process.outputHandle);
+    CloseHandle(process.processHandle);
+    process.processHandle = process.inputHandle = process.outputHandle = nullptr;
+    process.pending.clear();
+}
+
+bool WriteEngineLine(EngineProcess &process, const string &line)
+{
+    if (!process.inputHandle)
+        return false;
+    string text = line + "\n";
+    DWORD written;
+    return WriteFile(process.inputHandle, text.data(), (DWORD)text.size(), &written, nullptr) && written == text.size();
+}
+
+bool ReadEngineLine(EngineProcess &process, string &line, int timeoutMs)
+{
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(timeoutMs);
+    while (!TakeLine(process, line))
+    {
+        // Anonymous pipes can't be waited on, so poll for data
+        DWORD available = 0;
+        if (!PeekNamedPipe(process.outputHandle, nullptr, 0, nullptr, &available, nullptr))
+            return false;
+        if (available == 0)
+        {
+            if (timeoutMs >= 0 && RemainingMs(deadline) == 0)
+                return false;
+            Sleep(1);
+            continue;
+        }
+
+        char chunk[4096];
+        DWORD count;
+        if (!ReadFile(process.outputHandle, chunk, min<DWORD>(available, sizeof(chunk)), &count, nullptr) || count == 0)
+            return false;
+        process.pending.append(chunk, count);
+    }
+    return true;
+}
+
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// Our pipe ends must not leak into engines started by other threads
+static bool OpenPipe(int fds[2])
+{
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0)
+        return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+bool StartEngineProcess(EngineProcess &process, const char *command)
+{
+    StopEngineProcess(process);
+
+    // A write to an engine that just died must fail, not kill us
+    signal(SIGPIPE, SIG_IGN);
+
+    int input[2], output[2];
+    if (!OpenPipe(input))
+        return false;
+    if (!OpenPipe(output))
+    {
+        close(input[0]);
+        close(input[1]);
+        return false;
+    }
+
+    int pid = fork();
+    if (pid == 0)
+    {
+        dup2(input[0], 0);
+        dup2(output[1], 1);
+        execl("/bin/sh", "sh", "-c", command, (char *)nullptr);
+        _exit(127);
+    }
+
+    close(input[0]);
+    close(output[1]);
+    if (pid < 0)
+    {
+        close(input[1]);
+        close(output[0]);
+        return false;
+    }
+
+    process.pid = pid;
+    process.inputFd = input[1];
+    process.outputFd = output[0];
+    process.pending.clear();
+    return true;
+}
+
+bool IsEngineProcessRunning(const EngineProcess &process)
+{
+    return process.pid > 0 && waitpid(process.pid, nullptr, WNOHANG) == 0;
+}
+
+void StopEngineProcess(EngineProcess &process)
+{
+    if (process.pid <= 0)
+        return;
+
+    WriteEngineLine(process, "quit");
+    bool exited = false;
+    for (int i = 0; i < 100 && !exited; i++)
+    {
+        exited = waitpid(process.pid, nullptr, WNOHANG) != 0;
+        if (!exited)
+            this_thread::sleep_for(milliseconds(10));
+    }
+    if (!exited)
+    {
+        kill(process.pid, SIGKILL);
+        waitpid(process.pid, nullptr, 0);
+    }
+
+    close(process.inputFd);
+    close(process.outputFd);
+    process.pid = process.inputFd = process.outputFd = -1;
+    process.pending.clear();
+}
+
+bool WriteEngineLine(EngineProcess &process, const string &line)
+{
+    if (process.inputFd < 0)
+        return false;
+    string text = line + "\n";
+    size_t done = 0;
+    while (done < text.size())
+    {
+        ssize_t count = write(process.inputFd, text.data() + done, text.size() - done);
+        if (count <= 0)
+            return false;
+        done += (size_t)count;
+    }
+    return true;
+}
+
+bool ReadEngineLine(EngineProcess &process, string &line, int timeoutMs)
+{
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(timeoutMs);
+    while (!TakeLine(process, line))
+    {
+        if (process.outputFd < 0)
+            return false;
+        pollfd wait = {process.outputFd, POLLIN, 0};
+        int ready = poll(&wait, 1, timeoutMs < 0 ? -1 : RemainingMs(deadline));
+        if (ready == 0)
+            return false;
+        if (ready < 0)
+            continue; // Interrupted by a signal
+
+        char chunk[4096];
+        ssize_t count = read(process.outputFd, chunk, sizeof(chunk));
+        if (count <= 0)
+            return false;
+        process.pending.append(chunk, (size_t)count);
+    }
+    return true;
+}
+
+#endif
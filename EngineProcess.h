@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+// A child process, normally a UCI engine, driven line by line through its
+// stdin and stdout. Reads take a timeout so a hung engine cannot stall the caller.
+struct EngineProcess
+{
+    int pid = -1;                  // POSIX only
+    int inputFd = -1;              // POSIX only, our end of the child's stdin
+    int outputFd = -1;             // POSIX only, our end of the child's stdout
+    void *processHandle = nullptr; // Windows only
+    void *inputHandle = nullptr;   // Windows only
+    void *outputHandle = nullptr;  // Windows only
+    std::string pending;           // Bytes read past the last returned line
+};
+
+// The command runs through the shell (cmd.exe on Windows), so arguments are allowed
+bool StartEngineProcess(EngineProcess &process, const char *command);
+// Sends "quit", then kills the process if it hasn't exited within a second
+void StopEngineProcess(EngineProcess &process);
+bool IsEngineProcessRunning(const EngineProcess &process);
+
+bool WriteEngineLine(EngineProcess &process, const std::string &line);
+// False on timeout or end of output; timeoutMs < 0 waits forever
+bool ReadEngineLine(EngineProcess &process, std::string &line, int timeoutMs);
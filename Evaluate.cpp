@@ -0,0 +1,204 @@
+#include "Evaluate.h"
+#include "EvalParams.h"
+#include <stdlib.h>
+
+static const int phaseWeight[7] = {0, 0, 1, 1, 2, 4, 0};
+
+static Bitboard fileMask[8];
+static Bitboard adjacentFiles[8];
+static Bitboard passedMask[2][64]; // Squares ahead on the same and adjacent files
+
+static struct EvaluateTables
+{
+    EvaluateTables()
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            for (int row = 0; row < 8; row++)
+                fileMask[col] |= SquareBit(row * 8 + col);
+        }
+        for (int col = 0; col < 8; col++)
+            adjacentFiles[col] = (col > 0 ? fileMask[col - 1] : 0) | (col < 7 ? fileMask[col + 1] : 0);
+
+        for (int sq = 0; sq < 64; sq++)
+        {
+            Bitboard files = fileMask[SquareCol(sq)] | adjacentFiles[SquareCol(sq)];
+            for (int row = 0; row < 8; row++)
+            {
+                Bitboard rank = 0xFFULL << (row * 8);
+                if (row < SquareRow(sq))
+                    passedMask[0][sq] |= files & rank;
+                if (row > SquareRow(sq))
+                    passedMask[1][sq] |= files & rank;
+            }
+        }
+    }
+} evaluateTables;
+
+static const int (*pieceTables[7])[2] = {nullptr, PAWN_TABLE, KNIGHT_TABLE, BISHOP_TABLE, ROOK_TABLE, QUEEN_TABLE, KING_TABLE};
+
+static const EvalTable evalTables[] = {
+    {"PIECE_VALUE", PIECE_VALUE, 7, nullptr},
+    {"PAWN_TABLE", PAWN_TABLE, 64, nullptr},
+    {"KNIGHT_TABLE", KNIGHT_TABLE, 64, nullptr},
+    {"BISHOP_TABLE", BISHOP_TABLE, 64, nullptr},
+    {"ROOK_TABLE", ROOK_TABLE, 64, nullptr},
+    {"QUEEN_TABLE", QUEEN_TABLE, 64, nullptr},
+    {"KING_TABLE", KING_TABLE, 64, nullptr},
+    {"MOBILITY", MOBILITY, 7, "Per attacked square not covered by enemy pawns: [knight .. queen]"},
+    {"PASSED_PAWN", PASSED_PAWN, 8, "Passed pawns by rank counted from the pawn's own side (index 1 = starting rank)"},
+    {"DOUBLED_PAWN", &DOUBLED_PAWN, 1, nullptr},
+    {"ISOLATED_PAWN", &ISOLATED_PAWN, 1, nullptr},
+    {"BISHOP_PAIR", &BISHOP_PAIR, 1, nullptr},
+    {"ROOK_OPEN_FILE", &ROOK_OPEN_FILE, 1, nullptr},
+    {"ROOK_SEMI_OPEN_FILE", &ROOK_SEMI_OPEN_FILE, 1, nullptr},
+    {"TEMPO", &TEMPO, 1, nullptr}};
+
+#define EVAL_TABLES ((int)(sizeof(evalTables) / sizeof(evalTables[0])))
+
+// One side's running score; with a trace every weight added is also counted
+struct SideScore
+{
+    int value[2] = {0, 0};
+    EvalTrace *trace = nullptr;
+    int sign = 1; // Trace counts are white minus black
+};
+
+// Term index of a weight pair, found by address; only used while tracing
+static int TermIndex(const int weight[2])
+{
+    int first = 0;
+    for (int i = 0; i < EVAL_TABLES; i++)
+    {
+        uintptr_t offset = (uintptr_t)weight - (uintptr_t)evalTables[i].weights;
+        if (offset < sizeof(int[2]) * evalTables[i].size)
+            return first + (int)(offset / sizeof(int[2]));
+        first += evalTables[i].size;
+    }
+    abort();
+}
+
+static void Add(SideScore &score, const int weight[2], int count = 1)
+{
+    score.value[0] += weight[0] * count;
+    score.value[1] += weight[1] * count;
+    if (score.trace)
+        score.trace->counts[TermIndex(weight)] += score.sign * count;
+}
+
+static Bitboard PawnAttackSpan(Bitboard pawns, bool white)
+{
+    Bitboard attacks = 0;
+    while (pawns)
+        attacks |= PawnAttacks(PopLsb(pawns), white);
+    return attacks;
+}
+
+// Score of one side, added to score[] from that side's point of view
+static void EvaluateSide(const Position &pos, int us, SideScore &score)
+{
+    int them = us ^ 1;
+    bool white = us == 0;
+    Bitboard occupied = Occupied(pos);
+    Bitboard ourPawns = pos.pieces[us][PAWN];
+    Bitboard theirPawns = pos.pieces[them][PAWN];
+    Bitboard safe = ~pos.pieces[us][0] & ~PawnAttackSpan(theirPawns, !white);
+
+    for (int type = PAWN; type <= KING; type++)
+    {
+        Bitboard pieces = pos.pieces[us][type];
+        while (pieces)
+        {
+            int sq = PopLsb(pieces);
+            int tableSq = white ? sq : sq ^ 56;
+            Add(score, PIECE_VALUE[type]);
+            Add(score, pieceTables[type][tableSq]);
+
+            Bitboard attacks = 0;
+            switch (type)
+            {
+            case PAWN:
+            {
+                int col = SquareCol(sq);
+                if (!(passedMask[us][sq] & theirPawns))
+                    Add(score, PASSED_PAWN[white ? 7 - SquareRow(sq) : SquareRow(sq)]);
+                if (!(adjacentFiles[col] & ourPawns))
+                    Add(score, ISOLATED_PAWN);
+                if (passedMask[us][sq] & fileMask[col] & ourPawns)
+                    Add(score, DOUBLED_PAWN);
+                break;
+            }
+            case KNIGHT:
+                attacks = KnightAttacks(sq);
+                break;
+            case BISHOP:
+                attacks = BishopAttacks(sq, occupied);
+                break;
+            case ROOK:
+                attacks = RookAttacks(sq, occupied);
+                if (!(fileMask[SquareCol(sq)] & ourPawns))
+                    Add(score, (fileMask[SquareCol(sq)] & theirPawns) ? ROOK_SEMI_OPEN_FILE : ROOK_OPEN_FILE);
+                break;
+            case QUEEN:
+                attacks = BishopAttacks(sq, occupied) | RookAttacks(sq, occupied);
+                break;
+            }
+            if (attacks)
+                Add(score, MOBILITY[type], PopCount(attacks & safe));
+        }
+    }
+
+    if (PopCount(pos.pieces[us][BISHOP]) >= 2)
+        Add(score, BISHOP_PAIR);
+}
+
+static int EvaluatePosition(const Position &pos, EvalTrace *trace)
+{
+    SideScore white, black;
+    white.trace = black.trace = trace;
+    black.sign = -1;
+    EvaluateSide(pos, 0, white);
+    EvaluateSide(pos, 1, black);
+
+    int us = pos.whiteToMove ? 0 : 1;
+    int mg = (white.value[0] - black.value[0]) * (us == 0 ? 1 : -1) + TEMPO[0];
+    int eg = (white.value[1] - black.value[1]) * (us == 0 ? 1 : -1) + TEMPO[1];
+
+    int phase = 0;
+    for (int type = KNIGHT; type <= QUEEN; type++)
+        phase += phaseWeight[type] * PopCount(pos.pieces[0][type] | pos.pieces[1][type]);
+    if (phase > MAX_PHASE)
+        phase = MAX_PHASE;
+
+    if (trace)
+    {
+        trace->counts[TermIndex(TEMPO)] += us == 0 ? 1 : -1;
+        trace->phase = phase;
+    }
+    return (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE;
+}
+
+int Evaluate(const Position &pos)
+{
+    return EvaluatePosition(pos, nullptr);
+}
+
+int GetEvalTables(const EvalTable *&tables)
+{
+    tables = evalTables;
+    return EVAL_TABLES;
+}
+
+int EvalTermCount()
+{
+    int count = 0;
+    for (int i = 0; i < EVAL_TABLES; i++)
+        count += evalTables[i].size;
+    return count;
+}
+
+void TraceEvaluate(const Position &pos, EvalTrace &trace)
+{
+    trace.counts.assign(EvalTermCount(), 0);
+    EvaluatePosition(pos, &trace);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Position.h"
+#include <vector>
+
+#define MAX_PHASE 24 // Game phase with all minor and major pieces on the board
+
+// Static evaluation in centipawns from the side to move: material, piece-square
+// tables, mobility and pawn structure, blended between middlegame and endgame
+// weights (EvalParams.h) by the material left on the board.
+int Evaluate(const Position &pos);
+
+// For the tuner: the weight tables of EvalParams.h in file order. Every
+// {middlegame, endgame} pair gets a term index, its table's first index plus
+// its offset in the table.
+struct EvalTable
+{
+    const char *name;
+    const int (*weights)[2];
+    int size;            // Pairs; 1 = a plain [2] array
+    const char *comment; // Line written above the table, or nullptr
+};
+
+int GetEvalTables(const EvalTable *&tables); // Returns the table count
+int EvalTermCount();
+
+// The evaluation as a sum over terms: how often each weight pair was added,
+// white's count minus black's (the tempo term counts +1 for white to move).
+// Evaluate() from white's side is then the phase blend of the weighted sums.
+struct EvalTrace
+{
+    std::vector<int> counts; // Per term index
+    int phase = 0;           // 0 (pawn endgame) .. MAX_PHASE
+};
+
+void TraceEvaluate(const Position &pos, EvalTrace &trace);
@@ -1,11 +1,24 @@
 #include "raylib.h"
 #include <stdio.h>
+#include <math.h>
 #include <direct.h>
 #include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <vector>
 #include <fstream>
+#include "Position.h"
+#include "GameDatabase.h"
+#include "PolyglotBook.h"
+#include "Tablebase.h"
+#include "Syzygy.h"
+#include "GameState.h"
+#include "AssetLoader.h"
+#include "BoardFeed.h"
+#include "Profiler.h"
+#include "GameClock.h"
+#include "EnginePlayer.h"
+#include <thread>
 
 using namespace std;
 
@@ -19,51 +32,123 @@ typedef enum GameScreen
     PREVIOUS_GAME,
     GAME_SETTINGS,
     THEME_SETTINGS,
+    SPECTATOR_VIEW,
     EXIT
 } GameScreen;
 
-// Chess piece textures
-Texture2D whitePawn, whiteKnight, whiteBishop, whiteRook, whiteQueen, whiteKing;
-Texture2D blackPawn, blackKnight, blackBishop, blackRook, blackQueen, blackKing;
+// Chess piece textures: saare 12 pieces ek atlas me, board par jitne bade dikhte hain
+// utne hi scale karke, taaki saare pieces ek hi texture se ek batch me draw hon
+#define PIECE_SCALE 0.45f
+Texture2D pieceAtlas;
+Rectangle pieceRects[13]; // pieceRects[piece + 6], piece -6..6
 Texture2D backgroundImage;
 Texture2D boardTexture;
 Texture2D menuBackground;
 
-// Board themes
-vector<pair<string, Texture2D>> boardThemes;
+// Board themes: shuru me sirf naam aur path, texture pehli baar chune jaane par load hota hai
+struct BoardTheme
+{
+    string name;
+    const char *path;
+    Texture2D texture;
+    bool requested;
+};
+vector<BoardTheme> boardThemes;
 int currentBoardTheme = 0;
 
+// Images aur sounds worker threads par decode hote hain; texture aur sound
+// banana main thread par, UploadLoadedAssets me
+enum AssetId
+{
+    ASSET_MENU_BACKGROUND,
+    ASSET_BACKGROUND,
+    ASSET_SOUNDS,                     // 6 sounds, move se promotion tak
+    ASSET_PIECES = ASSET_SOUNDS + 6,  // 12 images, atlas ke order me
+    ASSET_THEMES = ASSET_PIECES + 12  // + theme index
+};
+AssetLoader assetLoader;
+Image pieceImages[12];
+int pieceImagesLoaded = 0;
+bool menuAssetsReady = false;
+int gameAssetsLeft = 13; // Background aur 12 pieces, inke bina board screen nahi khulta
+
 // Sounds
 Sound moveSound, captureSound, checkSound, castleSound, checkmateSound, promotionSound;
 Music menuMusic, gameMusic;
 
-// Game state variables
-int board[8][8] = {
-    {-4, -2, -3, -5, -6, -3, -2, -4},
-    {-1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 0, 0, 0, 0, 0, 0, 0},
-    {0, 0, 0, 0, 0, 0, 0, 0},
-    {0, 0, 0, 0, 0, 0, 0, 0},
-    {0, 0, 0, 0, 0, 0, 0, 0},
-    {1, 1, 1, 1, 1, 1, 1, 1},
-    {4, 2, 3, 5, 6, 3, 2, 4}};
-
-int selectedSquareRow = -1;
-int selectedSquareCol = -1;
-bool isWhiteTurn = true;
-int enPassantTargetRow = -1;
-int enPassantTargetCol = -1;
-bool whiteKingMoved = false;
-bool whiteRookKingsideMoved = false;
-bool whiteRookQueensideMoved = false;
-bool blackKingMoved = false;
-bool blackRookKingsideMoved = false;
-bool blackRookQueensideMoved = false;
-bool promotionActive = false;
-int promotionRow, promotionCol;
-bool isWhitePromoting;
-bool gameOver = false;
-bool promotionPending = false;
+// Game state: rules ka state pool me, selection sirf UI ka
+GameStatePool gameStates;
+uint64_t currentGameHandle = 0;
+GameState *game = nullptr;
+
+struct BoardSelection
+{
+    int row = -1;
+    int col = -1;
+};
+BoardSelection selection;
+
+// Legal moves sirf position badalne par dobara nikalte hain
+LegalMoveCache legalMoves = {};
+
+// Game clock: settings me chuna control agle game se lagta hai. Time frame ke
+// hisaab se nahi ghatta, har baar timer se nikalta hai, isliye drift nahi hota
+const ClockControl clockPresets[] = {
+    {"Off", CLOCK_OFF, 0, 0},
+    {"Bullet 1+0", CLOCK_FISCHER, 60000, 0},
+    {"Bullet 2+1", CLOCK_FISCHER, 120000, 1000},
+    {"Blitz 3+2", CLOCK_FISCHER, 180000, 2000},
+    {"Blitz 5 delay 3", CLOCK_DELAY, 300000, 3000},
+    {"Blitz 5 Bronstein 3", CLOCK_BRONSTEIN, 300000, 3000},
+    {"Rapid 10+5", CLOCK_FISCHER, 600000, 5000}};
+#define CLOCK_PRESET_COUNT (int)(sizeof(clockPresets) / sizeof(clockPresets[0]))
+#define CLOCK_TENTHS_BELOW 10000000000LL // Itne ns se kam bache to tenths dikhte hain
+int clockPreset = 0;
+GameClock gameClock;
+int64_t shownClock[2] = {-1, -1}; // Screen par dikhaya hua time; badle tabhi redraw
+
+// Engine opponent (Black) apne thread par search karta hai, UI uska intezaar nahi
+// karta. Apni chaal ke baad woh expected reply par ponder karta hai: wahi reply
+// aaye to wahi search chalta rehta hai, warna hash table garam milta hai
+#define ENGINE_HASH_MB 64
+#define ENGINE_MOVE_TIME 1000 // Clock band ho to har chaal par itne ms
+EnginePlayer enginePlayer;
+bool engineOpponent = false;
+bool enginePondering = true;
+vector<uint64_t> gameKeys; // Har chaal se pehle ki position, repetition ke liye
+
+// Analysis (coaching): engine ki top N lines board par arrows aur scores ke saath.
+// Saari lines ek hi multi-PV search me, ek hash table share karke; har iteration
+// ke baad nayi lines aati hain. Apna alag EnginePlayer, taaki khelne wale engine
+// se na takraye
+#define ANALYSIS_MAX_LINES 4
+EnginePlayer analysisPlayer;
+int analysisLines = 0;    // 0 = band
+uint64_t analysisKey = 0; // Kis position ka analysis chal raha hai
+uint32_t drawnAnalysisVersion = 0;
+
+// Event-driven redraw: kuch na badle to frame draw hi nahi hota, CPU idle rehta hai
+#define IDLE_WAIT (1.0 / 60.0) // Idle me itni der so kar input dekhte hain
+bool eventDrivenRedraw = true;
+int redrawFrames = 2;     // Itne frames aur draw karne hain
+GameState drawnState;     // Last frame me kaunsi position dikhayi thi
+int drawnScreen = -1;
+
+// Background aur board ek render texture me; theme ya window size badalne par hi dobara banta hai
+RenderTexture2D boardLayer = {};
+unsigned int boardLayerTheme = 0; // Layer kis theme texture se bani thi
+
+// Spectator grid (Game -watch live.txt): feed ke saare boards ek screen par. Grid
+// ek render texture me banta hai aur sirf wahi boards dobara bante hain jinka
+// version badla; har frame bas ek texture draw
+#define SPECTATOR_HEADER 30
+BoardFeed spectatorFeed;
+RenderTexture2D spectatorLayer = {};
+vector<uint32_t> spectatorDrawn; // Layer me har board ka kaunsa version hai, 0 = abhi bana hi nahi
+int spectatorColumns = 0;
+
+// Profiling overlay (F3) aur Chrome trace (F4 shuru / save); -DCHESS_PROFILE ke bina khaali
+bool showProfileOverlay = false;
 
 // Settings
 bool highlightLegalMoves = true;
@@ -72,26 +157,58 @@ float soundVolume = 1.0f;
 bool isMenuMusicPlaying = false;
 bool isGameMusicPlaying = false;
 
+// Game database (optional, opened from games.cdb if present)
+GameDatabase gameDatabase;
+uint64_t databaseStatsKey = 0;
+PositionStats databaseStats = {};
+
+// Opening book (optional, book.bin)
+PolyglotBook openingBook;
+uint64_t bookMovesKey = 0;
+BookMove bookMoves[5];
+int bookMoveCount = 0;
+
+// Endgame tablebases (optional, tablebases/*.ctb and Syzygy files in syzygy/)
+uint64_t tablebaseKey = 0;
+bool tablebaseFound = false;
+TablebaseResult tablebaseResult = {};
+bool syzygyFound = false;
+int syzygyWdl = 0;
+int syzygyDtz = 0;
+
 // Function declarations
 void ResetGame();
-void DrawChessBoard(bool isWhiteTurn);
-void DrawPieces(int board[8][8]);
+bool LoadSavedGame();
+void DrawChessBoard(const GameState &state);
+void DrawPieces(const GameState &state);
 void LoadResources();
+void BuildPieceAtlas();
+bool UploadLoadedAssets();
+void RequestBoardTheme(int theme);
+void DrawLoadingScreen();
 void UnloadResources();
-void HandlePieceMovement(int board[8][8], int row, int col, int possibleMoves[8][8]);
-void DrawValidMoves(int board[8][8], int piece, int row, int col);
-bool IsValidMove(int board[8][8], int piece, int startRow, int startCol, int endRow, int endCol, bool validateCheck = true);
-bool IsKingInCheck(int board[8][8], bool isWhite);
-bool IsCheckmate(int board[8][8], bool isWhite);
-bool WouldBeInCheck(int board[8][8], int piece, int startRow, int startCol, int endRow, int endCol, bool isWhite);
-bool CanCastle(int board[8][8], bool isWhite, bool kingside);
+void DrawValidMoves(int row, int col);
 void DrawPromotionMenu();
 void UpdateGame();
 void DrawGame();
-void SaveGameState();
-bool LoadGameState();
 void LoadBoardThemes();
 void UnloadBoardThemes();
+void DrawDatabaseStats();
+void DrawBookMoves();
+void DrawTablebaseResult();
+void RequestRedraw(int frames = 2);
+bool NeedsRedraw(int screen);
+void UpdateBoardLayer();
+void UpdateSpectatorLayer();
+void DrawProfileOverlay();
+bool UpdateGameClock(bool onBoard);
+double ClockWaitSeconds();
+void DrawGameClocks();
+bool IsEngineTurn();
+void RecordPosition();
+bool UpdateEngine(bool onBoard);
+bool UpdateAnalysis(bool onBoard);
+void DrawAnalysis();
 
 // Slider ka function
 float Clamp(float value, float min, float max)
@@ -105,173 +222,218 @@ float Clamp(float value, float min, float max)
 
 void ResetGame()
 {
-    // Board reset ka function
-    int newBoard[8][8] = {
-        {-4, -2, -3, -5, -6, -3, -2, -4},
-        {-1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0},
-        {1, 1, 1, 1, 1, 1, 1, 1},
-        {4, 2, 3, 5, 6, 3, 2, 4}};
-    memcpy(board, newBoard, sizeof(newBoard));
-
-    selectedSquareRow = -1;
-    selectedSquareCol = -1;
-    isWhiteTurn = true;
-    enPassantTargetRow = -1;
-    enPassantTargetCol = -1;
-    whiteKingMoved = false;
-    whiteRookKingsideMoved = false;
-    whiteRookQueensideMoved = false;
-    blackKingMoved = false;
-    blackRookKingsideMoved = false;
-    blackRookQueensideMoved = false;
-    promotionActive = false;
-    gameOver = false;
-    promotionPending = false;
+    // Purana game pool me wapas, naya wahi slot le lega
+    if (currentGameHandle)
+        DestroyGameState(gameStates, currentGameHandle);
+    game = CreateGameState(gameStates, currentGameHandle);
+
+    selection = BoardSelection();
+    ResetClock(gameClock, clockPresets[clockPreset], true);
+    ClearEnginePlayer(enginePlayer);
+    ClearEnginePlayer(analysisPlayer);
+    analysisKey = 0;
+    gameKeys.clear();
+}
+
+// Save file kharab ho to chalu game nahi bigadta
+bool LoadSavedGame()
+{
+    GameState loaded;
+    if (!LoadGameState(loaded, "saved_game.dat"))
+        return false;
+
+    ResetGame();
+    *game = loaded;
+    ResetClock(gameClock, clockPresets[clockPreset], IsWhiteTurn(loaded)); // Save file me clock nahi hota, poora time milta hai
+    return true;
 }
 
 void LoadBoardThemes()
 {
     UnloadBoardThemes();
 
-    boardThemes.push_back({"Classic", LoadTexture("assets/chessboard.png")});
-    boardThemes.push_back({"Wood", LoadTexture("assets/wood_chessboard.png")});
-    boardThemes.push_back({"Bubble Gum", LoadTexture("assets/bubblegum_chessboard.png")});
-    boardThemes.push_back({"Marble", LoadTexture("assets/marble_chessboard.png")});
-    boardThemes.push_back({"News Paper", LoadTexture("assets/newspaper_chessboard.png")});
-    boardThemes.push_back({"Ninja", LoadTexture("assets/Hello_chessboard.png")});
+    boardThemes.push_back({"Classic", "assets/chessboard.png", {}, false});
+    boardThemes.push_back({"Wood", "assets/wood_chessboard.png", {}, false});
+    boardThemes.push_back({"Bubble Gum", "assets/bubblegum_chessboard.png", {}, false});
+    boardThemes.push_back({"Marble", "assets/marble_chessboard.png", {}, false});
+    boardThemes.push_back({"News Paper", "assets/newspaper_chessboard.png", {}, false});
+    boardThemes.push_back({"Ninja", "assets/Hello_chessboard.png", {}, false});
 
     currentBoardTheme = 0; // Default
+    RequestBoardTheme(currentBoardTheme);
 }
 
 void UnloadBoardThemes()
 {
     for (auto &theme : boardThemes)
     {
-        UnloadTexture(theme.second);
+        if (theme.texture.id != 0)
+            UnloadTexture(theme.texture);
     }
     boardThemes.clear();
 }
 
-void SaveGameState()
+// Board bhi seedha BOARD_WIDTH x BOARD_HEIGHT par decode hota hai, draw karte waqt scaling nahi
+void RequestBoardTheme(int theme)
 {
-    FILE *file = fopen("saved_game.dat", "wb");
-    if (file)
+    if (boardThemes[theme].requested)
+        return;
+    boardThemes[theme].requested = true;
+    QueueImage(assetLoader, ASSET_THEMES + theme, boardThemes[theme].path, BOARD_WIDTH, BOARD_HEIGHT);
+}
+
+// 12 piece images ek texture me: upar white, neeche black, pawn se king tak.
+// Images workers pehle hi PIECE_SCALE par la chuke hain
+void BuildPieceAtlas()
+{
+    const int padding = 2; // Filtering me padosi piece na jhalke
+
+    int cellWidth = 1, cellHeight = 1;
+    for (int i = 0; i < 12; i++)
+    {
+        if (pieceImages[i].data)
+        {
+            cellWidth = max(cellWidth, pieceImages[i].width);
+            cellHeight = max(cellHeight, pieceImages[i].height);
+        }
+    }
+
+    Image atlas = GenImageColor(6 * (cellWidth + padding), 2 * (cellHeight + padding), BLANK);
+    memset(pieceRects, 0, sizeof(pieceRects));
+    for (int i = 0; i < 12; i++)
     {
-        fwrite(board, sizeof(int), 64, file);
-
-        fwrite(&isWhiteTurn, sizeof(bool), 1, file);
-        fwrite(&enPassantTargetRow, sizeof(int), 1, file);
-        fwrite(&enPassantTargetCol, sizeof(int), 1, file);
-        fwrite(&whiteKingMoved, sizeof(bool), 1, file);
-        fwrite(&whiteRookKingsideMoved, sizeof(bool), 1, file);
-        fwrite(&whiteRookQueensideMoved, sizeof(bool), 1, file);
-        fwrite(&blackKingMoved, sizeof(bool), 1, file);
-        fwrite(&blackRookKingsideMoved, sizeof(bool), 1, file);
-        fwrite(&blackRookQueensideMoved, sizeof(bool), 1, file);
-
-        fclose(file);
+        if (!pieceImages[i].data)
+            continue;
+        Rectangle cell = {(float)((i % 6) * (cellWidth + padding)), (float)((i / 6) * (cellHeight + padding)),
+                          (float)pieceImages[i].width, (float)pieceImages[i].height};
+        ImageDraw(&atlas, pieceImages[i], (Rectangle){0, 0, cell.width, cell.height}, cell, WHITE);
+        pieceRects[(i < 6 ? i % 6 + 1 : -(i % 6 + 1)) + 6] = cell;
+        UnloadImage(pieceImages[i]);
     }
+
+    pieceAtlas = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+    // Board par 1:1 hi draw hota hai; spectator grid chhote boards ke liye scale karta hai
+    SetTextureFilter(pieceAtlas, TEXTURE_FILTER_BILINEAR);
 }
 
-bool LoadGameState()
+// Jo decode ho chuka hai use GPU / audio device par; kuch naya aaya to true
+bool UploadLoadedAssets()
 {
-    FILE *file = fopen("saved_game.dat", "rb");
-    if (file)
+    Sound *sounds[6] = {&moveSound, &captureSound, &checkSound, &castleSound, &checkmateSound, &promotionSound};
+
+    bool uploaded = false;
+    AssetJob job;
+    while (TakeLoadedAsset(assetLoader, job))
     {
-        fread(board, sizeof(int), 64, file);
-        fread(&isWhiteTurn, sizeof(bool), 1, file);
-        fread(&enPassantTargetRow, sizeof(int), 1, file);
-        fread(&enPassantTargetCol, sizeof(int), 1, file);
-        fread(&whiteKingMoved, sizeof(bool), 1, file);
-        fread(&whiteRookKingsideMoved, sizeof(bool), 1, file);
-        fread(&whiteRookQueensideMoved, sizeof(bool), 1, file);
-        fread(&blackKingMoved, sizeof(bool), 1, file);
-        fread(&blackRookKingsideMoved, sizeof(bool), 1, file);
-        fread(&blackRookQueensideMoved, sizeof(bool), 1, file);
-
-        fclose(file);
-
-        selectedSquareRow = -1;
-        selectedSquareCol = -1;
-        promotionActive = false;
-        promotionPending = false;
-        gameOver = false;
-
-        return true;
+        uploaded = true;
+        if (job.id >= ASSET_THEMES)
+        {
+            boardThemes[job.id - ASSET_THEMES].texture = LoadTextureFromImage(job.image);
+            UnloadImage(job.image);
+        }
+        else if (job.id >= ASSET_PIECES)
+        {
+            pieceImages[job.id - ASSET_PIECES] = job.image;
+            if (++pieceImagesLoaded == 12)
+                BuildPieceAtlas();
+            gameAssetsLeft--;
+        }
+        else if (job.id >= ASSET_SOUNDS)
+        {
+            Sound *sound = sounds[job.id - ASSET_SOUNDS];
+            if (job.wave.data)
+            {
+                *sound = LoadSoundFromWave(job.wave);
+                SetSoundVolume(*sound, soundVolume);
+                UnloadWave(job.wave);
+            }
+        }
+        else
+        {
+            Texture2D &texture = job.id == ASSET_MENU_BACKGROUND ? menuBackground : backgroundImage;
+            texture = LoadTextureFromImage(job.image);
+            UnloadImage(job.image);
+            if (job.id == ASSET_MENU_BACKGROUND)
+                menuAssetsReady = true;
+            else
+                gameAssetsLeft--;
+        }
     }
-    return false;
+    return uploaded;
+}
+
+void DrawLoadingScreen()
+{
+    int taken, total;
+    GetAssetProgress(assetLoader, taken, total);
+    float progress = total ? (float)taken / total : 1.0f;
+
+    ClearBackground(BLACK);
+    int x = GetScreenWidth() / 2 - 200;
+    int y = GetScreenHeight() / 2;
+    DrawText("Loading...", x, y - 40, 20, WHITE);
+    DrawRectangle(x, y, 400, 20, DARKGRAY);
+    DrawRectangle(x, y, (int)(400 * progress), 20, GOLD);
+    DrawText(TextFormat("%d / %d", taken, total), x, y + 30, 20, LIGHTGRAY);
 }
 
+// Sirf queue karta hai; menu ka background sabse pehle, taaki menu jaldi khule
 void LoadResources()
 {
-    whitePawn = LoadTexture("assets/white_pawn.png");
-    whiteKnight = LoadTexture("assets/white_knight.png");
-    whiteBishop = LoadTexture("assets/white_bishop.png");
-    whiteRook = LoadTexture("assets/white_rook.png");
-    whiteQueen = LoadTexture("assets/white_queen.png");
-    whiteKing = LoadTexture("assets/white_king.png");
-
-    blackPawn = LoadTexture("assets/black_pawn.png");
-    blackKnight = LoadTexture("assets/black_knight.png");
-    blackBishop = LoadTexture("assets/black_bishop.png");
-    blackRook = LoadTexture("assets/black_rook.png");
-    blackQueen = LoadTexture("assets/black_queen.png");
-    blackKing = LoadTexture("assets/black_king.png");
-
-    backgroundImage = LoadTexture("assets/chess_background.png");
-    menuBackground = LoadTexture("assets/menuBackground.png");
+    StartAssetLoader(assetLoader);
+
+    QueueImage(assetLoader, ASSET_MENU_BACKGROUND, "assets/menuBackground.png");
+    QueueImage(assetLoader, ASSET_BACKGROUND, "assets/chess_background.png");
+
+    const char *names[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+    for (int i = 0; i < 12; i++)
+        QueueScaledImage(assetLoader, ASSET_PIECES + i, TextFormat("assets/%s_%s.png", i < 6 ? "white" : "black", names[i % 6]), PIECE_SCALE);
+
+    const char *soundFiles[6] = {"moveSound", "captureSound", "checkSound", "castleSound", "checkmateSound", "promotionSound"};
+    for (int i = 0; i < 6; i++)
+        QueueWave(assetLoader, ASSET_SOUNDS + i, TextFormat("assets/%s.mp3", soundFiles[i]));
 
     LoadBoardThemes();
 
     InitAudioDevice();
 
-    moveSound = LoadSound("assets/moveSound.mp3");
-    captureSound = LoadSound("assets/captureSound.mp3");
-    checkSound = LoadSound("assets/checkSound.mp3");
-    castleSound = LoadSound("assets/castleSound.mp3");
-    checkmateSound = LoadSound("assets/checkmateSound.mp3");
-    promotionSound = LoadSound("assets/promotionSound.mp3");
-
+    // Music stream karta hai, poora decode nahi hota; main thread par hi theek hai
     menuMusic = LoadMusicStream("assets/bkgmusic.mp3");
     gameMusic = LoadMusicStream("assets/soundeffect.mp3");
 
-    SetSoundVolume(moveSound, soundVolume);
-    SetSoundVolume(captureSound, soundVolume);
-    SetSoundVolume(checkSound, soundVolume);
-    SetSoundVolume(castleSound, soundVolume);
-    SetSoundVolume(checkmateSound, soundVolume);
-    SetSoundVolume(promotionSound, soundVolume);
-
     SetMusicVolume(menuMusic, musicVolume);
     SetMusicVolume(gameMusic, musicVolume);
 
     PlayMusicStream(menuMusic);
     isMenuMusicPlaying = true;
     isGameMusicPlaying = false;
+
+    OpenGameDatabase(gameDatabase, "games.cdb");
+    OpenPolyglotBook(openingBook, "book.bin");
+    SetTablebasePath("tablebases");
+    SetSyzygyPath("syzygy");
 }
 
 void UnloadResources()
 {
-    UnloadTexture(whitePawn);
-    UnloadTexture(whiteKnight);
-    UnloadTexture(whiteBishop);
-    UnloadTexture(whiteRook);
-    UnloadTexture(whiteQueen);
-    UnloadTexture(whiteKing);
-    UnloadTexture(blackPawn);
-    UnloadTexture(blackKnight);
-    UnloadTexture(blackBishop);
-    UnloadTexture(blackRook);
-    UnloadTexture(blackQueen);
-    UnloadTexture(blackKing);
+    StopAssetLoader(assetLoader);
+    for (int i = 0; i < 12 && pieceImagesLoaded < 12; i++)
+    {
+        if (pieceImages[i].data)
+            UnloadImage(pieceImages[i]);
+    }
+
+    UnloadTexture(pieceAtlas);
     UnloadTexture(backgroundImage);
     UnloadTexture(menuBackground);
 
     UnloadBoardThemes();
+    if (boardLayer.id != 0)
+        UnloadRenderTexture(boardLayer);
+    if (spectatorLayer.id != 0)
+        UnloadRenderTexture(spectatorLayer);
+    CloseBoardFeed(spectatorFeed);
 
     UnloadSound(moveSound);
     UnloadSound(captureSound);
@@ -286,16 +448,20 @@ void UnloadResources()
     StopMusicStream(gameMusic);
 
     CloseAudioDevice();
+
+    CloseGameDatabase(gameDatabase);
+    ClosePolyglotBook(openingBook);
 }
 
-void DrawChessBoard(bool isWhiteTurn)
+// Layer banane ke liye: theme, ya theme na mile to saade squares
+void DrawBoardSquares()
 {
     int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
     int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
 
-    if (!boardThemes.empty())
+    if (!boardThemes.empty() && boardThemes[currentBoardTheme].texture.id != 0)
     {
-        Texture2D currentBoard = boardThemes[currentBoardTheme].second;
+        Texture2D currentBoard = boardThemes[currentBoardTheme].texture;
         DrawTexturePro(
             currentBoard,
             (Rectangle){0, 0, (float)currentBoard.width, (float)currentBoard.height},
@@ -322,172 +488,79 @@ void DrawChessBoard(bool isWhiteTurn)
             }
         }
     }
+}
+
+void UpdateBoardLayer()
+{
+    PROFILE_SCOPE(ZONE_DRAW, "UpdateBoardLayer");
+    int width = GetScreenWidth();
+    int height = GetScreenHeight();
+    bool sizeChanged = boardLayer.texture.width != width || boardLayer.texture.height != height;
+    unsigned int theme = boardThemes.empty() ? 0 : boardThemes[currentBoardTheme].texture.id;
+    if (boardLayer.id != 0 && !sizeChanged && boardLayerTheme == theme)
+        return;
 
-    // King ke check ka highlight
-    if (IsKingInCheck(board, isWhiteTurn))
+    if (boardLayer.id == 0 || sizeChanged)
     {
-        int kingRow = -1, kingCol = -1;
-        int kingPiece = isWhiteTurn ? 6 : -6;
+        if (boardLayer.id != 0)
+            UnloadRenderTexture(boardLayer);
+        boardLayer = LoadRenderTexture(width, height);
+    }
 
-        // King ki position dhund ke check dega
-        for (int row = 0; row < 8; row++)
-        {
-            for (int col = 0; col < 8; col++)
-            {
-                if (board[row][col] == kingPiece)
-                {
-                    kingRow = row;
-                    kingCol = col;
-                    break;
-                }
-            }
-            if (kingRow != -1)
-                break;
-        }
+    BeginTextureMode(boardLayer);
+    ClearBackground(BLACK);
+    DrawTexturePro(backgroundImage,
+                   (Rectangle){0, 0, (float)backgroundImage.width, (float)backgroundImage.height},
+                   (Rectangle){0, 0, (float)width, (float)height},
+                   (Vector2){0, 0}, 0, WHITE);
+    DrawBoardSquares();
+    EndTextureMode();
+    boardLayerTheme = theme;
+}
 
-        if (kingRow != -1 && kingCol != -1)
-        {
-            DrawRectangle(kingCol * 62.5 + boardOffsetX, kingRow * 62.5 + boardOffsetY,
-                          62.5, 62.5, ColorAlpha(RED, 0.5f));
-        }
+// Background aur board layer se ek hi draw me, upar sirf state wali cheezein
+void DrawChessBoard(const GameState &state)
+{
+    int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+
+    // Render texture ulta store hota hai, isliye source height negative
+    DrawTextureRec(boardLayer.texture,
+                   (Rectangle){0, 0, (float)boardLayer.texture.width, -(float)boardLayer.texture.height},
+                   (Vector2){0, 0}, WHITE);
+
+    // King ke check ka highlight; state me pehle se rakha hai
+    int king = KingSquare(state, IsWhiteTurn(state));
+    if (IsInCheck(state) && king != -1)
+    {
+        DrawRectangle((king % 8) * 62.5 + boardOffsetX, (king / 8) * 62.5 + boardOffsetY,
+                      62.5, 62.5, ColorAlpha(RED, 0.5f));
     }
 }
 
-void DrawPieces(int board[8][8])
+void DrawPieces(const GameState &state)
 {
     const float squareSize = BOARD_WIDTH / 8.0f;
     int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
     int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
 
-    BeginBlendMode(BLEND_ALPHA);
-
+    // Sab ek hi texture se, to raylib ek hi draw call me bhej deta hai
     for (int row = 0; row < 8; row++)
     {
         for (int col = 0; col < 8; col++)
         {
-            int piece = board[row][col];
+            int piece = PieceAt(state, row, col);
             if (piece == 0)
                 continue;
 
-            Texture2D *pieceTexture = nullptr;
-            switch (piece)
-            {
-            case 1:
-                pieceTexture = &whitePawn;
-                break;
-            case 2:
-                pieceTexture = &whiteKnight;
-                break;
-            case 3:
-                pieceTexture = &whiteBishop;
-                break;
-            case 4:
-                pieceTexture = &whiteRook;
-                break;
-            case 5:
-                pieceTexture = &whiteQueen;
-                break;
-            case 6:
-                pieceTexture = &whiteKing;
-                break;
-            case -1:
-                pieceTexture = &blackPawn;
-                break;
-            case -2:
-                pieceTexture = &blackKnight;
-                break;
-            case -3:
-                pieceTexture = &blackBishop;
-                break;
-            case -4:
-                pieceTexture = &blackRook;
-                break;
-            case -5:
-                pieceTexture = &blackQueen;
-                break;
-            case -6:
-                pieceTexture = &blackKing;
-                break;
-            default:
-                pieceTexture = nullptr;
-                break;
-            }
-
-            if (pieceTexture)
-            {
-                float x = boardOffsetX + col * squareSize + (squareSize - pieceTexture->width * 0.45f) / 2;
-                float y = boardOffsetY + row * squareSize + (squareSize - pieceTexture->height * 0.45f) / 2;
-
-                float scale = 0.45f;
+            const Rectangle &source = pieceRects[piece + 6];
+            float x = boardOffsetX + col * squareSize + (squareSize - source.width) / 2;
+            float y = boardOffsetY + row * squareSize + (squareSize - source.height) / 2;
 
-                DrawTextureEx(*pieceTexture, (Vector2){x, y}, 0.0f, scale, WHITE);
-            }
+            // Poore pixel par, taaki 1:1 texture dhundhla na ho
+            DrawTextureRec(pieceAtlas, source, (Vector2){(float)(int)x, (float)(int)y}, WHITE);
         }
     }
-
-    EndBlendMode();
-}
-
-bool WouldBeInCheck(int board[8][8], int piece, int startRow, int startCol, int endRow, int endCol, bool isWhite)
-{
-    int tempBoard[8][8];
-    memcpy(tempBoard, board, sizeof(int) * 8 * 8);
-
-    tempBoard[endRow][endCol] = piece;
-    tempBoard[startRow][startCol] = 0;
-
-    return IsKingInCheck(tempBoard, isWhite);
-}
-
-bool CanCastle(int board[8][8], bool isWhite, bool kingside)
-{
-    int row = isWhite ? 7 : 0;
-    int kingCol = 4;
-    int rookCol = kingside ? 7 : 0;
-    int step = kingside ? 1 : -1;
-
-    // Agar king aur rook move kare to castling not possible
-    if (isWhite)
-    {
-        if (whiteKingMoved)
-            return false;
-        if (kingside && whiteRookKingsideMoved)
-            return false;
-        if (!kingside && whiteRookQueensideMoved)
-            return false;
-    }
-    else
-    {
-        if (blackKingMoved)
-            return false;
-        if (kingside && blackRookKingsideMoved)
-            return false;
-        if (!kingside && blackRookQueensideMoved)
-            return false;
-    }
-
-    // Agar beech ki grid khaali hai tabhi castle hoga
-    for (int col = kingCol + step; col != rookCol; col += step)
-    {
-        if (board[row][col] != 0)
-            return false;
-    }
-
-    // King check me to nahi hai
-    for (int col = kingCol; col != kingCol + 2 * step; col += step)
-    {
-        int tempBoard[8][8];
-        memcpy(tempBoard, board, sizeof(int) * 8 * 8);
-        tempBoard[row][col] = isWhite ? 6 : -6;
-        tempBoard[row][kingCol] = 0;
-
-        if (IsKingInCheck(tempBoard, isWhite))
-        {
-            return false;
-        }
-    }
-
-    return true;
 }
 
 void DrawPromotionMenu()
@@ -504,11 +577,8 @@ void DrawPromotionMenu()
     float menuY = boardOffsetY + (BOARD_HEIGHT - menuHeight - 10) / 2;
     DrawRectangle(menuX, menuY, menuWidth, menuHeight, LIGHTGRAY);
 
-    Texture2D *pieces[4] = {
-        isWhitePromoting ? &whiteQueen : &blackQueen,
-        isWhitePromoting ? &whiteRook : &blackRook,
-        isWhitePromoting ? &whiteBishop : &blackBishop,
-        isWhitePromoting ? &whiteKnight : &blackKnight};
+    bool whitePromoting = HasGameFlag(*game, GAME_WHITE_PROMOTING);
+    int pieces[4] = {5, 4, 3, 2};
 
     const char *labels[4] = {"Q", "R", "B", "K"};
 
@@ -520,7 +590,11 @@ void DrawPromotionMenu()
         Vector2 mousePos = GetMousePosition();
         Color btnColor = CheckCollisionPointRec(mousePos, (Rectangle){btnX, btnY, 50, 50}) ? LIGHTGRAY : WHITE;
         DrawRectangle(btnX, btnY, 50, 50, btnColor);
-        DrawTextureEx(*pieces[i], (Vector2){btnX, btnY}, 0, 0.35f, WHITE);
+        // Atlas pieces 0.45 par hain, menu me 0.35 chahiye
+        const Rectangle &source = pieceRects[(whitePromoting ? pieces[i] : -pieces[i]) + 6];
+        float scale = 0.35f / PIECE_SCALE;
+        DrawTexturePro(pieceAtlas, source, (Rectangle){btnX, btnY, source.width * scale, source.height * scale},
+                       (Vector2){0, 0}, 0, WHITE);
         DrawText(labels[i], btnX, btnY, 10, BLACK);
 
         if (btnColor.g == LIGHTGRAY.g)
@@ -530,715 +604,728 @@ void DrawPromotionMenu()
     }
 }
 
-bool IsValidMove(int board[8][8], int piece, int startRow, int startCol, int endRow, int endCol, bool validateCheck)
+void DrawValidMoves(int row, int col)
 {
-    if (endRow < 0 || endRow >= 8 || endCol < 0 || endCol >= 8)
-    {
-        return false;
-    }
-
-    // Apna piece capture nahi kar sakte
-    if (board[endRow][endCol] != 0 && (board[endRow][endCol] * piece > 0))
-    {
-        return false;
-    }
+    if (!highlightLegalMoves)
+        return;
 
-    int rowDiff = endRow - startRow;
-    int colDiff = endCol - startCol;
+    int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
 
-    switch (abs(piece))
+    Color transparentGreen = {200, 200, 200, 128};
+    Bitboard destinations = legalMoves.destinations[row * 8 + col];
+    while (destinations)
     {
-    case 1:
-    { // Pawn
-        int direction = (piece > 0) ? -1 : 1;
+        int sq = PopLsb(destinations);
+        DrawRectangle((sq % 8) * 62.5 + boardOffsetX, (sq / 8) * 62.5 + boardOffsetY, 62.5, 62.5, transparentGreen);
+    }
+}
 
-        // Normal move forward
-        if (colDiff == 0 && rowDiff == direction && board[endRow][endCol] == 0)
-        {
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
+void UpdateGame()
+{
+    PROFILE_SCOPE(ZONE_UPDATE, "UpdateGame");
+    int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+    GameState &state = *game;
+    UpdateLegalMoveCache(legalMoves, state);
 
-        // Double move from starting position
-        if (colDiff == 0 && rowDiff == 2 * direction &&
-            ((piece == 1 && startRow == 6) || (piece == -1 && startRow == 1)) &&
-            board[startRow + direction][startCol] == 0 &&
-            board[endRow][endCol] == 0)
-        {
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
+    // Time khatam ho ya engine ki baari ho to board par click nahi chalta
+    if (gameClock.flagged != -1 || IsEngineTurn())
+        return;
 
-        // Capture diagonally
-        if (abs(colDiff) == 1 && rowDiff == direction && board[endRow][endCol] * piece < 0)
-        {
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+    {
+        Vector2 mousePos = GetMousePosition();
 
-        // En passant
-        if (abs(colDiff) == 1 && rowDiff == direction &&
-            endRow == enPassantTargetRow && endCol == enPassantTargetCol)
+        if (mousePos.x >= boardOffsetX && mousePos.x < boardOffsetX + BOARD_WIDTH &&
+            mousePos.y >= boardOffsetY && mousePos.y < boardOffsetY + BOARD_HEIGHT)
         {
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
 
-        break;
-    }
-    case 2:
-    { // Knight
-        if ((abs(rowDiff) == 2 && abs(colDiff) == 1) || (abs(rowDiff) == 1 && abs(colDiff) == 2))
-        {
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
-        break;
-    }
-    case 3:
-    { // Bishop
-        if (abs(rowDiff) == abs(colDiff))
-        {
-            int stepRow = rowDiff > 0 ? 1 : -1;
-            int stepCol = colDiff > 0 ? 1 : -1;
+            int row = (mousePos.y - boardOffsetY) / 62.5;
+            int col = (mousePos.x - boardOffsetX) / 62.5;
+            int clicked = PieceAt(state, row, col);
 
-            for (int i = 1; i < abs(rowDiff); i++)
+            // Piece select karne ki condition
+            if (selection.row == -1 && selection.col == -1)
             {
-                if (board[startRow + i * stepRow][startCol + i * stepCol] != 0)
+                if ((IsWhiteTurn(state) && clicked > 0) || (!IsWhiteTurn(state) && clicked < 0))
                 {
-                    return false;
+                    selection.row = row;
+                    selection.col = col;
                 }
             }
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
+            // Piece select kia to move karne ki condition
+            else
             {
-                return false;
-            }
-            return true;
-        }
-        break;
-    }
-    case 4:
-    { // Rook
-        if (rowDiff == 0 || colDiff == 0)
-        {
-            int stepRow = (rowDiff == 0) ? 0 : (rowDiff > 0 ? 1 : -1);
-            int stepCol = (colDiff == 0) ? 0 : (colDiff > 0 ? 1 : -1);
+                int piece = PieceAt(state, selection.row, selection.col);
 
-            for (int i = 1; i < max(abs(rowDiff), abs(colDiff)); i++)
-            {
-                if (board[startRow + i * stepRow][startCol + i * stepCol] != 0)
+                // Check if we're clicking on another piece of the same color
+                if (clicked != 0 && clicked * piece > 0)
                 {
-                    return false;
+                    // Select the new piece instead
+                    selection.row = row;
+                    selection.col = col;
                 }
-            }
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
-        break;
-    }
-    case 5:
-    { // Queen
-        if (abs(rowDiff) == abs(colDiff))
-        {
-            int stepRow = rowDiff > 0 ? 1 : -1;
-            int stepCol = colDiff > 0 ? 1 : -1;
-
-            for (int i = 1; i < abs(rowDiff); i++)
-            {
-                if (board[startRow + i * stepRow][startCol + i * stepCol] != 0)
+                else
                 {
-                    return false;
-                }
-            }
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
-        if (rowDiff == 0 || colDiff == 0)
-        {
-            int stepRow = (rowDiff == 0) ? 0 : (rowDiff > 0 ? 1 : -1);
-            int stepCol = (colDiff == 0) ? 0 : (colDiff > 0 ? 1 : -1);
+                    // Attempt to make a move
+                    if (IsCachedLegalMove(legalMoves, selection.row, selection.col, row, col))
+                    {
+                        RecordPosition();
+                        int effects = ApplyGameMove(state, selection.row, selection.col, row, col);
+                        // Promotion me clock piece chunne ke baad dabta hai
+                        if (!(effects & MOVE_PROMOTION))
+                            PressClock(gameClock, IsWhiteTurn(state), ClockNow());
 
-            for (int i = 1; i < max(abs(rowDiff), abs(colDiff)); i++)
-            {
-                if (board[startRow + i * stepRow][startCol + i * stepCol] != 0)
-                {
-                    return false;
+                        // Play sounds
+                        if (effects & MOVE_CAPTURE)
+                            PlaySound(captureSound);
+                        else
+                            PlaySound((effects & MOVE_CASTLE) ? castleSound : moveSound);
+                        if (effects & MOVE_CHECK)
+                            PlaySound(checkSound);
+                        if (effects & MOVE_CHECKMATE)
+                            PlaySound(checkmateSound);
+                    }
+                    selection = BoardSelection();
                 }
             }
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
         }
-        break;
     }
-    case 6:
-    { // King
-        // Normal king move
-        if ((abs(rowDiff) <= 1 && abs(colDiff) <= 1))
-        {
-            if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-            {
-                return false;
-            }
-            return true;
-        }
 
-        // Castling
-        if (abs(colDiff) == 2 && rowDiff == 0)
+    // Handle promotion selection
+    if (HasGameFlag(state, GAME_PROMOTION_PENDING) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+    {
+        int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
+        int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+
+        float menuWidth = 250;
+        float menuHeight = 80;
+        float menuX = boardOffsetX + (BOARD_WIDTH - menuWidth) / 2;
+        float menuY = boardOffsetY + (BOARD_HEIGHT - menuHeight - 10) / 2;
+
+        Vector2 mousePos = GetMousePosition();
+
+        for (int i = 0; i < 4; i++)
         {
-            bool kingside = colDiff > 0;
-            bool isWhite = piece > 0;
+            float btnX = menuX + 20 + i * 55;
+            float btnY = menuY + 20;
 
-            if (CanCastle(board, isWhite, kingside))
+            if (CheckCollisionPointRec(mousePos, (Rectangle){btnX, btnY, 50, 50}))
             {
-                if (validateCheck && WouldBeInCheck(board, piece, startRow, startCol, endRow, endCol, piece > 0))
-                {
-                    return false;
-                }
-                return true;
+                int effects = ApplyPromotion(state, i);
+                PressClock(gameClock, IsWhiteTurn(state), ClockNow());
+                PlaySound(promotionSound);
+                if (effects & MOVE_CHECK)
+                    PlaySound(checkSound);
+                if (effects & MOVE_CHECKMATE)
+                    PlaySound(checkmateSound);
+                break;
             }
         }
-        break;
-    }
     }
-
-    return false;
 }
 
-void HandlePieceMovement(int board[8][8], int row, int col, int possibleMoves[8][8])
+void DrawDatabaseStats()
 {
-    int piece = board[row][col];
-    if (piece == 0)
+    if (!IsGameDatabaseOpen(gameDatabase) || HasGameFlag(*game, GAME_PROMOTION_PENDING))
         return;
 
-    for (int r = 0; r < 8; r++)
+    // Lookup sirf tab jab position badle
+    Position pos;
+    GetGamePosition(*game, pos);
+    if (pos.key != databaseStatsKey)
     {
-        for (int c = 0; c < 8; c++)
-        {
-            possibleMoves[r][c] = 0;
-        }
+        databaseStats = GetPositionStats(gameDatabase, pos.key);
+        databaseStatsKey = pos.key;
     }
 
-    auto isValid = [](int r, int c)
-    {
-        return r >= 0 && r < 8 && c >= 0 && c < 8;
-    };
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+    int x = 40;
+    int y = boardOffsetY;
+
+    DrawRectangle(x - 10, y - 10, 220, 150, ColorAlpha(BLACK, 0.6f));
+    DrawText("Database", x, y, 20, GOLD);
+    DrawText(TextFormat("Games: %u", databaseStats.games), x, y + 30, 20, WHITE);
 
-    switch (abs(piece))
+    if (databaseStats.games > 0)
     {
-    case 1:
-    { // Pawn
-        int direction = (piece > 0) ? -1 : 1;
+        float total = (float)databaseStats.games;
+        DrawText(TextFormat("White: %.1f%%", 100.0f * databaseStats.whiteWins / total), x, y + 60, 20, WHITE);
+        DrawText(TextFormat("Draw:  %.1f%%", 100.0f * databaseStats.draws / total), x, y + 85, 20, LIGHTGRAY);
+        DrawText(TextFormat("Black: %.1f%%", 100.0f * databaseStats.blackWins / total), x, y + 110, 20, GRAY);
+    }
+}
 
-        // Single move forward
-        if (isValid(row + direction, col) && board[row + direction][col] == 0)
-        {
-            if (IsValidMove(board, piece, row, col, row + direction, col))
-            {
-                possibleMoves[row + direction][col] = 1;
-            }
-        }
+void DrawBookMoves()
+{
+    if (!IsPolyglotBookOpen(openingBook) || HasGameFlag(*game, GAME_PROMOTION_PENDING))
+        return;
 
-        // Double move from starting position
-        if (((piece == 1 && row == 6) || (piece == -1 && row == 1)) &&
-            isValid(row + 2 * direction, col) && board[row + 2 * direction][col] == 0 &&
-            board[row + direction][col] == 0)
-        {
-            if (IsValidMove(board, piece, row, col, row + 2 * direction, col))
-            {
-                possibleMoves[row + 2 * direction][col] = 1;
-            }
-        }
+    Position pos;
+    GetGamePosition(*game, pos);
+    if (pos.key != bookMovesKey)
+    {
+        bookMoveCount = ProbeBook(openingBook, pos, bookMoves, 5);
+        bookMovesKey = pos.key;
+    }
+    if (bookMoveCount == 0)
+        return;
 
-        // Capturing diagonally
-        if (isValid(row + direction, col - 1) && board[row + direction][col - 1] * piece < 0)
-        {
-            if (IsValidMove(board, piece, row, col, row + direction, col - 1))
-            {
-                possibleMoves[row + direction][col - 1] = 1;
-            }
-        }
-        if (isValid(row + direction, col + 1) && board[row + direction][col + 1] * piece < 0)
-        {
-            if (IsValidMove(board, piece, row, col, row + direction, col + 1))
-            {
-                possibleMoves[row + direction][col + 1] = 1;
-            }
-        }
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+    int x = 40;
+    int y = boardOffsetY + 170;
 
-        // En passant
-        if (enPassantTargetRow != -1)
-        {
-            if (abs(col - enPassantTargetCol) == 1 && row + direction == enPassantTargetRow)
-            {
-                if (IsValidMove(board, piece, row, col, enPassantTargetRow, enPassantTargetCol))
-                {
-                    possibleMoves[enPassantTargetRow][enPassantTargetCol] = 1;
-                }
-            }
-        }
-        break;
+    unsigned totalWeight = 0;
+    for (int i = 0; i < bookMoveCount; i++)
+        totalWeight += bookMoves[i].weight;
+
+    DrawRectangle(x - 10, y - 10, 220, 45 + bookMoveCount * 25, ColorAlpha(BLACK, 0.6f));
+    DrawText("Book", x, y, 20, GOLD);
+    for (int i = 0; i < bookMoveCount; i++)
+    {
+        float share = totalWeight ? 100.0f * bookMoves[i].weight / totalWeight : 0.0f;
+        DrawText(TextFormat("%-8s %.0f%%", MoveToSan(pos, bookMoves[i].move).c_str(), share), x, y + 30 + i * 25, 20, WHITE);
     }
-    case 2:
-    { // Knight
-        int moves[8][2] = {
-            {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+}
 
-        for (auto &move : moves)
-        {
-            int r = row + move[0], c = col + move[1];
-            if (isValid(r, c) && board[r][c] * piece <= 0)
-            {
-                if (IsValidMove(board, piece, row, col, r, c))
-                {
-                    possibleMoves[r][c] = 1;
-                }
-            }
-        }
-        break;
+void DrawTablebaseResult()
+{
+    if ((TablebasePieceLimit() == 0 && SyzygyPieceLimit() == 0) || HasGameFlag(*game, GAME_PROMOTION_PENDING))
+        return;
+
+    Position pos;
+    GetGamePosition(*game, pos);
+    if (pos.key != tablebaseKey)
+    {
+        // Apne tables mate tak ki doori dete hain, Syzygy sirf result aur DTZ
+        tablebaseFound = ProbeTablebase(pos, tablebaseResult);
+        syzygyFound = !tablebaseFound && ProbeSyzygyWdl(pos, syzygyWdl);
+        if (syzygyFound && !ProbeSyzygyDtz(pos, syzygyDtz))
+            syzygyDtz = 0;
+        tablebaseKey = pos.key;
     }
-    case 3: // Bishop
-    case 4:
-    { // Rook
-        int directions[8][2] = {
-            {-1, -1}, {-1, 1}, {1, -1}, {1, 1}, // Bishop
-            {-1, 0},
-            {1, 0},
-            {0, -1},
-            {0, 1} // Rook
-        };
-
-        int maxSteps = (abs(piece) == 3) ? 4 : 8; // Limit directions for bishop and rook
-        for (int i = 0; i < maxSteps; i++)
-        {
-            int stepRow = directions[i][0], stepCol = directions[i][1];
-            for (int dist = 1; dist < 8; dist++)
-            {
-                int r = row + dist * stepRow, c = col + dist * stepCol;
-                if (!isValid(r, c) || (board[r][c] != 0 && board[r][c] * piece > 0))
-                    break;
+    if (!tablebaseFound && !syzygyFound)
+        return;
 
-                if (IsValidMove(board, piece, row, col, r, c))
-                {
-                    possibleMoves[r][c] = 1;
-                }
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+    int x = 40;
+    int y = boardOffsetY + BOARD_HEIGHT - 60;
 
-                if (board[r][c] * piece < 0)
-                    break;
-            }
-        }
-        break;
+    // Result side to move ke hisaab se hota hai
+    const char *text = "Draw";
+    if (tablebaseFound && tablebaseResult.wdl != 0)
+    {
+        bool whiteWins = (tablebaseResult.wdl > 0) == pos.whiteToMove;
+        text = TextFormat("%s mates in %d", whiteWins ? "White" : "Black", (tablebaseResult.plies + 1) / 2);
+    }
+    else if (syzygyFound && (syzygyWdl == SYZYGY_CURSED_WIN || syzygyWdl == SYZYGY_BLESSED_LOSS))
+        text = "Draw (50-move rule)";
+    else if (syzygyFound && syzygyWdl != SYZYGY_DRAW)
+    {
+        bool whiteWins = (syzygyWdl > 0) == pos.whiteToMove;
+        text = TextFormat("%s wins, DTZ %d", whiteWins ? "White" : "Black", abs(syzygyDtz));
     }
-    case 5:
-    { // Queen
-        int directions[8][2] = {
-            {-1, -1}, {-1, 1}, {1, -1}, {1, 1}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}};
 
-        for (auto &dir : directions)
-        {
-            for (int dist = 1; dist < 8; dist++)
-            {
-                int r = row + dist * dir[0], c = col + dist * dir[1];
-                if (!isValid(r, c) || (board[r][c] != 0 && board[r][c] * piece > 0))
-                    break;
+    DrawRectangle(x - 10, y - 10, 220, 70, ColorAlpha(BLACK, 0.6f));
+    DrawText("Tablebase", x, y, 20, GOLD);
+    DrawText(text, x, y + 30, 20, WHITE);
+}
 
-                if (IsValidMove(board, piece, row, col, r, c))
-                {
-                    possibleMoves[r][c] = 1;
-                }
+void DrawGame()
+{
+    PROFILE_SCOPE(ZONE_DRAW, "DrawGame");
+    // Background DrawChessBoard ki layer me hi aa jata hai
+    UpdateLegalMoveCache(legalMoves, *game);
+    DrawChessBoard(*game);
+    DrawPieces(*game);
+    DrawDatabaseStats();
+    DrawBookMoves();
+    DrawTablebaseResult();
+    DrawGameClocks();
+
+    DrawAnalysis();
+    if (IsEngineTurn())
+        DrawText("Engine thinking...", (GetScreenWidth() + BOARD_WIDTH) / 2 + 20, (GetScreenHeight() - BOARD_HEIGHT) / 2 + 70, 20, LIGHTGRAY);
+
+    if (selection.row != -1 && selection.col != -1)
+    {
+        DrawValidMoves(selection.row, selection.col);
+    }
 
-                if (board[r][c] * piece < 0)
-                    break;
-            }
-        }
-        break;
+    if (HasGameFlag(*game, GAME_PROMOTION_PENDING))
+    {
+        DrawPromotionMenu();
     }
-    case 6:
-    { // King
-        int moves[8][2] = {
-            {-1, -1}, {-1, 1}, {1, -1}, {1, 1}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}};
 
-        for (auto &move : moves)
-        {
-            int r = row + move[0], c = col + move[1];
-            if (isValid(r, c) && board[r][c] * piece <= 0)
-            {
-                if (IsValidMove(board, piece, row, col, r, c))
-                {
-                    possibleMoves[r][c] = 1;
-                }
-            }
-        }
+    if (gameClock.flagged != -1)
+    {
+        const char *text = gameClock.flagged == 0 ? "White flagged! Black wins on time." : "Black flagged! White wins on time.";
+        DrawText(text, GetScreenWidth() / 2 - MeasureText(text, 30) / 2, GetScreenHeight() / 2 - 20, 30, RED);
+    }
+    else if (HasGameFlag(*game, GAME_OVER))
+    {
+        DrawText("Checkmate! Game Over.", GetScreenWidth() / 2 - 150, GetScreenHeight() / 2 - 20, 30, RED);
+    }
+}
 
-        // Castling moves
-        bool isWhite = piece > 0;
-        if (!(isWhite ? whiteKingMoved : blackKingMoved))
-        {
-            // Kingside
-            if (CanCastle(board, isWhite, true))
-            {
-                possibleMoves[row][col + 2] = 1;
-            }
-            // Queenside
-            if (CanCastle(board, isWhite, false))
-            {
-                possibleMoves[row][col - 2] = 1;
-            }
-        }
-        break;
+// Clock ka text: 10 second se upar m:ss, neeche s.t; dono upar ki taraf round,
+// taaki 0.0 tabhi dikhe jab flag gire
+int64_t ClockDisplayValue(int64_t ns)
+{
+    int64_t tenths = (ns + 99999999) / 100000000;
+    return ns < CLOCK_TENTHS_BELOW ? tenths : (tenths + 9) / 10 * 10;
+}
+
+// Har loop me, draw ho ya na ho: clock chalana/rokna aur flag girna yahin dekha jata hai.
+// true jab screen par dikhne wala time badla
+bool UpdateGameClock(bool onBoard)
+{
+    if (gameClock.control.mode == CLOCK_OFF)
+        return false;
+
+    // Board screen se bahar ya game khatam ho to clock ruka rehta hai
+    int64_t now = ClockNow();
+    if (onBoard && !HasGameFlag(*game, GAME_OVER))
+        StartClock(gameClock, now);
+    else
+        PauseClock(gameClock, now);
+
+    if (CheckFlagFall(gameClock, now))
+    {
+        SetGameFlag(*game, GAME_OVER, true);
+        selection = BoardSelection();
+        PlaySound(checkmateSound);
     }
+
+    bool changed = false;
+    for (int side = 0; side < 2; side++)
+    {
+        int64_t value = ClockDisplayValue(ClockRemainingNs(gameClock, side == 0, now));
+        changed |= value != shownClock[side];
+        shownClock[side] = value;
     }
+    return changed;
 }
 
-void DrawValidMoves(int board[8][8], int piece, int row, int col)
+// Idle me itna hi soyen ki agla tick ya flag der se na dikhe
+double ClockWaitSeconds()
 {
-    if (!highlightLegalMoves)
+    int64_t now = ClockNow();
+    int64_t remaining = ClockRemainingNs(gameClock, gameClock.side == 0, now);
+    int64_t next = ClockNextTickNs(gameClock, now, remaining <= CLOCK_TENTHS_BELOW ? 100000000 : 1000000000);
+    return next < 0 ? IDLE_WAIT : min(IDLE_WAIT, next / 1e9);
+}
+
+void DrawGameClocks()
+{
+    if (gameClock.control.mode == CLOCK_OFF)
         return;
 
-    int possibleMoves[8][8] = {0};
     int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
     int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
-    HandlePieceMovement(board, row, col, possibleMoves);
+    int x = boardOffsetX + BOARD_WIDTH + 30;
+    int64_t now = ClockNow();
 
-    Color transparentGreen = {200, 200, 200, 128};
-    for (int r = 0; r < 8; r++)
+    // Black upar, white neeche, jaise board par
+    for (int side = 0; side < 2; side++)
     {
-        for (int c = 0; c < 8; c++)
-        {
-            if (possibleMoves[r][c] == 1)
-            {
-                DrawRectangle(c * 62.5 + boardOffsetX, r * 62.5 + boardOffsetY, 62.5, 62.5, transparentGreen);
-            }
-        }
+        int y = side == 0 ? boardOffsetY + BOARD_HEIGHT - 50 : boardOffsetY;
+        int64_t value = ClockDisplayValue(ClockRemainingNs(gameClock, side == 0, now));
+        const char *text = value < CLOCK_TENTHS_BELOW / 100000000
+                               ? TextFormat("%d.%d", (int)(value / 10), (int)(value % 10))
+                               : TextFormat("%d:%02d", (int)(value / 600), (int)(value / 10 % 60));
+        bool toMove = gameClock.side == side && gameClock.flagged == -1;
+        Color color = gameClock.flagged == side || value < CLOCK_TENTHS_BELOW / 100000000 ? RED : toMove ? WHITE : GRAY;
+
+        DrawRectangle(x - 10, y, 160, 50, ColorAlpha(BLACK, 0.6f));
+        if (toMove)
+            DrawRectangleLines(x - 10, y, 160, 50, GOLD);
+        DrawText(text, x, y + 10, 30, color);
     }
+    DrawText(gameClock.control.name, x, boardOffsetY + BOARD_HEIGHT / 2 - 10, 20, LIGHTGRAY);
 }
 
-bool IsKingInCheck(int board[8][8], bool isWhite)
+bool IsEngineTurn()
 {
-    int kingRow = -1, kingCol = -1;
-    int kingPiece = isWhite ? 6 : -6;
+    return engineOpponent && !IsWhiteTurn(*game) && !HasGameFlag(*game, GAME_OVER) &&
+           !HasGameFlag(*game, GAME_PROMOTION_PENDING) && gameClock.flagged == -1;
+}
 
-    for (int row = 0; row < 8; row++)
+// Chaal chalne se pehle: abhi ki position history me
+void RecordPosition()
+{
+    Position pos;
+    GetGamePosition(*game, pos);
+    gameKeys.push_back(pos.key);
+}
+
+// Clock chalu ho to engine apna time khud baant-ta hai, warna fixed time
+SearchLimits EngineLimits()
+{
+    SearchLimits limits;
+    if (gameClock.control.mode == CLOCK_OFF)
     {
-        for (int col = 0; col < 8; col++)
-        {
-            if (board[row][col] == kingPiece)
-            {
-                kingRow = row;
-                kingCol = col;
-                break;
-            }
-        }
-        if (kingRow != -1)
-            break;
+        limits.moveTime = ENGINE_MOVE_TIME;
+        return limits;
+    }
+
+    int64_t now = ClockNow();
+    for (int side = 0; side < 2; side++)
+    {
+        limits.time[side] = max((int)(ClockRemainingNs(gameClock, side == 0, now) / 1000000), 1);
+        // Delay/Bronstein me bonus sirf use kiye time tak milta hai, increment nahi:
+        // engine ko 0 batao taaki woh clock se zyada na khaaye
+        limits.increment[side] = gameClock.control.mode == CLOCK_FISCHER ? gameClock.control.bonusMs : 0;
+    }
+    return limits;
+}
+
+// Har loop me: engine ki baari aane par search shuru (ya ponder hit), chaal
+// tayyar ho to board par. true jab engine ne chaal chali
+bool UpdateEngine(bool onBoard)
+{
+    if (!engineOpponent || !onBoard || HasGameFlag(*game, GAME_OVER) || gameClock.flagged != -1)
+    {
+        StopEnginePlayer(enginePlayer);
+        return false;
+    }
+    // Insaan ki baari: ponder chalta rehta hai
+    if (!IsEngineTurn())
+        return false;
+
+    Position pos;
+    GetGamePosition(*game, pos);
+    if (!ResolvePonder(enginePlayer, pos) && !IsEngineSearching(enginePlayer))
+    {
+        Move moves[MAX_MOVES];
+        if (GenerateLegalMoves(pos, moves) == 0)
+            return false;
+        if (!enginePlayer.ready)
+            InitEnginePlayer(enginePlayer, ENGINE_HASH_MB, max((int)thread::hardware_concurrency() / 2, 1));
+        StartEngineSearch(enginePlayer, pos, gameKeys, EngineLimits());
     }
 
-    if (kingRow == -1 || kingCol == -1)
+    SearchResult result;
+    if (!TakeEngineResult(enginePlayer, result) || result.bestMove == MOVE_NONE)
         return false;
 
-    for (int row = 0; row < 8; row++)
+    Move m = result.bestMove;
+    int from = MoveFrom(m), to = MoveTo(m);
+    RecordPosition();
+    int effects = ApplyGameMove(*game, from / 8, from % 8, to / 8, to % 8);
+    if (effects & MOVE_PROMOTION)
+        effects |= ApplyPromotion(*game, QUEEN - MovePromotion(m)); // choice 0-3 = queen, rook, bishop, knight
+    PressClock(gameClock, IsWhiteTurn(*game), ClockNow());
+    selection = BoardSelection();
+
+    if (effects & MOVE_CAPTURE)
+        PlaySound(captureSound);
+    else
+        PlaySound((effects & MOVE_CASTLE) ? castleSound : moveSound);
+    if (effects & MOVE_CHECK)
+        PlaySound(checkSound);
+    if (effects & MOVE_CHECKMATE)
+        PlaySound(checkmateSound);
+
+    // Jis reply ki umeed hai uspar ponder, agar woh board par bhi legal hai
+    if (enginePondering && result.ponderMove != MOVE_NONE && IsWhiteTurn(*game) && !HasGameFlag(*game, GAME_OVER))
+    {
+        Position next;
+        GetGamePosition(*game, next);
+        Move replies[MAX_MOVES];
+        int count = GenerateLegalMoves(next, replies);
+        if (find(replies, replies + count, result.ponderMove) != replies + count)
+            StartPondering(enginePlayer, next, gameKeys, result.ponderMove, EngineLimits());
+    }
+    return true;
+}
+
+// Sabse bade square cells jitne columns me aayein
+void SpectatorGridLayout(int count, int &columns, float &cellSize)
+{
+    float width = (float)GetScreenWidth();
+    float height = (float)(GetScreenHeight() - SPECTATOR_HEADER);
+    columns = 1;
+    cellSize = 0;
+    for (int c = 1; c <= max(count, 1); c++)
     {
-        for (int col = 0; col < 8; col++)
+        int rows = (count + c - 1) / c;
+        float size = min(width / c, rows ? height / rows : height);
+        if (size > cellSize)
         {
-            int piece = board[row][col];
-            if (piece != 0 && (piece * kingPiece < 0))
-            {
-                if (IsValidMove(board, piece, row, col, kingRow, kingCol, false))
-                {
-                    return true;
-                }
-            }
+            cellSize = size;
+            columns = c;
         }
     }
-
-    return false;
 }
 
-bool IsCheckmate(int board[8][8], bool isWhite)
+void UpdateSpectatorLayer()
 {
-    if (!IsKingInCheck(board, isWhite))
+    PROFILE_SCOPE(ZONE_DRAW, "UpdateSpectatorLayer");
+    int width = GetScreenWidth();
+    int height = GetScreenHeight();
+    int count = (int)spectatorFeed.boards.size();
+    int columns;
+    float cellSize;
+    SpectatorGridLayout(count, columns, cellSize);
+
+    bool sizeChanged = spectatorLayer.texture.width != width || spectatorLayer.texture.height != height;
+    if (spectatorLayer.id == 0 || sizeChanged)
     {
-        return false;
+        if (spectatorLayer.id != 0)
+            UnloadRenderTexture(spectatorLayer);
+        spectatorLayer = LoadRenderTexture(width, height);
     }
 
-    for (int startRow = 0; startRow < 8; startRow++)
+    // Naya board aaya ya window badli to poora grid naye sire se
+    bool relayout = sizeChanged || count != (int)spectatorDrawn.size() || columns != spectatorColumns;
+    if (relayout)
     {
-        for (int startCol = 0; startCol < 8; startCol++)
-        {
-            int piece = board[startRow][startCol];
-
-            if (piece != 0 && ((isWhite && piece > 0) || (!isWhite && piece < 0)))
-            {
-
-                for (int endRow = 0; endRow < 8; endRow++)
-                {
-                    for (int endCol = 0; endCol < 8; endCol++)
-                    {
+        spectatorDrawn.assign(count, 0);
+        spectatorColumns = columns;
+    }
 
-                        int capturedPiece = board[endRow][endCol];
-                        board[endRow][endCol] = piece;
-                        board[startRow][startCol] = 0;
+    vector<int> dirty;
+    for (int i = 0; i < count; i++)
+    {
+        if (spectatorDrawn[i] != spectatorFeed.boards[i].version)
+            dirty.push_back(i);
+    }
+    if (dirty.empty() && !relayout)
+        return;
 
-                        bool stillInCheck = IsKingInCheck(board, isWhite);
+    // Cell me board ke neeche label ki jagah, agar cell itna bada ho
+    int labelHeight = cellSize >= 120 ? 18 : 0;
+    float square = (float)(int)((cellSize - 6 - labelHeight) / 8);
+    float boardSize = square * 8;
+    float pieceScale = square / (BOARD_WIDTH / 8.0f);
+    auto cellOrigin = [&](int i)
+    {
+        return (Vector2){(float)(int)((i % columns) * cellSize + 3), (float)(int)(SPECTATOR_HEADER + (i / columns) * cellSize + 3)};
+    };
 
-                        board[startRow][startCol] = piece;
-                        board[endRow][endCol] = capturedPiece;
+    BeginTextureMode(spectatorLayer);
+    if (relayout)
+    {
+        ClearBackground(BLACK);
+        DrawText(count ? TextFormat("Watching %d boards  (Backspace: menu)", count) : "Waiting for games...", 10, 6, 20, LIGHTGRAY);
+    }
 
-                        if (!stillInCheck)
-                        {
-                            return false;
-                        }
-                    }
-                }
-            }
+    // Teen pass: pehle saare squares, phir saare pieces, phir saare labels, taaki
+    // texture sirf do baar badle, boards kitne bhi hon
+    for (int i : dirty)
+    {
+        Vector2 origin = cellOrigin(i);
+        DrawRectangle((int)origin.x - 3, (int)origin.y - 3, (int)cellSize, (int)cellSize, BLACK);
+        DrawRectangle((int)origin.x, (int)origin.y, (int)boardSize, (int)boardSize, BEIGE);
+        for (int sq = 0; sq < 64; sq++)
+        {
+            if ((sq / 8 + sq % 8) % 2 == 1)
+                DrawRectangle((int)(origin.x + (sq % 8) * square), (int)(origin.y + (sq / 8) * square), (int)square, (int)square, DARKBROWN);
         }
     }
-
-    return true;
+    for (int i : dirty)
+    {
+        Vector2 origin = cellOrigin(i);
+        const FeedBoard &board = spectatorFeed.boards[i];
+        for (int sq = 0; sq < 64; sq++)
+        {
+            if (board.board[sq] == 0)
+                continue;
+            const Rectangle &source = pieceRects[board.board[sq] + 6];
+            float w = source.width * pieceScale, h = source.height * pieceScale;
+            DrawTexturePro(pieceAtlas, source,
+                           (Rectangle){origin.x + (sq % 8) * square + (square - w) / 2, origin.y + (sq / 8) * square + (square - h) / 2, w, h},
+                           (Vector2){0, 0}, 0, WHITE);
+        }
+    }
+    for (int i : dirty)
+    {
+        const FeedBoard &board = spectatorFeed.boards[i];
+        if (labelHeight)
+        {
+            Vector2 origin = cellOrigin(i);
+            const char *status = !board.result.empty() ? board.result.c_str() : board.whiteToMove ? "white to move" : "black to move";
+            DrawText(TextFormat("%s  %s", board.id.c_str(), status), (int)origin.x, (int)(origin.y + boardSize + 2), 14,
+                     board.result.empty() ? LIGHTGRAY : GOLD);
+        }
+        spectatorDrawn[i] = board.version;
+    }
+    EndTextureMode();
 }
 
-void UpdateGame()
+// Pichhle frame ka hisaab: kahan kitna waqt gaya aur rules kitni baar chale
+void DrawProfileOverlay()
 {
-    int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
-    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+    if (!showProfileOverlay)
+        return;
 
-    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+    int x = 10, y = GetScreenHeight() - 200;
+    DrawRectangle(x - 5, y - 5, 330, 195, ColorAlpha(BLACK, 0.75f));
+    if (!PROFILER_ENABLED)
     {
-        Vector2 mousePos = GetMousePosition();
-
-        if (mousePos.x >= boardOffsetX && mousePos.x < boardOffsetX + BOARD_WIDTH &&
-            mousePos.y >= boardOffsetY && mousePos.y < boardOffsetY + BOARD_HEIGHT)
-        {
-
-            int row = (mousePos.y - boardOffsetY) / 62.5;
-            int col = (mousePos.x - boardOffsetX) / 62.5;
-
-            // Piece select karne ki condition
-            if (selectedSquareRow == -1 && selectedSquareCol == -1)
-            {
-                if ((isWhiteTurn && board[row][col] > 0) || (!isWhiteTurn && board[row][col] < 0))
-                {
-                    selectedSquareRow = row;
-                    selectedSquareCol = col;
-                }
-            }
-            // Piece select kia to move karne ki condition
-            else
-            {
-                // Check if we're clicking on another piece of the same color
-                if (board[row][col] != 0 &&
-                    board[row][col] * board[selectedSquareRow][selectedSquareCol] > 0)
-                {
-                    // Select the new piece instead
-                    selectedSquareRow = row;
-                    selectedSquareCol = col;
-                }
-                else
-                {
-                    // Attempt to make a move
-                    if (IsValidMove(board, board[selectedSquareRow][selectedSquareCol],
-                                    selectedSquareRow, selectedSquareCol, row, col))
-                    {
-                        int piece = board[selectedSquareRow][selectedSquareCol];
-                        bool isWhite = piece > 0;
-
-                        // Handle castling
-                        if (abs(piece) == 6 && abs(selectedSquareCol - col) == 2)
-                        {
-                            bool kingside = col > selectedSquareCol;
-                            int rookCol = kingside ? 7 : 0;
-                            int newRookCol = kingside ? 5 : 3;
-
-                            board[row][newRookCol] = board[row][rookCol];
-                            board[row][rookCol] = 0;
-                        }
-
-                        // Handle en passant
-                        if (abs(piece) == 1 && col != selectedSquareCol && board[row][col] == 0)
-                        {
-                            board[selectedSquareRow][col] = 0;
-                        }
-
-                        // Make the move
-                        int originalPiece = board[row][col];
-                        board[row][col] = piece;
-                        board[selectedSquareRow][selectedSquareCol] = 0;
-
-                        // En Passant target
-                        if (abs(piece) == 1 && abs(row - selectedSquareRow) == 2)
-                        {
-                            enPassantTargetRow = (row + selectedSquareRow) / 2;
-                            enPassantTargetCol = col;
-                        }
-                        else
-                        {
-                            enPassantTargetRow = -1;
-                            enPassantTargetCol = -1;
-                        }
+        DrawText("Built without -DCHESS_PROFILE", x, y, 16, ORANGE);
+        return;
+    }
 
-                        // Play sounds
-                        if (originalPiece == 0)
-                        {
-                            PlaySound(abs(piece) == 6 && abs(selectedSquareCol - col) == 2 ? castleSound : moveSound);
-                        }
-                        else
-                        {
-                            PlaySound(captureSound);
-                        }
+    ProfileFrame frame;
+    GetLastProfileFrame(frame);
+    float frameMs = GetFrameTime() * 1000.0f;
+    double measured = 0;
+    for (int z = 0; z < ZONE_COUNT; z++)
+        measured += frame.zoneMs[z];
+
+    DrawText(TextFormat("Frame %.2f ms%s", frameMs, IsProfileTraceRunning() ? "   [recording trace]" : ""), x, y, 16, GOLD);
+    y += 22;
+    for (int z = 0; z < ZONE_COUNT; z++, y += 18)
+        DrawText(TextFormat("%-8s %7.3f ms", profileZoneNames[z], frame.zoneMs[z]), x, y, 16, WHITE);
+    DrawText(TextFormat("%-8s %7.3f ms", "other", max(0.0, frameMs - measured)), x, y, 16, LIGHTGRAY);
+    y += 26;
+    for (int c = 0; c < COUNTER_COUNT; c++, y += 16)
+        DrawText(TextFormat("%-20s %llu", profileCounterNames[c], (unsigned long long)frame.counts[c]), x, y, 14, LIGHTGRAY);
+}
 
-                        // Check / CheckMate
-                        if (IsKingInCheck(board, !isWhiteTurn))
-                        {
-                            PlaySound(checkSound);
-                            if (IsCheckmate(board, !isWhiteTurn))
-                            {
-                                PlaySound(checkmateSound);
-                                gameOver = true;
-                            }
-                        }
+void RequestRedraw(int frames)
+{
+    redrawFrames = max(redrawFrames, frames);
+}
 
-                        // Check for pawn promotion
-                        if (abs(piece) == 1 && (row == 0 || row == 7))
-                        {
-                            promotionPending = true;
-                            promotionRow = row;
-                            promotionCol = col;
-                            isWhitePromoting = isWhiteTurn;
-                        }
+// Input, screen ya position me kuch badla? Input ke baad ek frame aur, taaki
+// us input se hua badlaav (naya screen, music) bhi dikh jaye
+bool NeedsRedraw(int screen)
+{
+    bool inputChanged = GetMouseDelta().x != 0 || GetMouseDelta().y != 0 || GetMouseWheelMove() != 0 || IsWindowResized();
+    for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_MIDDLE && !inputChanged; button++)
+        inputChanged = IsMouseButtonPressed(button) || IsMouseButtonReleased(button);
+    for (int key = KEY_SPACE; key <= KEY_KB_MENU && !inputChanged; key++)
+        inputChanged = IsKeyPressed(key) || IsKeyReleased(key);
+    if (inputChanged)
+        RequestRedraw();
+
+    if (screen != drawnScreen || (game && memcmp(game, &drawnState, sizeof(GameState)) != 0))
+        RequestRedraw(1);
+    if (redrawFrames == 0)
+        return false;
 
-                        // Update castling flags
-                        if (abs(piece) == 6)
-                        {
-                            isWhite ? whiteKingMoved = true : blackKingMoved = true;
-                        }
-                        if (abs(piece) == 4)
-                        {
-                            if (isWhite)
-                            {
-                                if (selectedSquareCol == 0)
-                                    whiteRookQueensideMoved = true;
-                                if (selectedSquareCol == 7)
-                                    whiteRookKingsideMoved = true;
-                            }
-                            else
-                            {
-                                if (selectedSquareCol == 0)
-                                    blackRookQueensideMoved = true;
-                                if (selectedSquareCol == 7)
-                                    blackRookKingsideMoved = true;
-                            }
-                        }
+    redrawFrames--;
+    drawnScreen = screen;
+    if (game)
+        drawnState = *game;
+    return true;
+}
 
-                        // Validate move doesn't leave king in check
-                        if (IsKingInCheck(board, isWhiteTurn))
-                        {
-                            board[selectedSquareRow][selectedSquareCol] = piece;
-                            board[row][col] = originalPiece;
-                        }
-                        else
-                        {
-                            isWhiteTurn = !isWhiteTurn;
-                        }
-                    }
-                    selectedSquareRow = -1;
-                    selectedSquareCol = -1;
-                }
-            }
-        }
+// Har loop me: board ki position badli to naya analysis; nayi lines aayin to true
+bool UpdateAnalysis(bool onBoard)
+{
+    if (analysisLines == 0 || engineOpponent || !onBoard || HasGameFlag(*game, GAME_OVER) ||
+        HasGameFlag(*game, GAME_PROMOTION_PENDING) || gameClock.flagged != -1)
+    {
+        if (!IsEngineSearching(analysisPlayer))
+            return false;
+        StopEnginePlayer(analysisPlayer);
+        analysisKey = 0;
+        return true; // Arrows hatane ke liye
     }
 
-    // Handle promotion selection
-    if (promotionPending && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+    Position pos;
+    GetGamePosition(*game, pos);
+    if (pos.key != analysisKey || !IsEngineSearching(analysisPlayer) || analysisPlayer.limits.multiPv != analysisLines)
     {
-        int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
-        int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
-
-        float menuWidth = 250;
-        float menuHeight = 80;
-        float menuX = boardOffsetX + (BOARD_WIDTH - menuWidth) / 2;
-        float menuY = boardOffsetY + (BOARD_HEIGHT - menuHeight - 10) / 2;
-
-        Vector2 mousePos = GetMousePosition();
-
-        for (int i = 0; i < 4; i++)
-        {
-            float btnX = menuX + 20 + i * 55;
-            float btnY = menuY + 20;
-
-            if (CheckCollisionPointRec(mousePos, (Rectangle){btnX, btnY, 50, 50}))
-            {
-                board[promotionRow][promotionCol] = isWhitePromoting ? (5 - i) : -(5 - i);
-                promotionPending = false;
-                PlaySound(promotionSound);
+        if (!analysisPlayer.ready)
+            InitEnginePlayer(analysisPlayer, ENGINE_HASH_MB, max((int)thread::hardware_concurrency() / 2, 1));
+        SearchLimits limits;
+        limits.infinite = true;
+        limits.multiPv = analysisLines;
+        StartEngineSearch(analysisPlayer, pos, gameKeys, limits);
+        analysisKey = pos.key;
+    }
+    return analysisPlayer.linesVersion != drawnAnalysisVersion;
+}
 
-                isWhiteTurn = !isWhiteTurn;
+// Score hamesha White ki nazar se, jaise analysis boards me hota hai
+const char *FormatScore(int score, bool whiteToMove)
+{
+    if (!whiteToMove)
+        score = -score;
+    if (IsMateScore(score))
+        return TextFormat("%sM%d", score < 0 ? "-" : "", abs(MateInMoves(score)));
+    return TextFormat("%+.2f", score / 100.0f);
+}
 
-                if (IsKingInCheck(board, !isWhitePromoting))
-                {
-                    PlaySound(checkSound);
-                    if (IsCheckmate(board, !isWhitePromoting))
-                    {
-                        PlaySound(checkmateSound);
-                        gameOver = true;
-                    }
-                }
-                break;
-            }
-        }
-    }
+void DrawMoveArrow(Move m, float thick, Color color)
+{
+    int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
+    int from = MoveFrom(m), to = MoveTo(m);
+    Vector2 start = {boardOffsetX + (from % 8) * 62.5f + 31.25f, boardOffsetY + (from / 8) * 62.5f + 31.25f};
+    Vector2 end = {boardOffsetX + (to % 8) * 62.5f + 31.25f, boardOffsetY + (to / 8) * 62.5f + 31.25f};
+
+    float dx = end.x - start.x, dy = end.y - start.y;
+    float length = sqrtf(dx * dx + dy * dy);
+    dx /= length;
+    dy /= length;
+
+    // Dandi sir ke peeche tak, sir ek triangle (raylib ko counter-clockwise chahiye)
+    float head = thick * 2.5f;
+    Vector2 base = {end.x - dx * head, end.y - dy * head};
+    DrawLineEx(start, base, thick, color);
+    Vector2 left = {base.x + dy * head * 0.6f, base.y - dx * head * 0.6f};
+    Vector2 right = {base.x - dy * head * 0.6f, base.y + dx * head * 0.6f};
+    DrawTriangle(end, left, right, color);
 }
 
-void DrawGame()
+void DrawAnalysis()
 {
-    DrawTexturePro(backgroundImage,
-                   (Rectangle){0, 0, (float)backgroundImage.width, (float)backgroundImage.height},
-                   (Rectangle){0, 0, (float)GetScreenWidth(), (float)GetScreenHeight()},
-                   (Vector2){0, 0}, 0, WHITE);
+    if (!IsEngineSearching(analysisPlayer))
+        return;
 
-    DrawChessBoard(isWhiteTurn);
-    DrawPieces(board);
+    SearchLine lines[MAX_MULTI_PV];
+    int count;
+    drawnAnalysisVersion = GetEngineLines(analysisPlayer, lines, count);
 
-    if (selectedSquareRow != -1 && selectedSquareCol != -1)
-    {
-        DrawValidMoves(board, board[selectedSquareRow][selectedSquareCol],
-                       selectedSquareRow, selectedSquareCol);
-    }
+    // Isi frame me chaal chali gayi to lines purani position ki hain
+    Position pos;
+    GetGamePosition(*game, pos);
+    if (count == 0 || pos.key != analysisPlayer.searchPos.key)
+        return;
+    int boardOffsetX = (GetScreenWidth() - BOARD_WIDTH) / 2;
+    int boardOffsetY = (GetScreenHeight() - BOARD_HEIGHT) / 2;
 
-    if (promotionPending)
+    // Sabse achhi line sabse upar aur sabse moti
+    const Color colors[ANALYSIS_MAX_LINES] = {ColorAlpha(LIME, 0.8f), ColorAlpha(SKYBLUE, 0.7f), ColorAlpha(GOLD, 0.6f),
+                                              ColorAlpha(ORANGE, 0.5f)};
+    count = min(count, ANALYSIS_MAX_LINES);
+    for (int i = count - 1; i >= 0; i--)
     {
-        DrawPromotionMenu();
+        if (lines[i].length == 0)
+            continue;
+        DrawMoveArrow(lines[i].pv[0], 12.0f - 2 * i, colors[i]);
+        int to = MoveTo(lines[i].pv[0]);
+        int labelX = boardOffsetX + (to % 8) * 62.5f + 4, labelY = boardOffsetY + (to / 8) * 62.5f + 4;
+        DrawRectangle(labelX - 2, labelY - 2, 54, 18, ColorAlpha(BLACK, 0.7f));
+        DrawText(FormatScore(lines[i].score, pos.whiteToMove), labelX, labelY, 14, WHITE);
     }
 
-    if (gameOver)
+    // Lines ki list board ke right, pehli kuch chaalein SAN me
+    int x = boardOffsetX + BOARD_WIDTH + 30;
+    int y = boardOffsetY + 70;
+    DrawRectangle(x - 10, y - 10, 340, 40 + count * 25, ColorAlpha(BLACK, 0.6f));
+    DrawText(TextFormat("Analysis  depth %d", lines[0].depth), x, y, 20, GOLD);
+    for (int i = 0; i < count; i++)
     {
-        DrawText("Checkmate! Game Over.", GetScreenWidth() / 2 - 150, GetScreenHeight() / 2 - 20, 30, RED);
+        string text = FormatScore(lines[i].score, pos.whiteToMove);
+        Position p = pos;
+        for (int k = 0; k < min(lines[i].length, 5); k++)
+        {
+            text += " " + MoveToSan(p, lines[i].pv[k]);
+            DoMove(p, lines[i].pv[k]);
+        }
+        DrawText(text.c_str(), x, y + 30 + i * 25, 20, ColorAlpha(colors[i], 1.0f));
     }
 }
 
-int main()
+int main(int argc, char **argv)
 {
     const int screenWidth = 1280;
     const int screenHeight = 720;
@@ -1248,10 +1335,35 @@ int main()
 
     LoadResources();
 
+    // Game states ek fixed pool se aate hain, heap churn nahi
+    InitGameStatePool(gameStates, 64);
+    ResetGame();
+
     PlayMusicStream(menuMusic);
     SetMusicVolume(menuMusic, musicVolume);
 
+    // Pehla frame menu ke assets ka hi intezaar karta hai, baaki peeche load hote rehte hain
+    while (!menuAssetsReady && !WindowShouldClose())
+    {
+        UploadLoadedAssets();
+        UpdateMusicStream(menuMusic);
+        BeginDrawing();
+        DrawLoadingScreen();
+        EndDrawing();
+    }
+
     GameScreen currentScreen = GAME_MENU;
+
+    // Game -watch live.txt: seedha spectator grid, feed file se
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "-watch") != 0)
+            continue;
+        if (OpenBoardFeed(spectatorFeed, argv[i + 1]))
+            currentScreen = SPECTATOR_VIEW;
+        else
+            printf("Could not open %s\n", argv[i + 1]);
+    }
     bool usingKeyboard = false;
     int selectedButton = 0;
     bool keyReleased = true;
@@ -1269,8 +1381,41 @@ int main()
 
     while (!WindowShouldClose())
     {
-        UpdateMusicStream(menuMusic);
-        UpdateMusicStream(gameMusic);
+        {
+            PROFILE_SCOPE(ZONE_AUDIO, "UpdateMusicStream");
+            UpdateMusicStream(menuMusic);
+            UpdateMusicStream(gameMusic);
+        }
+
+        if (UploadLoadedAssets())
+            RequestRedraw();
+        if (PollBoardFeed(spectatorFeed) > 0 && currentScreen == SPECTATOR_VIEW)
+            RequestRedraw(1);
+        if (UpdateGameClock(currentScreen == NEW_GAME && gameAssetsLeft == 0))
+            RequestRedraw(1);
+        if (UpdateEngine(currentScreen == NEW_GAME && gameAssetsLeft == 0))
+            RequestRedraw(1);
+        if (UpdateAnalysis(currentScreen == NEW_GAME && gameAssetsLeft == 0))
+            RequestRedraw(1);
+
+        // Kuch nahi badla: draw chhod ke thodi der so jao, music ke buffer phir bhi bharte rahenge
+        if (eventDrivenRedraw && !NeedsRedraw(currentScreen))
+        {
+            WaitTime(ClockWaitSeconds());
+            PollInputEvents();
+            continue;
+        }
+        EndProfileFrame();
+
+        if (IsKeyPressed(KEY_F3))
+            showProfileOverlay = !showProfileOverlay;
+        if (IsKeyPressed(KEY_F4))
+        {
+            if (!IsProfileTraceRunning())
+                StartProfileTrace();
+            else if (WriteProfileTrace("trace.json"))
+                printf("Trace written to trace.json\n");
+        }
 
         if (IsKeyPressed(KEY_BACKSPACE) && currentScreen != GAME_MENU)
         {
@@ -1279,8 +1424,11 @@ int main()
             continue;
         }
 
-        UpdateMusicStream(menuMusic);
-        UpdateMusicStream(gameMusic);
+        {
+            PROFILE_SCOPE(ZONE_AUDIO, "UpdateMusicStream");
+            UpdateMusicStream(menuMusic);
+            UpdateMusicStream(gameMusic);
+        }
 
         if (currentScreen == GAME_MENU)
         {
@@ -1360,7 +1508,7 @@ int main()
                     PlayMusicStream(gameMusic);
                     break;
                 case 1:
-                    if (LoadGameState())
+                    if (LoadSavedGame())
                     {
                         currentScreen = NEW_GAME;
                         isMenuMusicPlaying = false;
@@ -1450,7 +1598,7 @@ int main()
                             PlayMusicStream(gameMusic);
                             break;
                         case 1:
-                            if (LoadGameState())
+                            if (LoadSavedGame())
                             {
                                 currentScreen = NEW_GAME;
                                 isMenuMusicPlaying = false;
@@ -1479,7 +1627,17 @@ int main()
 
         case NEW_GAME:
         {
+            // Board screen ke assets abhi aa rahe hain
+            if (gameAssetsLeft > 0)
+            {
+                BeginDrawing();
+                DrawLoadingScreen();
+                EndDrawing();
+                break;
+            }
+
             UpdateGame();
+            UpdateBoardLayer();
             BeginDrawing();
             DrawGame();
 
@@ -1494,10 +1652,31 @@ int main()
             DrawText("Save Game", saveButton.x + 10, saveButton.y + 10, 20, BLACK);
             if (saveHovered && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
             {
-                SaveGameState();
+                SaveGameState(*game, "saved_game.dat");
                 PlaySound(moveSound);
             }
 
+            DrawProfileOverlay();
+            EndDrawing();
+            break;
+        }
+
+        case SPECTATOR_VIEW:
+        {
+            if (gameAssetsLeft > 0)
+            {
+                BeginDrawing();
+                DrawLoadingScreen();
+                EndDrawing();
+                break;
+            }
+
+            UpdateSpectatorLayer();
+            BeginDrawing();
+            DrawTextureRec(spectatorLayer.texture,
+                           (Rectangle){0, 0, (float)spectatorLayer.texture.width, -(float)spectatorLayer.texture.height},
+                           (Vector2){0, 0}, WHITE);
+            DrawProfileOverlay();
             EndDrawing();
             break;
         }
@@ -1570,6 +1749,83 @@ int main()
                 SetSoundVolume(promotionSound, soundVolume);
             }
 
+            DrawText("Time Control:", 100, 320, 20, WHITE);
+            Rectangle clockButton = {350, 320, 220, 25};
+            DrawRectangleRec(clockButton, clockPresets[clockPreset].mode == CLOCK_OFF ? RED : GREEN);
+            DrawText(clockPresets[clockPreset].name, 355, 322, 20, WHITE);
+            DrawText("(next game)", 585, 322, 20, LIGHTGRAY);
+
+            if (CheckCollisionPointRec(GetMousePosition(), clockButton))
+            {
+                DrawRectangleLinesEx(clockButton, 2, GOLD);
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+                {
+                    clockPreset = (clockPreset + 1) % CLOCK_PRESET_COUNT;
+                    PlaySound(moveSound);
+                }
+            }
+
+            DrawText("Play Against Engine:", 100, 370, 20, WHITE);
+            Rectangle engineToggle = {350, 370, 50, 25};
+            DrawRectangleRec(engineToggle, engineOpponent ? GREEN : RED);
+            DrawText(engineOpponent ? "ON" : "OFF", 355, 372, 20, WHITE);
+
+            if (CheckCollisionPointRec(GetMousePosition(), engineToggle))
+            {
+                DrawRectangleLinesEx(engineToggle, 2, GOLD);
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+                {
+                    engineOpponent = !engineOpponent;
+                    PlaySound(moveSound);
+                }
+            }
+
+            DrawText("Engine Pondering:", 100, 420, 20, WHITE);
+            Rectangle ponderToggle = {350, 420, 50, 25};
+            DrawRectangleRec(ponderToggle, enginePondering ? GREEN : RED);
+            DrawText(enginePondering ? "ON" : "OFF", 355, 422, 20, WHITE);
+
+            if (CheckCollisionPointRec(GetMousePosition(), ponderToggle))
+            {
+                DrawRectangleLinesEx(ponderToggle, 2, GOLD);
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+                {
+                    enginePondering = !enginePondering;
+                    PlaySound(moveSound);
+                }
+            }
+
+            DrawText("Analysis Lines:", 100, 460, 20, WHITE);
+            Rectangle analysisToggle = {350, 460, 50, 25};
+            DrawRectangleRec(analysisToggle, analysisLines > 0 ? GREEN : RED);
+            DrawText(analysisLines > 0 ? TextFormat("%d", analysisLines) : "OFF", 355, 462, 20, WHITE);
+            DrawText("(without the engine opponent)", 415, 462, 20, LIGHTGRAY);
+
+            if (CheckCollisionPointRec(GetMousePosition(), analysisToggle))
+            {
+                DrawRectangleLinesEx(analysisToggle, 2, GOLD);
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+                {
+                    analysisLines = (analysisLines + 1) % (ANALYSIS_MAX_LINES + 1);
+                    PlaySound(moveSound);
+                }
+            }
+
+            DrawText("Redraw Only On Change:", 100, 270, 20, WHITE);
+            Rectangle redrawToggle = {350, 270, 50, 25};
+            DrawRectangleRec(redrawToggle, eventDrivenRedraw ? GREEN : RED);
+            DrawText(eventDrivenRedraw ? "ON" : "OFF", 355, 272, 20, WHITE);
+
+            if (CheckCollisionPointRec(GetMousePosition(), redrawToggle))
+            {
+                DrawRectangleLinesEx(redrawToggle, 2, GOLD);
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+                {
+                    eventDrivenRedraw = !eventDrivenRedraw;
+                    PlaySound(moveSound);
+                }
+            }
+
             // Back button
             Rectangle backButton = {screenWidth / 2.0f - 100.0f, 500.0f, 200.0f, 50.0f};
             bool isBackButtonHovered = CheckCollisionPointRec(GetMousePosition(), backButton);
@@ -1642,26 +1898,31 @@ int main()
                 bool isHovered = CheckCollisionPointRec(GetMousePosition(), themeButton);
 
                 DrawRectangleRec(themeButton, isSelected ? GREEN : (isHovered ? LIGHTGRAY : GRAY));
-                DrawText(boardThemes[i].first.c_str(), themeButton.x + 10, themeButton.y + 15, 20, BLACK);
+                DrawText(boardThemes[i].name.c_str(), themeButton.x + 10, themeButton.y + 15, 20, BLACK);
 
                 if (isHovered && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
                 {
                     currentBoardTheme = (int)i;
+                    RequestBoardTheme(currentBoardTheme);
                     PlaySound(moveSound);
                 }
             }
 
             // Preview of the current theme
-            if (!boardThemes.empty())
+            if (!boardThemes.empty() && boardThemes[currentBoardTheme].texture.id != 0)
             {
                 DrawTexturePro(
-                    boardThemes[currentBoardTheme].second,
-                    (Rectangle){0, 0, (float)boardThemes[currentBoardTheme].second.width, (float)boardThemes[currentBoardTheme].second.height},
+                    boardThemes[currentBoardTheme].texture,
+                    (Rectangle){0, 0, (float)boardThemes[currentBoardTheme].texture.width, (float)boardThemes[currentBoardTheme].texture.height},
                     (Rectangle){700, 120, 300, 300},
                     (Vector2){0, 0},
                     0,
                     WHITE);
             }
+            else if (!boardThemes.empty())
+            {
+                DrawText("Loading...", 800, 260, 20, LIGHTGRAY);
+            }
 
             // Back button
             Rectangle backButton = {screenWidth / 2.0f - 100.0f, 500.0f, 200.0f, 50.0f};
@@ -1705,6 +1966,8 @@ int main()
             break;
     }
 
+    StopEnginePlayer(enginePlayer);
+    StopEnginePlayer(analysisPlayer);
     UnloadResources();
     CloseWindow();
 
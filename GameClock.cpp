@@ -0,0 +1,109 @@
+#include "GameClock.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace std::chrono;
+
+#define NS_PER_MS ((int64_t)1000000)
+
+int64_t ClockNow()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t TurnUsedNs(const GameClock &clock, int64_t now)
+{
+    return clock.turnUsedNs + (clock.running ? now - clock.startNs : 0);
+}
+
+// What this turn costs so far; in delay mode the first bonusMs are free
+static int64_t ChargedNs(const GameClock &clock, int64_t used)
+{
+    if (clock.control.mode == CLOCK_DELAY)
+        return max(used - clock.control.bonusMs * NS_PER_MS, (int64_t)0);
+    return used;
+}
+
+static int64_t SideRemainingNs(const GameClock &clock, int side, int64_t now)
+{
+    if (side != clock.side)
+        return clock.remainingNs[side];
+    return clock.remainingNs[side] - ChargedNs(clock, TurnUsedNs(clock, now));
+}
+
+void ResetClock(GameClock &clock, const ClockControl &control, bool whiteToMove)
+{
+    clock = GameClock();
+    clock.control = control;
+    clock.remainingNs[0] = clock.remainingNs[1] = control.baseMs * NS_PER_MS;
+    clock.side = whiteToMove ? 0 : 1;
+}
+
+void StartClock(GameClock &clock, int64_t now)
+{
+    if (clock.running || clock.control.mode == CLOCK_OFF || clock.flagged != -1)
+        return;
+    clock.running = true;
+    clock.startNs = now;
+}
+
+void PauseClock(GameClock &clock, int64_t now)
+{
+    if (!clock.running)
+        return;
+    clock.turnUsedNs = TurnUsedNs(clock, now);
+    clock.running = false;
+}
+
+void PressClock(GameClock &clock, bool whiteToMove, int64_t now)
+{
+    int next = whiteToMove ? 0 : 1;
+    if (clock.control.mode == CLOCK_OFF || clock.flagged != -1 || next == clock.side)
+        return;
+    if (CheckFlagFall(clock, now))
+        return;
+
+    int64_t used = TurnUsedNs(clock, now);
+    int64_t bonus = clock.control.bonusMs * NS_PER_MS;
+    int64_t &remaining = clock.remainingNs[clock.side];
+    remaining -= ChargedNs(clock, used);
+    if (clock.control.mode == CLOCK_FISCHER)
+        remaining += bonus;
+    else if (clock.control.mode == CLOCK_BRONSTEIN)
+        remaining += min(used, bonus);
+
+    clock.side = next;
+    clock.turnUsedNs = 0;
+    clock.startNs = now;
+}
+
+int64_t ClockRemainingNs(const GameClock &clock, bool white, int64_t now)
+{
+    return max(SideRemainingNs(clock, white ? 0 : 1, now), (int64_t)0);
+}
+
+bool CheckFlagFall(GameClock &clock, int64_t now)
+{
+    if (!clock.running || SideRemainingNs(clock, clock.side, now) > 0)
+        return false;
+    clock.flagged = clock.side;
+    clock.remainingNs[clock.side] = 0;
+    clock.turnUsedNs = 0;
+    clock.running = false;
+    return true;
+}
+
+int64_t ClockNextTickNs(const GameClock &clock, int64_t now, int64_t stepNs)
+{
+    if (!clock.running)
+        return -1;
+
+    int64_t delayLeft = 0;
+    if (clock.control.mode == CLOCK_DELAY)
+        delayLeft = max(clock.control.bonusMs * NS_PER_MS - TurnUsedNs(clock, now), (int64_t)0);
+    int64_t remaining = SideRemainingNs(clock, clock.side, now);
+    if (remaining <= 0)
+        return 0;
+    return delayLeft + remaining - (remaining - 1) / stepNs * stepNs;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+// Two-sided chess clock on the monotonic timer. Nothing is counted down per
+// frame: the side on move has its time at the start of the turn minus the time
+// since, worked out from timestamps whenever someone looks. However often or
+// rarely that is, the clock doesn't drift and a flag fall is seen the moment
+// it's looked for.
+
+enum ClockMode
+{
+    CLOCK_OFF,      // Untimed
+    CLOCK_FISCHER,  // Bonus added after every move
+    CLOCK_DELAY,    // The clock waits out the bonus before it counts down (simple delay)
+    CLOCK_BRONSTEIN // Time used is given back after the move, up to the bonus
+};
+
+struct ClockControl
+{
+    const char *name;
+    ClockMode mode;
+    int baseMs;
+    int bonusMs; // Increment or delay, by mode
+};
+
+struct GameClock
+{
+    ClockControl control = {"Off", CLOCK_OFF, 0, 0};
+    int64_t remainingNs[2] = {0, 0}; // [white, black], before the current turn
+    int side = 0;                    // Whose turn it is, 0 = white
+    bool running = false;
+    int64_t startNs = 0;    // When the clock last started running this turn
+    int64_t turnUsedNs = 0; // Time used this turn before the last pause
+    int flagged = -1;       // Side that ran out of time
+};
+
+// Monotonic time in nanoseconds; only differences mean anything
+int64_t ClockNow();
+
+// Full time for both sides, stopped, with whiteToMove's turn next
+void ResetClock(GameClock &clock, const ClockControl &control, bool whiteToMove);
+// Start or carry on the current turn; a pause in between isn't charged
+void StartClock(GameClock &clock, int64_t now);
+void PauseClock(GameClock &clock, int64_t now);
+// The side on move has moved: its time is charged (less any delay), the
+// increment added and whiteToMove's turn begins. Nothing happens if it's
+// already whiteToMove's turn.
+void PressClock(GameClock &clock, bool whiteToMove, int64_t now);
+
+// Time left, never below zero
+int64_t ClockRemainingNs(const GameClock &clock, bool white, int64_t now);
+// True once, when the side on move runs out; the clock stops there
+bool CheckFlagFall(GameClock &clock, int64_t now);
+// Until the running side's time next crosses a multiple of stepNs, counting
+// any delay still to run first; -1 when the clock is stopped. Tells a caller
+// that only looks now and then when to look next.
+int64_t ClockNextTickNs(const GameClock &clock, int64_t now, int64_t stepNs);
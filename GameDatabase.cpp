@@ -0,0 +1,215 @@
+#include "GameDatabase.h"
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+bool OpenGameDatabase(GameDatabase &db, const char *path)
+{
+    CloseGameDatabase(db);
+    if (!MapFile(db.file, path))
+        return false;
+
+    const DbHeader *header = (const DbHeader *)db.file.data;
+    if (db.file.size < sizeof(DbHeader) || memcmp(header->magic, DB_MAGIC, 4) != 0 || header->version != DB_VERSION ||
+        header->indexOffset + header->indexCount * sizeof(DbIndexEntry) > db.file.size ||
+        header->movesOffset + header->movesSize > db.file.size ||
+        header->gamesOffset + (uint64_t)header->gameCount * sizeof(DbGame) > db.file.size)
+    {
+        CloseGameDatabase(db);
+        return false;
+    }
+
+    db.header = header;
+    db.games = (const DbGame *)(db.file.data + header->gamesOffset);
+    db.moves = db.file.data + header->movesOffset;
+    db.index = (const DbIndexEntry *)(db.file.data + header->indexOffset);
+    return true;
+}
+
+void CloseGameDatabase(GameDatabase &db)
+{
+    UnmapFile(db.file);
+    db.header = nullptr;
+    db.games = nullptr;
+    db.moves = nullptr;
+    db.index = nullptr;
+}
+
+bool IsGameDatabaseOpen(const GameDatabase &db)
+{
+    return db.header != nullptr;
+}
+
+// Lower bound over the sorted keys. Zobrist keys are uniformly distributed so an
+// interpolation probe usually lands within a few entries; every other step is a
+// plain bisection so a skewed range can never degrade past 2 * log2(n) probes.
+static size_t LowerBound(const DbIndexEntry *index, size_t count, uint64_t key)
+{
+    size_t lo = 0, hi = count;
+    bool interpolate = true;
+    while (hi - lo > 8)
+    {
+        uint64_t loKey = index[lo].key, hiKey = index[hi - 1].key;
+        if (key <= loKey)
+            return lo;
+        if (key > hiKey)
+            return hi;
+
+        size_t mid;
+        if (interpolate)
+            mid = lo + (size_t)((double)(key - loKey) / (double)(hiKey - loKey) * (double)(hi - 1 - lo));
+        else
+            mid = lo + (hi - lo) / 2;
+        interpolate = !interpolate;
+
+        if (index[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    while (lo < hi && index[lo].key < key)
+        lo++;
+    return lo;
+}
+
+size_t FindPosition(const GameDatabase &db, uint64_t key, const DbIndexEntry **first)
+{
+    *first = nullptr;
+    if (!db.header)
+        return 0;
+
+    size_t count = (size_t)db.header->indexCount;
+    size_t start = LowerBound(db.index, count, key);
+    size_t end = start;
+    while (end < count && db.index[end].key == key)
+        end++;
+
+    if (end > start)
+        *first = db.index + start;
+    return end - start;
+}
+
+PositionStats GetPositionStats(const GameDatabase &db, uint64_t key)
+{
+    PositionStats stats = {};
+    const DbIndexEntry *entries;
+    size_t count = FindPosition(db, key, &entries);
+    for (size_t i = 0; i < count; i++)
+    {
+        switch (entries[i].result)
+        {
+        case RESULT_WHITE_WINS:
+            stats.whiteWins++;
+            break;
+        case RESULT_DRAW:
+            stats.draws++;
+            break;
+        case RESULT_BLACK_WINS:
+            stats.blackWins++;
+            break;
+        }
+    }
+    stats.games = (uint32_t)count;
+    return stats;
+}
+
+bool ReadGameMoves(const GameDatabase &db, uint32_t game, vector<Move> &moves)
+{
+    moves.clear();
+    if (!db.header || game >= db.header->gameCount)
+        return false;
+
+    const DbGame &record = db.games[game];
+    if (record.movesOffset + record.plyCount > db.header->movesSize)
+        return false;
+
+    Position pos;
+    SetStartPosition(pos);
+    const uint8_t *stream = db.moves + record.movesOffset;
+    for (int ply = 0; ply < record.plyCount; ply++)
+    {
+        Move legal[MAX_MOVES];
+        int count = GenerateLegalMoves(pos, legal);
+        if (stream[ply] >= count)
+            return false;
+        moves.push_back(legal[stream[ply]]);
+        DoMove(pos, legal[stream[ply]]);
+    }
+    return true;
+}
+
+bool AddDatabaseGame(GameDatabaseBuilder &builder, const PgnGame &game)
+{
+    const char *fen = GetPgnTag(game, "FEN");
+    if (fen || game.moves.size() > 0xFFFF)
+        return false;
+
+    DbGame record = {};
+    record.movesOffset = builder.moves.size();
+    record.result = (uint8_t)ParseGameResult(game.result);
+    uint32_t gameIndex = (uint32_t)builder.games.size();
+
+    Position pos;
+    SetStartPosition(pos);
+    vector<uint8_t> stream;
+    vector<DbIndexEntry> entries;
+    entries.push_back({pos.key, gameIndex, 0, record.result, 0});
+
+    for (auto &san : game.moves)
+    {
+        Move move = ParseSanMove(pos, san.c_str());
+        if (move == MOVE_NONE)
+            return false;
+
+        Move legal[MAX_MOVES];
+        int count = GenerateLegalMoves(pos, legal);
+        stream.push_back((uint8_t)(find(legal, legal + count, move) - legal));
+        DoMove(pos, move);
+        entries.push_back({pos.key, gameIndex, (uint16_t)stream.size(), record.result, 0});
+    }
+
+    // A game that repeats a position still counts once for it
+    sort(entries.begin(), entries.end(), [](const DbIndexEntry &a, const DbIndexEntry &b)
+         { return a.key != b.key ? a.key < b.key : a.ply < b.ply; });
+    entries.erase(unique(entries.begin(), entries.end(), [](const DbIndexEntry &a, const DbIndexEntry &b)
+                         { return a.key == b.key; }),
+                  entries.end());
+
+    record.plyCount = (uint16_t)stream.size();
+    builder.games.push_back(record);
+    builder.moves.insert(builder.moves.end(), stream.begin(), stream.end());
+    builder.index.insert(builder.index.end(), entries.begin(), entries.end());
+    return true;
+}
+
+bool WriteGameDatabase(GameDatabaseBuilder &builder, const char *path)
+{
+    sort(builder.index.begin(), builder.index.end(), [](const DbIndexEntry &a, const DbIndexEntry &b)
+         { return a.key != b.key ? a.key < b.key : a.game < b.game; });
+
+    DbHeader header = {};
+    memcpy(header.magic, DB_MAGIC, 4);
+    header.version = DB_VERSION;
+    header.gameCount = (uint32_t)builder.games.size();
+    header.indexCount = builder.index.size();
+    header.gamesOffset = sizeof(DbHeader);
+    header.movesOffset = header.gamesOffset + builder.games.size() * sizeof(DbGame);
+    header.movesSize = builder.moves.size();
+    // Keep the index 8-byte aligned for the mapped reads
+    header.indexOffset = (header.movesOffset + header.movesSize + 7) & ~7ULL;
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    static const uint8_t padding[8] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(builder.games.data(), sizeof(DbGame), builder.games.size(), file) == builder.games.size();
+    ok = ok && fwrite(builder.moves.data(), 1, builder.moves.size(), file) == builder.moves.size();
+    size_t pad = (size_t)(header.indexOffset - header.movesOffset - header.movesSize);
+    ok = ok && fwrite(padding, 1, pad, file) == pad;
+    ok = ok && fwrite(builder.index.data(), sizeof(DbIndexEntry), builder.index.size(), file) == builder.index.size();
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
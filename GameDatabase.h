@@ -0,0 +1,85 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Position.h"
+#include "Pgn.h"
+#include <stdint.h>
+#include <vector>
+
+// On-disk game database (.cdb), little-endian, read through a memory mapping:
+//   DbHeader
+//   DbGame[gameCount]          fixed-size game records
+//   uint8_t[movesSize]         packed move streams, one byte per ply holding the
+//                              index of the move in GenerateLegalMoves order
+//   DbIndexEntry[indexCount]   every (position, game) pair sorted by Zobrist key
+
+#define DB_MAGIC "CHDB"
+#define DB_VERSION 1
+
+struct DbHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t gameCount;
+    uint32_t reserved;
+    uint64_t indexCount;
+    uint64_t gamesOffset;
+    uint64_t movesOffset;
+    uint64_t movesSize;
+    uint64_t indexOffset;
+};
+
+struct DbGame
+{
+    uint64_t movesOffset;
+    uint16_t plyCount;
+    uint8_t result; // GameResult
+    uint8_t reserved[5];
+};
+
+struct DbIndexEntry
+{
+    uint64_t key;
+    uint32_t game;
+    uint16_t ply;
+    uint8_t result;
+    uint8_t reserved;
+};
+
+struct GameDatabase
+{
+    MappedFile file;
+    const DbHeader *header = nullptr;
+    const DbGame *games = nullptr;
+    const uint8_t *moves = nullptr;
+    const DbIndexEntry *index = nullptr;
+};
+
+struct PositionStats
+{
+    uint32_t games;
+    uint32_t whiteWins;
+    uint32_t draws;
+    uint32_t blackWins;
+};
+
+bool OpenGameDatabase(GameDatabase &db, const char *path);
+void CloseGameDatabase(GameDatabase &db);
+bool IsGameDatabaseOpen(const GameDatabase &db);
+
+// Returns the number of index entries for the key and points first at the first one
+size_t FindPosition(const GameDatabase &db, uint64_t key, const DbIndexEntry **first);
+PositionStats GetPositionStats(const GameDatabase &db, uint64_t key);
+bool ReadGameMoves(const GameDatabase &db, uint32_t game, std::vector<Move> &moves);
+
+struct GameDatabaseBuilder
+{
+    std::vector<DbGame> games;
+    std::vector<uint8_t> moves;
+    std::vector<DbIndexEntry> index;
+};
+
+// Replays the SAN moves from the standard start position; returns false for
+// games that start from a FEN or contain an illegal move
+bool AddDatabaseGame(GameDatabaseBuilder &builder, const PgnGame &game);
+bool WriteGameDatabase(GameDatabaseBuilder &builder, const char *path);
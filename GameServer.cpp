@@ -0,0 +1,677 @@
+#include "ObjectPool.h"
+#include "Position.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Usage: chess-server [-port N] [-unix path] [-threads N] [-games N]
+//
+// Hosts any number of games over TCP and/or a Unix socket (Linux, epoll).
+// The protocol is one command per line:
+//
+//   client -> server                  server -> client
+//   play         (pair with anyone)   waiting
+//   new          (open a game)        game <id> white|black
+//   join <id>                         start <id>
+//   move <id> <e2e4>                  move <id> <e2e4>            (to both players)
+//   resign <id>                       end <id> <1-0|0-1|1/2-1/2|*> <reason>
+//   fen <id>                          fen <id> <fen>
+//   quit                              error <message>
+//
+// Each worker thread has its own epoll set and serves the connections it
+// accepted. Games and connections live in slab pools; a game is reached
+// through its id (pool handle) and guarded by its own mutex, so moves in
+// different games never contend.
+
+#define MAX_LINE 256
+#define MAX_OUTPUT (1 << 20) // A client this far behind is dropped
+
+enum ServerGameState
+{
+    GAME_WAITING,
+    GAME_PLAYING
+};
+
+struct ServerGame
+{
+    mutex lock;
+    uint64_t id = 0;         // Pool handle while in use, 0 when free
+    uint64_t players[2];     // Connection ids [white, black], 0 = open seat
+    Position pos;
+    uint64_t keys[100];      // Position keys since the last capture or pawn move, by halfmove clock
+    uint8_t state;
+};
+
+struct Connection
+{
+    mutex lock;              // Guards everything below but input
+    uint64_t id = 0;         // Pool handle while open, 0 when closed
+    int fd = -1;
+    int epoll = -1;          // Epoll set of the worker that owns the connection
+    bool wantWrite = false;
+    string output;           // Bytes the socket didn't take yet
+    vector<uint64_t> games;  // Games this connection sits in; finished ones are pruned lazily
+    string input;            // Only touched by the owning worker
+};
+
+struct Server
+{
+    mutex gamesLock;
+    ObjectPool<ServerGame> games;
+    mutex connectionsLock;
+    ObjectPool<Connection> connections;
+    mutex matchLock;
+    uint64_t waiting = 0; // Connection waiting for an opponent
+    vector<int> listeners;
+    atomic<uint64_t> moves{0};
+    atomic<uint64_t> validationNs{0};
+};
+
+static atomic<bool> stopServer{false};
+
+static void OnSignal(int)
+{
+    stopServer = true;
+}
+
+static Connection *FindConnection(Server &server, uint64_t id)
+{
+    lock_guard<mutex> lock(server.connectionsLock);
+    return PoolFind(server.connections, id);
+}
+
+static ServerGame *FindGame(Server &server, uint64_t id)
+{
+    lock_guard<mutex> lock(server.gamesLock);
+    return PoolFind(server.games, id);
+}
+
+// Safe from any thread: writes straight to the socket when nothing is queued,
+// otherwise queues and lets the owning worker flush on EPOLLOUT
+static void Send(Server &server, uint64_t connectionId, const string &text)
+{
+    Connection *connection = FindConnection(server, connectionId);
+    if (!connection)
+        return;
+    lock_guard<mutex> lock(connection->lock);
+    if (connection->id != connectionId)
+        return;
+
+    size_t sent = 0;
+    if (connection->output.empty())
+    {
+        ssize_t count = send(connection->fd, text.data(), text.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            return; // The owner sees the error and closes
+        sent = count > 0 ? (size_t)count : 0;
+    }
+    if (sent == text.size())
+        return;
+
+    connection->output.append(text, sent, string::npos);
+    if (connection->output.size() > MAX_OUTPUT)
+        shutdown(connection->fd, SHUT_RDWR);
+    else if (!connection->wantWrite)
+    {
+        connection->wantWrite = true;
+        epoll_event event = {EPOLLIN | EPOLLOUT | EPOLLRDHUP, {}};
+        event.data.u64 = connectionId;
+        epoll_ctl(connection->epoll, EPOLL_CTL_MOD, connection->fd, &event);
+    }
+}
+
+static void Flush(Connection &connection)
+{
+    lock_guard<mutex> lock(connection.lock);
+    while (!connection.output.empty())
+    {
+        ssize_t count = send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (count <= 0)
+            break;
+        connection.output.erase(0, (size_t)count);
+    }
+    if (connection.output.empty() && connection.wantWrite)
+    {
+        connection.wantWrite = false;
+        epoll_event event = {EPOLLIN | EPOLLRDHUP, {}};
+        event.data.u64 = connection.id;
+        epoll_ctl(connection.epoll, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+}
+
+// Records that the connection sits in the game; false if it has gone away
+static bool AttachGame(Server &server, uint64_t connectionId, uint64_t gameId)
+{
+    Connection *connection = FindConnection(server, connectionId);
+    if (!connection)
+        return false;
+    lock_guard<mutex> lock(connection->lock);
+    if (connection->id != connectionId)
+        return false;
+
+    if (connection->games.size() >= 8)
+    {
+        lock_guard<mutex> gamesLock(server.gamesLock);
+        size_t kept = 0;
+        for (uint64_t id : connection->games)
+        {
+            if (PoolFind(server.games, id))
+                connection->games[kept++] = id;
+        }
+        connection->games.resize(kept);
+    }
+    connection->games.push_back(gameId);
+    return true;
+}
+
+static void FreeGame(Server &server, ServerGame &game)
+{
+    uint32_t index = (uint32_t)game.id;
+    game.id = 0;
+    lock_guard<mutex> lock(server.gamesLock);
+    PoolFree(server.games, index);
+}
+
+static uint64_t CreateGame(Server &server, uint64_t white, uint64_t black)
+{
+    ServerGame *game;
+    uint64_t id;
+    {
+        lock_guard<mutex> lock(server.gamesLock);
+        uint32_t index = PoolAllocate(server.games);
+        if (index == POOL_NONE)
+            return 0;
+        id = PoolHandle(server.games, index);
+        game = &PoolSlot(server.games, index);
+    }
+
+    lock_guard<mutex> lock(game->lock);
+    game->id = id;
+    game->players[0] = white;
+    game->players[1] = black;
+    game->state = black ? GAME_PLAYING : GAME_WAITING;
+    SetStartPosition(game->pos);
+    return id;
+}
+
+static void EndGame(Server &server, ServerGame &game, const char *result, const char *reason)
+{
+    string text = "end " + to_string(game.id) + " " + result + " " + reason + "\n";
+    uint64_t players[2] = {game.players[0], game.players[1]};
+    FreeGame(server, game);
+    for (uint64_t player : players)
+    {
+        if (player)
+            Send(server, player, text);
+    }
+}
+
+// Seats two connections in a new game and tells both
+static void StartGame(Server &server, uint64_t white, uint64_t black)
+{
+    uint64_t id = CreateGame(server, white, black);
+    if (!id)
+    {
+        Send(server, white, "error server full\n");
+        Send(server, black, "error server full\n");
+        return;
+    }
+    bool present[2] = {AttachGame(server, white, id), AttachGame(server, black, id)};
+    if (!present[0] || !present[1])
+    {
+        ServerGame *game = FindGame(server, id);
+        lock_guard<mutex> lock(game->lock);
+        if (game->id == id)
+            EndGame(server, *game, present[0] ? "1-0" : "0-1", "abandoned");
+        return;
+    }
+
+    string start = "start " + to_string(id) + "\n";
+    Send(server, white, "game " + to_string(id) + " white\n" + start);
+    Send(server, black, "game " + to_string(id) + " black\n" + start);
+}
+
+static int RepetitionCount(const ServerGame &game)
+{
+    int count = 0;
+    for (int i = game.pos.halfmoveClock - 2; i >= 0; i -= 2)
+        count += game.keys[i] == game.pos.key;
+    return count;
+}
+
+static void HandleMove(Server &server, uint64_t connectionId, uint64_t gameId, const char *text)
+{
+    ServerGame *game = FindGame(server, gameId);
+    if (!game)
+    {
+        Send(server, connectionId, "error no game " + to_string(gameId) + "\n");
+        return;
+    }
+
+    unique_lock<mutex> lock(game->lock);
+    if (game->id != gameId || game->state != GAME_PLAYING)
+    {
+        lock.unlock();
+        Send(server, connectionId, "error game " + to_string(gameId) + " not in play\n");
+        return;
+    }
+    if (game->players[game->pos.whiteToMove ? 0 : 1] != connectionId)
+    {
+        lock.unlock();
+        Send(server, connectionId, "error not your move\n");
+        return;
+    }
+
+    steady_clock::time_point start = steady_clock::now();
+    Move m = ParseUciMove(game->pos, text);
+    if (m == MOVE_NONE)
+    {
+        lock.unlock();
+        Send(server, connectionId, "error illegal move " + string(text) + "\n");
+        return;
+    }
+    game->keys[game->pos.halfmoveClock] = game->pos.key;
+    DoMove(game->pos, m);
+
+    Move replies[MAX_MOVES];
+    const char *result = nullptr, *reason = nullptr;
+    if (GenerateLegalMoves(game->pos, replies) == 0)
+    {
+        bool mate = InCheck(game->pos);
+        result = !mate ? "1/2-1/2" : game->pos.whiteToMove ? "0-1" : "1-0";
+        reason = mate ? "checkmate" : "stalemate";
+    }
+    else if (game->pos.halfmoveClock >= 100)
+        result = "1/2-1/2", reason = "fifty-moves";
+    else if (RepetitionCount(*game) >= 2)
+        result = "1/2-1/2", reason = "repetition";
+    else if (IsInsufficientMaterial(game->pos))
+        result = "1/2-1/2", reason = "insufficient-material";
+    server.validationNs += (uint64_t)duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    server.moves++;
+
+    string update = "move " + to_string(gameId) + " " + MoveToUci(m) + "\n";
+    for (uint64_t player : game->players)
+        Send(server, player, update);
+    if (result)
+        EndGame(server, *game, result, reason);
+}
+
+static void HandleResign(Server &server, uint64_t connectionId, uint64_t gameId, const char *reason)
+{
+    ServerGame *game = FindGame(server, gameId);
+    if (!game)
+        return;
+    lock_guard<mutex> lock(game->lock);
+    if (game->id != gameId)
+        return;
+    if (game->players[0] == connectionId || game->players[1] == connectionId)
+    {
+        const char *result = game->state == GAME_WAITING ? "*" : game->players[0] == connectionId ? "0-1" : "1-0";
+        EndGame(server, *game, result, game->state == GAME_WAITING ? "aborted" : reason);
+    }
+}
+
+static void HandleCommand(Server &server, Connection &connection, const string &line)
+{
+    uint64_t self = connection.id;
+    char command[16] = {}, argument[MAX_LINE] = {};
+    unsigned long long gameId = 0;
+    sscanf(line.c_str(), "%15s %llu %255s", command, &gameId, argument);
+
+    if (strcmp(command, "move") == 0)
+        HandleMove(server, self, gameId, argument);
+    else if (strcmp(command, "play") == 0)
+    {
+        unique_lock<mutex> lock(server.matchLock);
+        uint64_t opponent = server.waiting;
+        if (opponent && opponent != self)
+        {
+            server.waiting = 0;
+            lock.unlock();
+            StartGame(server, opponent, self);
+        }
+        else
+        {
+            server.waiting = self;
+            lock.unlock();
+            Send(server, self, "waiting\n");
+        }
+    }
+    else if (strcmp(command, "new") == 0)
+    {
+        uint64_t id = CreateGame(server, self, 0);
+        if (!id || !AttachGame(server, self, id))
+            Send(server, self, "error server full\n");
+        else
+            Send(server, self, "game " + to_string(id) + " white\n");
+    }
+    else if (strcmp(command, "join") == 0)
+    {
+        ServerGame *game = FindGame(server, gameId);
+        uint64_t white = 0;
+        if (game)
+        {
+            lock_guard<mutex> lock(game->lock);
+            if (game->id == gameId && game->state == GAME_WAITING && game->players[0] != self)
+            {
+                game->players[1] = self;
+                game->state = GAME_PLAYING;
+                white = game->players[0];
+            }
+        }
+        // The seat is taken under the lock so two joiners can't both get it;
+        // if this connection can't hold the game after all, give it back
+        if (white && !AttachGame(server, self, gameId))
+        {
+            lock_guard<mutex> lock(game->lock);
+            if (game->id == gameId && game->players[1] == self)
+            {
+                game->players[1] = 0;
+                game->state = GAME_WAITING;
+            }
+            white = 0;
+        }
+        if (!white)
+        {
+            Send(server, self, "error cannot join " + to_string(gameId) + "\n");
+            return;
+        }
+        string start = "start " + to_string(gameId) + "\n";
+        Send(server, self, "game " + to_string(gameId) + " black\n" + start);
+        Send(server, white, start);
+    }
+    else if (strcmp(command, "resign") == 0)
+        HandleResign(server, self, gameId, "resignation");
+    else if (strcmp(command, "fen") == 0)
+    {
+        ServerGame *game = FindGame(server, gameId);
+        string fen;
+        if (game)
+        {
+            lock_guard<mutex> lock(game->lock);
+            if (game->id == gameId)
+                fen = GetFen(game->pos);
+        }
+        Send(server, self, fen.empty() ? "error no game " + to_string(gameId) + "\n" : "fen " + to_string(gameId) + " " + fen + "\n");
+    }
+    else if (strcmp(command, "quit") == 0)
+        shutdown(connection.fd, SHUT_RDWR);
+    else if (command[0])
+        Send(server, self, "error unknown command " + string(command) + "\n");
+}
+
+// Only the owning worker closes a connection; games it sat in are forfeited
+static void CloseConnection(Server &server, Connection &connection)
+{
+    uint64_t id = connection.id;
+    vector<uint64_t> games;
+    {
+        lock_guard<mutex> lock(connection.lock);
+        close(connection.fd);
+        connection.fd = -1;
+        connection.id = 0;
+        connection.output.clear();
+        connection.input.clear();
+        games.swap(connection.games);
+    }
+    {
+        lock_guard<mutex> lock(server.matchLock);
+        if (server.waiting == id)
+            server.waiting = 0;
+    }
+    for (uint64_t game : games)
+        HandleResign(server, id, game, "abandoned");
+
+    lock_guard<mutex> lock(server.connectionsLock);
+    PoolFree(server.connections, (uint32_t)id);
+}
+
+static void AcceptConnections(Server &server, int listener, int epoll)
+{
+    while (true)
+    {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on Unix sockets
+
+        Connection *connection;
+        uint64_t id;
+        {
+            lock_guard<mutex> lock(server.connectionsLock);
+            uint32_t index = PoolAllocate(server.connections);
+            if (index == POOL_NONE)
+            {
+                close(fd);
+                continue;
+            }
+            id = PoolHandle(server.connections, index);
+            connection = &PoolSlot(server.connections, index);
+        }
+        {
+            lock_guard<mutex> lock(connection->lock);
+            connection->id = id;
+            connection->fd = fd;
+            connection->epoll = epoll;
+            connection->wantWrite = false;
+        }
+
+        epoll_event event = {EPOLLIN | EPOLLRDHUP, {}};
+        event.data.u64 = id;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+static void HandleConnection(Server &server, uint64_t id, uint32_t events)
+{
+    Connection *connection = FindConnection(server, id);
+    if (!connection)
+        return;
+
+    if (events & EPOLLOUT)
+        Flush(*connection);
+
+    bool closed = (events & (EPOLLERR | EPOLLHUP)) != 0;
+    if (events & (EPOLLIN | EPOLLRDHUP))
+    {
+        char buffer[4096];
+        while (true)
+        {
+            ssize_t count = recv(connection->fd, buffer, sizeof(buffer), 0);
+            if (count > 0)
+            {
+                connection->input.append(buffer, (size_t)count);
+                continue;
+            }
+            if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                closed = true;
+            if (count == 0 || errno != EINTR)
+                break;
+        }
+
+        size_t start = 0, end;
+        while ((end = connection->input.find('\n', start)) != string::npos)
+        {
+            HandleCommand(server, *connection, connection->input.substr(start, end - start));
+            start = end + 1;
+        }
+        connection->input.erase(0, start);
+        if (connection->input.size() > MAX_LINE)
+            closed = true;
+    }
+
+    if (closed)
+        CloseConnection(server, *connection);
+}
+
+// Listener tags are small; connection ids always have a generation above bit 32
+static void RunWorker(Server &server)
+{
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    for (size_t i = 0; i < server.listeners.size(); i++)
+    {
+        epoll_event event = {EPOLLIN, {}};
+#ifdef EPOLLEXCLUSIVE
+        event.events |= EPOLLEXCLUSIVE; // Wake one worker per new connection
+#endif
+        event.data.u64 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, server.listeners[i], &event);
+    }
+
+    epoll_event events[256];
+    while (!stopServer)
+    {
+        int count = epoll_wait(epoll, events, 256, 200);
+        for (int i = 0; i < count; i++)
+        {
+            uint64_t tag = events[i].data.u64;
+            if (tag < server.listeners.size())
+                AcceptConnections(server, server.listeners[tag], epoll);
+            else
+                HandleConnection(server, tag, events[i].events);
+        }
+    }
+    close(epoll);
+}
+
+static int Listen(int family, const sockaddr *address, socklen_t length)
+{
+    int fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, address, length) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char **argv)
+{
+    int port = 7777, threads = 4;
+    uint32_t maxGames = 100000;
+    const char *unixPath = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-port") == 0)
+            port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-unix") == 0)
+            unixPath = argv[i + 1];
+        else if (strcmp(argv[i], "-threads") == 0)
+            threads = max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-games") == 0)
+            maxGames = (uint32_t)atoi(argv[i + 1]);
+    }
+
+    // Two sockets per game: ask for as many descriptors as we are allowed
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    Server server;
+    InitPool(server.games, maxGames);
+    InitPool(server.connections, maxGames * 2 + 1024);
+
+    if (port > 0)
+    {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)port);
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        int fd = Listen(AF_INET, (sockaddr *)&address, sizeof(address));
+        if (fd < 0)
+        {
+            printf("Could not listen on port %d\n", port);
+            return 1;
+        }
+        server.listeners.push_back(fd);
+    }
+    if (unixPath)
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, unixPath, sizeof(address.sun_path) - 1);
+        unlink(unixPath);
+        int fd = Listen(AF_UNIX, (sockaddr *)&address, sizeof(address));
+        if (fd < 0)
+        {
+            printf("Could not listen on %s\n", unixPath);
+            return 1;
+        }
+        server.listeners.push_back(fd);
+    }
+    if (server.listeners.empty())
+    {
+        printf("Usage: %s [-port N] [-unix path] [-threads N] [-games N]\n", argv[0]);
+        return 1;
+    }
+
+    vector<thread> workers;
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(RunWorker, ref(server));
+    printf("Serving on %s%s%s with %d threads\n", port > 0 ? ("port " + to_string(port)).c_str() : "",
+           port > 0 && unixPath ? " and " : "", unixPath ? unixPath : "", threads);
+    fflush(stdout);
+
+    uint64_t lastMoves = 0, lastNs = 0;
+    while (!stopServer)
+    {
+        this_thread::sleep_for(seconds(5));
+        uint64_t moves = server.moves, ns = server.validationNs;
+        uint32_t games, connections;
+        {
+            lock_guard<mutex> lock(server.gamesLock);
+            games = server.games.live;
+        }
+        {
+            lock_guard<mutex> lock(server.connectionsLock);
+            connections = server.connections.live;
+        }
+        if (moves != lastMoves)
+        {
+            printf("%u games, %u connections, %llu moves/s, %.2f us per move validated\n", games, connections,
+                   (unsigned long long)(moves - lastMoves) / 5, (ns - lastNs) / 1000.0 / (moves - lastMoves));
+            fflush(stdout);
+        }
+        lastMoves = moves;
+        lastNs = ns;
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+    for (int fd : server.listeners)
+        close(fd);
+    if (unixPath)
+        unlink(unixPath);
+    return 0;
+}
@@ -0,0 +1,729 @@
+#include "GameState.h"
+#include "Profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+static const int startBoard[8][8] = {
+    {-4, -2, -3, -5, -6, -3, -2, -4},
+    {-1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {1, 1, 1, 1, 1, 1, 1, 1},
+    {4, 2, 3, 5, 6, 3, 2, 4}};
+
+static void UnpackBoard(const GameState &state, int board[8][8])
+{
+    for (int row = 0; row < 8; row++)
+        for (int col = 0; col < 8; col++)
+            board[row][col] = PieceAt(state, row, col);
+}
+
+void ResetGameState(GameState &state)
+{
+    memset(&state, 0, sizeof(state));
+    state.kings[0] = state.kings[1] = -1;
+    for (int row = 0; row < 8; row++)
+        for (int col = 0; col < 8; col++)
+            SetPieceAt(state, row, col, startBoard[row][col]);
+    state.flags = GAME_WHITE_TO_MOVE;
+    state.enPassant = -1;
+    state.promotionSquare = -1;
+}
+
+void GetGamePosition(const GameState &state, Position &pos)
+{
+    // Rook capture hone par flag nahi badalta, isliye board bhi check karo
+    bool whiteKingHome = !(state.moved & WHITE_KING_MOVED) && PieceAt(state, 7, 4) == 6;
+    bool blackKingHome = !(state.moved & BLACK_KING_MOVED) && PieceAt(state, 0, 4) == -6;
+    uint8_t castling = 0;
+    if (whiteKingHome && !(state.moved & WHITE_ROOK_KINGSIDE_MOVED) && PieceAt(state, 7, 7) == 4)
+        castling |= WHITE_KINGSIDE;
+    if (whiteKingHome && !(state.moved & WHITE_ROOK_QUEENSIDE_MOVED) && PieceAt(state, 7, 0) == 4)
+        castling |= WHITE_QUEENSIDE;
+    if (blackKingHome && !(state.moved & BLACK_ROOK_KINGSIDE_MOVED) && PieceAt(state, 0, 7) == -4)
+        castling |= BLACK_KINGSIDE;
+    if (blackKingHome && !(state.moved & BLACK_ROOK_QUEENSIDE_MOVED) && PieceAt(state, 0, 0) == -4)
+        castling |= BLACK_QUEENSIDE;
+
+    int board[8][8];
+    UnpackBoard(state, board);
+    int epRow = state.enPassant < 0 ? -1 : state.enPassant / 8;
+    int epCol = state.enPassant < 0 ? -1 : state.enPassant % 8;
+    SetFromBoard(pos, board, IsWhiteTurn(state), castling, epRow, epCol);
+}
+
+void SetGamePosition(GameState &state, const Position &pos)
+{
+    memset(&state, 0, sizeof(state));
+    state.kings[0] = state.kings[1] = -1;
+    for (int sq = 0; sq < 64; sq++)
+        SetPieceAt(state, sq / 8, sq % 8, pos.board[sq]);
+    state.flags = pos.whiteToMove ? GAME_WHITE_TO_MOVE : 0;
+    state.enPassant = pos.enPassant;
+    state.promotionSquare = -1;
+
+    if (!(pos.castling & WHITE_KINGSIDE))
+        state.moved |= WHITE_ROOK_KINGSIDE_MOVED;
+    if (!(pos.castling & WHITE_QUEENSIDE))
+        state.moved |= WHITE_ROOK_QUEENSIDE_MOVED;
+    if (!(pos.castling & (WHITE_KINGSIDE | WHITE_QUEENSIDE)))
+        state.moved |= WHITE_KING_MOVED;
+    if (!(pos.castling & BLACK_KINGSIDE))
+        state.moved |= BLACK_ROOK_KINGSIDE_MOVED;
+    if (!(pos.castling & BLACK_QUEENSIDE))
+        state.moved |= BLACK_ROOK_QUEENSIDE_MOVED;
+    if (!(pos.castling & (BLACK_KINGSIDE | BLACK_QUEENSIDE)))
+        state.moved |= BLACK_KING_MOVED;
+
+    UpdateCheckState(state);
+}
+
+// File format is unchanged from when these were globals: 64 ints, then the
+// turn, en passant square and moved flags
+bool SaveGameState(const GameState &state, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    int board[8][8];
+    UnpackBoard(state, board);
+    bool isWhiteTurn = IsWhiteTurn(state);
+    int enPassantRow = state.enPassant < 0 ? -1 : state.enPassant / 8;
+    int enPassantCol = state.enPassant < 0 ? -1 : state.enPassant % 8;
+    fwrite(board, sizeof(int), 64, file);
+    fwrite(&isWhiteTurn, sizeof(bool), 1, file);
+    fwrite(&enPassantRow, sizeof(int), 1, file);
+    fwrite(&enPassantCol, sizeof(int), 1, file);
+    for (int bit = 0; bit < 6; bit++)
+    {
+        bool moved = (state.moved >> bit) & 1;
+        fwrite(&moved, sizeof(bool), 1, file);
+    }
+
+    fclose(file);
+    return true;
+}
+
+bool LoadGameState(GameState &state, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    int board[8][8];
+    bool isWhiteTurn = true;
+    int enPassantRow = -1, enPassantCol = -1;
+    bool moved[6] = {};
+    bool ok = fread(board, sizeof(int), 64, file) == 64 &&
+              fread(&isWhiteTurn, sizeof(bool), 1, file) == 1 &&
+              fread(&enPassantRow, sizeof(int), 1, file) == 1 &&
+              fread(&enPassantCol, sizeof(int), 1, file) == 1 &&
+              fread(moved, sizeof(bool), 6, file) == 6;
+    fclose(file);
+    if (!ok)
+        return false;
+
+    ResetGameState(state);
+    for (int row = 0; row < 8; row++)
+        for (int col = 0; col < 8; col++)
+            SetPieceAt(state, row, col, max(-6, min(6, board[row][col])));
+    SetGameFlag(state, GAME_WHITE_TO_MOVE, isWhiteTurn);
+    if (enPassantRow >= 0 && enPassantRow < 8 && enPassantCol >= 0 && enPassantCol < 8)
+        state.enPassant = (int8_t)(enPassantRow * 8 + enPassantCol);
+    for (int bit = 0; bit < 6; bit++)
+        state.moved |= moved[bit] << bit;
+    UpdateCheckState(state);
+    return true;
+}
+
+void UpdateCheckState(GameState &state)
+{
+    state.kings[0] = state.kings[1] = -1;
+    for (int sq = 63; sq >= 0; sq--)
+    {
+        // Neeche se upar, taaki do king hon to pehla wala (IsKingInCheck jaisa) rahe
+        int piece = PieceAt(state, sq / 8, sq % 8);
+        if (piece == 6 || piece == -6)
+            state.kings[piece < 0] = (int8_t)sq;
+    }
+
+    state.checkers = 0;
+    bool isWhite = IsWhiteTurn(state);
+    int king = KingSquare(state, isWhite);
+    if (king == -1)
+        return;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        int piece = PieceAt(state, sq / 8, sq % 8);
+        if (piece != 0 && (piece > 0) != isWhite &&
+            IsValidMove(state, piece, sq / 8, sq % 8, king / 8, king % 8, false))
+            state.checkers |= 1ULL << sq;
+    }
+}
+
+void InitGameStatePool(GameStatePool &pool, uint32_t capacity)
+{
+    InitPool(pool, capacity);
+}
+
+GameState *CreateGameState(GameStatePool &pool, uint64_t &handle)
+{
+    uint32_t index = PoolAllocate(pool);
+    if (index == POOL_NONE)
+        return nullptr;
+    GameState &state = PoolSlot(pool, index);
+    ResetGameState(state);
+    handle = PoolHandle(pool, index);
+    return &state;
+}
+
+GameState *FindGameState(GameStatePool &pool, uint64_t handle)
+{
+    return PoolFind(pool, handle);
+}
+
+void DestroyGameState(GameStatePool &pool, uint64_t handle)
+{
+    if (PoolFind(pool, handle))
+        PoolFree(pool, (uint32_t)handle);
+}
+
+bool WouldBeInCheck(const GameState &state, int piece, int startRow, int startCol, int endRow, int endCol, bool isWhite)
+{
+    PROFILE_COUNT(COUNT_WOULD_BE_IN_CHECK);
+    GameState tempState = state;
+    SetPieceAt(tempState, endRow, endCol, piece);
+    SetPieceAt(tempState, startRow, startCol, 0);
+
+    return IsKingInCheck(tempState, isWhite);
+}
+
+bool CanCastle(const GameState &state, bool isWhite, bool kingside)
+{
+    PROFILE_COUNT(COUNT_CAN_CASTLE);
+    int row = isWhite ? 7 : 0;
+    int kingCol = 4;
+    int rookCol = kingside ? 7 : 0;
+    int step = kingside ? 1 : -1;
+
+    // Agar king aur rook move kare to castling not possible
+    int kingMoved = isWhite ? WHITE_KING_MOVED : BLACK_KING_MOVED;
+    int rookMoved = isWhite ? (kingside ? WHITE_ROOK_KINGSIDE_MOVED : WHITE_ROOK_QUEENSIDE_MOVED)
+                            : (kingside ? BLACK_ROOK_KINGSIDE_MOVED : BLACK_ROOK_QUEENSIDE_MOVED);
+    if (state.moved & (kingMoved | rookMoved))
+        return false;
+
+    // Agar beech ki grid khaali hai tabhi castle hoga
+    for (int col = kingCol + step; col != rookCol; col += step)
+    {
+        if (PieceAt(state, row, col) != 0)
+            return false;
+    }
+
+    // King check me to nahi hai
+    for (int col = kingCol; col != kingCol + 2 * step; col += step)
+    {
+        GameState tempState = state;
+        SetPieceAt(tempState, row, col, isWhite ? 6 : -6);
+        SetPieceAt(tempState, row, kingCol, 0);
+
+        if (IsKingInCheck(tempState, isWhite))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Beech ke squares khaali hain ya nahi
+static bool IsPathClear(const GameState &state, int startRow, int startCol, int rowDiff, int colDiff)
+{
+    int stepRow = (rowDiff == 0) ? 0 : (rowDiff > 0 ? 1 : -1);
+    int stepCol = (colDiff == 0) ? 0 : (colDiff > 0 ? 1 : -1);
+
+    for (int i = 1; i < max(abs(rowDiff), abs(colDiff)); i++)
+    {
+        if (PieceAt(state, startRow + i * stepRow, startCol + i * stepCol) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsValidMove(const GameState &state, int piece, int startRow, int startCol, int endRow, int endCol, bool validateCheck)
+{
+    PROFILE_COUNT(COUNT_IS_VALID_MOVE);
+    if (endRow < 0 || endRow >= 8 || endCol < 0 || endCol >= 8)
+    {
+        return false;
+    }
+
+    // Apna piece capture nahi kar sakte
+    int target = PieceAt(state, endRow, endCol);
+    if (target != 0 && (target * piece > 0))
+    {
+        return false;
+    }
+
+    int rowDiff = endRow - startRow;
+    int colDiff = endCol - startCol;
+    bool moves = false;
+
+    switch (abs(piece))
+    {
+    case 1:
+    { // Pawn
+        int direction = (piece > 0) ? -1 : 1;
+
+        // Normal move forward
+        if (colDiff == 0 && rowDiff == direction && target == 0)
+            moves = true;
+
+        // Double move from starting position
+        else if (colDiff == 0 && rowDiff == 2 * direction &&
+                 ((piece == 1 && startRow == 6) || (piece == -1 && startRow == 1)) &&
+                 PieceAt(state, startRow + direction, startCol) == 0 &&
+                 target == 0)
+            moves = true;
+
+        // Capture diagonally
+        else if (abs(colDiff) == 1 && rowDiff == direction && target * piece < 0)
+            moves = true;
+
+        // En passant
+        else if (abs(colDiff) == 1 && rowDiff == direction &&
+                 endRow * 8 + endCol == state.enPassant)
+            moves = true;
+        break;
+    }
+    case 2: // Knight
+        moves = (abs(rowDiff) == 2 && abs(colDiff) == 1) || (abs(rowDiff) == 1 && abs(colDiff) == 2);
+        break;
+    case 3: // Bishop
+        if (abs(rowDiff) == abs(colDiff))
+        {
+            if (!IsPathClear(state, startRow, startCol, rowDiff, colDiff))
+                return false;
+            moves = true;
+        }
+        break;
+    case 4: // Rook
+        if (rowDiff == 0 || colDiff == 0)
+        {
+            if (!IsPathClear(state, startRow, startCol, rowDiff, colDiff))
+                return false;
+            moves = true;
+        }
+        break;
+    case 5: // Queen
+        if (abs(rowDiff) == abs(colDiff) || rowDiff == 0 || colDiff == 0)
+        {
+            if (!IsPathClear(state, startRow, startCol, rowDiff, colDiff))
+                return false;
+            moves = true;
+        }
+        break;
+    case 6: // King
+        // Normal king move, ya castling
+        if (abs(rowDiff) <= 1 && abs(colDiff) <= 1)
+            moves = true;
+        else if (abs(colDiff) == 2 && rowDiff == 0)
+            moves = CanCastle(state, piece > 0, colDiff > 0);
+        break;
+    }
+
+    if (!moves)
+        return false;
+    return !(validateCheck && WouldBeInCheck(state, piece, startRow, startCol, endRow, endCol, piece > 0));
+}
+
+void HandlePieceMovement(const GameState &state, int row, int col, int possibleMoves[8][8])
+{
+    PROFILE_SCOPE(ZONE_RULES, "HandlePieceMovement");
+    PROFILE_COUNT(COUNT_HANDLE_PIECE_MOVEMENT);
+    int piece = PieceAt(state, row, col);
+    if (piece == 0)
+        return;
+
+    for (int r = 0; r < 8; r++)
+    {
+        for (int c = 0; c < 8; c++)
+        {
+            possibleMoves[r][c] = 0;
+        }
+    }
+
+    auto isValid = [](int r, int c)
+    {
+        return r >= 0 && r < 8 && c >= 0 && c < 8;
+    };
+
+    switch (abs(piece))
+    {
+    case 1:
+    { // Pawn
+        int direction = (piece > 0) ? -1 : 1;
+
+        // Single move forward
+        if (isValid(row + direction, col) && PieceAt(state, row + direction, col) == 0)
+        {
+            if (IsValidMove(state, piece, row, col, row + direction, col))
+            {
+                possibleMoves[row + direction][col] = 1;
+            }
+        }
+
+        // Double move from starting position
+        if (((piece == 1 && row == 6) || (piece == -1 && row == 1)) &&
+            isValid(row + 2 * direction, col) && PieceAt(state, row + 2 * direction, col) == 0 &&
+            PieceAt(state, row + direction, col) == 0)
+        {
+            if (IsValidMove(state, piece, row, col, row + 2 * direction, col))
+            {
+                possibleMoves[row + 2 * direction][col] = 1;
+            }
+        }
+
+        // Capturing diagonally
+        for (int side = -1; side <= 1; side += 2)
+        {
+            if (isValid(row + direction, col + side) && PieceAt(state, row + direction, col + side) * piece < 0)
+            {
+                if (IsValidMove(state, piece, row, col, row + direction, col + side))
+                {
+                    possibleMoves[row + direction][col + side] = 1;
+                }
+            }
+        }
+
+        // En passant
+        if (state.enPassant != -1)
+        {
+            int enPassantRow = state.enPassant / 8, enPassantCol = state.enPassant % 8;
+            if (abs(col - enPassantCol) == 1 && row + direction == enPassantRow)
+            {
+                if (IsValidMove(state, piece, row, col, enPassantRow, enPassantCol))
+                {
+                    possibleMoves[enPassantRow][enPassantCol] = 1;
+                }
+            }
+        }
+        break;
+    }
+    case 2:
+    { // Knight
+        int moves[8][2] = {
+            {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+
+        for (auto &move : moves)
+        {
+            int r = row + move[0], c = col + move[1];
+            if (isValid(r, c) && PieceAt(state, r, c) * piece <= 0)
+            {
+                if (IsValidMove(state, piece, row, col, r, c))
+                {
+                    possibleMoves[r][c] = 1;
+                }
+            }
+        }
+        break;
+    }
+    case 3: // Bishop
+    case 4: // Rook
+    case 5:
+    { // Queen
+        int directions[8][2] = {
+            {-1, -1}, {-1, 1}, {1, -1}, {1, 1}, // Bishop
+            {-1, 0},
+            {1, 0},
+            {0, -1},
+            {0, 1} // Rook
+        };
+
+        // Bishop pehle 4, rook baaki 4, queen saari directions
+        int first = (abs(piece) == 4) ? 4 : 0;
+        int last = (abs(piece) == 3) ? 4 : 8;
+        for (int i = first; i < last; i++)
+        {
+            int stepRow = directions[i][0], stepCol = directions[i][1];
+            for (int dist = 1; dist < 8; dist++)
+            {
+                int r = row + dist * stepRow, c = col + dist * stepCol;
+                if (!isValid(r, c))
+                    break;
+                int target = PieceAt(state, r, c);
+                if (target != 0 && target * piece > 0)
+                    break;
+
+                if (IsValidMove(state, piece, row, col, r, c))
+                {
+                    possibleMoves[r][c] = 1;
+                }
+
+                if (target * piece < 0)
+                    break;
+            }
+        }
+        break;
+    }
+    case 6:
+    { // King
+        int moves[8][2] = {
+            {-1, -1}, {-1, 1}, {1, -1}, {1, 1}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+        for (auto &move : moves)
+        {
+            int r = row + move[0], c = col + move[1];
+            if (isValid(r, c) && PieceAt(state, r, c) * piece <= 0)
+            {
+                if (IsValidMove(state, piece, row, col, r, c))
+                {
+                    possibleMoves[r][c] = 1;
+                }
+            }
+        }
+
+        // Castling moves
+        bool isWhite = piece > 0;
+        if (!(state.moved & (isWhite ? WHITE_KING_MOVED : BLACK_KING_MOVED)))
+        {
+            // Kingside
+            if (CanCastle(state, isWhite, true))
+            {
+                possibleMoves[row][col + 2] = 1;
+            }
+            // Queenside
+            if (CanCastle(state, isWhite, false))
+            {
+                possibleMoves[row][col - 2] = 1;
+            }
+        }
+        break;
+    }
+    }
+}
+
+bool IsKingInCheck(const GameState &state, bool isWhite)
+{
+    PROFILE_COUNT(COUNT_IS_KING_IN_CHECK);
+    int kingRow = -1, kingCol = -1;
+    int kingPiece = isWhite ? 6 : -6;
+
+    // Rakha hua king square, agar king abhi bhi wahin hai
+    int king = KingSquare(state, isWhite);
+    if (king != -1 && PieceAt(state, king / 8, king % 8) == kingPiece)
+    {
+        kingRow = king / 8;
+        kingCol = king % 8;
+    }
+    for (int sq = 0; sq < 64 && kingRow == -1; sq++)
+    {
+        if (PieceAt(state, sq / 8, sq % 8) == kingPiece)
+        {
+            kingRow = sq / 8;
+            kingCol = sq % 8;
+        }
+    }
+
+    if (kingRow == -1 || kingCol == -1)
+        return false;
+
+    for (int row = 0; row < 8; row++)
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            int piece = PieceAt(state, row, col);
+            if (piece != 0 && (piece * kingPiece < 0))
+            {
+                if (IsValidMove(state, piece, row, col, kingRow, kingCol, false))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool IsCheckmate(const GameState &state, bool isWhite)
+{
+    PROFILE_SCOPE(ZONE_RULES, "IsCheckmate");
+    PROFILE_COUNT(COUNT_IS_CHECKMATE);
+    if (!IsKingInCheck(state, isWhite))
+    {
+        return false;
+    }
+
+    for (int startRow = 0; startRow < 8; startRow++)
+    {
+        for (int startCol = 0; startCol < 8; startCol++)
+        {
+            int piece = PieceAt(state, startRow, startCol);
+
+            if (piece != 0 && ((isWhite && piece > 0) || (!isWhite && piece < 0)))
+            {
+
+                for (int endRow = 0; endRow < 8; endRow++)
+                {
+                    for (int endCol = 0; endCol < 8; endCol++)
+                    {
+                        GameState tempState = state;
+                        SetPieceAt(tempState, endRow, endCol, piece);
+                        SetPieceAt(tempState, startRow, startCol, 0);
+
+                        if (!IsKingInCheck(tempState, isWhite))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void UpdateLegalMoveCache(LegalMoveCache &cache, const GameState &state)
+{
+    if (cache.valid && memcmp(&cache.state, &state, sizeof(state)) == 0)
+        return;
+
+    PROFILE_SCOPE(ZONE_RULES, "UpdateLegalMoveCache");
+    cache.state = state;
+    cache.valid = true;
+    bool isWhite = IsWhiteTurn(state);
+    for (int sq = 0; sq < 64; sq++)
+    {
+        cache.destinations[sq] = 0;
+        int piece = PieceAt(state, sq / 8, sq % 8);
+        if (piece == 0 || (piece > 0) != isWhite)
+            continue;
+
+        // Click validation always went through IsValidMove, so the cache does too
+        for (int target = 0; target < 64; target++)
+        {
+            if (IsValidMove(state, piece, sq / 8, sq % 8, target / 8, target % 8))
+                cache.destinations[sq] |= 1ULL << target;
+        }
+    }
+}
+
+int ApplyGameMove(GameState &state, int startRow, int startCol, int endRow, int endCol)
+{
+    PROFILE_SCOPE(ZONE_RULES, "ApplyGameMove");
+    int piece = PieceAt(state, startRow, startCol);
+    bool isWhite = piece > 0;
+    bool isWhiteTurn = IsWhiteTurn(state);
+    int effects = 0;
+
+    // Handle castling
+    if (abs(piece) == 6 && abs(startCol - endCol) == 2)
+    {
+        bool kingside = endCol > startCol;
+        int rookCol = kingside ? 7 : 0;
+        int newRookCol = kingside ? 5 : 3;
+
+        SetPieceAt(state, endRow, newRookCol, PieceAt(state, endRow, rookCol));
+        SetPieceAt(state, endRow, rookCol, 0);
+        effects |= MOVE_CASTLE;
+    }
+
+    // Handle en passant
+    if (abs(piece) == 1 && endCol != startCol && PieceAt(state, endRow, endCol) == 0)
+    {
+        SetPieceAt(state, startRow, endCol, 0);
+    }
+
+    // Make the move
+    int originalPiece = PieceAt(state, endRow, endCol);
+    SetPieceAt(state, endRow, endCol, piece);
+    SetPieceAt(state, startRow, startCol, 0);
+    if (originalPiece != 0)
+        effects |= MOVE_CAPTURE;
+
+    // En Passant target
+    if (abs(piece) == 1 && abs(endRow - startRow) == 2)
+        state.enPassant = (int8_t)(((endRow + startRow) / 2) * 8 + endCol);
+    else
+        state.enPassant = -1;
+
+    // Check / CheckMate
+    if (IsKingInCheck(state, !isWhiteTurn))
+    {
+        effects |= MOVE_CHECK;
+        if (IsCheckmate(state, !isWhiteTurn))
+        {
+            effects |= MOVE_CHECKMATE;
+            SetGameFlag(state, GAME_OVER, true);
+        }
+    }
+
+    // Check for pawn promotion
+    if (abs(piece) == 1 && (endRow == 0 || endRow == 7))
+    {
+        SetGameFlag(state, GAME_PROMOTION_PENDING, true);
+        SetGameFlag(state, GAME_WHITE_PROMOTING, isWhiteTurn);
+        state.promotionSquare = (int8_t)(endRow * 8 + endCol);
+        effects |= MOVE_PROMOTION;
+    }
+
+    // Update castling flags
+    if (abs(piece) == 6)
+    {
+        state.moved |= isWhite ? WHITE_KING_MOVED : BLACK_KING_MOVED;
+    }
+    if (abs(piece) == 4)
+    {
+        if (startCol == 0)
+            state.moved |= isWhite ? WHITE_ROOK_QUEENSIDE_MOVED : BLACK_ROOK_QUEENSIDE_MOVED;
+        if (startCol == 7)
+            state.moved |= isWhite ? WHITE_ROOK_KINGSIDE_MOVED : BLACK_ROOK_KINGSIDE_MOVED;
+    }
+
+    // Validate move doesn't leave king in check
+    if (IsKingInCheck(state, isWhiteTurn))
+    {
+        SetPieceAt(state, startRow, startCol, piece);
+        SetPieceAt(state, endRow, endCol, originalPiece);
+    }
+    else
+    {
+        SetGameFlag(state, GAME_WHITE_TO_MOVE, !isWhiteTurn);
+    }
+    UpdateCheckState(state);
+    return effects;
+}
+
+int ApplyPromotion(GameState &state, int choice)
+{
+    PROFILE_SCOPE(ZONE_RULES, "ApplyPromotion");
+    bool isWhitePromoting = HasGameFlag(state, GAME_WHITE_PROMOTING);
+    int effects = 0;
+    SetPieceAt(state, state.promotionSquare / 8, state.promotionSquare % 8, isWhitePromoting ? (5 - choice) : -(5 - choice));
+    SetGameFlag(state, GAME_PROMOTION_PENDING, false);
+    state.promotionSquare = -1;
+
+    // ApplyGameMove already handed the move over when the pawn arrived
+    if (IsKingInCheck(state, !isWhitePromoting))
+    {
+        effects |= MOVE_CHECK;
+        if (IsCheckmate(state, !isWhitePromoting))
+        {
+            effects |= MOVE_CHECKMATE;
+            SetGameFlag(state, GAME_OVER, true);
+        }
+    }
+    UpdateCheckState(state);
+    return effects;
+}
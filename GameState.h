@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ObjectPool.h"
+#include "Position.h"
+#include <stdint.h>
+
+// Everything the rules need to know about one game on the board screen, packed
+// into a fraction of a cache line: pieces are 4-bit signed codes (1-6 white,
+// -1..-6 black, the same values the board array always used), two squares per
+// byte, and the turn, castling and promotion state are bits. King squares and
+// the checkers are kept up to date by the move functions, so drawing never has
+// to run the rules. UI state such as the selected square lives with the UI.
+
+enum GameFlags
+{
+    GAME_WHITE_TO_MOVE = 1,
+    GAME_OVER = 2,
+    GAME_PROMOTION_PENDING = 4,
+    GAME_WHITE_PROMOTING = 8
+};
+
+// King and rook "has moved" bits; castling needs both pieces unmoved
+enum GameMovedFlags
+{
+    WHITE_KING_MOVED = 1,
+    WHITE_ROOK_KINGSIDE_MOVED = 2,
+    WHITE_ROOK_QUEENSIDE_MOVED = 4,
+    BLACK_KING_MOVED = 8,
+    BLACK_ROOK_KINGSIDE_MOVED = 16,
+    BLACK_ROOK_QUEENSIDE_MOVED = 32
+};
+
+struct GameState
+{
+    uint8_t squares[32];    // Square row*8+col in the low nibble of byte sq/2 when even, high nibble when odd
+    uint8_t flags;          // GameFlags
+    uint8_t moved;          // GameMovedFlags
+    int8_t enPassant;       // Square a pawn can capture en passant on, -1 if none
+    int8_t promotionSquare; // Pawn waiting for its new piece, -1 if none
+    int8_t kings[2];        // [0 white / 1 black] king square, -1 if missing
+    uint8_t unused[2];      // Keeps the struct free of padding so states can be memcmp'd
+    uint64_t checkers;      // Pieces giving check to the side to move, bit row*8+col
+};
+
+static_assert(sizeof(GameState) == 48, "GameState should have no padding and fit in one cache line");
+
+inline int PieceAt(const GameState &state, int row, int col)
+{
+    int sq = row * 8 + col;
+    int code = (state.squares[sq >> 1] >> ((sq & 1) * 4)) & 15;
+    return code >= 8 ? code - 16 : code;
+}
+
+inline void SetPieceAt(GameState &state, int row, int col, int piece)
+{
+    int sq = row * 8 + col, shift = (sq & 1) * 4;
+    state.squares[sq >> 1] = (uint8_t)((state.squares[sq >> 1] & ~(15 << shift)) | ((piece & 15) << shift));
+    if (piece == 6 || piece == -6)
+        state.kings[piece < 0] = (int8_t)sq;
+}
+
+inline bool IsWhiteTurn(const GameState &state)
+{
+    return (state.flags & GAME_WHITE_TO_MOVE) != 0;
+}
+
+// Read from the state, no rules work
+inline bool IsInCheck(const GameState &state)
+{
+    return state.checkers != 0;
+}
+
+inline int KingSquare(const GameState &state, bool isWhite)
+{
+    return state.kings[isWhite ? 0 : 1];
+}
+
+inline bool HasGameFlag(const GameState &state, int flag)
+{
+    return (state.flags & flag) != 0;
+}
+
+inline void SetGameFlag(GameState &state, int flag, bool on)
+{
+    state.flags = (uint8_t)(on ? state.flags | flag : state.flags & ~flag);
+}
+
+void ResetGameState(GameState &state);
+// Recomputes kings and checkers after the board was edited directly; the move functions do it themselves
+void UpdateCheckState(GameState &state);
+void GetGamePosition(const GameState &state, Position &pos); // Headless Position for the engine, book and tablebases
+// The other way, for tools that start from a FEN: lost castling rights become moved bits
+void SetGamePosition(GameState &state, const Position &pos);
+bool SaveGameState(const GameState &state, const char *path);
+bool LoadGameState(GameState &state, const char *path);
+
+// Fixed-size pool: game states are created and destroyed without touching the heap
+typedef ObjectPool<GameState, 256> GameStatePool;
+
+void InitGameStatePool(GameStatePool &pool, uint32_t capacity);
+// Starts from the initial position; returns nullptr when the pool is full
+GameState *CreateGameState(GameStatePool &pool, uint64_t &handle);
+GameState *FindGameState(GameStatePool &pool, uint64_t handle);
+void DestroyGameState(GameStatePool &pool, uint64_t handle);
+
+// Board screen rules, row 0 = rank 8
+bool IsValidMove(const GameState &state, int piece, int startRow, int startCol, int endRow, int endCol, bool validateCheck = true);
+bool IsKingInCheck(const GameState &state, bool isWhite);
+bool IsCheckmate(const GameState &state, bool isWhite);
+bool WouldBeInCheck(const GameState &state, int piece, int startRow, int startCol, int endRow, int endCol, bool isWhite);
+bool CanCastle(const GameState &state, bool isWhite, bool kingside);
+void HandlePieceMovement(const GameState &state, int row, int col, int possibleMoves[8][8]);
+
+// Legal destinations of every piece of the side to move, as one bitboard per
+// from-square (bit row*8+col). Worked out with the rules
+// above but only when the position changes; the board screen reads it every
+// frame for highlighting and click validation.
+struct LegalMoveCache
+{
+    GameState state; // Position the cache was computed for
+    bool valid;
+    uint64_t destinations[64];
+};
+
+// Recomputes only if state differs from the cached one
+void UpdateLegalMoveCache(LegalMoveCache &cache, const GameState &state);
+
+inline bool IsCachedLegalMove(const LegalMoveCache &cache, int startRow, int startCol, int endRow, int endCol)
+{
+    return (cache.destinations[startRow * 8 + startCol] >> (endRow * 8 + endCol)) & 1;
+}
+
+// What a move did, for sounds and messages
+enum MoveEffects
+{
+    MOVE_APPLIED = 1,
+    MOVE_CAPTURE = 2,
+    MOVE_CASTLE = 4,
+    MOVE_CHECK = 8,
+    MOVE_CHECKMATE = 16,
+    MOVE_PROMOTION = 32 // A piece has to be picked with ApplyPromotion
+};
+
+// Plays a move already checked with IsValidMove; returns MoveEffects
+int ApplyGameMove(GameState &state, int startRow, int startCol, int endRow, int endCol);
+// choice 0-3 = queen, rook, bishop, knight. The side to move was already
+// switched by ApplyGameMove, so a move plus its promotion is one turn
+int ApplyPromotion(GameState &state, int choice);
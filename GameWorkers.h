@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Pgn.h"
+#include "Search.h"
+#include <math.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Runs a search job over every game of a PGN file for the batch tools
+// (annotate, puzzles). Games are spread over the threads, one game per
+// thread at a time, each thread with its own single-threaded engine: nothing
+// is shared while searching, so the speed grows with the number of cores.
+// The engine's table is cleared before every game, which keeps the results
+// the same whatever the thread count, and they are handed back in input
+// order.
+
+#define GAMES_PENDING_PER_THREAD 4 // Games read ahead or waiting to be handed back in order
+
+// Expected score in percent for the side with this score
+inline double ExpectedScore(int score)
+{
+    if (IsMateScore(score))
+        return score > 0 ? 100 : 0;
+    return 100 / (1 + exp(-0.00368208 * score));
+}
+
+template <typename Result>
+struct GameWorkerQueue
+{
+    std::mutex lock;
+    std::condition_variable wakeWorkers;
+    std::condition_variable wakeReader;
+    std::deque<std::pair<size_t, PgnGame>> jobs;
+    bool done = false;
+    size_t read = 0;
+    std::map<size_t, std::pair<PgnGame, Result>> finished; // Waiting for the games before them
+    size_t written = 0;
+};
+
+// analyse(engine, game, index) runs on a worker thread and may change the game;
+// finish(game, index, result) gets the games back in input order, one call at
+// a time, so it can write output and add up counts without locking. Returns
+// the number of games read.
+template <typename Result>
+size_t RunGameWorkers(PgnReader &reader, int threads, int hashMegabytes,
+                      const std::function<Result(Engine &, PgnGame &, size_t)> &analyse,
+                      const std::function<void(PgnGame &, size_t, Result &)> &finish)
+{
+    GameWorkerQueue<Result> queue;
+    auto work = [&]()
+    {
+        Engine engine;
+        InitEngine(engine, hashMegabytes, 1);
+        while (true)
+        {
+            std::pair<size_t, PgnGame> job;
+            {
+                std::unique_lock<std::mutex> lock(queue.lock);
+                queue.wakeWorkers.wait(lock, [&] { return !queue.jobs.empty() || queue.done; });
+                if (queue.jobs.empty())
+                    return;
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+
+            ClearEngine(engine);
+            Result result = analyse(engine, job.second, job.first);
+
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.finished.emplace(job.first, std::make_pair(std::move(job.second), std::move(result)));
+            auto next = queue.finished.find(queue.written);
+            while (next != queue.finished.end())
+            {
+                finish(next->second.first, next->first, next->second.second);
+                queue.finished.erase(next);
+                queue.written++;
+                next = queue.finished.find(queue.written);
+            }
+            queue.wakeReader.notify_one();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(work);
+
+    // Read ahead only so far: a long game holds up the output, not memory
+    PgnGame game;
+    size_t pending = (size_t)threads * GAMES_PENDING_PER_THREAD;
+    while (ReadPgnGame(reader, game))
+    {
+        std::unique_lock<std::mutex> lock(queue.lock);
+        queue.wakeReader.wait(lock, [&] { return queue.read - queue.written < pending; });
+        queue.jobs.emplace_back(queue.read++, std::move(game));
+        queue.wakeWorkers.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue.lock);
+        queue.done = true;
+    }
+    queue.wakeWorkers.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+    return queue.written;
+}
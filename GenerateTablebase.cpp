@@ -0,0 +1,38 @@
+#include "Tablebase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+// Usage: gentb [-threads N] [-dir path] KQvK KRvK KPvK ...
+int main(int argc, char **argv)
+{
+    int threads = (int)std::thread::hardware_concurrency();
+    const char *directory = "tablebases";
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-threads") == 0)
+            threads = atoi(argv[first + 1]);
+        else if (strcmp(argv[first], "-dir") == 0)
+            directory = argv[first + 1];
+        first += 2;
+    }
+
+    if (first >= argc)
+    {
+        printf("Usage: %s [-threads N] [-dir path] KQvK KRvK KPvK ...\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = first; i < argc; i++)
+    {
+        if (!GenerateTablebase(argv[i], directory, threads))
+        {
+            printf("Could not generate %s\n", argv[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+bool MapFile(MappedFile &file, const char *path)
+{
+    UnmapFile(file);
+
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+
+    file.data = (const uint8_t *)data;
+    file.size = (size_t)size.QuadPart;
+    file.fileHandle = handle;
+    file.mappingHandle = mapping;
+    return true;
+}
+
+void UnmapFile(MappedFile &file)
+{
+    if (file.data)
+        UnmapViewOfFile((void *)file.data);
+    if (file.mappingHandle)
+        CloseHandle((HANDLE)file.mappingHandle);
+    if (file.fileHandle)
+        CloseHandle((HANDLE)file.fileHandle);
+    file = MappedFile();
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MapFile(MappedFile &file, const char *path)
+{
+    UnmapFile(file);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED)
+        return false;
+
+    file.data = (const uint8_t *)data;
+    file.size = (size_t)info.st_size;
+    return true;
+}
+
+void UnmapFile(MappedFile &file)
+{
+    if (file.data)
+        munmap((void *)file.data, file.size);
+    file = MappedFile();
+}
+#endif
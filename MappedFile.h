@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Read-only memory mapping of a whole file. Pages are faulted in by the OS on
+// first touch, so opening even a multi-gigabyte file costs nothing up front.
+struct MappedFile
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    void *fileHandle = nullptr;    // Windows only
+    void *mappingHandle = nullptr; // Windows only
+};
+
+bool MapFile(MappedFile &file, const char *path);
+void UnmapFile(MappedFile &file);
@@ -0,0 +1,213 @@
+#include "MoveValidation.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Below this many queries per thread, starting threads costs more than it saves
+#define MIN_QUERIES_PER_THREAD 16384
+
+static Bitboard betweenSquares[64][64]; // Strictly between two aligned squares
+static Bitboard lineThrough[64][64];    // Whole line through two aligned squares, edge to edge
+
+// Filled from coordinates rather than Position's tables, which may not be
+// initialised yet when this runs
+static struct ValidationTables
+{
+    ValidationTables()
+    {
+        const int directions[8][2] = {
+            {0, 1}, {1, 0}, {1, 1}, {1, -1}, {0, -1}, {-1, 0}, {-1, -1}, {-1, 1}};
+        auto isValid = [](int r, int c)
+        {
+            return r >= 0 && r < 8 && c >= 0 && c < 8;
+        };
+
+        for (int from = 0; from < 64; from++)
+        {
+            for (auto &d : directions)
+            {
+                // Full line: walk backwards to the edge, then forwards across the board
+                Bitboard line = SquareBit(from);
+                for (int r = SquareRow(from) - d[0], c = SquareCol(from) - d[1]; isValid(r, c); r -= d[0], c -= d[1])
+                    line |= SquareBit(r * 8 + c);
+                for (int r = SquareRow(from) + d[0], c = SquareCol(from) + d[1]; isValid(r, c); r += d[0], c += d[1])
+                    line |= SquareBit(r * 8 + c);
+
+                Bitboard between = 0;
+                for (int r = SquareRow(from) + d[0], c = SquareCol(from) + d[1]; isValid(r, c); r += d[0], c += d[1])
+                {
+                    betweenSquares[from][r * 8 + c] = between;
+                    lineThrough[from][r * 8 + c] = line;
+                    between |= SquareBit(r * 8 + c);
+                }
+            }
+        }
+    }
+} validationTables;
+
+void ComputeLegalityInfo(const Position &pos, LegalityInfo &info)
+{
+    int us = pos.whiteToMove ? 0 : 1, them = us ^ 1;
+    const Bitboard(&enemy)[7] = pos.pieces[them];
+    Bitboard occupied = Occupied(pos);
+    info.king = KingSquare(pos, pos.whiteToMove);
+    info.checkers = AttackersTo(pos, info.king, occupied) & enemy[0];
+
+    // A slider that would see the king through exactly one own piece pins it
+    info.pinned = 0;
+    Bitboard snipers = (RookAttacks(info.king, enemy[0]) & (enemy[ROOK] | enemy[QUEEN])) |
+                       (BishopAttacks(info.king, enemy[0]) & (enemy[BISHOP] | enemy[QUEEN]));
+    while (snipers)
+    {
+        Bitboard blockers = betweenSquares[info.king][PopLsb(snipers)] & occupied;
+        if (PopCount(blockers) == 1 && (blockers & pos.pieces[us][0]))
+            info.pinned |= blockers;
+    }
+
+    // The king is taken off the board so it can't hide behind itself along a checking line
+    Bitboard withoutKing = occupied & ~SquareBit(info.king);
+    Bitboard danger = 0;
+    Bitboard pieces = enemy[0];
+    while (pieces)
+    {
+        int sq = PopLsb(pieces);
+        switch (abs(pos.board[sq]))
+        {
+        case PAWN:
+            danger |= PawnAttacks(sq, !pos.whiteToMove);
+            break;
+        case KNIGHT:
+            danger |= KnightAttacks(sq);
+            break;
+        case BISHOP:
+            danger |= BishopAttacks(sq, withoutKing);
+            break;
+        case ROOK:
+            danger |= RookAttacks(sq, withoutKing);
+            break;
+        case QUEEN:
+            danger |= BishopAttacks(sq, withoutKing) | RookAttacks(sq, withoutKing);
+            break;
+        default:
+            danger |= KingAttacks(sq);
+            break;
+        }
+    }
+    info.kingDanger = danger;
+}
+
+bool IsLegalMove(const Position &pos, const LegalityInfo &info, Move m)
+{
+    if (!IsPseudoLegal(pos, m))
+        return false;
+
+    int from = MoveFrom(m), to = MoveTo(m);
+    if (from == info.king)
+    {
+        // Castling already had its squares checked by IsPseudoLegal
+        if (abs(to - from) == 2)
+            return true;
+        return !(info.kingDanger & SquareBit(to));
+    }
+    if (PopCount(info.checkers) > 1)
+        return false;
+
+    // En passant removes two pawns from one rank at once, which can uncover a
+    // check no pin covers; rare enough to just play it out
+    if (to == pos.enPassant && abs(pos.board[from]) == PAWN)
+        return IsLegal(pos, m);
+
+    if (info.checkers)
+    {
+        int checker = Lsb(info.checkers);
+        if (!((info.checkers | betweenSquares[info.king][checker]) & SquareBit(to)))
+            return false;
+    }
+    return !(info.pinned & SquareBit(from)) || (lineThrough[info.king][from] & SquareBit(to));
+}
+
+static bool SamePosition(const Position &a, const Position &b)
+{
+    return a.key == b.key && a.whiteToMove == b.whiteToMove && a.castling == b.castling &&
+           a.enPassant == b.enPassant && memcmp(a.board, b.board, sizeof(a.board)) == 0;
+}
+
+// Checks the queries in order[begin, end), recomputing the info only when the position changes
+static void ValidateRange(const MoveQuery *queries, const uint32_t *order, size_t begin, size_t end, uint8_t *results)
+{
+    const Position *current = nullptr;
+    LegalityInfo info;
+    for (size_t i = begin; i < end; i++)
+    {
+        const MoveQuery &query = queries[order[i]];
+        if (query.pos != current && !(current && SamePosition(*query.pos, *current)))
+        {
+            current = query.pos;
+            ComputeLegalityInfo(*current, info);
+        }
+        results[order[i]] = IsLegalMove(*current, info, query.move);
+    }
+}
+
+void ValidateMoves(const MoveQuery *queries, size_t count, uint64_t *legal, int threads)
+{
+    if (count == 0)
+        return;
+
+    // Group queries by position key with a counting sort: one hash lookup per
+    // run of queries on the same position, so repeats anywhere in the batch
+    // (the start position in every game, say) share one group
+    vector<uint32_t> groupOf(count), groupSizes;
+    unordered_map<uint64_t, uint32_t> groups;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0 && queries[i].pos->key == queries[i - 1].pos->key)
+            groupOf[i] = groupOf[i - 1];
+        else
+        {
+            auto inserted = groups.emplace(queries[i].pos->key, (uint32_t)groupSizes.size());
+            if (inserted.second)
+                groupSizes.push_back(0);
+            groupOf[i] = inserted.first->second;
+        }
+        groupSizes[groupOf[i]]++;
+    }
+    uint32_t start = 0;
+    for (uint32_t &size : groupSizes)
+    {
+        uint32_t groupStart = start;
+        start += size;
+        size = groupStart;
+    }
+    vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; i++)
+        order[groupSizes[groupOf[i]]++] = (uint32_t)i;
+
+    if (threads <= 0)
+        threads = (int)max(1u, thread::hardware_concurrency());
+    threads = (int)min<size_t>(threads, max<size_t>(1, count / MIN_QUERIES_PER_THREAD));
+
+    vector<uint8_t> results(count);
+    if (threads == 1)
+        ValidateRange(queries, order.data(), 0, count, results.data());
+    else
+    {
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            size_t begin = count * t / threads, end = count * (t + 1) / threads;
+            workers.emplace_back(ValidateRange, queries, order.data(), begin, end, results.data());
+        }
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    memset(legal, 0, (count + 63) / 64 * sizeof(uint64_t));
+    for (size_t i = 0; i < count; i++)
+        legal[i / 64] |= (uint64_t)results[i] << (i % 64);
+}
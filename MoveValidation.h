@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Position.h"
+#include <stddef.h>
+
+// Bulk legality checks for moves coming from outside (clients, imports).
+// The check, pin and king-danger data a position needs is computed once and
+// then every move against it is a handful of bitboard tests.
+
+struct LegalityInfo
+{
+    Bitboard checkers;   // Enemy pieces giving check
+    Bitboard pinned;     // Own pieces pinned to the king
+    Bitboard kingDanger; // Squares the king may not step to (attacked with the king itself out of the way)
+    int king;
+};
+
+void ComputeLegalityInfo(const Position &pos, LegalityInfo &info);
+// Any move, not only generated ones: shape, promotion piece and legality are all checked
+bool IsLegalMove(const Position &pos, const LegalityInfo &info, Move m);
+
+struct MoveQuery
+{
+    const Position *pos;
+    Move move;
+};
+
+// Sets bit i of legal (count bits, rounded up to whole words) when queries[i]
+// is legal. Queries on the same position, by pointer or by contents, share
+// one LegalityInfo; large batches are split over threads (0 = one per core).
+void ValidateMoves(const MoveQuery *queries, size_t count, uint64_t *legal, int threads = 0);
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+// Pool of objects allocated in fixed-size slabs. Objects never move once a
+// slab exists, freed slots are reused most recently freed first (their memory
+// is still warm), and every slot carries a generation so a stale handle to a
+// reused slot is detected. Objects are not reset on reuse: the caller
+// initialises them. Not thread-safe; guard it with a lock if shared.
+
+#define POOL_NONE 0xFFFFFFFFu
+
+template <typename T, uint32_t SlabSize = 1024>
+struct ObjectPool
+{
+    std::vector<std::unique_ptr<T[]>> slabs;
+    std::vector<uint32_t> generations; // Odd while the slot is in use
+    std::vector<uint32_t> freeList;
+    uint32_t created = 0;              // Slots handed out at least once
+    uint32_t capacity = POOL_NONE - 1; // Most slots the pool may ever hold
+    uint32_t live = 0;
+};
+
+// Reserves the bookkeeping up front so it never reallocates while the pool grows
+template <typename T, uint32_t S>
+void InitPool(ObjectPool<T, S> &pool, uint32_t capacity)
+{
+    pool.capacity = capacity;
+    pool.slabs.reserve((capacity + S - 1) / S);
+    pool.generations.reserve(capacity);
+    pool.freeList.reserve(capacity);
+}
+
+template <typename T, uint32_t S>
+T &PoolSlot(ObjectPool<T, S> &pool, uint32_t index)
+{
+    return pool.slabs[index / S][index % S];
+}
+
+// Returns the slot index, or POOL_NONE when the pool is at capacity
+template <typename T, uint32_t S>
+uint32_t PoolAllocate(ObjectPool<T, S> &pool)
+{
+    uint32_t index;
+    if (!pool.freeList.empty())
+    {
+        index = pool.freeList.back();
+        pool.freeList.pop_back();
+    }
+    else
+    {
+        if (pool.created >= pool.capacity)
+            return POOL_NONE;
+        if (pool.created % S == 0)
+            pool.slabs.emplace_back(new T[S]);
+        index = pool.created++;
+        pool.generations.push_back(0);
+    }
+    pool.generations[index]++;
+    pool.live++;
+    return index;
+}
+
+template <typename T, uint32_t S>
+void PoolFree(ObjectPool<T, S> &pool, uint32_t index)
+{
+    pool.generations[index]++;
+    pool.freeList.push_back(index);
+    pool.live--;
+}
+
+// Handles pack the generation above the index; 0 is never a valid handle
+template <typename T, uint32_t S>
+uint64_t PoolHandle(const ObjectPool<T, S> &pool, uint32_t index)
+{
+    return (uint64_t)pool.generations[index] << 32 | index;
+}
+
+template <typename T, uint32_t S>
+T *PoolFind(ObjectPool<T, S> &pool, uint64_t handle)
+{
+    uint32_t index = (uint32_t)handle;
+    if (index >= pool.created || pool.generations[index] != (uint32_t)(handle >> 32) || !(handle >> 32 & 1))
+        return nullptr;
+    return &PoolSlot(pool, index);
+}
@@ -0,0 +1,260 @@
+#include "Pgn.h"
+#include <string.h>
+#include <ctype.h>
+
+using namespace std;
+
+bool OpenPgn(PgnReader &reader, const char *path)
+{
+    reader.file = fopen(path, "rb");
+    reader.length = 0;
+    reader.offset = 0;
+    return reader.file != nullptr;
+}
+
+void ClosePgn(PgnReader &reader)
+{
+    if (reader.file)
+        fclose(reader.file);
+    reader.file = nullptr;
+}
+
+static int PeekChar(PgnReader &reader)
+{
+    if (reader.offset == reader.length)
+    {
+        reader.length = reader.file ? fread(reader.buffer, 1, sizeof(reader.buffer), reader.file) : 0;
+        reader.offset = 0;
+        if (reader.length == 0)
+            return EOF;
+    }
+    return (unsigned char)reader.buffer[reader.offset];
+}
+
+static int NextChar(PgnReader &reader)
+{
+    int c = PeekChar(reader);
+    if (c != EOF)
+        reader.offset++;
+    return c;
+}
+
+static void SkipUntil(PgnReader &reader, char end)
+{
+    int c;
+    while ((c = NextChar(reader)) != EOF && c != end)
+    {
+    }
+}
+
+static void ReadTag(PgnReader &reader, PgnGame &game)
+{
+    string name, value;
+    int c;
+    while ((c = PeekChar(reader)) != EOF && isspace(c))
+        NextChar(reader);
+    while ((c = PeekChar(reader)) != EOF && !isspace(c) && c != '"' && c != ']')
+        name += (char)NextChar(reader);
+    while ((c = PeekChar(reader)) != EOF && c != '"' && c != ']')
+        NextChar(reader);
+    if (PeekChar(reader) == '"')
+    {
+        NextChar(reader);
+        while ((c = NextChar(reader)) != EOF && c != '"')
+        {
+            if (c == '\\')
+                c = NextChar(reader);
+            if (c != EOF)
+                value += (char)c;
+        }
+    }
+    SkipUntil(reader, ']');
+    game.tags.push_back({name, value});
+}
+
+static bool IsResultToken(const string &token)
+{
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool ReadPgnGame(PgnReader &reader, PgnGame &game)
+{
+    game.tags.clear();
+    game.moves.clear();
+    game.comments.clear();
+    game.result.clear();
+
+    bool inMoves = false;
+    int variationDepth = 0;
+    int c;
+    while ((c = PeekChar(reader)) != EOF)
+    {
+        if (isspace(c))
+        {
+            NextChar(reader);
+            continue;
+        }
+        if (c == '[' && variationDepth == 0)
+        {
+            // A tag after movetext means the previous game had no result token
+            if (inMoves)
+                return true;
+            NextChar(reader);
+            ReadTag(reader, game);
+            continue;
+        }
+        if (c == '{')
+        {
+            SkipUntil(reader, '}');
+            continue;
+        }
+        if (c == ';' || c == '%')
+        {
+            SkipUntil(reader, '\n');
+            continue;
+        }
+        if (c == '(')
+        {
+            NextChar(reader);
+            variationDepth++;
+            continue;
+        }
+        if (c == ')')
+        {
+            NextChar(reader);
+            if (variationDepth > 0)
+                variationDepth--;
+            continue;
+        }
+
+        string token;
+        while ((c = PeekChar(reader)) != EOF && !isspace(c) && !strchr("{}();[", c))
+            token += (char)NextChar(reader);
+        if (token.empty())
+        {
+            NextChar(reader);
+            continue;
+        }
+        inMoves = true;
+        if (variationDepth > 0 || token[0] == '$')
+            continue;
+
+        if (IsResultToken(token))
+        {
+            game.result = token;
+            return true;
+        }
+
+        // Strip move numbers such as "12." or "12..." which may be glued to the move
+        if (isdigit((unsigned char)token[0]) && token.compare(0, 3, "0-0") != 0)
+        {
+            size_t i = 0;
+            while (i < token.size() && (isdigit((unsigned char)token[i]) || token[i] == '.'))
+                i++;
+            token.erase(0, i);
+            if (token.empty())
+                continue;
+        }
+        game.moves.push_back(token);
+    }
+    return inMoves || !game.tags.empty();
+}
+
+const char *GetPgnTag(const PgnGame &game, const char *name)
+{
+    for (auto &tag : game.tags)
+    {
+        if (tag.first == name)
+            return tag.second.c_str();
+    }
+    return nullptr;
+}
+
+void SetPgnTag(PgnGame &game, const char *name, const string &value)
+{
+    for (auto &tag : game.tags)
+    {
+        if (tag.first == name)
+        {
+            tag.second = value;
+            return;
+        }
+    }
+    game.tags.push_back({name, value});
+}
+
+GameResult ParseGameResult(const string &result)
+{
+    if (result == "1-0")
+        return RESULT_WHITE_WINS;
+    if (result == "0-1")
+        return RESULT_BLACK_WINS;
+    if (result == "1/2-1/2")
+        return RESULT_DRAW;
+    return RESULT_UNKNOWN;
+}
+
+const char *GameResultText(GameResult result)
+{
+    switch (result)
+    {
+    case RESULT_WHITE_WINS:
+        return "1-0";
+    case RESULT_BLACK_WINS:
+        return "0-1";
+    case RESULT_DRAW:
+        return "1/2-1/2";
+    default:
+        return "*";
+    }
+}
+
+// Plies played before the first move: 0 from the start position, otherwise
+// from the FEN tag's side to move and fullmove number
+static int StartingPly(const PgnGame &game)
+{
+    const char *fen = GetPgnTag(game, "FEN");
+    char board[100], side = 'w';
+    int halfmove = 0, fullmove = 1;
+    if (!fen || sscanf(fen, "%99s %c %*s %*s %d %d", board, &side, &halfmove, &fullmove) < 2)
+        return 0;
+    return 2 * (fullmove > 0 ? fullmove - 1 : 0) + (side == 'b' ? 1 : 0);
+}
+
+void WritePgnGame(FILE *file, const PgnGame &game)
+{
+    for (auto &tag : game.tags)
+        fprintf(file, "[%s \"%s\"]\n", tag.first.c_str(), tag.second.c_str());
+    fprintf(file, "\n");
+
+    // Keep movetext lines under 80 characters; a comment may run over
+    string line;
+    auto add = [&](const string &token)
+    {
+        if (!line.empty() && line.size() + token.size() + 1 > 79)
+        {
+            fprintf(file, "%s\n", line.c_str());
+            line.clear();
+        }
+        if (!line.empty())
+            line += ' ';
+        line += token;
+    };
+    bool commented = false;
+    int firstPly = StartingPly(game);
+    for (size_t i = 0; i < game.moves.size(); i++)
+    {
+        string token;
+        int ply = firstPly + (int)i;
+        if (ply % 2 == 0)
+            token = to_string(ply / 2 + 1) + ". ";
+        else if (i == 0 || commented)
+            token = to_string(ply / 2 + 1) + "... ";
+        add(token + game.moves[i]);
+        commented = i < game.comments.size() && !game.comments[i].empty();
+        if (commented)
+            add("{" + game.comments[i] + "}");
+    }
+    add(game.result.empty() ? "*" : game.result);
+    fprintf(file, "%s\n\n", line.c_str());
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+enum GameResult
+{
+    RESULT_UNKNOWN = 0,
+    RESULT_WHITE_WINS = 1,
+    RESULT_DRAW = 2,
+    RESULT_BLACK_WINS = 3
+};
+
+struct PgnGame
+{
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::vector<std::string> moves; // SAN, in game order
+    std::vector<std::string> comments; // Optional, per move: written in braces after it; empty = none
+    std::string result;
+};
+
+// Streams games out of a PGN file one at a time so large collections never sit in memory
+struct PgnReader
+{
+    FILE *file = nullptr;
+    char buffer[1 << 16];
+    size_t length = 0;
+    size_t offset = 0;
+};
+
+bool OpenPgn(PgnReader &reader, const char *path);
+void ClosePgn(PgnReader &reader);
+bool ReadPgnGame(PgnReader &reader, PgnGame &game);
+
+const char *GetPgnTag(const PgnGame &game, const char *name);
+void SetPgnTag(PgnGame &game, const char *name, const std::string &value);
+GameResult ParseGameResult(const std::string &result);
+const char *GameResultText(GameResult result);
+void WritePgnGame(FILE *file, const PgnGame &game);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Position.h"
+#include "Pgn.h"
+#include <stdint.h>
+#include <vector>
+
+// Polyglot .bin opening books: 16-byte big-endian entries sorted by key.
+// Probing works straight out of the mapping and never allocates.
+
+struct PolyglotEntry
+{
+    uint8_t key[8];
+    uint8_t move[2];
+    uint8_t weight[2];
+    uint8_t learn[4];
+};
+
+struct PolyglotBook
+{
+    MappedFile file;
+    const PolyglotEntry *entries = nullptr;
+    size_t count = 0;
+};
+
+struct BookMove
+{
+    Move move;
+    uint16_t weight;
+};
+
+// Keys use the specification's 781-entry Random64 table, built in
+uint64_t PolyglotKey(const Position &pos);
+// Self-test: the table gives the specification's key for the starting
+// position. Books are neither opened nor written when it fails
+bool CheckPolyglotRandom();
+
+bool OpenPolyglotBook(PolyglotBook &book, const char *path);
+void ClosePolyglotBook(PolyglotBook &book);
+bool IsPolyglotBookOpen(const PolyglotBook &book);
+
+// Fills up to maxMoves legal book moves for the position, highest weight first as stored
+int ProbeBook(const PolyglotBook &book, const Position &pos, BookMove *moves, int maxMoves);
+// Weighted random pick; random is any uniformly distributed 64-bit value
+Move PickBookMove(const PolyglotBook &book, const Position &pos, uint64_t random);
+
+struct PolyglotBookBuilder
+{
+    struct Record
+    {
+        uint64_t key;
+        uint16_t move;
+        uint32_t score; // 2 per win + 1 per draw for the side that played the move
+        uint32_t games;
+    };
+    std::vector<Record> records;
+    int maxPlies = 30;
+};
+
+bool AddBookGame(PolyglotBookBuilder &builder, const PgnGame &game);
+// Merges duplicates, drops moves seen in fewer than minGames games and writes the book
+bool WritePolyglotBook(PolyglotBookBuilder &builder, const char *path, uint32_t minGames);
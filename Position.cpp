@@ -0,0 +1,859 @@
+#include "Position.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+using namespace std;
+
+// Attack and hashing tables, filled once at startup
+static Bitboard knightAttacks[64];
+static Bitboard kingAttacks[64];
+static Bitboard pawnAttacks[2][64];
+static Bitboard rays[8][64];
+static uint8_t castlingMask[64];
+
+static uint64_t zobristPieces[2][7][64];
+static uint64_t zobristCastling[16];
+static uint64_t zobristEnPassant[8];
+static uint64_t zobristSide;
+
+// Directions as {row step, col step}; the first four increase the square index
+static const int rayDirections[8][2] = {
+    {0, 1}, {1, 0}, {1, 1}, {1, -1}, {0, -1}, {-1, 0}, {-1, -1}, {-1, 1}};
+
+static uint64_t NextRandom(uint64_t &state)
+{
+    // splitmix64
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static struct PositionTables
+{
+    PositionTables()
+    {
+        auto isValid = [](int r, int c)
+        {
+            return r >= 0 && r < 8 && c >= 0 && c < 8;
+        };
+
+        const int knightMoves[8][2] = {
+            {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+
+        for (int sq = 0; sq < 64; sq++)
+        {
+            int row = SquareRow(sq), col = SquareCol(sq);
+
+            for (auto &move : knightMoves)
+            {
+                if (isValid(row + move[0], col + move[1]))
+                    knightAttacks[sq] |= SquareBit((row + move[0]) * 8 + col + move[1]);
+            }
+
+            for (int d = 0; d < 8; d++)
+            {
+                int r = row + rayDirections[d][0], c = col + rayDirections[d][1];
+                if (isValid(r, c))
+                    kingAttacks[sq] |= SquareBit(r * 8 + c);
+
+                while (isValid(r, c))
+                {
+                    rays[d][sq] |= SquareBit(r * 8 + c);
+                    r += rayDirections[d][0];
+                    c += rayDirections[d][1];
+                }
+            }
+
+            // White pawns move towards row 0
+            for (int dc = -1; dc <= 1; dc += 2)
+            {
+                if (isValid(row - 1, col + dc))
+                    pawnAttacks[0][sq] |= SquareBit((row - 1) * 8 + col + dc);
+                if (isValid(row + 1, col + dc))
+                    pawnAttacks[1][sq] |= SquareBit((row + 1) * 8 + col + dc);
+            }
+
+            castlingMask[sq] = 0xF;
+        }
+
+        castlingMask[60] &= ~(WHITE_KINGSIDE | WHITE_QUEENSIDE);
+        castlingMask[63] &= ~WHITE_KINGSIDE;
+        castlingMask[56] &= ~WHITE_QUEENSIDE;
+        castlingMask[4] &= ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+        castlingMask[7] &= ~BLACK_KINGSIDE;
+        castlingMask[0] &= ~BLACK_QUEENSIDE;
+
+        uint64_t seed = 0x43484553535A4F42ULL;
+        for (int color = 0; color < 2; color++)
+            for (int type = 1; type <= 6; type++)
+                for (int sq = 0; sq < 64; sq++)
+                    zobristPieces[color][type][sq] = NextRandom(seed);
+
+        // Castling keys are combinations of one key per right so that updates stay incremental
+        uint64_t rightKeys[4];
+        for (int i = 0; i < 4; i++)
+            rightKeys[i] = NextRandom(seed);
+        for (int rights = 0; rights < 16; rights++)
+        {
+            zobristCastling[rights] = 0;
+            for (int i = 0; i < 4; i++)
+                if (rights & (1 << i))
+                    zobristCastling[rights] ^= rightKeys[i];
+        }
+
+        for (int col = 0; col < 8; col++)
+            zobristEnPassant[col] = NextRandom(seed);
+        zobristSide = NextRandom(seed);
+    }
+} positionTables;
+
+Bitboard KnightAttacks(int sq) { return knightAttacks[sq]; }
+Bitboard KingAttacks(int sq) { return kingAttacks[sq]; }
+Bitboard PawnAttacks(int sq, bool white) { return pawnAttacks[white ? 0 : 1][sq]; }
+
+static Bitboard RayAttacks(int sq, Bitboard occupied, const int (&directions)[4])
+{
+    Bitboard attacks = 0;
+    for (int d : directions)
+    {
+        Bitboard ray = rays[d][sq];
+        attacks |= ray;
+        Bitboard blockers = ray & occupied;
+        if (blockers)
+            attacks &= ~rays[d][d < 4 ? Lsb(blockers) : Msb(blockers)];
+    }
+    return attacks;
+}
+
+// Directions 0, 1, 4, 5 are straight and 2, 3, 6, 7 diagonal
+Bitboard RookAttacks(int sq, Bitboard occupied)
+{
+    static const int straight[4] = {0, 1, 4, 5};
+    return RayAttacks(sq, occupied, straight);
+}
+
+Bitboard BishopAttacks(int sq, Bitboard occupied)
+{
+    static const int diagonal[4] = {2, 3, 6, 7};
+    return RayAttacks(sq, occupied, diagonal);
+}
+
+Bitboard AttackersTo(const Position &pos, int sq, Bitboard occupied)
+{
+    const Bitboard(&w)[7] = pos.pieces[0];
+    const Bitboard(&b)[7] = pos.pieces[1];
+
+    return (pawnAttacks[1][sq] & w[PAWN]) | (pawnAttacks[0][sq] & b[PAWN]) |
+           (knightAttacks[sq] & (w[KNIGHT] | b[KNIGHT])) |
+           (kingAttacks[sq] & (w[KING] | b[KING])) |
+           (BishopAttacks(sq, occupied) & (w[BISHOP] | b[BISHOP] | w[QUEEN] | b[QUEEN])) |
+           (RookAttacks(sq, occupied) & (w[ROOK] | b[ROOK] | w[QUEEN] | b[QUEEN]));
+}
+
+bool IsSquareAttacked(const Position &pos, int sq, bool byWhite)
+{
+    const Bitboard(&p)[7] = pos.pieces[byWhite ? 0 : 1];
+    Bitboard occupied = Occupied(pos);
+
+    if (pawnAttacks[byWhite ? 1 : 0][sq] & p[PAWN])
+        return true;
+    if (knightAttacks[sq] & p[KNIGHT])
+        return true;
+    if (kingAttacks[sq] & p[KING])
+        return true;
+    if ((p[BISHOP] | p[QUEEN]) && (BishopAttacks(sq, occupied) & (p[BISHOP] | p[QUEEN])))
+        return true;
+    if ((p[ROOK] | p[QUEEN]) && (RookAttacks(sq, occupied) & (p[ROOK] | p[QUEEN])))
+        return true;
+    return false;
+}
+
+bool InCheck(const Position &pos)
+{
+    return IsSquareAttacked(pos, KingSquare(pos, pos.whiteToMove), !pos.whiteToMove);
+}
+
+bool IsInsufficientMaterial(const Position &pos)
+{
+    for (int color = 0; color < 2; color++)
+    {
+        if (pos.pieces[color][PAWN] | pos.pieces[color][ROOK] | pos.pieces[color][QUEEN])
+            return false;
+    }
+    return PopCount(Occupied(pos)) <= 3;
+}
+
+static void PutPiece(Position &pos, int sq, int piece)
+{
+    int color = piece > 0 ? 0 : 1;
+    int type = abs(piece);
+    pos.board[sq] = (int8_t)piece;
+    pos.pieces[color][0] |= SquareBit(sq);
+    pos.pieces[color][type] |= SquareBit(sq);
+    pos.key ^= zobristPieces[color][type][sq];
+}
+
+static void RemovePiece(Position &pos, int sq)
+{
+    int piece = pos.board[sq];
+    int color = piece > 0 ? 0 : 1;
+    int type = abs(piece);
+    pos.board[sq] = 0;
+    pos.pieces[color][0] &= ~SquareBit(sq);
+    pos.pieces[color][type] &= ~SquareBit(sq);
+    pos.key ^= zobristPieces[color][type][sq];
+}
+
+// The en passant square only counts when a pawn of the side to move could take there,
+// so transpositions hash the same regardless of an unusable double push
+static bool CanCaptureEnPassant(const Position &pos, int sq)
+{
+    return (pawnAttacks[pos.whiteToMove ? 1 : 0][sq] & pos.pieces[pos.whiteToMove ? 0 : 1][PAWN]) != 0;
+}
+
+uint64_t ComputeKey(const Position &pos)
+{
+    uint64_t key = 0;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        int piece = pos.board[sq];
+        if (piece != 0)
+            key ^= zobristPieces[piece > 0 ? 0 : 1][abs(piece)][sq];
+    }
+    key ^= zobristCastling[pos.castling];
+    if (pos.enPassant >= 0)
+        key ^= zobristEnPassant[SquareCol(pos.enPassant)];
+    if (!pos.whiteToMove)
+        key ^= zobristSide;
+    return key;
+}
+
+static void ClearPosition(Position &pos)
+{
+    memset(&pos, 0, sizeof(pos));
+    pos.whiteToMove = true;
+    pos.enPassant = -1;
+    pos.fullmoveNumber = 1;
+}
+
+void SetFromBoard(Position &pos, const int board[8][8], bool whiteToMove, uint8_t castling, int enPassantRow, int enPassantCol)
+{
+    ClearPosition(pos);
+    for (int row = 0; row < 8; row++)
+        for (int col = 0; col < 8; col++)
+            if (board[row][col] != 0)
+                PutPiece(pos, row * 8 + col, board[row][col]);
+
+    pos.whiteToMove = whiteToMove;
+    pos.castling = castling;
+    if (enPassantRow >= 0 && enPassantCol >= 0 && CanCaptureEnPassant(pos, enPassantRow * 8 + enPassantCol))
+        pos.enPassant = (int8_t)(enPassantRow * 8 + enPassantCol);
+    pos.key = ComputeKey(pos);
+}
+
+void SetStartPosition(Position &pos)
+{
+    SetFromFen(pos, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+}
+
+static const char pieceLetters[] = " PNBRQK";
+
+bool SetFromFen(Position &pos, const char *fen)
+{
+    ClearPosition(pos);
+
+    int sq = 0;
+    const char *p = fen;
+    while (*p == ' ')
+        p++;
+    for (; *p && *p != ' '; p++)
+    {
+        if (*p == '/')
+            continue;
+        if (isdigit((unsigned char)*p))
+        {
+            sq += *p - '0';
+            continue;
+        }
+        const char *letter = strchr(pieceLetters + 1, toupper((unsigned char)*p));
+        if (!letter || sq >= 64)
+            return false;
+        int type = (int)(letter - pieceLetters);
+        PutPiece(pos, sq++, isupper((unsigned char)*p) ? type : -type);
+    }
+    if (sq != 64 || PopCount(pos.pieces[0][KING]) != 1 || PopCount(pos.pieces[1][KING]) != 1)
+        return false;
+
+    while (*p == ' ')
+        p++;
+    pos.whiteToMove = (*p != 'b');
+    if (*p)
+        p++;
+
+    while (*p == ' ')
+        p++;
+    for (; *p && *p != ' '; p++)
+    {
+        switch (*p)
+        {
+        case 'K':
+            pos.castling |= WHITE_KINGSIDE;
+            break;
+        case 'Q':
+            pos.castling |= WHITE_QUEENSIDE;
+            break;
+        case 'k':
+            pos.castling |= BLACK_KINGSIDE;
+            break;
+        case 'q':
+            pos.castling |= BLACK_QUEENSIDE;
+            break;
+        }
+    }
+
+    while (*p == ' ')
+        p++;
+    if (p[0] >= 'a' && p[0] <= 'h' && p[1] >= '1' && p[1] <= '8')
+    {
+        int epSquare = ('8' - p[1]) * 8 + (p[0] - 'a');
+        if (CanCaptureEnPassant(pos, epSquare))
+            pos.enPassant = (int8_t)epSquare;
+        p += 2;
+    }
+    while (*p && *p != ' ')
+        p++;
+
+    int halfmove = 0, fullmove = 1;
+    if (sscanf(p, "%d %d", &halfmove, &fullmove) >= 1)
+    {
+        pos.halfmoveClock = (uint8_t)min(halfmove, 255);
+        pos.fullmoveNumber = (uint16_t)max(fullmove, 1);
+    }
+
+    pos.key = ComputeKey(pos);
+    return true;
+}
+
+string GetFen(const Position &pos)
+{
+    string fen;
+    for (int row = 0; row < 8; row++)
+    {
+        int empty = 0;
+        for (int col = 0; col < 8; col++)
+        {
+            int piece = pos.board[row * 8 + col];
+            if (piece == 0)
+            {
+                empty++;
+                continue;
+            }
+            if (empty)
+                fen += (char)('0' + empty);
+            empty = 0;
+            char letter = pieceLetters[abs(piece)];
+            fen += piece > 0 ? letter : (char)tolower(letter);
+        }
+        if (empty)
+            fen += (char)('0' + empty);
+        if (row < 7)
+            fen += '/';
+    }
+
+    fen += pos.whiteToMove ? " w " : " b ";
+    if (pos.castling == 0)
+        fen += '-';
+    if (pos.castling & WHITE_KINGSIDE)
+        fen += 'K';
+    if (pos.castling & WHITE_QUEENSIDE)
+        fen += 'Q';
+    if (pos.castling & BLACK_KINGSIDE)
+        fen += 'k';
+    if (pos.castling & BLACK_QUEENSIDE)
+        fen += 'q';
+    fen += ' ';
+    fen += pos.enPassant >= 0 ? SquareName(pos.enPassant) : "-";
+    fen += " " + to_string(pos.halfmoveClock) + " " + to_string(pos.fullmoveNumber);
+    return fen;
+}
+
+static int AddPawnMoves(int from, int to, bool promotes, Move *moves, int count)
+{
+    if (promotes)
+    {
+        moves[count++] = EncodeMove(from, to, QUEEN);
+        moves[count++] = EncodeMove(from, to, ROOK);
+        moves[count++] = EncodeMove(from, to, BISHOP);
+        moves[count++] = EncodeMove(from, to, KNIGHT);
+    }
+    else
+    {
+        moves[count++] = EncodeMove(from, to);
+    }
+    return count;
+}
+
+// Rights, empty path, rook in place and no attacked square on the king's way
+static bool CanCastle(const Position &pos, bool kingside)
+{
+    int row = pos.whiteToMove ? 7 : 0;
+    int kingFrom = row * 8 + 4;
+    uint8_t right = pos.whiteToMove ? (kingside ? WHITE_KINGSIDE : WHITE_QUEENSIDE) : (kingside ? BLACK_KINGSIDE : BLACK_QUEENSIDE);
+    bool them = !pos.whiteToMove;
+    Bitboard occupied = Occupied(pos);
+
+    if (!(pos.castling & right) || pos.board[kingFrom] != (pos.whiteToMove ? KING : -KING))
+        return false;
+    if (kingside)
+    {
+        if ((occupied & (SquareBit(kingFrom + 1) | SquareBit(kingFrom + 2))) ||
+            pos.board[kingFrom + 3] != (pos.whiteToMove ? ROOK : -ROOK))
+            return false;
+    }
+    else if ((occupied & (SquareBit(kingFrom - 1) | SquareBit(kingFrom - 2) | SquareBit(kingFrom - 3))) ||
+             pos.board[kingFrom - 4] != (pos.whiteToMove ? ROOK : -ROOK))
+        return false;
+
+    int step = kingside ? 1 : -1;
+    return !IsSquareAttacked(pos, kingFrom, them) && !IsSquareAttacked(pos, kingFrom + step, them) &&
+           !IsSquareAttacked(pos, kingFrom + 2 * step, them);
+}
+
+static int GeneratePseudoMoves(const Position &pos, Move *moves, bool capturesOnly)
+{
+    int count = 0;
+    int us = pos.whiteToMove ? 0 : 1;
+    Bitboard own = pos.pieces[us][0];
+    Bitboard enemy = pos.pieces[us ^ 1][0];
+    Bitboard occupied = own | enemy;
+    Bitboard targets = capturesOnly ? enemy : ~own;
+
+    // Pawns
+    int direction = pos.whiteToMove ? -8 : 8;
+    int startRow = pos.whiteToMove ? 6 : 1;
+    int lastRow = pos.whiteToMove ? 0 : 7;
+    Bitboard pawns = pos.pieces[us][PAWN];
+    while (pawns)
+    {
+        int from = PopLsb(pawns);
+        int to = from + direction;
+        bool promotes = SquareRow(to) == lastRow;
+
+        if (!(occupied & SquareBit(to)))
+        {
+            if (!capturesOnly)
+            {
+                count = AddPawnMoves(from, to, promotes, moves, count);
+                if (SquareRow(from) == startRow && !(occupied & SquareBit(to + direction)))
+                    moves[count++] = EncodeMove(from, to + direction);
+            }
+            else if (promotes)
+            {
+                moves[count++] = EncodeMove(from, to, QUEEN);
+            }
+        }
+
+        Bitboard captures = pawnAttacks[us][from] & enemy;
+        while (captures)
+            count = AddPawnMoves(from, PopLsb(captures), promotes, moves, count);
+
+        if (pos.enPassant >= 0 && (pawnAttacks[us][from] & SquareBit(pos.enPassant)))
+            moves[count++] = EncodeMove(from, pos.enPassant);
+    }
+
+    for (int type = KNIGHT; type <= KING; type++)
+    {
+        Bitboard pieces = pos.pieces[us][type];
+        while (pieces)
+        {
+            int from = PopLsb(pieces);
+            Bitboard attacks;
+            switch (type)
+            {
+            case KNIGHT:
+                attacks = knightAttacks[from];
+                break;
+            case BISHOP:
+                attacks = BishopAttacks(from, occupied);
+                break;
+            case ROOK:
+                attacks = RookAttacks(from, occupied);
+                break;
+            case QUEEN:
+                attacks = BishopAttacks(from, occupied) | RookAttacks(from, occupied);
+                break;
+            default:
+                attacks = kingAttacks[from];
+                break;
+            }
+            attacks &= targets;
+            while (attacks)
+                moves[count++] = EncodeMove(from, PopLsb(attacks));
+        }
+    }
+
+    // Castling: king moves two squares, the rook follows in DoMove
+    if (!capturesOnly)
+    {
+        int kingFrom = (pos.whiteToMove ? 7 : 0) * 8 + 4;
+        if (CanCastle(pos, true))
+            moves[count++] = EncodeMove(kingFrom, kingFrom + 2);
+        if (CanCastle(pos, false))
+            moves[count++] = EncodeMove(kingFrom, kingFrom - 2);
+    }
+
+    return count;
+}
+
+// Same rules as GeneratePseudoMoves (castling included), without generating anything
+bool IsPseudoLegal(const Position &pos, Move m)
+{
+    int from = MoveFrom(m), to = MoveTo(m), promotion = MovePromotion(m);
+    int us = pos.whiteToMove ? 0 : 1;
+    Bitboard own = pos.pieces[us][0];
+    Bitboard occupied = Occupied(pos);
+    if (!(own & SquareBit(from)) || (own & SquareBit(to)))
+        return false;
+
+    int type = abs(pos.board[from]);
+    if (type == PAWN)
+    {
+        int direction = pos.whiteToMove ? -8 : 8;
+        bool promotes = SquareRow(to) == (pos.whiteToMove ? 0 : 7);
+        if (promotes ? (promotion < KNIGHT || promotion > QUEEN) : promotion != 0)
+            return false;
+        if (pawnAttacks[us][from] & SquareBit(to))
+            return (pos.pieces[us ^ 1][0] & SquareBit(to)) || to == pos.enPassant;
+        if (occupied & SquareBit(to))
+            return false;
+        if (to == from + direction)
+            return true;
+        return to == from + 2 * direction && SquareRow(from) == (pos.whiteToMove ? 6 : 1) &&
+               !(occupied & SquareBit(from + direction));
+    }
+    if (promotion != 0)
+        return false;
+
+    switch (type)
+    {
+    case KNIGHT:
+        return (knightAttacks[from] & SquareBit(to)) != 0;
+    case BISHOP:
+        return (BishopAttacks(from, occupied) & SquareBit(to)) != 0;
+    case ROOK:
+        return (RookAttacks(from, occupied) & SquareBit(to)) != 0;
+    case QUEEN:
+        return ((BishopAttacks(from, occupied) | RookAttacks(from, occupied)) & SquareBit(to)) != 0;
+    default:
+        if (kingAttacks[from] & SquareBit(to))
+            return true;
+        return SquareRow(from) == SquareRow(to) && abs(to - from) == 2 && CanCastle(pos, to > from);
+    }
+}
+
+bool IsLegal(const Position &pos, Move m)
+{
+    Position next = pos;
+    DoMove(next, m);
+    return !IsSquareAttacked(next, KingSquare(next, pos.whiteToMove), next.whiteToMove);
+}
+
+int GenerateLegalMoves(const Position &pos, Move *moves)
+{
+    Move pseudo[MAX_MOVES];
+    int pseudoCount = GeneratePseudoMoves(pos, pseudo, false);
+    int count = 0;
+    for (int i = 0; i < pseudoCount; i++)
+        if (IsLegal(pos, pseudo[i]))
+            moves[count++] = pseudo[i];
+    return count;
+}
+
+int GenerateCaptures(const Position &pos, Move *moves)
+{
+    return GeneratePseudoMoves(pos, moves, true);
+}
+
+bool IsCapture(const Position &pos, Move m)
+{
+    return pos.board[MoveTo(m)] != 0 || (MoveTo(m) == pos.enPassant && abs(pos.board[MoveFrom(m)]) == PAWN);
+}
+
+int StaticExchange(const Position &pos, Move m)
+{
+    static const int values[7] = {0, 100, 300, 300, 500, 900, 20000};
+    int from = MoveFrom(m), to = MoveTo(m);
+    int capturer = abs(pos.board[from]);
+    Bitboard occupied = Occupied(pos) ^ SquareBit(from);
+
+    int gain[32], depth = 0;
+    gain[0] = values[abs(pos.board[to])];
+    if (capturer == PAWN && to == pos.enPassant)
+    {
+        gain[0] = values[PAWN];
+        occupied ^= SquareBit(to + (pos.whiteToMove ? 8 : -8));
+    }
+    if (MovePromotion(m))
+    {
+        gain[0] += values[MovePromotion(m)] - values[PAWN];
+        capturer = MovePromotion(m);
+    }
+
+    // Both sides keep recapturing with their least valuable attacker; sliders
+    // behind a capturer join in because attackers are recomputed each time
+    int side = pos.whiteToMove ? 1 : 0;
+    while (depth < 31)
+    {
+        depth++;
+        gain[depth] = values[capturer] - gain[depth - 1];
+
+        Bitboard attackers = AttackersTo(pos, to, occupied) & occupied & pos.pieces[side][0];
+        if (!attackers)
+            break;
+        int type = PAWN;
+        while (!(attackers & pos.pieces[side][type]))
+            type++;
+        occupied ^= SquareBit(Lsb(attackers & pos.pieces[side][type]));
+        capturer = type;
+        side ^= 1;
+    }
+
+    while (--depth)
+        gain[depth - 1] = -max(-gain[depth - 1], gain[depth]);
+    return gain[0];
+}
+
+void DoMove(Position &pos, Move m)
+{
+    int from = MoveFrom(m), to = MoveTo(m), promotion = MovePromotion(m);
+    int piece = pos.board[from];
+    bool white = piece > 0;
+
+    pos.key ^= zobristCastling[pos.castling];
+    if (pos.enPassant >= 0)
+        pos.key ^= zobristEnPassant[SquareCol(pos.enPassant)];
+
+    pos.halfmoveClock++;
+    if (abs(piece) == PAWN || pos.board[to] != 0)
+        pos.halfmoveClock = 0;
+
+    if (pos.board[to] != 0)
+        RemovePiece(pos, to);
+
+    if (abs(piece) == PAWN && to == pos.enPassant)
+        RemovePiece(pos, to + (white ? 8 : -8));
+
+    RemovePiece(pos, from);
+    PutPiece(pos, to, promotion ? (white ? promotion : -promotion) : piece);
+
+    if (abs(piece) == KING && abs(to - from) == 2)
+    {
+        bool kingside = to > from;
+        int rookFrom = kingside ? from + 3 : from - 4;
+        int rookTo = kingside ? from + 1 : from - 1;
+        RemovePiece(pos, rookFrom);
+        PutPiece(pos, rookTo, white ? ROOK : -ROOK);
+    }
+
+    pos.castling &= castlingMask[from] & castlingMask[to];
+    pos.key ^= zobristCastling[pos.castling];
+
+    pos.whiteToMove = !pos.whiteToMove;
+    pos.key ^= zobristSide;
+    if (pos.whiteToMove)
+        pos.fullmoveNumber++;
+
+    pos.enPassant = -1;
+    if (abs(piece) == PAWN && abs(to - from) == 16 && CanCaptureEnPassant(pos, (from + to) / 2))
+    {
+        pos.enPassant = (int8_t)((from + to) / 2);
+        pos.key ^= zobristEnPassant[SquareCol(pos.enPassant)];
+    }
+}
+
+void DoNullMove(Position &pos)
+{
+    if (pos.enPassant >= 0)
+        pos.key ^= zobristEnPassant[SquareCol(pos.enPassant)];
+    pos.enPassant = -1;
+    pos.whiteToMove = !pos.whiteToMove;
+    pos.key ^= zobristSide;
+    pos.halfmoveClock++;
+}
+
+string SquareName(int sq)
+{
+    string name;
+    name += (char)('a' + SquareCol(sq));
+    name += (char)('8' - SquareRow(sq));
+    return name;
+}
+
+string MoveToUci(Move m)
+{
+    if (m == MOVE_NONE)
+        return "0000";
+    string text = SquareName(MoveFrom(m)) + SquareName(MoveTo(m));
+    if (MovePromotion(m))
+        text += (char)tolower(pieceLetters[MovePromotion(m)]);
+    return text;
+}
+
+Move ParseUciMove(const Position &pos, const char *text)
+{
+    Move moves[MAX_MOVES];
+    int count = GenerateLegalMoves(pos, moves);
+    for (int i = 0; i < count; i++)
+    {
+        string uci = MoveToUci(moves[i]);
+        if (strncmp(uci.c_str(), text, uci.size()) == 0 && (text[uci.size()] == '\0' || isspace((unsigned char)text[uci.size()])))
+            return moves[i];
+    }
+    return MOVE_NONE;
+}
+
+string MoveToSan(const Position &pos, Move m)
+{
+    int from = MoveFrom(m), to = MoveTo(m);
+    int piece = abs(pos.board[from]);
+    string san;
+
+    if (piece == KING && abs(to - from) == 2)
+    {
+        san = to > from ? "O-O" : "O-O-O";
+    }
+    else
+    {
+        bool capture = IsCapture(pos, m);
+        if (piece == PAWN)
+        {
+            if (capture)
+                san += (char)('a' + SquareCol(from));
+        }
+        else
+        {
+            san += pieceLetters[piece];
+
+            // Disambiguate between identical pieces that can reach the same square
+            Move moves[MAX_MOVES];
+            int count = GenerateLegalMoves(pos, moves);
+            bool ambiguous = false, sameCol = false, sameRow = false;
+            for (int i = 0; i < count; i++)
+            {
+                int other = MoveFrom(moves[i]);
+                if (other != from && MoveTo(moves[i]) == to && abs(pos.board[other]) == piece)
+                {
+                    ambiguous = true;
+                    sameCol |= SquareCol(other) == SquareCol(from);
+                    sameRow |= SquareRow(other) == SquareRow(from);
+                }
+            }
+            if (ambiguous)
+            {
+                if (!sameCol)
+                    san += (char)('a' + SquareCol(from));
+                else if (!sameRow)
+                    san += (char)('8' - SquareRow(from));
+                else
+                    san += SquareName(from);
+            }
+        }
+        if (capture)
+            san += 'x';
+        san += SquareName(to);
+        if (MovePromotion(m))
+        {
+            san += '=';
+            san += pieceLetters[MovePromotion(m)];
+        }
+    }
+
+    Position next = pos;
+    DoMove(next, m);
+    if (InCheck(next))
+    {
+        Move replies[MAX_MOVES];
+        san += GenerateLegalMoves(next, replies) == 0 ? '#' : '+';
+    }
+    return san;
+}
+
+Move ParseSanMove(const Position &pos, const char *text)
+{
+    char san[16];
+    int length = 0;
+    for (const char *p = text; *p && !isspace((unsigned char)*p) && length < 15; p++)
+    {
+        if (*p == '+' || *p == '#' || *p == '!' || *p == '?' || *p == 'x' || *p == '-' || *p == '=')
+        {
+            if (*p == '-')
+                san[length++] = '-';
+            continue;
+        }
+        san[length++] = *p;
+    }
+    san[length] = '\0';
+
+    Move moves[MAX_MOVES];
+    int count = GenerateLegalMoves(pos, moves);
+
+    // Castling, also written with zeros
+    if (strcmp(san, "O-O") == 0 || strcmp(san, "0-0") == 0 || strcmp(san, "O-O-O") == 0 || strcmp(san, "0-0-0") == 0)
+    {
+        bool kingside = length == 3;
+        for (int i = 0; i < count; i++)
+        {
+            int from = MoveFrom(moves[i]), to = MoveTo(moves[i]);
+            if (abs(pos.board[from]) == KING && to - from == (kingside ? 2 : -2))
+                return moves[i];
+        }
+        return MOVE_NONE;
+    }
+
+    int piece = PAWN;
+    int start = 0;
+    if (length > 0 && strchr("NBRQK", san[0]))
+    {
+        piece = (int)(strchr(pieceLetters, san[0]) - pieceLetters);
+        start = 1;
+    }
+
+    int promotion = 0;
+    if (length > 0 && strchr("NBRQ", san[length - 1]) && piece == PAWN)
+    {
+        promotion = (int)(strchr(pieceLetters, san[length - 1]) - pieceLetters);
+        length--;
+    }
+
+    if (length - start < 2)
+        return MOVE_NONE;
+    char fileChar = san[length - 2], rankChar = san[length - 1];
+    if (fileChar < 'a' || fileChar > 'h' || rankChar < '1' || rankChar > '8')
+        return MOVE_NONE;
+    int to = ('8' - rankChar) * 8 + (fileChar - 'a');
+
+    int fromCol = -1, fromRow = -1;
+    for (int i = start; i < length - 2; i++)
+    {
+        if (san[i] >= 'a' && san[i] <= 'h')
+            fromCol = san[i] - 'a';
+        else if (san[i] >= '1' && san[i] <= '8')
+            fromRow = '8' - san[i];
+    }
+
+    Move found = MOVE_NONE;
+    for (int i = 0; i < count; i++)
+    {
+        int from = MoveFrom(moves[i]);
+        if (MoveTo(moves[i]) != to || abs(pos.board[from]) != piece || MovePromotion(moves[i]) != promotion)
+            continue;
+        if ((fromCol >= 0 && SquareCol(from) != fromCol) || (fromRow >= 0 && SquareRow(from) != fromRow))
+            continue;
+        if (found != MOVE_NONE)
+            return MOVE_NONE; // Ambiguous
+        found = moves[i];
+    }
+    return found;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Headless chess rules shared by the game, the database and the tools.
+// Pieces use the same codes as the board in Game.cpp: 1 pawn .. 6 king,
+// positive for white and negative for black. Squares are numbered
+// row * 8 + col with row 0 being black's back rank, so board[row][col]
+// in the game maps directly onto Position::board[row * 8 + col].
+
+typedef uint64_t Bitboard;
+typedef uint16_t Move;
+
+#define MAX_MOVES 256
+#define MOVE_NONE 0
+
+enum PieceType
+{
+    PAWN = 1,
+    KNIGHT = 2,
+    BISHOP = 3,
+    ROOK = 4,
+    QUEEN = 5,
+    KING = 6
+};
+
+enum CastlingRights
+{
+    WHITE_KINGSIDE = 1,
+    WHITE_QUEENSIDE = 2,
+    BLACK_KINGSIDE = 4,
+    BLACK_QUEENSIDE = 8
+};
+
+struct Position
+{
+    int8_t board[64];
+    Bitboard pieces[2][7]; // [0 white / 1 black][piece type], index 0 = all pieces of that colour
+    bool whiteToMove;
+    uint8_t castling;
+    int8_t enPassant; // Target square, only set when a pawn can actually capture there
+    uint8_t halfmoveClock;
+    uint16_t fullmoveNumber;
+    uint64_t key;
+};
+
+// Move = from | to << 6 | promotion piece type << 12
+inline Move EncodeMove(int from, int to, int promotion = 0) { return (Move)(from | (to << 6) | (promotion << 12)); }
+inline int MoveFrom(Move m) { return m & 63; }
+inline int MoveTo(Move m) { return (m >> 6) & 63; }
+inline int MovePromotion(Move m) { return (m >> 12) & 7; }
+
+inline int SquareRow(int sq) { return sq >> 3; }
+inline int SquareCol(int sq) { return sq & 7; }
+inline Bitboard SquareBit(int sq) { return 1ULL << sq; }
+inline int Lsb(Bitboard b) { return __builtin_ctzll(b); }
+inline int Msb(Bitboard b) { return 63 - __builtin_clzll(b); }
+inline int PopCount(Bitboard b) { return __builtin_popcountll(b); }
+inline int PopLsb(Bitboard &b)
+{
+    int sq = Lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+inline Bitboard Occupied(const Position &pos) { return pos.pieces[0][0] | pos.pieces[1][0]; }
+inline int KingSquare(const Position &pos, bool white) { return Lsb(pos.pieces[white ? 0 : 1][KING]); }
+
+Bitboard KnightAttacks(int sq);
+Bitboard KingAttacks(int sq);
+Bitboard PawnAttacks(int sq, bool white);
+Bitboard BishopAttacks(int sq, Bitboard occupied);
+Bitboard RookAttacks(int sq, Bitboard occupied);
+Bitboard AttackersTo(const Position &pos, int sq, Bitboard occupied);
+bool IsSquareAttacked(const Position &pos, int sq, bool byWhite);
+bool InCheck(const Position &pos);
+bool IsInsufficientMaterial(const Position &pos); // Bare kings, or one minor piece against a king
+
+void SetStartPosition(Position &pos);
+bool SetFromFen(Position &pos, const char *fen);
+std::string GetFen(const Position &pos);
+void SetFromBoard(Position &pos, const int board[8][8], bool whiteToMove, uint8_t castling, int enPassantRow, int enPassantCol);
+uint64_t ComputeKey(const Position &pos);
+
+int GenerateLegalMoves(const Position &pos, Move *moves);
+int GenerateCaptures(const Position &pos, Move *moves); // Pseudo-legal captures and promotions
+bool IsPseudoLegal(const Position &pos, Move m);
+bool IsLegal(const Position &pos, Move m); // For pseudo-legal moves
+bool IsCapture(const Position &pos, Move m);
+// Material won by a capture sequence on the target square (pawn = 100), pins ignored
+int StaticExchange(const Position &pos, Move m);
+void DoMove(Position &pos, Move m);
+void DoNullMove(Position &pos);
+
+std::string SquareName(int sq);
+std::string MoveToUci(Move m);
+Move ParseUciMove(const Position &pos, const char *text);
+std::string MoveToSan(const Position &pos, Move m);
+Move ParseSanMove(const Position &pos, const char *text);
@@ -0,0 +1,176 @@
+#include "Profiler.h"
+
+const char *profileZoneNames[ZONE_COUNT] = {"update", "rules", "draw", "audio"};
+const char *profileCounterNames[COUNTER_COUNT] = {"IsValidMove", "IsKingInCheck", "IsCheckmate",
+                                                  "WouldBeInCheck", "CanCastle", "HandlePieceMovement"};
+
+#ifdef CHESS_PROFILE
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+#define MAX_ZONE_DEPTH 64
+#define MAX_TRACE_EVENTS (1 << 22) // Per thread, about 100 MB; later events are dropped
+
+struct TraceEvent
+{
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct OpenZone
+{
+    ProfileZone zone;
+    const char *name;
+    uint64_t start;
+    uint64_t childTicks; // Spent in zones entered from this one
+};
+
+struct ProfileThread
+{
+    int id;
+    OpenZone stack[MAX_ZONE_DEPTH];
+    int depth = 0;
+    uint64_t zoneTicks[ZONE_COUNT] = {};
+    uint64_t counts[COUNTER_COUNT] = {};
+    ProfileFrame lastFrame = {};
+    mutex traceLock; // Only taken while a trace is recording
+    vector<TraceEvent> events;
+};
+
+static mutex threadsLock;
+static vector<unique_ptr<ProfileThread>> threads; // Kept after a thread exits so its events can still be written
+static atomic<bool> tracing{false};
+static thread_local ProfileThread *current = nullptr;
+
+// Ticks against steady_clock since the first use; the longer the program
+// runs, the better the ratio
+static uint64_t startTicks;
+static steady_clock::time_point startTime;
+
+static double TicksPerNs()
+{
+    double ns = (double)duration_cast<nanoseconds>(steady_clock::now() - startTime).count();
+    uint64_t ticks = ProfileTicks() - startTicks;
+    return ns > 0 && ticks > 0 ? ticks / ns : 1.0;
+}
+
+static ProfileThread &CurrentThread()
+{
+    if (!current)
+    {
+        lock_guard<mutex> lock(threadsLock);
+        if (threads.empty())
+        {
+            startTicks = ProfileTicks();
+            startTime = steady_clock::now();
+        }
+        threads.emplace_back(new ProfileThread());
+        current = threads.back().get();
+        current->id = (int)threads.size();
+    }
+    return *current;
+}
+
+void EnterProfileZone(ProfileZone zone, const char *name, uint64_t ticks)
+{
+    ProfileThread &thread = CurrentThread();
+    if (thread.depth < MAX_ZONE_DEPTH)
+        thread.stack[thread.depth] = {zone, name, ticks, 0};
+    thread.depth++;
+}
+
+void LeaveProfileZone(uint64_t ticks)
+{
+    ProfileThread &thread = *current;
+    if (--thread.depth >= MAX_ZONE_DEPTH)
+        return;
+
+    OpenZone &open = thread.stack[thread.depth];
+    uint64_t elapsed = ticks - open.start;
+    thread.zoneTicks[open.zone] += elapsed - open.childTicks;
+    if (thread.depth > 0 && thread.depth <= MAX_ZONE_DEPTH)
+        thread.stack[thread.depth - 1].childTicks += elapsed;
+
+    if (tracing.load(memory_order_relaxed))
+    {
+        lock_guard<mutex> lock(thread.traceLock);
+        if (thread.events.size() < MAX_TRACE_EVENTS)
+            thread.events.push_back({open.name, open.start, ticks});
+    }
+}
+
+void CountProfileCall(ProfileCounter counter)
+{
+    CurrentThread().counts[counter]++;
+}
+
+void EndProfileFrame()
+{
+    ProfileThread &thread = CurrentThread();
+    double ticksPerMs = TicksPerNs() * 1e6;
+    for (int z = 0; z < ZONE_COUNT; z++)
+        thread.lastFrame.zoneMs[z] = thread.zoneTicks[z] / ticksPerMs;
+    memcpy(thread.lastFrame.counts, thread.counts, sizeof(thread.counts));
+    memset(thread.zoneTicks, 0, sizeof(thread.zoneTicks));
+    memset(thread.counts, 0, sizeof(thread.counts));
+}
+
+void GetLastProfileFrame(ProfileFrame &frame)
+{
+    frame = CurrentThread().lastFrame;
+}
+
+void StartProfileTrace()
+{
+    CurrentThread();
+    lock_guard<mutex> lock(threadsLock);
+    for (auto &thread : threads)
+    {
+        lock_guard<mutex> traceLock(thread->traceLock);
+        thread->events.clear();
+    }
+    tracing = true;
+}
+
+bool IsProfileTraceRunning()
+{
+    return tracing;
+}
+
+bool WriteProfileTrace(const char *path)
+{
+    tracing = false;
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    double ticksPerUs = TicksPerNs() * 1e3;
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    lock_guard<mutex> lock(threadsLock);
+    for (auto &thread : threads)
+    {
+        lock_guard<mutex> traceLock(thread->traceLock);
+        for (const TraceEvent &event : thread->events)
+        {
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n",
+                    event.name, thread->id, (event.start - startTicks) / ticksPerUs, (event.end - event.start) / ticksPerUs);
+            first = false;
+        }
+        thread->events.clear();
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(file) == 0;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+// Scoped timers and call counters for the hot paths, compiled in with
+// -DCHESS_PROFILE and gone entirely without it (the macros expand to nothing
+// and the functions are empty inlines).
+//
+// Timers read the time stamp counter where there is one and steady_clock
+// elsewhere. Every thread keeps its own counters, zone totals and trace
+// events, so nothing is shared on the hot path. Zone totals are exclusive:
+// rules work done inside an update is counted as rules, not update.
+
+enum ProfileZone
+{
+    ZONE_UPDATE,
+    ZONE_RULES,
+    ZONE_DRAW,
+    ZONE_AUDIO,
+    ZONE_COUNT
+};
+
+enum ProfileCounter
+{
+    COUNT_IS_VALID_MOVE,
+    COUNT_IS_KING_IN_CHECK,
+    COUNT_IS_CHECKMATE,
+    COUNT_WOULD_BE_IN_CHECK,
+    COUNT_CAN_CASTLE,
+    COUNT_HANDLE_PIECE_MOVEMENT,
+    COUNTER_COUNT
+};
+
+extern const char *profileZoneNames[ZONE_COUNT];
+extern const char *profileCounterNames[COUNTER_COUNT];
+
+// One frame of the calling thread
+struct ProfileFrame
+{
+    double zoneMs[ZONE_COUNT];
+    uint64_t counts[COUNTER_COUNT];
+};
+
+#ifdef CHESS_PROFILE
+
+#define PROFILER_ENABLED 1
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+inline uint64_t ProfileTicks() { return __rdtsc(); }
+#else
+#include <chrono>
+inline uint64_t ProfileTicks() { return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count(); }
+#endif
+
+void EnterProfileZone(ProfileZone zone, const char *name, uint64_t ticks);
+void LeaveProfileZone(uint64_t ticks);
+void CountProfileCall(ProfileCounter counter);
+
+struct ProfileScope
+{
+    ProfileScope(ProfileZone zone, const char *name) { EnterProfileZone(zone, name, ProfileTicks()); }
+    ~ProfileScope() { LeaveProfileZone(ProfileTicks()); }
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(zone, name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(zone, name)
+#define PROFILE_COUNT(counter) CountProfileCall(counter)
+
+// Closes the calling thread's current frame: its totals become what
+// GetLastProfileFrame returns, and a new frame starts
+void EndProfileFrame();
+void GetLastProfileFrame(ProfileFrame &frame);
+
+// Chrome trace (chrome://tracing, Perfetto): zones entered on any thread
+// between Start and Write become complete events. Write stops recording.
+void StartProfileTrace();
+bool IsProfileTraceRunning();
+bool WriteProfileTrace(const char *path);
+
+#else
+
+#define PROFILER_ENABLED 0
+#define PROFILE_SCOPE(zone, name)
+#define PROFILE_COUNT(counter)
+
+inline void EndProfileFrame() {}
+inline void GetLastProfileFrame(ProfileFrame &frame) { frame = ProfileFrame(); }
+inline void StartProfileTrace() {}
+inline bool IsProfileTraceRunning() { return false; }
+inline bool WriteProfileTrace(const char *) { return false; }
+
+#endif
@@ -0,0 +1,300 @@
+#include "Evaluate.h"
+#include "GameWorkers.h"
+#include "Pgn.h"
+#include "Search.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+// Usage: puzzles [-scan N] [-verify N] [-gap P] [-moves N] [-skip N] [-threads N] [-hash MB]
+//                <games.pgn> <puzzles.epd>
+//
+// Mines games for tactical puzzles: positions where exactly one move works.
+// Every position goes through three stages, cheapest first:
+//
+//   1. Static filters, no search: past the first -skip plies (default 10),
+//      at least two legal moves, not already decided on material, and
+//      something forcing on the board (a check, a promotion or a capture
+//      that wins material by static exchange).
+//   2. A two-line multi-PV search to -scan depth (8): the best move must be
+//      worth at least -gap percentage points (30) more expected score than
+//      the second best, and not simply take back what was just captured.
+//   3. The same at -verify depth (14), which must agree on the move.
+//
+// A puzzle's solution then goes on with the reply the engine expects and the
+// next move, as long as that move is unique at -verify depth too, up to
+// -moves moves for the solver (3). Puzzles are written as EPD in game order,
+// each position once: bm (the first move), pv (the whole solution), ce or dm
+// (score or mate from the solver's side), id and the game it came from.
+// Games are mined in parallel with RunGameWorkers (GameWorkers.h).
+
+#define DEFAULT_SCAN_DEPTH 8
+#define DEFAULT_VERIFY_DEPTH 14
+#define DEFAULT_SKIP 10
+#define DECIDED_MATERIAL 600 // Static evaluation past which the game is over anyway
+
+struct PuzzleConfig
+{
+    int scanDepth = DEFAULT_SCAN_DEPTH;
+    int verifyDepth = DEFAULT_VERIFY_DEPTH;
+    double gap = 30;
+    int maxMoves = 3;
+    int skip = DEFAULT_SKIP;
+    int threads = 1;
+    int hashMegabytes = 16;
+};
+
+// Positions that got through each stage
+struct PuzzleCounts
+{
+    size_t positions = 0, filtered = 0, scanned = 0, verified = 0;
+};
+
+// One game's puzzles as (key, EPD) and what got through each stage
+struct PuzzleResult
+{
+    vector<pair<uint64_t, string>> puzzles;
+    PuzzleCounts counts;
+};
+
+// Stage 1: worth a search at all
+static bool HasTactics(const Position &pos)
+{
+    if (IsInsufficientMaterial(pos) || abs(Evaluate(pos)) > DECIDED_MATERIAL)
+        return false;
+    Move moves[MAX_MOVES];
+    int count = GenerateLegalMoves(pos, moves);
+    if (count < 2)
+        return false;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (MovePromotion(moves[i]) || (IsCapture(pos, moves[i]) && StaticExchange(pos, moves[i]) > 0))
+            return true;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        Position next = pos;
+        DoMove(next, moves[i]);
+        if (InCheck(next))
+            return true;
+    }
+    return false;
+}
+
+// The best move if it is the only good one at this depth, else MOVE_NONE
+static Move UniqueBestMove(Engine &engine, const Position &pos, const vector<uint64_t> &history, int depth,
+                           double gap, SearchResult &result)
+{
+    SearchLimits limits;
+    limits.depth = depth;
+    limits.multiPv = 2;
+    result = Search(engine, pos, history, limits);
+    if (result.lineCount < 2 || result.lines[0].length == 0)
+        return MOVE_NONE;
+    if (ExpectedScore(result.lines[0].score) - ExpectedScore(result.lines[1].score) < gap)
+        return MOVE_NONE;
+    return result.lines[0].pv[0];
+}
+
+static string FormatPuzzle(const Position &pos, const vector<Move> &solution, int score, const PgnGame &game,
+                           size_t index, size_t ply)
+{
+    // EPD carries only the first four FEN fields
+    string fen = GetFen(pos);
+    for (int field = 0, at = 0; at < (int)fen.size(); at++)
+    {
+        if (fen[at] == ' ' && ++field == 4)
+        {
+            fen.resize(at);
+            break;
+        }
+    }
+
+    string epd = fen + " bm " + MoveToSan(pos, solution[0]) + "; pv";
+    Position line = pos;
+    for (Move m : solution)
+    {
+        epd += " " + MoveToSan(line, m);
+        DoMove(line, m);
+    }
+    char text[32];
+    if (IsMateScore(score))
+        snprintf(text, sizeof(text), "; dm %d;", MateInMoves(score));
+    else
+        snprintf(text, sizeof(text), "; ce %d;", score);
+    epd += text;
+    epd += " id \"" + to_string(index + 1) + "." + to_string(ply + 1) + "\";";
+
+    const char *white = GetPgnTag(game, "White"), *black = GetPgnTag(game, "Black");
+    const char *event = GetPgnTag(game, "Event"), *date = GetPgnTag(game, "Date");
+    string source = string(white ? white : "?") + " - " + (black ? black : "?");
+    if (event)
+        source += string(", ") + event;
+    if (date)
+        source += string(" ") + date;
+    // Quotes would end the EPD string early
+    replace(source.begin(), source.end(), '"', '\'');
+    return epd + " c0 \"" + source + "\";";
+}
+
+static PuzzleResult FindPuzzles(Engine &engine, const PuzzleConfig &config, const PgnGame &game, size_t index)
+{
+    PuzzleResult found;
+    PuzzleCounts &counts = found.counts;
+    Position pos;
+    SetStartPosition(pos);
+    const char *fen = GetPgnTag(game, "FEN");
+    if (fen && !SetFromFen(pos, fen))
+        return found;
+
+    vector<uint64_t> history;
+    Move previous = MOVE_NONE;
+    bool previousCapture = false;
+    for (size_t ply = 0; ply < game.moves.size(); ply++)
+    {
+        Move played = ParseSanMove(pos, game.moves[ply].c_str());
+        if (played == MOVE_NONE)
+            break;
+        counts.positions++;
+
+        if ((int)ply >= config.skip && HasTactics(pos))
+        {
+            counts.filtered++;
+            SearchResult result;
+            Move best = UniqueBestMove(engine, pos, history, config.scanDepth, config.gap, result);
+            // Taking back a piece that was just captured is no puzzle
+            if (best != MOVE_NONE && previousCapture && MoveTo(best) == MoveTo(previous))
+                best = MOVE_NONE;
+            if (best != MOVE_NONE)
+            {
+                counts.scanned++;
+                if (UniqueBestMove(engine, pos, history, config.verifyDepth, config.gap, result) == best)
+                {
+                    counts.verified++;
+                    int score = result.lines[0].score;
+                    vector<Move> solution(1, best);
+
+                    // Extend while the solver's next move is unique as well
+                    Position line = pos;
+                    vector<uint64_t> keys = history;
+                    keys.push_back(line.key);
+                    DoMove(line, best);
+                    for (int moves = 1; moves < config.maxMoves && result.lines[0].length >= 2; moves++)
+                    {
+                        Move reply = result.lines[0].pv[1];
+                        Position after = line;
+                        DoMove(after, reply);
+                        keys.push_back(line.key);
+                        Move next = UniqueBestMove(engine, after, keys, config.verifyDepth, config.gap, result);
+                        if (next == MOVE_NONE)
+                            break;
+                        solution.push_back(reply);
+                        solution.push_back(next);
+                        keys.push_back(after.key);
+                        line = after;
+                        DoMove(line, next);
+                    }
+                    found.puzzles.emplace_back(pos.key, FormatPuzzle(pos, solution, score, game, index, ply));
+                }
+            }
+        }
+
+        previous = played;
+        previousCapture = IsCapture(pos, played);
+        history.push_back(pos.key);
+        DoMove(pos, played);
+    }
+    return found;
+}
+
+int main(int argc, char **argv)
+{
+    PuzzleConfig config;
+    config.threads = max((int)thread::hardware_concurrency(), 1);
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-scan") == 0)
+            config.scanDepth = max(atoi(argv[first + 1]), 1);
+        else if (strcmp(argv[first], "-verify") == 0)
+            config.verifyDepth = max(atoi(argv[first + 1]), 1);
+        else if (strcmp(argv[first], "-gap") == 0)
+            config.gap = atof(argv[first + 1]);
+        else if (strcmp(argv[first], "-moves") == 0)
+            config.maxMoves = max(atoi(argv[first + 1]), 1);
+        else if (strcmp(argv[first], "-skip") == 0)
+            config.skip = max(atoi(argv[first + 1]), 0);
+        else if (strcmp(argv[first], "-threads") == 0)
+            config.threads = max(atoi(argv[first + 1]), 1);
+        else if (strcmp(argv[first], "-hash") == 0)
+            config.hashMegabytes = max(atoi(argv[first + 1]), 1);
+        else
+            printf("Unknown option %s\n", argv[first]);
+        first += 2;
+    }
+
+    if (argc - first != 2)
+    {
+        printf("Usage: %s [-scan N] [-verify N] [-gap P] [-moves N] [-skip N] [-threads N] [-hash MB] "
+               "<games.pgn> <puzzles.epd>\n",
+               argv[0]);
+        return 1;
+    }
+
+    PgnReader reader;
+    if (!OpenPgn(reader, argv[first]))
+    {
+        printf("Could not open %s\n", argv[first]);
+        return 1;
+    }
+    FILE *out = fopen(argv[first + 1], "w");
+    if (!out)
+    {
+        printf("Could not create %s\n", argv[first + 1]);
+        return 1;
+    }
+
+    PuzzleCounts counts;
+    set<uint64_t> seen; // Positions already written, from any game
+    size_t puzzles = 0, duplicates = 0;
+    steady_clock::time_point start = steady_clock::now();
+    size_t games = RunGameWorkers<PuzzleResult>(
+        reader, config.threads, config.hashMegabytes,
+        [&](Engine &engine, PgnGame &game, size_t index) { return FindPuzzles(engine, config, game, index); },
+        [&](PgnGame &, size_t, PuzzleResult &found)
+        {
+            counts.positions += found.counts.positions;
+            counts.filtered += found.counts.filtered;
+            counts.scanned += found.counts.scanned;
+            counts.verified += found.counts.verified;
+            for (auto &puzzle : found.puzzles)
+            {
+                if (!seen.insert(puzzle.first).second)
+                {
+                    duplicates++;
+                    continue;
+                }
+                fprintf(out, "%s\n", puzzle.second.c_str());
+                puzzles++;
+            }
+            fflush(out);
+        });
+    ClosePgn(reader);
+    fclose(out);
+
+    double seconds = duration_cast<milliseconds>(steady_clock::now() - start).count() / 1000.0;
+    printf("%zu games, %zu positions in %.1f s on %d threads\n", games, counts.positions, seconds, config.threads);
+    printf("%zu passed the static filters, %zu the scan, %zu the verification\n", counts.filtered, counts.scanned,
+           counts.verified);
+    printf("%zu puzzles written, %zu repeated positions left out\n", puzzles, duplicates);
+    return 0;
+}
@@ -0,0 +1,428 @@
+#include "GameState.h"
+#include "Position.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+// Usage: rulesbench [-positions N] [-samples N] [-seed N] [-out results.txt]
+//                   [-baseline results.txt] [-threshold PCT]
+//
+// Times the board-screen rules (GameState.cpp) over a fixed corpus of
+// positions: random games from the start position with a fixed seed, so every
+// run and every machine sees the same positions. Each benchmark is run as
+// several samples; the median ns/op is reported together with the spread
+// (median absolute deviation), and a benchmark whose spread is above
+// MAX_SPREAD_PCT is rerun and marked unstable if it stays that way. On Linux,
+// cycles, instructions, branch misses and cache misses per op come from
+// perf_event when the kernel allows it.
+//
+// -out writes "name ns_per_op spread_pct" lines; -baseline reads the same
+// format and exits with 1 if any benchmark got slower by more than -threshold
+// percent (default 5).
+
+#define SAMPLE_MS 40       // Target length of one sample
+#define MAX_SPREAD_PCT 3.0 // Above this a benchmark is rerun
+#define MAX_ATTEMPTS 3
+
+static volatile uint64_t sink; // Keeps results alive so the calls can't be optimised out
+
+static uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Positions 0 to 120 plies into random games; games that end early are cut where they end
+static vector<GameState> BuildCorpus(int count, uint64_t seed)
+{
+    vector<GameState> corpus;
+    Move moves[MAX_MOVES];
+    while ((int)corpus.size() < count)
+    {
+        Position pos;
+        SetStartPosition(pos);
+        int plies = (int)(SplitMix64(seed) % 121);
+        for (int ply = 0; ply < plies; ply++)
+        {
+            int n = GenerateLegalMoves(pos, moves);
+            if (n == 0)
+                break;
+            Move m = moves[SplitMix64(seed) % n];
+            // The board screen only ever promotes through its menu; keep to queens
+            if (MovePromotion(m) && MovePromotion(m) != QUEEN)
+                m = EncodeMove(MoveFrom(m), MoveTo(m), QUEEN);
+            DoMove(pos, m);
+        }
+        if (GenerateLegalMoves(pos, moves) == 0)
+            continue;
+
+        GameState state;
+        SetGamePosition(state, pos);
+        corpus.push_back(state);
+    }
+    return corpus;
+}
+
+// One pass over the corpus; returns the number of calls made
+typedef uint64_t (*BenchPass)(const vector<GameState> &corpus);
+
+static uint64_t BenchIsValidMove(const vector<GameState> &corpus)
+{
+    uint64_t calls = 0, legal = 0;
+    for (const GameState &state : corpus)
+    {
+        bool isWhite = IsWhiteTurn(state);
+        for (int from = 0; from < 64; from++)
+        {
+            int piece = PieceAt(state, from / 8, from % 8);
+            if (piece == 0 || (piece > 0) != isWhite)
+                continue;
+            for (int to = 0; to < 64; to++)
+                legal += IsValidMove(state, piece, from / 8, from % 8, to / 8, to % 8);
+            calls += 64;
+        }
+    }
+    sink += legal;
+    return calls;
+}
+
+static uint64_t BenchIsKingInCheck(const vector<GameState> &corpus)
+{
+    uint64_t checks = 0;
+    for (const GameState &state : corpus)
+        checks += IsKingInCheck(state, true) + IsKingInCheck(state, false);
+    sink += checks;
+    return corpus.size() * 2;
+}
+
+static uint64_t BenchIsCheckmate(const vector<GameState> &corpus)
+{
+    uint64_t mates = 0;
+    for (const GameState &state : corpus)
+        mates += IsCheckmate(state, IsWhiteTurn(state));
+    sink += mates;
+    return corpus.size();
+}
+
+static uint64_t BenchCanCastle(const vector<GameState> &corpus)
+{
+    uint64_t allowed = 0;
+    for (const GameState &state : corpus)
+    {
+        allowed += CanCastle(state, true, true) + CanCastle(state, true, false);
+        allowed += CanCastle(state, false, true) + CanCastle(state, false, false);
+    }
+    sink += allowed;
+    return corpus.size() * 4;
+}
+
+static uint64_t BenchHandlePieceMovement(const vector<GameState> &corpus)
+{
+    uint64_t calls = 0, targets = 0;
+    int possibleMoves[8][8];
+    for (const GameState &state : corpus)
+    {
+        bool isWhite = IsWhiteTurn(state);
+        for (int from = 0; from < 64; from++)
+        {
+            int piece = PieceAt(state, from / 8, from % 8);
+            if (piece == 0 || (piece > 0) != isWhite)
+                continue;
+            memset(possibleMoves, 0, sizeof(possibleMoves));
+            HandlePieceMovement(state, from / 8, from % 8, possibleMoves);
+            for (int sq = 0; sq < 64; sq++)
+                targets += possibleMoves[sq / 8][sq % 8];
+            calls++;
+        }
+    }
+    sink += targets;
+    return calls;
+}
+
+struct Benchmark
+{
+    const char *name;
+    BenchPass pass;
+};
+
+static const Benchmark benchmarks[] = {
+    {"IsValidMove", BenchIsValidMove},
+    {"IsKingInCheck", BenchIsKingInCheck},
+    {"IsCheckmate", BenchIsCheckmate},
+    {"CanCastle", BenchCanCastle},
+    {"HandlePieceMovement", BenchHandlePieceMovement},
+};
+
+// Hardware counters for the calling thread, user space only
+struct PerfCounters
+{
+    int fds[4] = {-1, -1, -1, -1};
+    uint64_t values[4] = {};
+};
+
+static const char *perfCounterNames[4] = {"cycles", "instructions", "branch-misses", "cache-misses"};
+
+static bool OpenPerfCounters(PerfCounters &perf)
+{
+#ifdef __linux__
+    const uint64_t configs[4] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+                                 PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < 4; i++)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        perf.fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    return perf.fds[0] >= 0;
+#else
+    (void)perf;
+    return false;
+#endif
+}
+
+static void StartPerfCounters(PerfCounters &perf)
+{
+#ifdef __linux__
+    for (int fd : perf.fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void)perf;
+#endif
+}
+
+static void StopPerfCounters(PerfCounters &perf)
+{
+#ifdef __linux__
+    for (int i = 0; i < 4; i++)
+    {
+        perf.values[i] = 0;
+        if (perf.fds[i] >= 0)
+        {
+            ioctl(perf.fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(perf.fds[i], &perf.values[i], sizeof(uint64_t)) != sizeof(uint64_t))
+                perf.values[i] = 0;
+        }
+    }
+#else
+    (void)perf;
+#endif
+}
+
+static void ClosePerfCounters(PerfCounters &perf)
+{
+#ifdef __linux__
+    for (int &fd : perf.fds)
+    {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+#else
+    (void)perf;
+#endif
+}
+
+struct BenchResult
+{
+    double nsPerOp;   // Median over the samples
+    double spreadPct; // Median absolute deviation, as a percentage of the median
+    bool stable;
+    double perOp[4]; // Perf counters per op, from one extra pass; negative if unavailable
+};
+
+static double Median(vector<double> values)
+{
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static BenchResult RunBenchmark(const Benchmark &bench, const vector<GameState> &corpus, int samples, PerfCounters &perf, bool hasPerf)
+{
+    // Warm up, and find how many passes fill one sample
+    steady_clock::time_point start = steady_clock::now();
+    bench.pass(corpus);
+    double passNs = (double)duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    int passes = max(1, (int)(SAMPLE_MS * 1e6 / max(passNs, 1.0)));
+
+    BenchResult result = {};
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++)
+    {
+        vector<double> times;
+        for (int s = 0; s < samples; s++)
+        {
+            uint64_t calls = 0;
+            start = steady_clock::now();
+            for (int p = 0; p < passes; p++)
+                calls += bench.pass(corpus);
+            double ns = (double)duration_cast<nanoseconds>(steady_clock::now() - start).count();
+            times.push_back(ns / calls);
+        }
+        result.nsPerOp = Median(times);
+        vector<double> deviations;
+        for (double t : times)
+            deviations.push_back(fabs(t - result.nsPerOp));
+        result.spreadPct = 100.0 * Median(deviations) / result.nsPerOp;
+        result.stable = result.spreadPct <= MAX_SPREAD_PCT;
+        if (result.stable)
+            break;
+    }
+
+    for (double &value : result.perOp)
+        value = -1;
+    if (hasPerf)
+    {
+        StartPerfCounters(perf);
+        uint64_t calls = 0;
+        for (int p = 0; p < passes; p++)
+            calls += bench.pass(corpus);
+        StopPerfCounters(perf);
+        for (int i = 0; i < 4; i++)
+            result.perOp[i] = perf.fds[i] >= 0 ? (double)perf.values[i] / calls : -1;
+    }
+    return result;
+}
+
+static bool ReadBaseline(const char *path, map<string, double> &baseline)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    char line[256], name[128];
+    double ns;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] != '#' && sscanf(line, "%127s %lf", name, &ns) == 2)
+            baseline[name] = ns;
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int positions = 2000, samples = 15;
+    uint64_t seed = 20240601;
+    const char *outPath = nullptr, *baselinePath = nullptr;
+    double threshold = 5.0;
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            printf("Usage: %s [-positions N] [-samples N] [-seed N] [-out results.txt] [-baseline results.txt] [-threshold PCT]\n", argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "-positions") == 0)
+            positions = max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-samples") == 0)
+            samples = max(3, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-seed") == 0)
+            seed = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "-out") == 0)
+            outPath = argv[i + 1];
+        else if (strcmp(argv[i], "-baseline") == 0)
+            baselinePath = argv[i + 1];
+        else if (strcmp(argv[i], "-threshold") == 0)
+            threshold = atof(argv[i + 1]);
+        else
+            printf("Unknown option %s\n", argv[i]);
+    }
+
+    map<string, double> baseline;
+    if (baselinePath && !ReadBaseline(baselinePath, baseline))
+    {
+        printf("Could not read %s\n", baselinePath);
+        return 1;
+    }
+
+    vector<GameState> corpus = BuildCorpus(positions, seed);
+    PerfCounters perf;
+    bool hasPerf = OpenPerfCounters(perf);
+    printf("%d positions, seed %llu, %d samples of ~%d ms%s\n", positions, (unsigned long long)seed, samples, SAMPLE_MS,
+           hasPerf ? "" : ", no perf counters");
+
+    printf("%-20s %10s %8s", "benchmark", "ns/op", "spread");
+    if (hasPerf)
+    {
+        for (const char *name : perfCounterNames)
+            printf(" %14s", name);
+    }
+    printf("%s\n", baselinePath ? "   vs baseline" : "");
+
+    FILE *out = outPath ? fopen(outPath, "w") : nullptr;
+    if (outPath && !out)
+    {
+        printf("Could not write %s\n", outPath);
+        return 1;
+    }
+    if (out)
+        fprintf(out, "# rulesbench: name ns_per_op spread_pct, %d positions, seed %llu\n", positions, (unsigned long long)seed);
+
+    bool regressed = false;
+    for (const Benchmark &bench : benchmarks)
+    {
+        BenchResult result = RunBenchmark(bench, corpus, samples, perf, hasPerf);
+        printf("%-20s %10.1f %7.1f%%", bench.name, result.nsPerOp, result.spreadPct);
+        if (hasPerf)
+        {
+            for (double value : result.perOp)
+            {
+                if (value < 0)
+                    printf(" %14s", "-");
+                else
+                    printf(" %14.1f", value);
+            }
+        }
+        auto base = baseline.find(bench.name);
+        if (base != baseline.end())
+        {
+            double change = 100.0 * (result.nsPerOp / base->second - 1);
+            bool slower = change > threshold;
+            regressed |= slower;
+            printf("   %+.1f%%%s", change, slower ? " REGRESSION" : "");
+        }
+        printf("%s\n", result.stable ? "" : " (unstable)");
+        fflush(stdout);
+
+        if (out)
+            fprintf(out, "%s %.3f %.2f\n", bench.name, result.nsPerOp, result.spreadPct);
+    }
+
+    if (out)
+        fclose(out);
+    ClosePerfCounters(perf);
+    if (regressed)
+        printf("Slower than the baseline by more than %.1f%%\n", threshold);
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,490 @@
+#include "GameState.h"
+#include "Position.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace std;
+
+// Usage: rulesfuzz [-games N] [-plies N] [-seed N] [-skip moves,board,turn,mate]
+//
+// Differential fuzzer for the board-screen rules (GameState.cpp) against the
+// bitboard generator in Position.cpp, which is first checked against known
+// perft counts. Random legal games are played on both at once, and at every
+// ply it compares:
+//
+//   moves      destinations the board highlights and accepts (the legal move cache)
+//   board      the pieces after the move (castling, en passant, promotion)
+//   turn       side to move after the move
+//   mate       game over flagged exactly when the side to move is mated
+//
+// Before the games, every promotion of a few fixed positions goes through
+// the same comparison, since random games seldom reach one.
+//
+// A failure is shrunk by taking pieces off the board while the same mismatch
+// still shows, and printed as a FEN plus the move in question. -skip leaves
+// out known differences; the rules are put back in step with the reference
+// after a skipped one so the game can go on.
+//
+// Built with clang -fsanitize=fuzzer -DRULES_FUZZ_LIBFUZZER the same check
+// runs as a libFuzzer target: the input bytes choose the moves, and
+// RULESFUZZ_SKIP holds the -skip list.
+
+#define MAX_PLIES 400
+
+enum FailureKind
+{
+    FAIL_NONE,
+    FAIL_MOVES,
+    FAIL_BOARD,
+    FAIL_TURN,
+    FAIL_MATE,
+    FAIL_KIND_COUNT
+};
+
+static const char *failureNames[FAIL_KIND_COUNT] = {"", "moves", "board", "turn", "mate"};
+
+struct Failure
+{
+    FailureKind kind = FAIL_NONE;
+    Position pos;
+    Move move = MOVE_NONE;
+    bool referenceHasMove = false; // moves: which side the move was missing from
+    bool needsHistory = false;     // Didn't reproduce from the FEN alone
+    string detail;
+    string history; // UCI moves from the start position
+};
+
+// Move choices come from the fuzzer's input, or from a seeded generator
+struct ByteSource
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t at = 0;
+    uint64_t seed = 0;
+};
+
+static uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// -1 once the input has run out
+static int NextChoice(ByteSource &source, int count)
+{
+    if (!source.data)
+        return (int)(SplitMix64(source.seed) % count);
+    if (source.at >= source.size)
+        return -1;
+    return source.data[source.at++] % count;
+}
+
+static uint64_t Perft(const Position &pos, int depth)
+{
+    Move moves[MAX_MOVES];
+    int n = GenerateLegalMoves(pos, moves);
+    if (depth == 1)
+        return n;
+    uint64_t nodes = 0;
+    for (int i = 0; i < n; i++)
+    {
+        Position next = pos;
+        DoMove(next, moves[i]);
+        nodes += Perft(next, depth - 1);
+    }
+    return nodes;
+}
+
+// The reference has to be right before it can judge anything
+static bool CheckReference()
+{
+    struct PerftCase
+    {
+        const char *fen;
+        int depth;
+        uint64_t nodes;
+    };
+    static const PerftCase cases[] = {
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+        {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4, 43238},
+        {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3, 9467},
+        {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+    };
+    for (const PerftCase &test : cases)
+    {
+        Position pos;
+        uint64_t nodes = SetFromFen(pos, test.fen) ? Perft(pos, test.depth) : 0;
+        if (nodes != test.nodes)
+        {
+            printf("Reference generator is wrong: perft %d of %s gives %llu, expected %llu\n", test.depth, test.fen,
+                   (unsigned long long)nodes, (unsigned long long)test.nodes);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Legal moves as from-square -> destination bitboards; promotions count once
+static void ReferenceDestinations(const Position &pos, uint64_t destinations[64])
+{
+    memset(destinations, 0, 64 * sizeof(uint64_t));
+    Move moves[MAX_MOVES];
+    int n = GenerateLegalMoves(pos, moves);
+    for (int i = 0; i < n; i++)
+        destinations[MoveFrom(moves[i])] |= 1ULL << MoveTo(moves[i]);
+}
+
+static void CacheDestinations(const GameState &state, uint64_t destinations[64])
+{
+    LegalMoveCache cache = {};
+    UpdateLegalMoveCache(cache, state);
+    memcpy(destinations, cache.destinations, 64 * sizeof(uint64_t));
+}
+
+static bool FirstDifference(const uint64_t reference[64], const uint64_t rules[64], int &from, int &to)
+{
+    for (from = 0; from < 64; from++)
+    {
+        uint64_t diff = reference[from] ^ rules[from];
+        if (diff)
+        {
+            to = Lsb(diff);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Plays m on both sides and compares what comes out
+static FailureKind CheckMoveResult(const Position &pos, GameState &state, Move m, string &detail)
+{
+    int from = MoveFrom(m), to = MoveTo(m);
+    int effects = ApplyGameMove(state, from / 8, from % 8, to / 8, to % 8);
+    if (effects & MOVE_PROMOTION)
+        ApplyPromotion(state, QUEEN - MovePromotion(m)); // choice 0-3 = queen, rook, bishop, knight
+
+    Position next = pos;
+    DoMove(next, m);
+
+    for (int sq = 0; sq < 64; sq++)
+    {
+        if (PieceAt(state, sq / 8, sq % 8) != next.board[sq])
+        {
+            detail = "square " + SquareName(sq) + " holds " + to_string(PieceAt(state, sq / 8, sq % 8)) +
+                     ", expected " + to_string(next.board[sq]);
+            return FAIL_BOARD;
+        }
+    }
+    if (IsWhiteTurn(state) != next.whiteToMove)
+    {
+        detail = string(IsWhiteTurn(state) ? "white" : "black") + " to move, expected " + (next.whiteToMove ? "white" : "black");
+        return FAIL_TURN;
+    }
+    Move moves[MAX_MOVES];
+    bool mated = GenerateLegalMoves(next, moves) == 0 && InCheck(next);
+    if (HasGameFlag(state, GAME_OVER) != mated)
+    {
+        detail = mated ? "mate not detected" : "game over without mate";
+        return FAIL_MATE;
+    }
+    return FAIL_NONE;
+}
+
+// Promotions the way the board screen's engine plays them, ApplyGameMove then
+// ApplyPromotion straight after: every piece, both colours, with and without
+// a capture. Random games reach promotions too rarely to watch this closely.
+static bool CheckPromotions()
+{
+    static const char *cases[] = {
+        "6k1/8/8/8/8/8/1p4K1/8 b - - 0 1",   // b2b1
+        "1r4k1/P7/8/8/8/8/8/6K1 w - - 0 1",   // a7a8, a7b8
+        "6k1/8/8/8/8/8/1p4K1/2R5 b - - 0 1",  // b2b1, b2c1
+    };
+    for (const char *fen : cases)
+    {
+        Position pos;
+        SetFromFen(pos, fen);
+        Move moves[MAX_MOVES];
+        int n = GenerateLegalMoves(pos, moves);
+        for (int i = 0; i < n; i++)
+        {
+            if (!MovePromotion(moves[i]))
+                continue;
+            GameState state;
+            SetGamePosition(state, pos);
+            string detail;
+            FailureKind kind = CheckMoveResult(pos, state, moves[i], detail);
+            if (kind != FAIL_NONE)
+            {
+                printf("Promotion mismatch (%s): %s\n  fen  %s\n  move %s\n", failureNames[kind], detail.c_str(), fen,
+                       MoveToUci(moves[i]).c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The move set comparison on a state built fresh from pos
+static bool MoveSetDiffers(const Position &pos, int from, int to, bool referenceHasMove)
+{
+    GameState state;
+    SetGamePosition(state, pos);
+    uint64_t reference[64], rules[64];
+    ReferenceDestinations(pos, reference);
+    CacheDestinations(state, rules);
+    bool inReference = (reference[from] >> to) & 1, inRules = (rules[from] >> to) & 1;
+    return inReference == referenceHasMove && inRules != referenceHasMove;
+}
+
+static bool StillFails(const Position &pos, const Failure &failure)
+{
+    int from = MoveFrom(failure.move), to = MoveTo(failure.move);
+    if (failure.kind == FAIL_MOVES)
+        return MoveSetDiffers(pos, from, to, failure.referenceHasMove);
+
+    Move moves[MAX_MOVES];
+    int n = GenerateLegalMoves(pos, moves);
+    bool legal = false;
+    for (int i = 0; i < n && !legal; i++)
+        legal = moves[i] == failure.move;
+    if (!legal)
+        return false;
+
+    GameState state;
+    SetGamePosition(state, pos);
+    string detail;
+    return CheckMoveResult(pos, state, failure.move, detail) == failure.kind;
+}
+
+// Board with one piece taken off, castling rights that lost their rook or king dropped
+static bool RemovePiece(const Position &pos, int sq, Position &result)
+{
+    int board[8][8];
+    for (int s = 0; s < 64; s++)
+        board[s / 8][s % 8] = s == sq ? 0 : pos.board[s];
+
+    uint8_t castling = pos.castling;
+    if (board[7][4] != KING)
+        castling &= ~(WHITE_KINGSIDE | WHITE_QUEENSIDE);
+    if (board[7][7] != ROOK)
+        castling &= ~WHITE_KINGSIDE;
+    if (board[7][0] != ROOK)
+        castling &= ~WHITE_QUEENSIDE;
+    if (board[0][4] != -KING)
+        castling &= ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+    if (board[0][7] != -ROOK)
+        castling &= ~BLACK_KINGSIDE;
+    if (board[0][0] != -ROOK)
+        castling &= ~BLACK_QUEENSIDE;
+
+    int epRow = pos.enPassant < 0 ? -1 : pos.enPassant / 8, epCol = pos.enPassant < 0 ? -1 : pos.enPassant % 8;
+    SetFromBoard(result, board, pos.whiteToMove, castling, epRow, epCol);
+
+    // The side that just moved can't be left in check
+    return !IsSquareAttacked(result, KingSquare(result, !result.whiteToMove), result.whiteToMove);
+}
+
+static void Shrink(Failure &failure)
+{
+    if (!StillFails(failure.pos, failure))
+    {
+        failure.needsHistory = true;
+        return;
+    }
+
+    int from = MoveFrom(failure.move), to = MoveTo(failure.move);
+    bool removed = true;
+    while (removed)
+    {
+        removed = false;
+        for (int sq = 0; sq < 64; sq++)
+        {
+            int piece = failure.pos.board[sq];
+            if (piece == 0 || abs(piece) == KING || sq == from || sq == to)
+                continue;
+            Position smaller;
+            if (RemovePiece(failure.pos, sq, smaller) && StillFails(smaller, failure))
+            {
+                failure.pos = smaller;
+                removed = true;
+            }
+        }
+    }
+}
+
+// Plays one game; true with failure filled in on the first mismatch not in skip
+static bool FuzzGame(ByteSource &source, int plies, unsigned skip, Failure &failure)
+{
+    Position pos;
+    SetStartPosition(pos);
+    GameState state;
+    ResetGameState(state);
+    string history;
+    Move moves[MAX_MOVES];
+
+    for (int ply = 0; ply < plies; ply++)
+    {
+        int n = GenerateLegalMoves(pos, moves);
+        if (n == 0)
+            return false;
+
+        if (!(skip & (1u << FAIL_MOVES)))
+        {
+            uint64_t reference[64], rules[64];
+            ReferenceDestinations(pos, reference);
+            CacheDestinations(state, rules);
+            int from, to;
+            if (FirstDifference(reference, rules, from, to))
+            {
+                failure.kind = FAIL_MOVES;
+                failure.pos = pos;
+                failure.move = EncodeMove(from, to);
+                failure.referenceHasMove = (reference[from] >> to) & 1;
+                failure.detail = failure.referenceHasMove ? "legal move not accepted" : "illegal move accepted";
+                failure.history = history;
+                return true;
+            }
+        }
+
+        int choice = NextChoice(source, n);
+        if (choice < 0)
+            return false;
+        Move m = moves[choice];
+
+        FailureKind kind = CheckMoveResult(pos, state, m, failure.detail);
+        if (kind != FAIL_NONE && !(skip & (1u << kind)))
+        {
+            failure.kind = kind;
+            failure.pos = pos;
+            failure.move = m;
+            failure.history = history;
+            return true;
+        }
+
+        history += (history.empty() ? "" : " ") + MoveToUci(m);
+        DoMove(pos, m);
+        // After a skipped mismatch carry on from the reference
+        if (kind != FAIL_NONE)
+            SetGamePosition(state, pos);
+    }
+    return false;
+}
+
+static void PrintFailure(const Failure &failure)
+{
+    printf("Mismatch (%s): %s\n", failureNames[failure.kind], failure.detail.c_str());
+    printf("  fen  %s\n", GetFen(failure.pos).c_str());
+    printf("  move %s\n", MoveToUci(failure.move).c_str());
+    if (failure.needsHistory)
+        printf("  only reproduces after the moves: %s\n", failure.history.empty() ? "(none)" : failure.history.c_str());
+}
+
+static unsigned ParseSkip(const char *list)
+{
+    unsigned skip = 0;
+    string text = list ? list : "";
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find(',', start);
+        string name = text.substr(start, end == string::npos ? string::npos : end - start);
+        bool known = false;
+        for (int kind = FAIL_MOVES; kind < FAIL_KIND_COUNT; kind++)
+        {
+            if (name == failureNames[kind])
+            {
+                skip |= 1u << kind;
+                known = true;
+            }
+        }
+        if (!known)
+            printf("Unknown check %s\n", name.c_str());
+        start = end == string::npos ? text.size() : end + 1;
+    }
+    return skip;
+}
+
+#ifdef RULES_FUZZ_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool referenceChecked = CheckReference() && CheckPromotions();
+    static unsigned skip = ParseSkip(getenv("RULESFUZZ_SKIP"));
+    if (!referenceChecked)
+        abort();
+
+    ByteSource source;
+    source.data = data;
+    source.size = size;
+    Failure failure;
+    if (FuzzGame(source, MAX_PLIES, skip, failure))
+    {
+        Shrink(failure);
+        PrintFailure(failure);
+        fflush(stdout);
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    int games = 10000, plies = MAX_PLIES;
+    uint64_t seed = 1;
+    unsigned skip = 0;
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            printf("Usage: %s [-games N] [-plies N] [-seed N] [-skip moves,board,turn,mate]\n", argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "-games") == 0)
+            games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-plies") == 0)
+            plies = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-seed") == 0)
+            seed = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "-skip") == 0)
+            skip = ParseSkip(argv[i + 1]);
+        else
+            printf("Unknown option %s\n", argv[i]);
+    }
+
+    if (!CheckReference() || !CheckPromotions())
+        return 1;
+
+    for (int game = 0; game < games; game++)
+    {
+        // Every game has its own seed so a failure can be replayed alone
+        ByteSource source;
+        source.seed = seed + game;
+        Failure failure;
+        if (FuzzGame(source, plies, skip, failure))
+        {
+            printf("Game %d (-seed %llu -games 1):\n", game + 1, (unsigned long long)(seed + game));
+            Shrink(failure);
+            PrintFailure(failure);
+            return 1;
+        }
+        if ((game + 1) % 1000 == 0)
+        {
+            printf("%d games, no mismatches\n", game + 1);
+            fflush(stdout);
+        }
+    }
+    if (games % 1000 != 0)
+        printf("%d games, no mismatches\n", games);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,877 @@
+#include "Search.h"
+#include "Evaluate.h"
+#include "Syzygy.h"
+#include "Tablebase.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+struct RootMove
+{
+    Move move = MOVE_NONE;
+    int score = -VALUE_INFINITE;
+    int previousScore = -VALUE_INFINITE;
+    int selDepth = 0;
+    Move pv[MAX_PLY];
+    int pvLength = 0;
+};
+
+struct SearchThread;
+
+// State shared by the threads of one search
+struct SearchControl
+{
+    const SearchLimits *limits;
+    const function<void(const SearchInfo &)> *report;
+    vector<unique_ptr<SearchThread>> *threads;
+    int softMs = 0;
+    int hardMs = 0;
+    int multiPv = 1;
+};
+
+struct SearchThread
+{
+    Engine *engine;
+    SearchControl *control;
+    int id = 0;
+    Position root;
+    vector<uint64_t> keys; // Positions before the current one; 0 marks a null move
+    vector<RootMove> rootMoves;
+    int pvIndex = 0;
+    int rootDepth = 0;
+    int completedDepth = 0;
+    int selDepth = 0;
+    atomic<uint64_t> nodes{0};
+    atomic<uint64_t> tbHits{0};
+    int history[2][64][64];
+    Move killers[MAX_PLY + 1][2];
+    Move pv[MAX_PLY + 1][MAX_PLY + 1]; // Triangular PV table
+    int pvLength[MAX_PLY + 1];
+};
+
+static const int seeValues[7] = {0, 100, 300, 300, 500, 900, 0};
+static int reductions[64][64];
+
+static struct SearchTables
+{
+    SearchTables()
+    {
+        for (int depth = 1; depth < 64; depth++)
+        {
+            for (int moves = 1; moves < 64; moves++)
+                reductions[depth][moves] = (int)(0.75 + log((double)depth) * log((double)moves) / 2.25);
+        }
+    }
+} searchTables;
+
+bool IsMateScore(int score)
+{
+    return abs(score) >= VALUE_MATE_IN_MAX;
+}
+
+int MateInMoves(int score)
+{
+    return score > 0 ? (VALUE_MATE - score + 1) / 2 : -(VALUE_MATE + score) / 2;
+}
+
+void InitEngine(Engine &engine, int hashMegabytes, int threads)
+{
+    SetEngineHash(engine, hashMegabytes);
+    SetEngineThreads(engine, threads);
+}
+
+void SetEngineHash(Engine &engine, int megabytes)
+{
+    ResizeTranspositionTable(engine.tt, (size_t)max(megabytes, 1));
+}
+
+void SetEngineThreads(Engine &engine, int threads)
+{
+    engine.threads = max(threads, 1);
+}
+
+void ClearEngine(Engine &engine)
+{
+    ClearTranspositionTable(engine.tt);
+}
+
+void StopSearch(Engine &engine)
+{
+    engine.stop = true;
+}
+
+static int64_t NowNs()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void PonderHit(Engine &engine)
+{
+    engine.startNs = NowNs();
+    engine.pondering = false;
+}
+
+void AllocateSearchTime(const SearchLimits &limits, bool whiteToMove, int &softMs, int &hardMs)
+{
+    softMs = hardMs = 0;
+    if (limits.moveTime > 0)
+    {
+        softMs = hardMs = limits.moveTime;
+        return;
+    }
+
+    int side = whiteToMove ? 0 : 1;
+    if (limits.time[side] <= 0)
+        return;
+
+    // Keep a little back for communication, never bet more than half the clock
+    // unless the time control ends with this move
+    const int overhead = 30;
+    int available = max(limits.time[side] - overhead, 1);
+    int movesToGo = limits.movesToGo > 0 ? min(limits.movesToGo, 40) : 30;
+    softMs = available / movesToGo + limits.increment[side] * 3 / 4;
+    hardMs = min(softMs * 4, movesToGo == 1 ? available * 9 / 10 : available / 2);
+    softMs = max(min(softMs, hardMs), 1);
+    hardMs = max(hardMs, 1);
+}
+
+static int64_t ElapsedMs(const Engine &engine)
+{
+    return (NowNs() - engine.startNs.load()) / 1000000;
+}
+
+static uint64_t TotalNodes(const SearchControl &control)
+{
+    uint64_t nodes = 0;
+    for (auto &thread : *control.threads)
+        nodes += thread->nodes.load(memory_order_relaxed);
+    return nodes;
+}
+
+static uint64_t TotalTbHits(const SearchControl &control)
+{
+    uint64_t hits = 0;
+    for (auto &thread : *control.threads)
+        hits += thread->tbHits.load(memory_order_relaxed);
+    return hits;
+}
+
+static void CountNode(SearchThread &t)
+{
+    t.nodes.store(t.nodes.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Only the main thread looks at the clock; everyone polls the stop flag
+static bool ShouldStop(SearchThread &t)
+{
+    Engine &engine = *t.engine;
+    if (t.id == 0 && (t.nodes.load(memory_order_relaxed) & 1023) == 0)
+    {
+        const SearchControl &control = *t.control;
+        if (control.hardMs > 0 && !engine.pondering && ElapsedMs(engine) >= control.hardMs)
+            engine.stop = true;
+        if (control.limits->nodes && TotalNodes(control) >= control.limits->nodes)
+            engine.stop = true;
+    }
+    return engine.stop.load(memory_order_relaxed);
+}
+
+static int ScoreToTT(int score, int ply)
+{
+    return score >= VALUE_TB_WIN_IN_MAX ? score + ply : score <= -VALUE_TB_WIN_IN_MAX ? score - ply : score;
+}
+
+static int ScoreFromTT(int score, int ply)
+{
+    return score >= VALUE_TB_WIN_IN_MAX ? score - ply : score <= -VALUE_TB_WIN_IN_MAX ? score + ply : score;
+}
+
+static int TablebaseScore(const TablebaseResult &result, int ply)
+{
+    if (result.wdl == 0)
+        return 0;
+    return result.wdl > 0 ? VALUE_MATE - ply - result.plies : -VALUE_MATE + ply + result.plies;
+}
+
+static bool IsRepetition(const SearchThread &t, const Position &pos)
+{
+    int end = (int)t.keys.size();
+    int limit = min((int)pos.halfmoveClock, end);
+    for (int i = 1; i <= limit; i++)
+    {
+        uint64_t key = t.keys[end - i];
+        if (key == 0)
+            break;
+        if (i % 2 == 0 && key == pos.key)
+            return true;
+    }
+    return false;
+}
+
+static bool HasNonPawnMaterial(const Position &pos)
+{
+    int us = pos.whiteToMove ? 0 : 1;
+    return (pos.pieces[us][0] & ~pos.pieces[us][PAWN] & ~pos.pieces[us][KING]) != 0;
+}
+
+static bool IsQuiet(const Position &pos, Move m)
+{
+    return !IsCapture(pos, m) && !MovePromotion(m);
+}
+
+static void ScoreMoves(const SearchThread &t, const Position &pos, const Move *moves, int count, int *scores, Move ttMove, int ply)
+{
+    int us = pos.whiteToMove ? 0 : 1;
+    for (int i = 0; i < count; i++)
+    {
+        Move m = moves[i];
+        int from = MoveFrom(m), to = MoveTo(m);
+        if (m == ttMove)
+            scores[i] = 1 << 30;
+        else if (IsCapture(pos, m) || MovePromotion(m) == QUEEN)
+        {
+            int victim = pos.board[to] ? abs(pos.board[to]) : IsCapture(pos, m) ? PAWN : 0;
+            int order = victim * 16 - abs(pos.board[from]) + (MovePromotion(m) == QUEEN ? 64 : 0);
+            scores[i] = (StaticExchange(pos, m) >= 0 ? 1 << 28 : -(1 << 24)) + order;
+        }
+        else if (MovePromotion(m))
+            scores[i] = -(1 << 25);
+        else if (m == t.killers[ply][0])
+            scores[i] = (1 << 27);
+        else if (m == t.killers[ply][1])
+            scores[i] = (1 << 27) - 1;
+        else
+            scores[i] = t.history[us][from][to];
+    }
+}
+
+static Move PickMove(Move *moves, int *scores, int count, int index)
+{
+    int best = index;
+    for (int i = index + 1; i < count; i++)
+    {
+        if (scores[i] > scores[best])
+            best = i;
+    }
+    swap(moves[index], moves[best]);
+    swap(scores[index], scores[best]);
+    return moves[index];
+}
+
+static void UpdateHistory(int &entry, int bonus)
+{
+    entry += bonus - entry * abs(bonus) / 16384;
+}
+
+static void UpdatePv(SearchThread &t, int ply, Move m)
+{
+    t.pv[ply][ply] = m;
+    for (int i = ply + 1; i < t.pvLength[ply + 1]; i++)
+        t.pv[ply][i] = t.pv[ply + 1][i];
+    t.pvLength[ply] = max(t.pvLength[ply + 1], ply + 1);
+}
+
+static int Quiesce(SearchThread &t, const Position &pos, int alpha, int beta, int ply)
+{
+    t.pvLength[ply] = ply;
+    if (ShouldStop(t))
+        return 0;
+    CountNode(t);
+    t.selDepth = max(t.selDepth, ply);
+    if (ply >= MAX_PLY)
+        return Evaluate(pos);
+    if (pos.halfmoveClock >= 100 || IsInsufficientMaterial(pos))
+        return 0;
+
+    bool pvNode = beta - alpha > 1;
+    TTData entry;
+    bool ttHit = ProbeTranspositionTable(t.engine->tt, pos.key, entry);
+    if (ttHit && !pvNode)
+    {
+        int score = ScoreFromTT(entry.score, ply);
+        if ((entry.bound == BOUND_EXACT) || (entry.bound == BOUND_LOWER && score >= beta) ||
+            (entry.bound == BOUND_UPPER && score <= alpha))
+            return score;
+    }
+
+    bool inCheck = InCheck(pos);
+    int standPat = -VALUE_INFINITE, bestScore;
+    if (inCheck)
+        bestScore = -VALUE_MATE + ply;
+    else
+    {
+        standPat = ttHit && entry.eval != VALUE_NONE ? entry.eval : Evaluate(pos);
+        if (standPat >= beta)
+            return standPat;
+        alpha = max(alpha, standPat);
+        bestScore = standPat;
+    }
+
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count = inCheck ? GenerateLegalMoves(pos, moves) : GenerateCaptures(pos, moves);
+    ScoreMoves(t, pos, moves, count, scores, ttHit ? entry.move : MOVE_NONE, ply);
+
+    Move bestMove = MOVE_NONE;
+    int originalAlpha = alpha;
+    for (int i = 0; i < count; i++)
+    {
+        Move m = PickMove(moves, scores, count, i);
+        if (!inCheck)
+        {
+            if (MovePromotion(m) && MovePromotion(m) != QUEEN)
+                continue;
+            // Captures that lose material or cannot lift the score near alpha
+            int victim = pos.board[MoveTo(m)] ? abs(pos.board[MoveTo(m)]) : IsCapture(pos, m) ? PAWN : 0;
+            if (!MovePromotion(m) && standPat + seeValues[victim] + 200 <= alpha)
+                continue;
+            if (scores[i] < 0 || !IsLegal(pos, m))
+                continue;
+        }
+
+        Position next = pos;
+        DoMove(next, m);
+        int score = -Quiesce(t, next, -beta, -alpha, ply + 1);
+        if (t.engine->stop.load(memory_order_relaxed))
+            return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                bestMove = m;
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+
+    int bound = bestScore >= beta ? BOUND_LOWER : bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+    StoreTranspositionTable(t.engine->tt, pos.key, bestMove, ScoreToTT(bestScore, ply), inCheck ? VALUE_NONE : standPat, 0, bound);
+    return bestScore;
+}
+
+static int Negamax(SearchThread &t, const Position &pos, int alpha, int beta, int depth, int ply, bool allowNull)
+{
+    if (depth <= 0)
+        return Quiesce(t, pos, alpha, beta, ply);
+
+    t.pvLength[ply] = ply;
+    if (ShouldStop(t))
+        return 0;
+    CountNode(t);
+    t.selDepth = max(t.selDepth, ply);
+    if (ply >= MAX_PLY)
+        return Evaluate(pos);
+    if (pos.halfmoveClock >= 100 || IsRepetition(t, pos) || IsInsufficientMaterial(pos))
+        return 0;
+
+    // Mate distance pruning
+    alpha = max(alpha, -VALUE_MATE + ply);
+    beta = min(beta, VALUE_MATE - ply - 1);
+    if (alpha >= beta)
+        return alpha;
+
+    bool pvNode = beta - alpha > 1;
+    TTData entry;
+    bool ttHit = ProbeTranspositionTable(t.engine->tt, pos.key, entry);
+    Move ttMove = ttHit ? entry.move : MOVE_NONE;
+    if (ttHit && !pvNode && entry.depth >= depth)
+    {
+        int score = ScoreFromTT(entry.score, ply);
+        if ((entry.bound == BOUND_EXACT) || (entry.bound == BOUND_LOWER && score >= beta) ||
+            (entry.bound == BOUND_UPPER && score <= alpha))
+            return score;
+    }
+
+    // Tablebases: our own give exact mate distances, Syzygy only the result
+    int pieces = PopCount(Occupied(pos));
+    if (pos.castling == 0 && pieces <= TablebasePieceLimit())
+    {
+        TablebaseResult result;
+        if (ProbeTablebase(pos, result))
+        {
+            t.tbHits.fetch_add(1, memory_order_relaxed);
+            int score = TablebaseScore(result, ply);
+            StoreTranspositionTable(t.engine->tt, pos.key, MOVE_NONE, ScoreToTT(score, ply), VALUE_NONE, min(depth + 6, MAX_PLY - 1), BOUND_EXACT);
+            return score;
+        }
+    }
+    if (pos.castling == 0 && pos.halfmoveClock == 0 && pieces <= SyzygyPieceLimit())
+    {
+        int wdl;
+        if (ProbeSyzygyWdl(pos, wdl))
+        {
+            t.tbHits.fetch_add(1, memory_order_relaxed);
+            int score = wdl == SYZYGY_WIN ? VALUE_TB_WIN - ply : wdl == SYZYGY_LOSS ? -VALUE_TB_WIN + ply : wdl;
+            int bound = wdl == SYZYGY_WIN ? BOUND_LOWER : wdl == SYZYGY_LOSS ? BOUND_UPPER : BOUND_EXACT;
+            if (bound == BOUND_EXACT || (bound == BOUND_LOWER && score >= beta) || (bound == BOUND_UPPER && score <= alpha))
+            {
+                StoreTranspositionTable(t.engine->tt, pos.key, MOVE_NONE, ScoreToTT(score, ply), VALUE_NONE, min(depth + 6, MAX_PLY - 1), bound);
+                return score;
+            }
+        }
+    }
+
+    bool inCheck = InCheck(pos);
+    int staticEval = inCheck ? -VALUE_INFINITE : ttHit && entry.eval != VALUE_NONE ? entry.eval : Evaluate(pos);
+
+    if (!pvNode && !inCheck)
+    {
+        // Reverse futility: far above beta with little depth left
+        if (depth <= 6 && staticEval - 80 * depth >= beta && abs(beta) < VALUE_TB_WIN_IN_MAX)
+            return staticEval;
+
+        // Null move: if passing still beats beta, a real move will too
+        if (allowNull && depth >= 3 && staticEval >= beta && HasNonPawnMaterial(pos))
+        {
+            Position next = pos;
+            DoNullMove(next);
+            t.keys.push_back(0);
+            int score = -Negamax(t, next, -beta, -beta + 1, depth - 3 - depth / 4, ply + 1, false);
+            t.keys.pop_back();
+            if (t.engine->stop.load(memory_order_relaxed))
+                return 0;
+            if (score >= beta)
+                return score >= VALUE_TB_WIN_IN_MAX ? beta : score;
+        }
+    }
+
+    // Without a hash move a PV node is likely badly ordered: search it shallower first
+    if (pvNode && ttMove == MOVE_NONE && depth >= 6)
+        depth--;
+
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count = GenerateLegalMoves(pos, moves);
+    if (count == 0)
+        return inCheck ? -VALUE_MATE + ply : 0;
+    ScoreMoves(t, pos, moves, count, scores, ttMove, ply);
+
+    int us = pos.whiteToMove ? 0 : 1;
+    int bestScore = -VALUE_INFINITE, originalAlpha = alpha;
+    Move bestMove = MOVE_NONE;
+    Move quietsTried[MAX_MOVES];
+    int quietCount = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        Move m = PickMove(moves, scores, count, i);
+        bool quiet = IsQuiet(pos, m);
+
+        if (!pvNode && !inCheck && quiet && bestScore > -VALUE_TB_WIN_IN_MAX)
+        {
+            // Late move pruning and futility pruning of quiet moves near the leaves
+            if (depth <= 3 && i >= 4 + 2 * depth * depth)
+                continue;
+            if (depth <= 2 && i > 0 && staticEval + 100 + 150 * depth <= alpha)
+                continue;
+        }
+
+        Position next = pos;
+        DoMove(next, m);
+        bool givesCheck = InCheck(next);
+        int newDepth = depth - 1 + (givesCheck && ply < 2 * t.rootDepth ? 1 : 0);
+
+        t.keys.push_back(pos.key);
+        int score;
+        if (i == 0)
+            score = -Negamax(t, next, -beta, -alpha, newDepth, ply + 1, true);
+        else
+        {
+            int reduction = 0;
+            if (depth >= 3 && i >= 3 && quiet && !inCheck && !givesCheck)
+            {
+                reduction = reductions[min(depth, 63)][min(i, 63)];
+                if (pvNode)
+                    reduction--;
+                if (m == t.killers[ply][0] || m == t.killers[ply][1])
+                    reduction--;
+                reduction = max(0, min(reduction, newDepth - 1));
+            }
+
+            score = -Negamax(t, next, -alpha - 1, -alpha, newDepth - reduction, ply + 1, true);
+            if (score > alpha && reduction > 0)
+                score = -Negamax(t, next, -alpha - 1, -alpha, newDepth, ply + 1, true);
+            if (score > alpha && score < beta)
+                score = -Negamax(t, next, -beta, -alpha, newDepth, ply + 1, true);
+        }
+        t.keys.pop_back();
+        if (t.engine->stop.load(memory_order_relaxed))
+            return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                bestMove = m;
+                if (pvNode)
+                    UpdatePv(t, ply, m);
+                if (alpha >= beta)
+                {
+                    if (quiet)
+                    {
+                        int bonus = min(depth * depth, 400);
+                        UpdateHistory(t.history[us][MoveFrom(m)][MoveTo(m)], bonus);
+                        for (int j = 0; j < quietCount; j++)
+                            UpdateHistory(t.history[us][MoveFrom(quietsTried[j])][MoveTo(quietsTried[j])], -bonus);
+                        if (t.killers[ply][0] != m)
+                        {
+                            t.killers[ply][1] = t.killers[ply][0];
+                            t.killers[ply][0] = m;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+        if (quiet)
+            quietsTried[quietCount++] = m;
+    }
+
+    int bound = bestScore >= beta ? BOUND_LOWER : bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+    StoreTranspositionTable(t.engine->tt, pos.key, bestMove, ScoreToTT(bestScore, ply), inCheck ? VALUE_NONE : staticEval, depth, bound);
+    return bestScore;
+}
+
+// Searches the root moves from pvIndex on; earlier ones are the lines already found
+static int SearchRoot(SearchThread &t, int alpha, int beta, int depth)
+{
+    int bestScore = -VALUE_INFINITE;
+    t.pvLength[0] = 0;
+
+    for (size_t i = t.pvIndex; i < t.rootMoves.size(); i++)
+    {
+        RootMove &rm = t.rootMoves[i];
+        int moveCount = (int)(i - t.pvIndex) + 1;
+        Position next = t.root;
+        DoMove(next, rm.move);
+        bool quiet = IsQuiet(t.root, rm.move);
+        int newDepth = depth - 1 + (InCheck(next) ? 1 : 0);
+        t.selDepth = 0;
+
+        t.keys.push_back(t.root.key);
+        int score;
+        if (moveCount == 1)
+            score = -Negamax(t, next, -beta, -alpha, newDepth, 1, true);
+        else
+        {
+            int reduction = depth >= 3 && moveCount > 4 && quiet && !InCheck(t.root) && !InCheck(next) ? 1 : 0;
+            score = -Negamax(t, next, -alpha - 1, -alpha, newDepth - reduction, 1, true);
+            if (score > alpha && reduction > 0)
+                score = -Negamax(t, next, -alpha - 1, -alpha, newDepth, 1, true);
+            if (score > alpha && score < beta)
+                score = -Negamax(t, next, -beta, -alpha, newDepth, 1, true);
+        }
+        t.keys.pop_back();
+        if (t.engine->stop.load(memory_order_relaxed))
+            return bestScore;
+
+        if (moveCount == 1 || score > alpha)
+        {
+            rm.score = score;
+            rm.selDepth = t.selDepth;
+            rm.pv[0] = rm.move;
+            rm.pvLength = 1;
+            for (int j = 1; j < t.pvLength[1] && j < MAX_PLY; j++)
+                rm.pv[rm.pvLength++] = t.pv[1][j];
+        }
+        else
+            rm.score = -VALUE_INFINITE;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+    return bestScore;
+}
+
+static void FillLine(const RootMove &rm, int depth, SearchLine &line)
+{
+    line.length = rm.pvLength;
+    memcpy(line.pv, rm.pv, sizeof(Move) * rm.pvLength);
+    line.score = rm.score != -VALUE_INFINITE ? rm.score : rm.previousScore;
+    line.depth = depth;
+    line.selDepth = rm.selDepth;
+}
+
+static void ReportLines(SearchThread &t, int depth)
+{
+    const SearchControl &control = *t.control;
+    if (!*control.report)
+        return;
+
+    for (int i = 0; i < control.multiPv; i++)
+    {
+        SearchLine line;
+        FillLine(t.rootMoves[i], depth, line);
+        SearchInfo info;
+        info.depth = depth;
+        info.multiPv = i + 1;
+        info.line = &line;
+        info.nodes = TotalNodes(control);
+        info.tbHits = TotalTbHits(control);
+        info.timeMs = ElapsedMs(*t.engine);
+        info.hashFull = TranspositionTableFull(t.engine->tt);
+        (*control.report)(info);
+    }
+}
+
+static bool ByScore(const RootMove &a, const RootMove &b)
+{
+    return a.score > b.score;
+}
+
+static void IterativeDeepening(SearchThread &t)
+{
+    Engine &engine = *t.engine;
+    const SearchControl &control = *t.control;
+    const SearchLimits &limits = *control.limits;
+
+    // The soft limit is only the expected time: a best move that keeps holding
+    // stops the search sooner, one that just changed or a falling score gets
+    // more, up to the hard limit
+    Move lastBest = MOVE_NONE;
+    int lastScore = 0, stableIterations = 0;
+
+    // Helpers start one ply deeper every other thread so they spread over the tree
+    for (int depth = 1 + (t.id % 2); depth < MAX_PLY; depth++)
+    {
+        if (t.id == 0 && limits.depth > 0 && depth > limits.depth)
+            break;
+        t.rootDepth = depth;
+        for (auto &rm : t.rootMoves)
+            rm.previousScore = rm.score;
+
+        for (t.pvIndex = 0; t.pvIndex < control.multiPv; t.pvIndex++)
+        {
+            // Aspiration window around the last score, widened on failure
+            int previous = t.rootMoves[t.pvIndex].previousScore;
+            int delta = 25, alpha = -VALUE_INFINITE, beta = VALUE_INFINITE;
+            if (depth >= 5 && abs(previous) < VALUE_TB_WIN_IN_MAX)
+            {
+                alpha = max(previous - delta, -VALUE_INFINITE);
+                beta = min(previous + delta, VALUE_INFINITE);
+            }
+
+            while (true)
+            {
+                int score = SearchRoot(t, alpha, beta, depth);
+                stable_sort(t.rootMoves.begin() + t.pvIndex, t.rootMoves.end(), ByScore);
+                if (engine.stop)
+                    break;
+
+                if (score <= alpha)
+                {
+                    beta = (alpha + beta) / 2;
+                    alpha = max(score - delta, -VALUE_INFINITE);
+                }
+                else if (score >= beta)
+                    beta = min(score + delta, VALUE_INFINITE);
+                else
+                    break;
+                delta += delta / 2;
+            }
+            stable_sort(t.rootMoves.begin(), t.rootMoves.begin() + t.pvIndex + 1, ByScore);
+            if (engine.stop)
+                break;
+        }
+        if (engine.stop)
+            break;
+        t.completedDepth = depth;
+
+        if (t.id != 0)
+            continue;
+        ReportLines(t, depth);
+
+        int best = t.rootMoves[0].score;
+        double scale = 1.0;
+        if (lastBest != MOVE_NONE)
+        {
+            stableIterations = t.rootMoves[0].move == lastBest ? stableIterations + 1 : 0;
+            scale = stableIterations >= 4 ? 0.5 : stableIterations >= 2 ? 0.8 : stableIterations == 0 ? 1.6 : 1.0;
+            if (best < lastScore - 30)
+                scale *= 1.3;
+        }
+        lastBest = t.rootMoves[0].move;
+        lastScore = best;
+
+        bool timed = !limits.infinite && !engine.pondering;
+        int softMs = limits.moveTime == 0 && control.hardMs > 0 ? min((int)(control.softMs * scale), control.hardMs) : control.softMs;
+        if (timed && control.softMs > 0 && ElapsedMs(engine) >= max(softMs, 1))
+            break;
+        if (timed && IsMateScore(best) && depth >= 2 * abs(MateInMoves(best)) + 2)
+            break;
+    }
+}
+
+static bool RootHasRepeated(const Position &pos, const vector<uint64_t> &history)
+{
+    int end = (int)history.size();
+    int limit = min((int)pos.halfmoveClock, end);
+    for (int i = 2; i <= limit; i += 2)
+    {
+        if (history[end - i] == pos.key)
+            return true;
+    }
+    return false;
+}
+
+// With our own tables at the root only the moves keeping the best mate distance stay
+static int FilterTablebaseRootMoves(const Position &pos, Move *moves, int count)
+{
+    if (pos.castling != 0 || PopCount(Occupied(pos)) > TablebasePieceLimit())
+        return 0;
+
+    int scores[MAX_MOVES];
+    for (int i = 0; i < count; i++)
+    {
+        Position next = pos;
+        DoMove(next, moves[i]);
+        TablebaseResult result;
+        if (!ProbeTablebase(next, result))
+            return 0;
+        scores[i] = -TablebaseScore(result, 1);
+    }
+
+    int best = *max_element(scores, scores + count);
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (scores[i] == best)
+            moves[kept++] = moves[i];
+    }
+    return kept;
+}
+
+SearchResult Search(Engine &engine, const Position &pos, const vector<uint64_t> &history,
+                    const SearchLimits &limits, const function<void(const SearchInfo &)> &report)
+{
+    SearchResult result;
+    engine.stop = false;
+    engine.pondering = limits.ponder;
+    engine.startNs = NowNs();
+    NewSearchGeneration(engine.tt);
+
+    Move moves[MAX_MOVES];
+    int count = GenerateLegalMoves(pos, moves);
+    if (!limits.searchMoves.empty())
+    {
+        int kept = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (find(limits.searchMoves.begin(), limits.searchMoves.end(), moves[i]) != limits.searchMoves.end())
+                moves[kept++] = moves[i];
+        }
+        count = kept;
+    }
+
+    if (count > 0)
+    {
+        int kept = FilterTablebaseRootMoves(pos, moves, count);
+        int wdl;
+        if (kept == 0)
+            kept = FilterSyzygyRootMoves(pos, moves, count, RootHasRepeated(pos, history), wdl);
+        if (kept > 0)
+            count = kept;
+    }
+
+    SearchControl control;
+    control.limits = &limits;
+    control.report = &report;
+    control.multiPv = max(1, min(min(limits.multiPv, count), MAX_MULTI_PV));
+    AllocateSearchTime(limits, pos.whiteToMove, control.softMs, control.hardMs);
+    // Nothing to choose between: one iteration for the score and the expected reply
+    if (count == 1 && limits.moveTime == 0 && control.softMs > 0)
+        control.softMs = 1;
+
+    vector<unique_ptr<SearchThread>> threads;
+    control.threads = &threads;
+    for (int i = 0; i < engine.threads; i++)
+    {
+        unique_ptr<SearchThread> t(new SearchThread());
+        t->engine = &engine;
+        t->control = &control;
+        t->id = i;
+        t->root = pos;
+        t->keys = history;
+        memset(t->history, 0, sizeof(t->history));
+        memset(t->killers, 0, sizeof(t->killers));
+        for (int j = 0; j < count; j++)
+        {
+            RootMove rm;
+            rm.move = moves[j];
+            rm.pv[0] = moves[j];
+            rm.pvLength = 1;
+            t->rootMoves.push_back(rm);
+        }
+        threads.push_back(move(t));
+    }
+
+    if (count > 0)
+    {
+        vector<thread> helpers;
+        for (int i = 1; i < engine.threads; i++)
+            helpers.emplace_back(IterativeDeepening, ref(*threads[i]));
+        IterativeDeepening(*threads[0]);
+
+        // Hold the answer until the GUI stops an infinite or ponder search
+        while (!engine.stop && (engine.pondering || limits.infinite))
+            this_thread::sleep_for(milliseconds(1));
+        engine.stop = true;
+        for (auto &helper : helpers)
+            helper.join();
+    }
+    else
+    {
+        while (!engine.stop && (engine.pondering || limits.infinite))
+            this_thread::sleep_for(milliseconds(1));
+        result.score = InCheck(pos) ? -VALUE_MATE : 0;
+    }
+    engine.pondering = false;
+
+    SearchThread &main = *threads[0];
+    result.nodes = TotalNodes(control);
+    if (count == 0)
+        return result;
+
+    result.depth = main.completedDepth;
+    result.lineCount = control.multiPv;
+    for (int i = 0; i < result.lineCount; i++)
+        FillLine(main.rootMoves[i], main.completedDepth, result.lines[i]);
+    result.bestMove = result.lines[0].pv[0];
+    result.score = result.lines[0].score;
+
+    // Without a second PV move, the hash table may still know the expected reply
+    if (result.lines[0].length > 1)
+        result.ponderMove = result.lines[0].pv[1];
+    else
+    {
+        Position next = pos;
+        DoMove(next, result.bestMove);
+        TTData entry;
+        Move replies[MAX_MOVES];
+        int replyCount = GenerateLegalMoves(next, replies);
+        if (ProbeTranspositionTable(engine.tt, next.key, entry) && find(replies, replies + replyCount, entry.move) != replies + replyCount)
+            result.ponderMove = entry.move;
+    }
+    return result;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Position.h"
+#include "TranspositionTable.h"
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+// Alpha-beta search with iterative deepening, run on any number of threads
+// that share one transposition table (lazy SMP). Each Engine is independent,
+// so several can search different games at the same time.
+
+#define MAX_PLY 128
+#define MAX_MULTI_PV 16
+
+#define VALUE_INFINITE 32001
+#define VALUE_NONE 32002 // Transposition table eval when the entry has none (tablebase hits, in check)
+#define VALUE_MATE 32000
+#define VALUE_MATE_IN_MAX (VALUE_MATE - 1000) // Mates from our own tablebases can be long
+#define VALUE_TB_WIN 30000                    // Syzygy win, not a known mate distance
+#define VALUE_TB_WIN_IN_MAX (VALUE_TB_WIN - MAX_PLY)
+
+struct SearchLimits
+{
+    int depth = 0;            // 0 = no limit
+    uint64_t nodes = 0;       // 0 = no limit
+    int moveTime = 0;         // Milliseconds for this move, 0 = use the clock
+    int time[2] = {0, 0};     // Remaining clock in ms [white, black], 0 = no clock
+    int increment[2] = {0, 0};
+    int movesToGo = 0;        // Moves to the next time control, 0 = sudden death
+    bool infinite = false;    // Search until stopped
+    bool ponder = false;      // Start in ponder mode, the clock runs after PonderHit
+    int multiPv = 1;
+    std::vector<Move> searchMoves; // Restrict the root moves, empty = all
+};
+
+struct SearchLine
+{
+    Move pv[MAX_PLY];
+    int length = 0;
+    int score = 0;
+    int depth = 0;
+    int selDepth = 0;
+};
+
+// Progress report after each finished line of an iteration
+struct SearchInfo
+{
+    int depth;
+    int multiPv; // 1-based line number
+    const SearchLine *line;
+    uint64_t nodes;
+    uint64_t tbHits;
+    int64_t timeMs;
+    int hashFull; // Per mille
+};
+
+struct SearchResult
+{
+    Move bestMove = MOVE_NONE;
+    Move ponderMove = MOVE_NONE;
+    int score = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    int lineCount = 0;
+    SearchLine lines[MAX_MULTI_PV];
+};
+
+struct Engine
+{
+    TranspositionTable tt;
+    int threads = 1;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> pondering{false};
+    std::atomic<int64_t> startNs{0}; // Clock start on steady_clock, moved by PonderHit from the UCI thread
+};
+
+void InitEngine(Engine &engine, int hashMegabytes, int threads);
+void SetEngineHash(Engine &engine, int megabytes);
+void SetEngineThreads(Engine &engine, int threads);
+void ClearEngine(Engine &engine); // New game: forget everything learned so far
+
+// Blocking: returns when a limit is reached or StopSearch is called from another
+// thread. history holds the keys of the game positions before pos, for
+// repetition detection. In ponder or infinite mode the result is held back
+// until PonderHit or StopSearch, as UCI requires.
+SearchResult Search(Engine &engine, const Position &pos, const std::vector<uint64_t> &history,
+                    const SearchLimits &limits, const std::function<void(const SearchInfo &)> &report = nullptr);
+void StopSearch(Engine &engine);
+void PonderHit(Engine &engine); // The expected move was played: the clock starts now
+
+// Time for this move from the clock: soft is checked between iterations, hard stops the search
+void AllocateSearchTime(const SearchLimits &limits, bool whiteToMove, int &softMs, int &hardMs);
+
+bool IsMateScore(int score);
+int MateInMoves(int score); // Positive when the side to move mates
@@ -0,0 +1,781 @@
+#include "EngineProcess.h"
+#include "Pgn.h"
+#include "PolyglotBook.h"
+#include "Position.h"
+#include "Syzygy.h"
+#include "Tablebase.h"
+#include "TrainingData.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Usage: selfplay -engine name=A cmd=./chess-uci [tc=10+0.1] [option.Hash=16] -engine name=B cmd=...
+//                 [-each key=value ...] [-games N] [-concurrency N] [-book book.bin] [-bookdepth N]
+//                 [-randomplies N] [-seed N] [-draw movenumber=N movecount=N score=CP]
+//                 [-resign movecount=N score=CP] [-tb] [-sprt elo0=E elo1=E alpha=A beta=B]
+//                 [-timemargin MS] [-pgnout games.pgn] [-feed live.txt] [-dataout games.tdat]
+//
+// Every worker thread owns one process per engine and plays whole games with
+// them; games come in pairs with the same opening and colours swapped.
+// -feed appends "<worker> <fen>" after every move and "<worker> end <result>"
+// after every game, for the game's spectator grid (Game -watch live.txt).
+// -dataout appends every position an engine searched, with its score, to a
+// training data file (TrainingData.h) once the game's result is known.
+
+struct TimeControl
+{
+    string text = "-";   // As given, for the PGN TimeControl tag
+    int movesPerPeriod = 0; // 0 = whole game
+    int baseMs = 0;
+    int incrementMs = 0;
+    int moveTimeMs = 0;
+    uint64_t nodes = 0;
+    int depth = 0;
+};
+
+struct PlayerConfig
+{
+    string name;
+    string command;
+    TimeControl timeControl;
+    vector<pair<string, string>> options;
+};
+
+struct MatchConfig
+{
+    PlayerConfig players[2];
+    int games = 2;
+    int concurrency = 1;
+    string bookPath;
+    int bookDepth = 8;
+    int randomPlies = 0;
+    uint64_t seed = 1;
+    string pgnPath;
+    string feedPath;
+    string dataPath;
+    int timeMarginMs = 100;
+    int drawMoveNumber = 0; // Draw adjudication, 0 = off
+    int drawMoveCount = 0;
+    int drawScore = 0;
+    int resignMoveCount = 0; // Resign adjudication, 0 = off
+    int resignScore = 0;
+    bool tablebases = false;
+    bool sprt = false;
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+};
+
+struct GameOutcome
+{
+    GameResult result = RESULT_UNKNOWN;
+    string termination;
+    PgnGame record;
+    vector<PackedPosition> positions; // For -dataout
+    bool restart[2] = {false, false}; // Engine misbehaved and needs a new process
+};
+
+// Results from the first engine's side
+struct MatchState
+{
+    atomic<int> nextGame{0};
+    atomic<bool> stop{false};
+    mutex lock;
+    int wins = 0, losses = 0, draws = 0;
+    FILE *pgn = nullptr;
+    FILE *feed = nullptr;
+    TrainingWriter data;
+};
+
+static uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// "40/60+0.6" = 40 moves in 60 s plus 0.6 s a move, "10+0.1", "inf"
+static bool ParseTimeControl(const string &text, TimeControl &tc)
+{
+    tc.text = text;
+    if (text == "inf")
+        return true;
+
+    const char *p = text.c_str();
+    const char *slash = strchr(p, '/');
+    if (slash)
+    {
+        tc.movesPerPeriod = atoi(p);
+        p = slash + 1;
+    }
+    char *end;
+    double base = strtod(p, &end);
+    if (end == p)
+        return false;
+    tc.baseMs = (int)(base * 1000);
+    if (*end == '+')
+        tc.incrementMs = (int)(atof(end + 1) * 1000);
+    return true;
+}
+
+static bool ApplyPlayerSetting(PlayerConfig &player, const char *setting)
+{
+    const char *equals = strchr(setting, '=');
+    if (!equals)
+        return false;
+    string key(setting, equals - setting), value(equals + 1);
+
+    if (key == "name")
+        player.name = value;
+    else if (key == "cmd")
+        player.command = value;
+    else if (key == "tc")
+        return ParseTimeControl(value, player.timeControl);
+    else if (key == "st")
+    {
+        player.timeControl.moveTimeMs = (int)(atof(value.c_str()) * 1000);
+        player.timeControl.text = value + "/move";
+    }
+    else if (key == "nodes")
+        player.timeControl.nodes = strtoull(value.c_str(), nullptr, 10);
+    else if (key == "depth")
+        player.timeControl.depth = atoi(value.c_str());
+    else if (key.compare(0, 7, "option.") == 0)
+        player.options.push_back({key.substr(7), value});
+    else
+        return false;
+    return true;
+}
+
+static bool WaitForLine(EngineProcess &process, const char *token, int timeoutMs)
+{
+    string line;
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(timeoutMs);
+    while (true)
+    {
+        int remaining = (int)duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+        if (remaining <= 0 || !ReadEngineLine(process, line, remaining))
+            return false;
+        if (line.compare(0, strlen(token), token) == 0)
+            return true;
+    }
+}
+
+static bool StartPlayer(EngineProcess &process, const PlayerConfig &player)
+{
+    if (!StartEngineProcess(process, player.command.c_str()))
+        return false;
+    WriteEngineLine(process, "uci");
+    if (!WaitForLine(process, "uciok", 10000))
+    {
+        StopEngineProcess(process);
+        return false;
+    }
+    for (auto &option : player.options)
+        WriteEngineLine(process, "setoption name " + option.first + " value " + option.second);
+    return true;
+}
+
+static bool StartNewGame(EngineProcess &process)
+{
+    WriteEngineLine(process, "ucinewgame");
+    WriteEngineLine(process, "isready");
+    return WaitForLine(process, "readyok", 10000);
+}
+
+// The same pair index always gives the same opening, so both games of a pair match
+static vector<Move> ChooseOpening(const MatchConfig &config, const PolyglotBook &book, int pair)
+{
+    uint64_t state = config.seed * 0x2545F4914F6CDD1DULL + (uint64_t)pair;
+    vector<Move> moves;
+    Position pos;
+    SetStartPosition(pos);
+
+    if (IsPolyglotBookOpen(book))
+    {
+        for (int ply = 0; ply < config.bookDepth; ply++)
+        {
+            Move m = PickBookMove(book, pos, SplitMix64(state));
+            if (m == MOVE_NONE)
+                break;
+            moves.push_back(m);
+            DoMove(pos, m);
+        }
+    }
+    for (int ply = 0; ply < config.randomPlies; ply++)
+    {
+        Move legal[MAX_MOVES];
+        int count = GenerateLegalMoves(pos, legal);
+        if (count == 0)
+            break;
+        Move m = legal[SplitMix64(state) % count];
+        moves.push_back(m);
+        DoMove(pos, m);
+    }
+    return moves;
+}
+
+static int CountRepetitions(const Position &pos, const vector<uint64_t> &keys)
+{
+    int end = (int)keys.size(), count = 0;
+    int limit = min((int)pos.halfmoveClock, end);
+    for (int i = 2; i <= limit; i += 2)
+    {
+        if (keys[end - i] == pos.key)
+            count++;
+    }
+    return count;
+}
+
+static GameResult WinFor(bool white)
+{
+    return white ? RESULT_WHITE_WINS : RESULT_BLACK_WINS;
+}
+
+// Result of the position by the rules, or by the tablebases when adjudicating with them
+static GameResult RulesResult(const MatchConfig &config, const Position &pos, const vector<uint64_t> &keys, string &termination)
+{
+    Move legal[MAX_MOVES];
+    if (GenerateLegalMoves(pos, legal) == 0)
+    {
+        termination = InCheck(pos) ? "checkmate" : "stalemate";
+        return InCheck(pos) ? WinFor(!pos.whiteToMove) : RESULT_DRAW;
+    }
+    if (pos.halfmoveClock >= 100)
+    {
+        termination = "fifty-move rule";
+        return RESULT_DRAW;
+    }
+    if (CountRepetitions(pos, keys) >= 2)
+    {
+        termination = "threefold repetition";
+        return RESULT_DRAW;
+    }
+    if (IsInsufficientMaterial(pos))
+    {
+        termination = "insufficient material";
+        return RESULT_DRAW;
+    }
+
+    if (config.tablebases && pos.castling == 0)
+    {
+        TablebaseResult result;
+        int wdl;
+        int pieces = PopCount(Occupied(pos));
+        if (pieces <= TablebasePieceLimit() && ProbeTablebase(pos, result))
+            wdl = result.wdl * 2;
+        else if (!(pieces <= SyzygyPieceLimit() && ProbeSyzygyWdl(pos, wdl)))
+            return RESULT_UNKNOWN;
+
+        termination = "tablebase adjudication";
+        if (wdl == SYZYGY_WIN)
+            return WinFor(pos.whiteToMove);
+        if (wdl == SYZYGY_LOSS)
+            return WinFor(!pos.whiteToMove);
+        return RESULT_DRAW;
+    }
+    return RESULT_UNKNOWN;
+}
+
+static string GoCommand(const TimeControl &tc, const int clock[2], const int movesLeft[2], const TimeControl *colorControls[2], bool white)
+{
+    if (tc.moveTimeMs)
+        return "go movetime " + to_string(tc.moveTimeMs);
+    if (tc.nodes)
+        return "go nodes " + to_string(tc.nodes);
+    if (tc.depth)
+        return "go depth " + to_string(tc.depth);
+    if (!tc.baseMs)
+        return "go infinite";
+
+    string command = "go wtime " + to_string(max(clock[0], 1)) + " btime " + to_string(max(clock[1], 1)) +
+                     " winc " + to_string(colorControls[0]->incrementMs) + " binc " + to_string(colorControls[1]->incrementMs);
+    int side = white ? 0 : 1;
+    if (tc.movesPerPeriod)
+        command += " movestogo " + to_string(movesLeft[side]);
+    return command;
+}
+
+// Reads "info ... score cp 35 ..." or "score mate -3", from the engine's side
+static bool ParseScore(const string &line, int &score)
+{
+    size_t at = line.find(" score ");
+    if (at == string::npos)
+        return false;
+    const char *p = line.c_str() + at + 7;
+    if (strncmp(p, "cp ", 3) == 0)
+        score = atoi(p + 3);
+    else if (strncmp(p, "mate ", 5) == 0)
+    {
+        int mate = atoi(p + 5);
+        score = mate > 0 ? 32000 - mate : -32000 - mate;
+    }
+    else
+        return false;
+    return true;
+}
+
+static void SetGameTags(PgnGame &game, const MatchConfig &config, int index, int white)
+{
+    time_t now = time(nullptr);
+    char date[16];
+    strftime(date, sizeof(date), "%Y.%m.%d", localtime(&now));
+    SetPgnTag(game, "Event", "Self-play");
+    SetPgnTag(game, "Site", "?");
+    SetPgnTag(game, "Date", date);
+    SetPgnTag(game, "Round", to_string(index + 1));
+    SetPgnTag(game, "White", config.players[white].name);
+    SetPgnTag(game, "Black", config.players[1 - white].name);
+    SetPgnTag(game, "Result", "*");
+    SetPgnTag(game, "TimeControl", config.players[white].timeControl.text);
+}
+
+static void WriteFeed(MatchState &match, int slot, const string &text)
+{
+    if (!match.feed)
+        return;
+    lock_guard<mutex> lock(match.lock);
+    fprintf(match.feed, "%d %s\n", slot + 1, text.c_str());
+    fflush(match.feed);
+}
+
+// Plays one game; white is the index of the player with the white pieces
+static GameOutcome PlayGame(const MatchConfig &config, MatchState &match, int slot, EngineProcess engines[2], int index, int white,
+                            const vector<Move> &opening)
+{
+    GameOutcome outcome;
+    SetGameTags(outcome.record, config, index, white);
+
+    Position pos;
+    SetStartPosition(pos);
+    vector<uint64_t> keys;
+    string moveList;
+    for (Move m : opening)
+    {
+        outcome.record.moves.push_back(MoveToSan(pos, m));
+        moveList += " " + MoveToUci(m);
+        keys.push_back(pos.key);
+        DoMove(pos, m);
+    }
+    WriteFeed(match, slot, GetFen(pos));
+
+    // Clocks are indexed by colour, players by their slot in the config
+    int players[2] = {white, 1 - white};
+    const TimeControl *controls[2] = {&config.players[players[0]].timeControl, &config.players[players[1]].timeControl};
+    int clock[2] = {controls[0]->baseMs, controls[1]->baseMs};
+    int movesLeft[2] = {controls[0]->movesPerPeriod, controls[1]->movesPerPeriod};
+    int resignCount[2] = {0, 0};
+    int drawCount = 0;
+
+    for (int p = 0; p < 2; p++)
+    {
+        if (!StartNewGame(engines[p]))
+        {
+            outcome.restart[p] = true;
+            outcome.result = WinFor(players[0] != p);
+            outcome.termination = config.players[p].name + " did not respond";
+            return outcome;
+        }
+    }
+
+    while (true)
+    {
+        outcome.result = RulesResult(config, pos, keys, outcome.termination);
+        if (outcome.result != RESULT_UNKNOWN)
+            break;
+
+        int side = pos.whiteToMove ? 0 : 1;
+        int player = players[side];
+        EngineProcess &engine = engines[player];
+        const TimeControl &tc = *controls[side];
+        WriteEngineLine(engine, "position startpos" + (moveList.empty() ? string() : " moves" + moveList));
+        WriteEngineLine(engine, GoCommand(tc, clock, movesLeft, controls, pos.whiteToMove));
+
+        // Engines without a clock still get a generous limit so a hang can't stall the match
+        int allowedMs = tc.baseMs ? clock[side] + config.timeMarginMs : tc.moveTimeMs ? tc.moveTimeMs + max(config.timeMarginMs, 1000) : 60000;
+        steady_clock::time_point start = steady_clock::now();
+        string line, bestMove;
+        int score = 0;
+        bool hasScore = false;
+        while (bestMove.empty())
+        {
+            int remaining = allowedMs - (int)duration_cast<milliseconds>(steady_clock::now() - start).count();
+            if (remaining <= 0 || !ReadEngineLine(engine, line, remaining))
+                break;
+            if (line.compare(0, 5, "info ") == 0)
+                hasScore |= ParseScore(line, score);
+            else if (line.compare(0, 9, "bestmove ") == 0)
+            {
+                size_t end = line.find(' ', 9);
+                bestMove = line.substr(9, end == string::npos ? string::npos : end - 9);
+            }
+        }
+        int elapsed = (int)duration_cast<milliseconds>(steady_clock::now() - start).count();
+
+        if (bestMove.empty() || (tc.baseMs && elapsed > clock[side] + config.timeMarginMs))
+        {
+            outcome.restart[player] = bestMove.empty();
+            outcome.result = WinFor(!pos.whiteToMove);
+            outcome.termination = IsEngineProcessRunning(engine) ? config.players[player].name + " lost on time"
+                                                                : config.players[player].name + " disconnected";
+            break;
+        }
+        if (tc.baseMs)
+        {
+            clock[side] += tc.incrementMs - elapsed;
+            if (tc.movesPerPeriod && --movesLeft[side] == 0)
+            {
+                clock[side] += tc.baseMs;
+                movesLeft[side] = tc.movesPerPeriod;
+            }
+        }
+
+        Move m = ParseUciMove(pos, bestMove.c_str());
+        if (m == MOVE_NONE)
+        {
+            outcome.result = WinFor(!pos.whiteToMove);
+            outcome.termination = config.players[player].name + " played an illegal move (" + bestMove + ")";
+            break;
+        }
+        if (match.data.file && hasScore)
+        {
+            outcome.positions.emplace_back();
+            PackPosition(pos, score, outcome.positions.back());
+        }
+        outcome.record.moves.push_back(MoveToSan(pos, m));
+        moveList += " " + bestMove;
+        keys.push_back(pos.key);
+        DoMove(pos, m);
+        WriteFeed(match, slot, GetFen(pos));
+
+        // Adjudication on the engines' own scores
+        if (config.resignMoveCount)
+        {
+            resignCount[side] = hasScore && score <= -config.resignScore ? resignCount[side] + 1 : 0;
+            if (resignCount[side] >= config.resignMoveCount)
+            {
+                outcome.result = WinFor(side == 1);
+                outcome.termination = "resign adjudication";
+                break;
+            }
+        }
+        if (config.drawMoveCount)
+        {
+            bool quiet = hasScore && abs(score) <= config.drawScore && pos.fullmoveNumber >= config.drawMoveNumber;
+            drawCount = quiet ? drawCount + 1 : 0;
+            if (drawCount >= 2 * config.drawMoveCount)
+            {
+                outcome.result = RESULT_DRAW;
+                outcome.termination = "draw adjudication";
+                break;
+            }
+        }
+    }
+
+    outcome.record.result = GameResultText(outcome.result);
+    SetPgnTag(outcome.record, "Result", outcome.record.result);
+    SetPgnTag(outcome.record, "PlyCount", to_string(outcome.record.moves.size()));
+    SetPgnTag(outcome.record, "Termination", outcome.termination);
+    return outcome;
+}
+
+static double EloFromScore(double score)
+{
+    score = min(max(score, 1e-6), 1 - 1e-6);
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+static double ScoreFromElo(double elo)
+{
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+// Mean and per-game variance of the score from win/loss/draw counts
+static void ScoreMoments(int wins, int losses, int draws, double &mean, double &variance)
+{
+    double n = wins + losses + draws;
+    mean = (wins + draws * 0.5) / n;
+    variance = (wins * (1 - mean) * (1 - mean) + losses * mean * mean + draws * (0.5 - mean) * (0.5 - mean)) / n;
+}
+
+// 95% confidence interval, half width
+static void EstimateElo(int wins, int losses, int draws, double &elo, double &margin)
+{
+    double mean, variance;
+    ScoreMoments(wins, losses, draws, mean, variance);
+    double deviation = 1.96 * sqrt(variance / (wins + losses + draws));
+    elo = EloFromScore(mean);
+    margin = (EloFromScore(mean + deviation) - EloFromScore(mean - deviation)) / 2;
+}
+
+// Log-likelihood ratio of elo1 against elo0, normal approximation of the score
+// distribution (the "generalized" SPRT used by most testing frameworks)
+static double SprtLlr(int wins, int losses, int draws, double elo0, double elo1)
+{
+    int n = wins + losses + draws;
+    if (n == 0)
+        return 0;
+    double mean, variance;
+    ScoreMoments(wins, losses, draws, mean, variance);
+    if (variance <= 0)
+        return 0;
+    double s0 = ScoreFromElo(elo0), s1 = ScoreFromElo(elo1);
+    return (s1 - s0) * (2 * mean - s0 - s1) * n / (2 * variance);
+}
+
+static void RecordGame(const MatchConfig &config, MatchState &match, int index, int white, GameOutcome &outcome)
+{
+    lock_guard<mutex> lock(match.lock);
+    if (match.pgn)
+    {
+        WritePgnGame(match.pgn, outcome.record);
+        fflush(match.pgn);
+    }
+    // A game cut short by an engine that failed says nothing about its positions
+    if (match.data.file && !outcome.restart[0] && !outcome.restart[1])
+    {
+        if (!WriteTrainingGame(match.data, outcome.positions.data(), outcome.positions.size(), outcome.result))
+            printf("Could not write training data for game %d\n", index + 1);
+        fflush(match.data.file);
+    }
+
+    // Count from the first engine's side
+    if (outcome.result == RESULT_DRAW)
+        match.draws++;
+    else if ((outcome.result == RESULT_WHITE_WINS) == (white == 0))
+        match.wins++;
+    else
+        match.losses++;
+
+    int played = match.wins + match.losses + match.draws;
+    const string &first = config.players[0].name, &second = config.players[1].name;
+    printf("Finished game %d (%s vs %s): %s {%s}\n", index + 1, config.players[white].name.c_str(),
+           config.players[1 - white].name.c_str(), outcome.record.result.c_str(), outcome.termination.c_str());
+    double elo, margin;
+    EstimateElo(match.wins, match.losses, match.draws, elo, margin);
+    printf("Score of %s vs %s: %d - %d - %d [%.3f] %d\n", first.c_str(), second.c_str(), match.wins, match.losses,
+           match.draws, (match.wins + match.draws * 0.5) / played, played);
+    printf("Elo difference: %.1f +/- %.1f\n", elo, margin);
+
+    if (config.sprt)
+    {
+        double llr = SprtLlr(match.wins, match.losses, match.draws, config.elo0, config.elo1);
+        double lower = log(config.beta / (1 - config.alpha)), upper = log((1 - config.beta) / config.alpha);
+        printf("SPRT: llr %.2f (%.2f, %.2f) [%.2f, %.2f]\n", llr, lower, upper, config.elo0, config.elo1);
+        if (!match.stop && (llr <= lower || llr >= upper))
+        {
+            printf("SPRT: %s accepted\n", llr >= upper ? "H1" : "H0");
+            match.stop = true;
+        }
+    }
+    fflush(stdout);
+}
+
+static void RunWorker(const MatchConfig &config, const PolyglotBook &book, MatchState &match, int slot)
+{
+    EngineProcess engines[2];
+    while (!match.stop)
+    {
+        int index = match.nextGame++;
+        if (index >= config.games)
+            break;
+
+        bool ready = true;
+        for (int p = 0; p < 2 && ready; p++)
+        {
+            if (!IsEngineProcessRunning(engines[p]) && !StartPlayer(engines[p], config.players[p]))
+            {
+                printf("Could not start %s (%s)\n", config.players[p].name.c_str(), config.players[p].command.c_str());
+                ready = false;
+            }
+        }
+        if (!ready)
+        {
+            match.stop = true;
+            break;
+        }
+
+        int white = index % 2;
+        GameOutcome outcome = PlayGame(config, match, slot, engines, index, white, ChooseOpening(config, book, index / 2));
+        for (int p = 0; p < 2; p++)
+        {
+            if (outcome.restart[p])
+                StopEngineProcess(engines[p]);
+        }
+        RecordGame(config, match, index, white, outcome);
+        WriteFeed(match, slot, "end " + outcome.record.result);
+    }
+    StopEngineProcess(engines[0]);
+    StopEngineProcess(engines[1]);
+}
+
+// Reads key=value settings following an option until the next option
+static int ReadSettings(int argc, char **argv, int first, vector<const char *> &settings)
+{
+    settings.clear();
+    while (first < argc && argv[first][0] != '-')
+        settings.push_back(argv[first++]);
+    return first;
+}
+
+static double SettingValue(const char *setting, const char *key, double fallback)
+{
+    size_t length = strlen(key);
+    if (strncmp(setting, key, length) == 0 && setting[length] == '=')
+        return atof(setting + length + 1);
+    return fallback;
+}
+
+int main(int argc, char **argv)
+{
+    MatchConfig config;
+    config.seed = (uint64_t)time(nullptr);
+    vector<const char *> each, settings;
+    int engineCount = 0;
+
+    int i = 1;
+    while (i < argc)
+    {
+        const char *option = argv[i++];
+        i = ReadSettings(argc, argv, i, settings);
+        const char *value = settings.empty() ? "" : settings[0];
+
+        if (strcmp(option, "-engine") == 0 && engineCount < 2)
+        {
+            PlayerConfig &player = config.players[engineCount++];
+            for (const char *setting : settings)
+            {
+                if (!ApplyPlayerSetting(player, setting))
+                    printf("Unknown engine setting %s\n", setting);
+            }
+        }
+        else if (strcmp(option, "-each") == 0)
+            each.insert(each.end(), settings.begin(), settings.end());
+        else if (strcmp(option, "-games") == 0)
+            config.games = atoi(value);
+        else if (strcmp(option, "-concurrency") == 0)
+            config.concurrency = max(1, atoi(value));
+        else if (strcmp(option, "-book") == 0)
+            config.bookPath = value;
+        else if (strcmp(option, "-bookdepth") == 0)
+            config.bookDepth = atoi(value);
+        else if (strcmp(option, "-randomplies") == 0)
+            config.randomPlies = atoi(value);
+        else if (strcmp(option, "-seed") == 0)
+            config.seed = strtoull(value, nullptr, 10);
+        else if (strcmp(option, "-pgnout") == 0)
+            config.pgnPath = value;
+        else if (strcmp(option, "-feed") == 0)
+            config.feedPath = value;
+        else if (strcmp(option, "-dataout") == 0)
+            config.dataPath = value;
+        else if (strcmp(option, "-timemargin") == 0)
+            config.timeMarginMs = atoi(value);
+        else if (strcmp(option, "-tb") == 0)
+            config.tablebases = true;
+        else if (strcmp(option, "-draw") == 0)
+        {
+            for (const char *setting : settings)
+            {
+                config.drawMoveNumber = (int)SettingValue(setting, "movenumber", config.drawMoveNumber);
+                config.drawMoveCount = (int)SettingValue(setting, "movecount", config.drawMoveCount);
+                config.drawScore = (int)SettingValue(setting, "score", config.drawScore);
+            }
+        }
+        else if (strcmp(option, "-resign") == 0)
+        {
+            for (const char *setting : settings)
+            {
+                config.resignMoveCount = (int)SettingValue(setting, "movecount", config.resignMoveCount);
+                config.resignScore = (int)SettingValue(setting, "score", config.resignScore);
+            }
+        }
+        else if (strcmp(option, "-sprt") == 0)
+        {
+            config.sprt = true;
+            for (const char *setting : settings)
+            {
+                config.elo0 = SettingValue(setting, "elo0", config.elo0);
+                config.elo1 = SettingValue(setting, "elo1", config.elo1);
+                config.alpha = SettingValue(setting, "alpha", config.alpha);
+                config.beta = SettingValue(setting, "beta", config.beta);
+            }
+        }
+        else
+            printf("Unknown option %s\n", option);
+    }
+
+    if (engineCount < 2)
+    {
+        printf("Usage: %s -engine name=A cmd=./chess-uci -engine name=B cmd=./other -each tc=10+0.1 [options]\n", argv[0]);
+        return 1;
+    }
+    for (int p = 0; p < 2; p++)
+    {
+        PlayerConfig &player = config.players[p];
+        for (const char *setting : each)
+            ApplyPlayerSetting(player, setting);
+        if (player.name.empty())
+            player.name = player.command;
+        if (player.command.empty())
+        {
+            printf("Engine %d has no cmd=\n", p + 1);
+            return 1;
+        }
+    }
+
+    PolyglotBook book;
+    if (!config.bookPath.empty() && !OpenPolyglotBook(book, config.bookPath.c_str()))
+    {
+        printf("Could not open %s\n", config.bookPath.c_str());
+        return 1;
+    }
+    if (config.tablebases)
+    {
+        SetTablebasePath("tablebases");
+        SetSyzygyPath("syzygy");
+    }
+
+    MatchState match;
+    if (!config.pgnPath.empty() && !(match.pgn = fopen(config.pgnPath.c_str(), "a")))
+    {
+        printf("Could not open %s\n", config.pgnPath.c_str());
+        return 1;
+    }
+    if (!config.feedPath.empty() && !(match.feed = fopen(config.feedPath.c_str(), "w")))
+    {
+        printf("Could not open %s\n", config.feedPath.c_str());
+        return 1;
+    }
+
+    if (!config.dataPath.empty() && !OpenTrainingWriter(match.data, config.dataPath.c_str()))
+    {
+        printf("Could not open %s\n", config.dataPath.c_str());
+        return 1;
+    }
+
+    vector<thread> workers;
+    for (int t = 0; t < min(config.concurrency, config.games); t++)
+        workers.emplace_back(RunWorker, cref(config), cref(book), ref(match), t);
+    for (auto &worker : workers)
+        worker.join();
+
+    if (match.pgn)
+        fclose(match.pgn);
+    if (match.feed)
+        fclose(match.feed);
+    CloseTrainingWriter(match.data);
+    ClosePolyglotBook(book);
+    return 0;
+}
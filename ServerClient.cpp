@@ -0,0 +1,274 @@
+#include "Position.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Usage: chess-client [-host 127.0.0.1] [-port N | -unix path] [-connections N] [-games N] [-seed N]
+//
+// Stand-in for real players when testing chess-server: opens the given number
+// of connections, pairs them up with "play" and answers every move with a
+// random legal one, until the requested number of games has finished. Then
+// prints throughput and the round-trip time from sending a move to seeing it
+// broadcast back.
+
+struct ClientConnection
+{
+    int fd = -1;
+    string input;
+    uint64_t gameId = 0;
+    bool white = false;
+    Position pos;
+    vector<uint64_t> keys; // Earlier positions of the game, for repetitions
+    steady_clock::time_point sentAt; // When our last move went out
+};
+
+struct ClientStats
+{
+    uint64_t gamesStarted = 0;
+    uint64_t gamesFinished = 0;
+    uint64_t moves = 0;
+    uint64_t errors = 0;
+    vector<float> latenciesUs;
+    uint64_t results[4] = {}; // White wins, draws, black wins, aborted
+};
+
+static uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static bool SendLine(ClientConnection &connection, const string &line)
+{
+    string text = line + "\n";
+    // Lines are tiny; a blocking send on a local socket keeps the client simple
+    return send(connection.fd, text.data(), text.size(), MSG_NOSIGNAL) == (ssize_t)text.size();
+}
+
+// The server ends drawn games right after the move; don't answer those
+static bool IsDrawn(const ClientConnection &connection)
+{
+    const Position &pos = connection.pos;
+    if (pos.halfmoveClock >= 100 || IsInsufficientMaterial(pos))
+        return true;
+    int repetitions = 0, end = (int)connection.keys.size();
+    for (int i = 2; i <= min((int)pos.halfmoveClock, end); i += 2)
+        repetitions += connection.keys[end - i] == pos.key;
+    return repetitions >= 2;
+}
+
+static void PlayRandomMove(ClientConnection &connection, uint64_t &random)
+{
+    if (IsDrawn(connection))
+        return;
+    Move moves[MAX_MOVES];
+    int count = GenerateLegalMoves(connection.pos, moves);
+    if (count == 0)
+        return;
+    connection.sentAt = steady_clock::now();
+    SendLine(connection, "move " + to_string(connection.gameId) + " " + MoveToUci(moves[SplitMix64(random) % count]));
+}
+
+static void HandleLine(ClientConnection &connection, const string &line, ClientStats &stats, uint64_t targetGames, uint64_t &random)
+{
+    char command[16] = {}, argument[64] = {};
+    unsigned long long id = 0;
+    sscanf(line.c_str(), "%15s %llu %63s", command, &id, argument);
+
+    if (strcmp(command, "game") == 0)
+    {
+        connection.gameId = id;
+        connection.white = strcmp(argument, "white") == 0;
+        SetStartPosition(connection.pos);
+        connection.keys.clear();
+    }
+    else if (strcmp(command, "start") == 0)
+    {
+        if (connection.white)
+        {
+            stats.gamesStarted++;
+            PlayRandomMove(connection, random);
+        }
+    }
+    else if (strcmp(command, "move") == 0 && id == connection.gameId)
+    {
+        Move m = ParseUciMove(connection.pos, argument);
+        if (m == MOVE_NONE)
+        {
+            stats.errors++;
+            return;
+        }
+        bool ours = connection.pos.whiteToMove == connection.white;
+        if (ours)
+        {
+            stats.moves++;
+            stats.latenciesUs.push_back(duration_cast<nanoseconds>(steady_clock::now() - connection.sentAt).count() / 1000.0f);
+        }
+        connection.keys.push_back(connection.pos.key);
+        DoMove(connection.pos, m);
+        if (!ours)
+            PlayRandomMove(connection, random);
+    }
+    else if (strcmp(command, "end") == 0 && id == connection.gameId)
+    {
+        connection.gameId = 0;
+        if (connection.white)
+        {
+            stats.gamesFinished++;
+            string result = argument;
+            stats.results[result == "1-0" ? 0 : result == "1/2-1/2" ? 1 : result == "0-1" ? 2 : 3]++;
+        }
+        if (stats.gamesStarted < targetGames)
+            SendLine(connection, "play");
+    }
+    else if (strcmp(command, "error") == 0)
+        stats.errors++;
+}
+
+static int Connect(const char *host, int port, const char *unixPath)
+{
+    if (unixPath)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, unixPath, sizeof(address.sun_path) - 1);
+        if (fd >= 0 && connect(fd, (sockaddr *)&address, sizeof(address)) == 0)
+            return fd;
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, host, &address.sin_addr);
+    if (fd >= 0 && connect(fd, (sockaddr *)&address, sizeof(address)) == 0)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+    if (fd >= 0)
+        close(fd);
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *host = "127.0.0.1", *unixPath = nullptr;
+    int port = 7777, connectionCount = 100;
+    uint64_t targetGames = 1000, random = 1;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-host") == 0)
+            host = argv[i + 1];
+        else if (strcmp(argv[i], "-port") == 0)
+            port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-unix") == 0)
+            unixPath = argv[i + 1];
+        else if (strcmp(argv[i], "-connections") == 0)
+            connectionCount = max(2, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-games") == 0)
+            targetGames = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "-seed") == 0)
+            random = strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    vector<ClientConnection> connections(connectionCount);
+    for (int i = 0; i < connectionCount; i++)
+    {
+        connections[i].fd = Connect(host, port, unixPath);
+        if (connections[i].fd < 0)
+        {
+            printf("Could not connect (%s) after %d connections\n", strerror(errno), i);
+            return 1;
+        }
+        epoll_event event = {EPOLLIN, {}};
+        event.data.u32 = (uint32_t)i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, connections[i].fd, &event);
+    }
+
+    ClientStats stats;
+    steady_clock::time_point start = steady_clock::now();
+    for (auto &connection : connections)
+        SendLine(connection, "play");
+
+    epoll_event events[256];
+    int open = connectionCount;
+    while (stats.gamesFinished < targetGames && open > 0)
+    {
+        int count = epoll_wait(epoll, events, 256, 10000);
+        if (count == 0)
+        {
+            printf("No traffic for 10 s, giving up\n");
+            break;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            ClientConnection &connection = connections[events[i].data.u32];
+            char buffer[4096];
+            ssize_t length = recv(connection.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (length <= 0)
+            {
+                if (length == 0 || (errno != EAGAIN && errno != EINTR))
+                {
+                    close(connection.fd);
+                    open--;
+                }
+                continue;
+            }
+            connection.input.append(buffer, (size_t)length);
+            size_t first = 0, end;
+            while ((end = connection.input.find('\n', first)) != string::npos)
+            {
+                HandleLine(connection, connection.input.substr(first, end - first), stats, targetGames, random);
+                first = end + 1;
+            }
+            connection.input.erase(0, first);
+        }
+    }
+
+    double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    sort(stats.latenciesUs.begin(), stats.latenciesUs.end());
+    auto percentile = [&](double p) {
+        return stats.latenciesUs.empty() ? 0.0f : stats.latenciesUs[(size_t)(p * (stats.latenciesUs.size() - 1))];
+    };
+    printf("%llu games (+%llu =%llu -%llu, %llu aborted), %llu moves in %.1f s: %.0f moves/s, %llu errors\n",
+           (unsigned long long)stats.gamesFinished, (unsigned long long)stats.results[0], (unsigned long long)stats.results[1],
+           (unsigned long long)stats.results[2], (unsigned long long)stats.results[3], (unsigned long long)stats.moves,
+           seconds, stats.moves / seconds, (unsigned long long)stats.errors);
+    printf("Move round trip: p50 %.0f us, p99 %.0f us, max %.0f us\n", percentile(0.5), percentile(0.99), percentile(1.0));
+
+    for (auto &connection : connections)
+        close(connection.fd);
+    return stats.errors ? 1 : 0;
+}
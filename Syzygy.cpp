@@ -0,0 +1,1136 @@
+/*
+  Syzygy tablebase probing, adapted from src/syzygy/tbprobe.cpp of Stockfish.
+
+  Copyright (c) 2013 Ronald de Man
+  Copyright (C) 2016-2024 Marco Costalba, Lucas Braesch and the Stockfish
+  developers (see the AUTHORS file of Stockfish)
+  Adaptation to this program's Position type, file registry and root filter
+  by the authors of this program.
+
+  This file is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or (at your option)
+  any later version.
+
+  This file is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License along
+  with this file. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Syzygy.h"
+#include "MappedFile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define SYZYGY_PIECES 7
+#define MAX_DTZ (1 << 18)
+
+#ifdef _WIN32
+#define PATH_SEPARATOR ';'
+#else
+#define PATH_SEPARATOR ':'
+#endif
+
+enum SyzygyFlag
+{
+    FLAG_STM = 1,
+    FLAG_MAPPED = 2,
+    FLAG_WIN_PLIES = 4,
+    FLAG_LOSS_PLIES = 8,
+    FLAG_WIDE = 16,
+    FLAG_SINGLE_VALUE = 128
+};
+
+enum ProbeState
+{
+    PROBE_FAIL,
+    PROBE_OK,
+    PROBE_CHANGE_STM,       // DTZ table stores the other side to move
+    PROBE_ZEROING_BEST_MOVE // Best move is a capture or pawn move
+};
+
+static const uint8_t wdlMagic[4] = {0x71, 0xE8, 0x23, 0x5D};
+static const uint8_t dtzMagic[4] = {0xD7, 0x66, 0x0C, 0xA5};
+static const char pieceLetters[] = " PNBRQK";
+
+struct SparseEntry
+{
+    uint8_t block[4];
+    uint8_t offset[2];
+};
+
+// Two 12-bit symbols packed in 3 bytes
+struct SymbolPair
+{
+    uint8_t lr[3];
+};
+
+// One compressed sub-table: a side to move and, with pawns, a leading pawn file
+struct PairsData
+{
+    uint8_t flags = 0;
+    int maxSymLen = 0;
+    int minSymLen = 0; // The stored value when FLAG_SINGLE_VALUE is set
+    uint32_t numBlocks = 0;
+    size_t blockSize = 0;
+    size_t span = 0; // Every span values there is a sparse index entry
+    const uint8_t *lowestSym = nullptr;
+    const SymbolPair *btree = nullptr;
+    const uint8_t *blockLength = nullptr;
+    uint32_t blockLengthSize = 0;
+    const SparseEntry *sparseIndex = nullptr;
+    size_t sparseIndexSize = 0;
+    const uint8_t *data = nullptr;
+    vector<uint64_t> base64; // Lowest code of each symbol length, left aligned
+    vector<uint8_t> symlen;  // Values represented by each symbol, minus one
+    uint8_t pieces[SYZYGY_PIECES] = {};
+    uint64_t groupIdx[SYZYGY_PIECES + 1] = {};
+    int groupLen[SYZYGY_PIECES + 1] = {};
+    uint16_t mapIdx[4] = {}; // DTZ value maps for win, loss, cursed win, blessed loss
+};
+
+struct SyzygyTable
+{
+    bool dtz = false;
+    string name;
+    uint64_t key = 0, key2 = 0; // Material as named / with colours swapped
+    int pieceCount = 0;
+    bool hasPawns = false;
+    bool hasUniquePieces = false;
+    int pawnCount[2] = {}; // [leading colour / other colour]
+
+    // Mapping state: users pins the mapping while a probe reads it
+    atomic<bool> ready{false};
+    atomic<int> users{0};
+    atomic<uint64_t> lastUsed{0};
+    bool missing = false;
+    MappedFile file;
+    const uint8_t *dtzMap = nullptr;
+    PairsData items[2][4]; // [side to move][leading pawn file]
+};
+
+struct SyzygyEntry
+{
+    SyzygyTable wdl, dtz;
+};
+
+static int mapPawns[64];
+static int mapB1H1H7[64];
+static int mapA1D1D4[64];
+static int mapKK[10][64];
+static int binomial[6][64];
+static int leadPawnIdx[6][64];
+static int leadPawnsSize[6][4];
+
+// Syzygy numbers squares a1 = 0 .. h8 = 63, so its rank 0 is our row 7
+static int ToSyzygySquare(int sq) { return sq ^ 56; }
+static int SquareRank(int s) { return s >> 3; }
+static int SquareFile(int s) { return s & 7; }
+static int OffDiagonal(int s) { return SquareRank(s) - SquareFile(s); }
+
+static struct SyzygyTables
+{
+    SyzygyTables()
+    {
+        int code = 0;
+        for (int s = 0; s < 64; s++)
+        {
+            if (OffDiagonal(s) < 0)
+                mapB1H1H7[s] = code++;
+        }
+
+        // a1-d1-d4 triangle: squares below the diagonal first, diagonal squares last
+        vector<int> diagonal;
+        code = 0;
+        for (int s = 0; s < 28; s++)
+        {
+            if (SquareFile(s) > 3)
+                continue;
+            if (OffDiagonal(s) < 0)
+                mapA1D1D4[s] = code++;
+            else if (OffDiagonal(s) == 0)
+                diagonal.push_back(s);
+        }
+        for (int s : diagonal)
+            mapA1D1D4[s] = code++;
+
+        // The 462 legal placements of two kings with the first in the triangle;
+        // with the first on the diagonal the second may not be above it
+        vector<pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; idx++)
+        {
+            for (int s1 = 0; s1 < 28; s1++)
+            {
+                if (SquareFile(s1) > 3 || mapA1D1D4[s1] != idx || (idx == 0 && s1 != 1))
+                    continue;
+                for (int s2 = 0; s2 < 64; s2++)
+                {
+                    if (abs(SquareRank(s1) - SquareRank(s2)) <= 1 && abs(SquareFile(s1) - SquareFile(s2)) <= 1)
+                        continue;
+                    if (OffDiagonal(s1) == 0 && OffDiagonal(s2) > 0)
+                        continue;
+                    if (OffDiagonal(s1) == 0 && OffDiagonal(s2) == 0)
+                        bothOnDiagonal.push_back({idx, s2});
+                    else
+                        mapKK[idx][s2] = code++;
+                }
+            }
+        }
+        for (auto &p : bothOnDiagonal)
+            mapKK[p.first][p.second] = code++;
+
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; n++)
+        {
+            for (int k = 0; k < 6 && k <= n; k++)
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+        }
+
+        // mapPawns numbers a2-h7 so that the leading pawn (nearest the edge,
+        // then lowest rank) has the highest value
+        int available = 47;
+        for (int leadPawns = 1; leadPawns <= 5; leadPawns++)
+        {
+            for (int f = 0; f < 4; f++)
+            {
+                int idx = 0;
+                for (int r = 1; r <= 6; r++)
+                {
+                    int sq = r * 8 + f;
+                    if (leadPawns == 1)
+                    {
+                        mapPawns[sq] = available--;
+                        mapPawns[sq ^ 7] = available--;
+                    }
+                    leadPawnIdx[leadPawns][sq] = idx;
+                    idx += binomial[leadPawns - 1][mapPawns[sq]];
+                }
+                leadPawnsSize[leadPawns][f] = idx;
+            }
+        }
+    }
+} syzygyTables;
+
+static uint16_t ReadLittle16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t ReadLittle32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint32_t ReadBig32(const uint8_t *p) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+static uint64_t ReadBig64(const uint8_t *p) { return (uint64_t)ReadBig32(p) << 32 | ReadBig32(p + 4); }
+
+static int PairLeft(const SymbolPair &p) { return ((p.lr[1] & 0xF) << 8) | p.lr[0]; }
+static int PairRight(const SymbolPair &p) { return (p.lr[2] << 4) | (p.lr[1] >> 4); }
+
+static bool PawnOrder(int a, int b) { return mapPawns[a] < mapPawns[b]; }
+
+// Piece codes as stored in the files: 1 pawn .. 6 king, +8 for black
+static int SyzygyPiece(int piece) { return piece > 0 ? piece : (-piece | 8); }
+
+static uint64_t MaterialKey(const int counts[2][7])
+{
+    uint64_t key = 0;
+    for (int color = 0; color < 2; color++)
+    {
+        for (int type = PAWN; type <= QUEEN; type++)
+            key = key * 16 + (uint64_t)counts[color][type];
+    }
+    return key;
+}
+
+static uint64_t MaterialKeyOf(const Position &pos)
+{
+    int counts[2][7];
+    for (int color = 0; color < 2; color++)
+    {
+        for (int type = PAWN; type <= QUEEN; type++)
+            counts[color][type] = PopCount(pos.pieces[color][type]);
+    }
+    return MaterialKey(counts);
+}
+
+static PairsData *GetPairs(SyzygyTable &table, int stm, int file)
+{
+    return &table.items[table.dtz ? 0 : stm % 2][table.hasPawns ? file : 0];
+}
+
+// Registry
+
+static vector<string> syzygyPaths;
+static mutex syzygyMutex;
+static vector<unique_ptr<SyzygyEntry>> syzygyEntries;
+static map<uint64_t, SyzygyEntry *> syzygyByKey;
+static int syzygyPieceLimit = 0;
+static int mappedLimit = SYZYGY_DEFAULT_MAPPED;
+static int mappedCount = 0;
+static atomic<uint64_t> useClock{0};
+
+static bool ParseSyzygyName(const string &name, int counts[2][7])
+{
+    memset(counts, 0, sizeof(int) * 2 * 7);
+    int side = 0, pieces = 0;
+    for (char c : name)
+    {
+        if (c == 'v')
+        {
+            side++;
+            continue;
+        }
+        const char *letter = strchr(pieceLetters + 1, c);
+        if (!letter || side > 1)
+            return false;
+        counts[side][letter - pieceLetters]++;
+        pieces++;
+    }
+    return side == 1 && counts[0][KING] == 1 && counts[1][KING] == 1 && pieces <= SYZYGY_PIECES;
+}
+
+static void SetupTable(SyzygyTable &table, const string &name, const int counts[2][7], bool dtz)
+{
+    int swapped[2][7];
+    for (int type = 0; type < 7; type++)
+    {
+        swapped[0][type] = counts[1][type];
+        swapped[1][type] = counts[0][type];
+    }
+
+    table.dtz = dtz;
+    table.name = name;
+    table.key = MaterialKey(counts);
+    table.key2 = MaterialKey(swapped);
+    for (int color = 0; color < 2; color++)
+    {
+        for (int type = PAWN; type <= KING; type++)
+        {
+            table.pieceCount += counts[color][type];
+            if (type != KING && counts[color][type] == 1)
+                table.hasUniquePieces = true;
+        }
+    }
+    table.hasPawns = counts[0][PAWN] + counts[1][PAWN] > 0;
+
+    // With pawns on both sides the side with fewer pawns leads
+    bool whiteLeads = counts[1][PAWN] == 0 || (counts[0][PAWN] > 0 && counts[1][PAWN] >= counts[0][PAWN]);
+    table.pawnCount[0] = counts[whiteLeads ? 0 : 1][PAWN];
+    table.pawnCount[1] = counts[whiteLeads ? 1 : 0][PAWN];
+}
+
+void SetSyzygyPath(const char *paths)
+{
+    lock_guard<mutex> lock(syzygyMutex);
+    for (auto &entry : syzygyEntries)
+    {
+        UnmapFile(entry->wdl.file);
+        UnmapFile(entry->dtz.file);
+    }
+    syzygyEntries.clear();
+    syzygyByKey.clear();
+    syzygyPaths.clear();
+    syzygyPieceLimit = 0;
+    mappedCount = 0;
+
+    string list = paths ? paths : "";
+    for (size_t start = 0; start <= list.size();)
+    {
+        size_t end = list.find(PATH_SEPARATOR, start);
+        if (end == string::npos)
+            end = list.size();
+        if (end > start)
+            syzygyPaths.push_back(list.substr(start, end - start));
+        start = end + 1;
+    }
+
+    for (auto &directory : syzygyPaths)
+    {
+        error_code error;
+        for (auto &file : filesystem::directory_iterator(directory, error))
+        {
+            if (file.path().extension() != ".rtbw")
+                continue;
+
+            string name = file.path().stem().string();
+            int counts[2][7];
+            if (!ParseSyzygyName(name, counts))
+                continue;
+            uint64_t key = MaterialKey(counts);
+            if (syzygyByKey.count(key))
+                continue;
+
+            unique_ptr<SyzygyEntry> entry(new SyzygyEntry());
+            SetupTable(entry->wdl, name, counts, false);
+            SetupTable(entry->dtz, name, counts, true);
+            syzygyByKey[entry->wdl.key] = entry.get();
+            syzygyByKey[entry->wdl.key2] = entry.get();
+            syzygyPieceLimit = max(syzygyPieceLimit, entry->wdl.pieceCount);
+            syzygyEntries.push_back(move(entry));
+        }
+    }
+}
+
+void SetSyzygyMappedLimit(int files)
+{
+    lock_guard<mutex> lock(syzygyMutex);
+    mappedLimit = max(files, 2);
+}
+
+int SyzygyPieceLimit()
+{
+    return syzygyPieceLimit;
+}
+
+// Table layout
+
+static void SetGroups(SyzygyTable &table, PairsData *d, const int order[2], int file)
+{
+    int n = 0, firstLen = table.hasPawns ? 0 : table.hasUniquePieces ? 3 : 2;
+    d->groupLen[n] = 1;
+
+    // Leading group, then runs of identical pieces: KRvKN gives (3, 1)
+    for (int i = 1; i < table.pieceCount; i++)
+    {
+        if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1])
+            d->groupLen[n]++;
+        else
+            d->groupLen[++n] = 1;
+    }
+    d->groupLen[++n] = 0;
+
+    // The groups are combined in a per-table order: order[0] places the leading
+    // group and order[1] the remaining pawns when both sides have pawns
+    bool bothPawns = table.hasPawns && table.pawnCount[1];
+    int next = bothPawns ? 2 : 1;
+    int freeSquares = 64 - d->groupLen[0] - (bothPawns ? d->groupLen[1] : 0);
+    uint64_t idx = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++)
+    {
+        if (k == order[0])
+        {
+            d->groupIdx[0] = idx;
+            idx *= table.hasPawns ? leadPawnsSize[d->groupLen[0]][file] : table.hasUniquePieces ? 31332 : 462;
+        }
+        else if (k == order[1])
+        {
+            d->groupIdx[1] = idx;
+            idx *= binomial[d->groupLen[1]][48 - d->groupLen[0]];
+        }
+        else
+        {
+            d->groupIdx[next] = idx;
+            idx *= binomial[d->groupLen[next]][freeSquares];
+            freeSquares -= d->groupLen[next++];
+        }
+    }
+    d->groupIdx[n] = idx;
+}
+
+static uint8_t SetSymbolLength(PairsData *d, int sym, vector<bool> &visited)
+{
+    visited[sym] = true;
+    int right = PairRight(d->btree[sym]);
+    if (right == 0xFFF)
+        return 0;
+
+    int left = PairLeft(d->btree[sym]);
+    if (!visited[left])
+        d->symlen[left] = SetSymbolLength(d, left, visited);
+    if (!visited[right])
+        d->symlen[right] = SetSymbolLength(d, right, visited);
+    return (uint8_t)(d->symlen[left] + d->symlen[right] + 1);
+}
+
+static const uint8_t *SetSizes(PairsData *d, const uint8_t *data)
+{
+    d->flags = *data++;
+    if (d->flags & FLAG_SINGLE_VALUE)
+    {
+        d->minSymLen = *data++;
+        return data;
+    }
+
+    int groups = 0;
+    while (d->groupLen[groups])
+        groups++;
+    uint64_t tableSize = d->groupIdx[groups];
+
+    d->blockSize = (size_t)1 << *data++;
+    d->span = (size_t)1 << *data++;
+    d->sparseIndexSize = (size_t)((tableSize + d->span - 1) / d->span);
+    int padding = *data++;
+    d->numBlocks = ReadLittle32(data);
+    data += 4;
+    d->blockLengthSize = d->numBlocks + padding; // Padding keeps the sparse index in range
+    d->maxSymLen = *data++;
+    d->minSymLen = *data++;
+    d->lowestSym = data;
+
+    // Canonical Huffman code: longer symbols have lower values, so base64[i]
+    // (length minSymLen + i, left aligned) decreases with i
+    int lengths = d->maxSymLen - d->minSymLen + 1;
+    d->base64.assign(lengths, 0);
+    for (int i = lengths - 2; i >= 0; i--)
+        d->base64[i] = (d->base64[i + 1] + ReadLittle16(d->lowestSym + 2 * i) - ReadLittle16(d->lowestSym + 2 * (i + 1))) / 2;
+    for (int i = 0; i < lengths; i++)
+        d->base64[i] <<= 64 - i - d->minSymLen;
+    data += lengths * 2;
+
+    // Symbols expand recursively into pairs of symbols (Re-Pair compression)
+    d->symlen.assign(ReadLittle16(data), 0);
+    data += 2;
+    d->btree = (const SymbolPair *)data;
+    vector<bool> visited(d->symlen.size());
+    for (size_t sym = 0; sym < d->symlen.size(); sym++)
+    {
+        if (!visited[sym])
+            d->symlen[sym] = SetSymbolLength(d, (int)sym, visited);
+    }
+    return data + d->symlen.size() * sizeof(SymbolPair) + (d->symlen.size() & 1);
+}
+
+static const uint8_t *SetDtzMap(SyzygyTable &table, const uint8_t *data, const uint8_t *base, int maxFile)
+{
+    table.dtzMap = data;
+    for (int f = 0; f <= maxFile; f++)
+    {
+        PairsData *d = GetPairs(table, 0, f);
+        if (!(d->flags & FLAG_MAPPED))
+            continue;
+
+        if (d->flags & FLAG_WIDE)
+        {
+            data += (data - base) & 1;
+            for (int i = 0; i < 4; i++)
+            {
+                d->mapIdx[i] = (uint16_t)((data - table.dtzMap) / 2 + 1);
+                data += 2 * ReadLittle16(data) + 2;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                d->mapIdx[i] = (uint16_t)(data - table.dtzMap + 1);
+                data += *data + 1;
+            }
+        }
+    }
+    return data + ((data - base) & 1);
+}
+
+static bool InitTable(SyzygyTable &table, const uint8_t *base)
+{
+    enum
+    {
+        HAS_PAWNS = 2
+    };
+
+    const uint8_t *data = base + 4;
+    if (((*data & HAS_PAWNS) != 0) != table.hasPawns)
+        return false;
+    data++;
+
+    int sides = !table.dtz && table.key != table.key2 ? 2 : 1;
+    int maxFile = table.hasPawns ? 3 : 0;
+    bool bothPawns = table.hasPawns && table.pawnCount[1];
+
+    for (int f = 0; f <= maxFile; f++)
+    {
+        for (int i = 0; i < sides; i++)
+            *GetPairs(table, i, f) = PairsData();
+
+        int order[2][2] = {{*data & 0xF, bothPawns ? *(data + 1) & 0xF : 0xF},
+                           {*data >> 4, bothPawns ? *(data + 1) >> 4 : 0xF}};
+        data += 1 + bothPawns;
+
+        for (int k = 0; k < table.pieceCount; k++, data++)
+        {
+            for (int i = 0; i < sides; i++)
+                GetPairs(table, i, f)->pieces[k] = (uint8_t)(i ? *data >> 4 : *data & 0xF);
+        }
+        for (int i = 0; i < sides; i++)
+            SetGroups(table, GetPairs(table, i, f), order[i], f);
+    }
+    data += (data - base) & 1;
+
+    for (int f = 0; f <= maxFile; f++)
+    {
+        for (int i = 0; i < sides; i++)
+            data = SetSizes(GetPairs(table, i, f), data);
+    }
+
+    if (table.dtz)
+        data = SetDtzMap(table, data, base, maxFile);
+
+    for (int f = 0; f <= maxFile; f++)
+    {
+        for (int i = 0; i < sides; i++)
+        {
+            PairsData *d = GetPairs(table, i, f);
+            d->sparseIndex = (const SparseEntry *)data;
+            data += d->sparseIndexSize * sizeof(SparseEntry);
+        }
+    }
+    for (int f = 0; f <= maxFile; f++)
+    {
+        for (int i = 0; i < sides; i++)
+        {
+            PairsData *d = GetPairs(table, i, f);
+            d->blockLength = data;
+            data += d->blockLengthSize * 2;
+        }
+    }
+    for (int f = 0; f <= maxFile; f++)
+    {
+        for (int i = 0; i < sides; i++)
+        {
+            data = base + (((data - base) + 0x3F) & ~(ptrdiff_t)0x3F);
+            PairsData *d = GetPairs(table, i, f);
+            d->data = data;
+            data += (size_t)d->numBlocks * d->blockSize;
+        }
+    }
+    return (size_t)(data - base) <= table.file.size;
+}
+
+static bool MapTable(SyzygyTable &table)
+{
+    for (auto &directory : syzygyPaths)
+    {
+        string path = directory + "/" + table.name + (table.dtz ? ".rtbz" : ".rtbw");
+        if (!MapFile(table.file, path.c_str()))
+            continue;
+
+        const uint8_t *magic = table.dtz ? dtzMagic : wdlMagic;
+        if (table.file.size % 64 == 16 && memcmp(table.file.data, magic, 4) == 0 && InitTable(table, table.file.data))
+            return true;
+        UnmapFile(table.file);
+    }
+    return false;
+}
+
+// Releases the least recently used mapping that no probe is reading
+static void EvictTable()
+{
+    SyzygyTable *oldest = nullptr;
+    for (auto &entry : syzygyEntries)
+    {
+        for (SyzygyTable *table : {&entry->wdl, &entry->dtz})
+        {
+            if (table->ready && table->users == 0 && (!oldest || table->lastUsed < oldest->lastUsed))
+                oldest = table;
+        }
+    }
+    if (!oldest)
+        return;
+
+    oldest->ready = false;
+    if (oldest->users != 0)
+    {
+        oldest->ready = true; // A probe got in first, keep it
+        return;
+    }
+    UnmapFile(oldest->file);
+    for (auto &side : oldest->items)
+    {
+        for (auto &d : side)
+            d = PairsData();
+    }
+    mappedCount--;
+}
+
+// Pins the table's mapping, mapping the file on first use
+static bool AcquireTable(SyzygyTable &table)
+{
+    table.users++;
+    if (table.ready)
+    {
+        table.lastUsed = ++useClock;
+        return true;
+    }
+    table.users--;
+
+    lock_guard<mutex> lock(syzygyMutex);
+    if (table.missing)
+        return false;
+    if (!table.ready)
+    {
+        if (mappedCount >= mappedLimit)
+            EvictTable();
+        if (!MapTable(table))
+        {
+            table.missing = true;
+            return false;
+        }
+        mappedCount++;
+        table.ready = true;
+    }
+    table.users++;
+    table.lastUsed = ++useClock;
+    return true;
+}
+
+static void ReleaseTable(SyzygyTable &table)
+{
+    table.users--;
+}
+
+// Decoding
+
+static int DecompressPairs(PairsData *d, uint64_t idx)
+{
+    if (d->flags & FLAG_SINGLE_VALUE)
+        return d->minSymLen;
+
+    // The sparse index entry k points at the value k * span + span / 2; walk
+    // from there to the block holding idx
+    uint32_t k = (uint32_t)(idx / d->span);
+    uint32_t block = ReadLittle32(d->sparseIndex[k].block);
+    int offset = ReadLittle16(d->sparseIndex[k].offset);
+    offset += (int)(idx % d->span) - (int)(d->span / 2);
+
+    while (offset < 0)
+        offset += ReadLittle16(d->blockLength + 2 * --block) + 1;
+    while (offset > ReadLittle16(d->blockLength + 2 * block))
+        offset -= ReadLittle16(d->blockLength + 2 * block++) + 1;
+
+    // Read Huffman symbols until the one covering offset
+    const uint8_t *ptr = d->data + (uint64_t)block * d->blockSize;
+    uint64_t buf64 = ReadBig64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym;
+
+    while (true)
+    {
+        int len = 0;
+        while (buf64 < d->base64[len])
+            len++;
+
+        sym = (int)((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+        sym += ReadLittle16(d->lowestSym + 2 * len);
+
+        if (offset < d->symlen[sym] + 1)
+            break;
+
+        offset -= d->symlen[sym] + 1;
+        len += d->minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32)
+        {
+            buf64Size += 32;
+            buf64 |= (uint64_t)ReadBig32(ptr) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // Expand the symbol's pairs down to the single value at offset
+    while (d->symlen[sym])
+    {
+        int left = PairLeft(d->btree[sym]);
+        if (offset < d->symlen[left] + 1)
+            sym = left;
+        else
+        {
+            offset -= d->symlen[left] + 1;
+            sym = PairRight(d->btree[sym]);
+        }
+    }
+    return PairLeft(d->btree[sym]);
+}
+
+static int MapScore(SyzygyTable &table, int file, int value, int wdl)
+{
+    if (!table.dtz)
+        return value - 2;
+
+    static const int wdlMap[] = {1, 3, 0, 2, 0};
+    PairsData *d = GetPairs(table, 0, file);
+    if (d->flags & FLAG_MAPPED)
+    {
+        int idx = d->mapIdx[wdlMap[wdl + 2]] + value;
+        value = (d->flags & FLAG_WIDE) ? ReadLittle16(table.dtzMap + 2 * idx) : table.dtzMap[idx];
+    }
+
+    // Tables store moves unless the plies flag is set; cursed results are always moves
+    if ((wdl == SYZYGY_WIN && !(d->flags & FLAG_WIN_PLIES)) || (wdl == SYZYGY_LOSS && !(d->flags & FLAG_LOSS_PLIES)) ||
+        wdl == SYZYGY_CURSED_WIN || wdl == SYZYGY_BLESSED_LOSS)
+        value *= 2;
+    return value + 1;
+}
+
+static int ProbeTable(const Position &pos, SyzygyTable &table, int wdl, ProbeState &state)
+{
+    int squares[SYZYGY_PIECES];
+    uint8_t pieces[SYZYGY_PIECES];
+    int size = 0, leadPawnCount = 0, tbFile = 0;
+    Bitboard leadPawns = 0;
+
+    // Tables have the named side as white; symmetric tables only store white to move
+    bool symmetricBlackToMove = table.key == table.key2 && !pos.whiteToMove;
+    bool blackStronger = MaterialKeyOf(pos) != table.key;
+    bool flip = symmetricBlackToMove || blackStronger;
+    int flipColor = flip ? 8 : 0;
+    int flipSquares = flip ? 56 : 0;
+    int stm = (int)flip ^ (pos.whiteToMove ? 0 : 1);
+
+    if (table.hasPawns)
+    {
+        // Leading pawns come first; the one nearest the edge picks the sub-table
+        int pawn = GetPairs(table, 0, 0)->pieces[0] ^ flipColor;
+        Bitboard b = leadPawns = pos.pieces[(pawn & 8) ? 1 : 0][PAWN];
+        while (b)
+            squares[size++] = ToSyzygySquare(PopLsb(b)) ^ flipSquares;
+        leadPawnCount = size;
+        swap(squares[0], *max_element(squares, squares + leadPawnCount, PawnOrder));
+        tbFile = min(SquareFile(squares[0]), 7 - SquareFile(squares[0]));
+    }
+
+    // DTZ tables are one-sided
+    if (table.dtz && (GetPairs(table, stm, tbFile)->flags & FLAG_STM) != stm && !(table.key == table.key2 && !table.hasPawns))
+    {
+        state = PROBE_CHANGE_STM;
+        return 0;
+    }
+
+    Bitboard b = Occupied(pos) & ~leadPawns;
+    while (b)
+    {
+        int sq = PopLsb(b);
+        squares[size] = ToSyzygySquare(sq) ^ flipSquares;
+        pieces[size++] = (uint8_t)(SyzygyPiece(pos.board[sq]) ^ flipColor);
+    }
+
+    // Reorder the pieces into the sequence the table was compressed with
+    PairsData *d = GetPairs(table, stm, tbFile);
+    for (int i = leadPawnCount; i < size - 1; i++)
+    {
+        for (int j = i + 1; j < size; j++)
+        {
+            if (d->pieces[i] == pieces[j])
+            {
+                swap(pieces[i], pieces[j]);
+                swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    if (SquareFile(squares[0]) > 3)
+    {
+        for (int i = 0; i < size; i++)
+            squares[i] ^= 7;
+    }
+
+    uint64_t idx;
+    if (table.hasPawns)
+    {
+        idx = leadPawnIdx[leadPawnCount][squares[0]];
+        stable_sort(squares + 1, squares + leadPawnCount, PawnOrder);
+        for (int i = 1; i < leadPawnCount; i++)
+            idx += binomial[i][mapPawns[squares[i]]];
+    }
+    else
+    {
+        // Without pawns the leading piece also goes below rank 5 and below the a1-h8 diagonal
+        if (SquareRank(squares[0]) > 3)
+        {
+            for (int i = 0; i < size; i++)
+                squares[i] ^= 56;
+        }
+        for (int i = 0; i < d->groupLen[0]; i++)
+        {
+            if (!OffDiagonal(squares[i]))
+                continue;
+            if (OffDiagonal(squares[i]) > 0)
+            {
+                for (int j = i; j < size; j++)
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+            break;
+        }
+
+        if (table.hasUniquePieces)
+        {
+            // The first three unique pieces are encoded together
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (OffDiagonal(squares[0]))
+                idx = ((uint64_t)mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            else if (OffDiagonal(squares[1]))
+                idx = (6 * 63 + (uint64_t)SquareRank(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            else if (OffDiagonal(squares[2]))
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + (uint64_t)SquareRank(squares[0]) * 7 * 28 +
+                      (SquareRank(squares[1]) - adjust1) * 28 + mapB1H1H7[squares[2]];
+            else
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (uint64_t)SquareRank(squares[0]) * 7 * 6 +
+                      (SquareRank(squares[1]) - adjust1) * 6 + (SquareRank(squares[2]) - adjust2);
+        }
+        else
+            idx = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+    }
+
+    // Remaining groups: each is a combination of squares not taken by earlier groups
+    idx *= d->groupIdx[0];
+    int *groupSq = squares + d->groupLen[0];
+    bool remainingPawns = table.hasPawns && table.pawnCount[1];
+    for (int next = 1; d->groupLen[next]; next++)
+    {
+        stable_sort(groupSq, groupSq + d->groupLen[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < d->groupLen[next]; i++)
+        {
+            int adjust = (int)count_if(squares, groupSq, [&](int s)
+                                       { return groupSq[i] > s; });
+            n += binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * d->groupIdx[next];
+        groupSq += d->groupLen[next];
+    }
+
+    return MapScore(table, tbFile, DecompressPairs(d, idx), wdl);
+}
+
+static int ProbeFile(const Position &pos, bool dtz, int wdl, ProbeState &state)
+{
+    if (PopCount(Occupied(pos)) == 2)
+        return SYZYGY_DRAW;
+
+    auto found = syzygyByKey.find(MaterialKeyOf(pos));
+    if (found == syzygyByKey.end())
+    {
+        state = PROBE_FAIL;
+        return 0;
+    }
+
+    SyzygyTable &table = dtz ? found->second->dtz : found->second->wdl;
+    if (!AcquireTable(table))
+    {
+        state = PROBE_FAIL;
+        return 0;
+    }
+    int value = ProbeTable(pos, table, wdl, state);
+    ReleaseTable(table);
+    return value;
+}
+
+// Probing
+
+// Tables don't store positions with en passant rights and may hold "don't care"
+// values where a capture is best, so captures are searched before the lookup
+static int SearchWdl(const Position &pos, ProbeState &state, bool checkZeroingMoves)
+{
+    Move moves[MAX_MOVES];
+    int total = GenerateLegalMoves(pos, moves);
+    int moveCount = 0, bestValue = SYZYGY_LOSS, value;
+
+    for (int i = 0; i < total; i++)
+    {
+        if (!IsCapture(pos, moves[i]) && (!checkZeroingMoves || abs(pos.board[MoveFrom(moves[i])]) != PAWN))
+            continue;
+
+        moveCount++;
+        Position next = pos;
+        DoMove(next, moves[i]);
+        value = -SearchWdl(next, state, false);
+        if (state == PROBE_FAIL)
+            return SYZYGY_DRAW;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            if (value >= SYZYGY_WIN)
+            {
+                state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    bool noMoreMoves = moveCount && moveCount == total;
+    if (noMoreMoves)
+        value = bestValue;
+    else
+    {
+        value = ProbeFile(pos, false, SYZYGY_DRAW, state);
+        if (state == PROBE_FAIL)
+            return SYZYGY_DRAW;
+    }
+
+    if (bestValue >= value)
+    {
+        state = bestValue > SYZYGY_DRAW || noMoreMoves ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return bestValue;
+    }
+    state = PROBE_OK;
+    return value;
+}
+
+static int DtzBeforeZeroing(int wdl)
+{
+    return wdl == SYZYGY_WIN ? 1 : wdl == SYZYGY_CURSED_WIN ? 101 : wdl == SYZYGY_BLESSED_LOSS ? -101 : wdl == SYZYGY_LOSS ? -1 : 0;
+}
+
+static int Sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+static int SearchDtz(const Position &pos, ProbeState &state)
+{
+    state = PROBE_OK;
+    int wdl = SearchWdl(pos, state, true);
+    if (state == PROBE_FAIL || wdl == SYZYGY_DRAW)
+        return 0;
+    if (state == PROBE_ZEROING_BEST_MOVE)
+        return DtzBeforeZeroing(wdl);
+
+    int dtz = ProbeFile(pos, true, wdl, state);
+    if (state == PROBE_FAIL)
+        return 0;
+    if (state != PROBE_CHANGE_STM)
+        return (dtz + 100 * (wdl == SYZYGY_BLESSED_LOSS || wdl == SYZYGY_CURSED_WIN)) * Sign(wdl);
+
+    // The table holds the other side to move: take the best reply one ply down
+    Move moves[MAX_MOVES];
+    int count = GenerateLegalMoves(pos, moves);
+    int minDtz = 0xFFFF;
+    for (int i = 0; i < count; i++)
+    {
+        bool zeroing = IsCapture(pos, moves[i]) || abs(pos.board[MoveFrom(moves[i])]) == PAWN;
+        Position next = pos;
+        DoMove(next, moves[i]);
+
+        // For zeroing moves the sign comes from the position after the move
+        if (zeroing)
+        {
+            state = PROBE_OK;
+            dtz = -DtzBeforeZeroing(SearchWdl(next, state, false));
+        }
+        else
+            dtz = -SearchDtz(next, state);
+        if (state == PROBE_FAIL)
+            return 0;
+
+        Move replies[MAX_MOVES];
+        if (dtz == 1 && InCheck(next) && GenerateLegalMoves(next, replies) == 0)
+            minDtz = 1;
+        if (!zeroing)
+            dtz += Sign(dtz);
+        if (dtz < minDtz && Sign(dtz) == Sign(wdl))
+            minDtz = dtz;
+    }
+    return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+static bool CanProbe(const Position &pos)
+{
+    return pos.castling == 0 && PopCount(Occupied(pos)) <= syzygyPieceLimit;
+}
+
+bool ProbeSyzygyWdl(const Position &pos, int &wdl)
+{
+    if (!CanProbe(pos))
+        return false;
+    ProbeState state = PROBE_OK;
+    wdl = SearchWdl(pos, state, false);
+    return state != PROBE_FAIL;
+}
+
+bool ProbeSyzygyDtz(const Position &pos, int &dtz)
+{
+    if (!CanProbe(pos))
+        return false;
+    ProbeState state;
+    dtz = SearchDtz(pos, state);
+    return state != PROBE_FAIL;
+}
+
+// Root filtering
+
+// Certain wins rank highest; wins that run into the 50-move rule rank by how
+// close they stay to it, losses the other way round
+static bool RankByDtz(const Position &pos, const Move *moves, int count, bool hasRepeated, int *ranks)
+{
+    int halfmoves = pos.halfmoveClock;
+    for (int i = 0; i < count; i++)
+    {
+        Position next = pos;
+        DoMove(next, moves[i]);
+
+        ProbeState state = PROBE_OK;
+        int dtz;
+        if (next.halfmoveClock == 0)
+            dtz = DtzBeforeZeroing(-SearchWdl(next, state, false));
+        else if (next.halfmoveClock > 99)
+            dtz = 0;
+        else
+        {
+            dtz = -SearchDtz(next, state);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+
+        Move replies[MAX_MOVES];
+        if (dtz == 2 && InCheck(next) && GenerateLegalMoves(next, replies) == 0)
+            dtz = 1;
+        if (state == PROBE_FAIL)
+            return false;
+
+        ranks[i] = dtz > 0 ? (dtz + halfmoves <= 99 && !hasRepeated ? MAX_DTZ : MAX_DTZ - (dtz + halfmoves))
+                   : dtz < 0 ? (-dtz * 2 + halfmoves < 100 ? -MAX_DTZ : -MAX_DTZ + (-dtz + halfmoves))
+                             : 0;
+    }
+    return true;
+}
+
+static bool RankByWdl(const Position &pos, const Move *moves, int count, int *ranks)
+{
+    static const int wdlToRank[] = {-MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ};
+    for (int i = 0; i < count; i++)
+    {
+        Position next = pos;
+        DoMove(next, moves[i]);
+        ProbeState state = PROBE_OK;
+        int wdl = -SearchWdl(next, state, false);
+        if (state == PROBE_FAIL)
+            return false;
+        ranks[i] = wdlToRank[wdl + 2];
+    }
+    return true;
+}
+
+int FilterSyzygyRootMoves(const Position &pos, Move *moves, int count, bool hasRepeated, int &wdl)
+{
+    if (count == 0 || !CanProbe(pos))
+        return 0;
+
+    int ranks[MAX_MOVES] = {};
+    if (!RankByDtz(pos, moves, count, hasRepeated, ranks) && !RankByWdl(pos, moves, count, ranks))
+        return 0;
+
+    int best = *max_element(ranks, ranks + count);
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (ranks[i] == best)
+            moves[kept++] = moves[i];
+    }
+
+    const int bound = MAX_DTZ - 100;
+    wdl = best >= bound ? SYZYGY_WIN : best > 0 ? SYZYGY_CURSED_WIN : best == 0 ? SYZYGY_DRAW : best > -bound ? SYZYGY_BLESSED_LOSS : SYZYGY_LOSS;
+    return kept;
+}
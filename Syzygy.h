@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Position.h"
+
+// Probing of Syzygy endgame tablebases: .rtbw files hold win/draw/loss, .rtbz
+// files the distance to the next capture or pawn move (DTZ). Files are looked
+// up by name ("KRPvKR.rtbw") in the directories given to SetSyzygyPath and
+// memory-mapped the first time a position needs them. At most
+// SetSyzygyMappedLimit files stay mapped; the least recently used one is
+// released when another has to be mapped.
+//
+// Results are from the side to move. Cursed wins and blessed losses are
+// positions that are won or lost but drawn under the 50-move rule.
+
+enum SyzygyWdl
+{
+    SYZYGY_LOSS = -2,
+    SYZYGY_BLESSED_LOSS = -1,
+    SYZYGY_DRAW = 0,
+    SYZYGY_CURSED_WIN = 1,
+    SYZYGY_WIN = 2
+};
+
+#define SYZYGY_DEFAULT_MAPPED 64
+
+// Directories separated by ';' on Windows and ':' elsewhere
+void SetSyzygyPath(const char *paths);
+void SetSyzygyMappedLimit(int files);
+int SyzygyPieceLimit(); // Largest piece count among the tables found, 0 if none
+
+// Positions with castling rights or more pieces than the limit are not probed
+bool ProbeSyzygyWdl(const Position &pos, int &wdl);
+// Plies to the next zeroing move on the optimal path: positive when the side to
+// move wins, beyond 100 for cursed wins and blessed losses, 0 for draws
+bool ProbeSyzygyDtz(const Position &pos, int &dtz);
+
+// Keeps only the tablebase-optimal moves of a root move list, ranked by DTZ and
+// by WDL when the .rtbz file is missing. hasRepeated tells whether the root
+// position already occurred since the last zeroing move. Returns the number of
+// moves kept (0 when the position is not covered) and the root result in wdl.
+int FilterSyzygyRootMoves(const Position &pos, Move *moves, int count, bool hasRepeated, int &wdl);
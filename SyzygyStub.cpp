@@ -0,0 +1,31 @@
+#include "Syzygy.h"
+
+// Syzygy.h without any tables, for builds that leave out the GPL-licensed
+// decoder in Syzygy.cpp: no files are ever found, so every probe misses and
+// the callers fall back to our own tablebases and the search. Link either
+// this file or Syzygy.cpp, never both.
+
+void SetSyzygyPath(const char *) {}
+
+void SetSyzygyMappedLimit(int) {}
+
+int SyzygyPieceLimit()
+{
+    return 0;
+}
+
+bool ProbeSyzygyWdl(const Position &, int &)
+{
+    return false;
+}
+
+bool ProbeSyzygyDtz(const Position &, int &)
+{
+    return false;
+}
+
+int FilterSyzygyRootMoves(const Position &, Move *, int, bool, int &wdl)
+{
+    wdl = SYZYGY_DRAW;
+    return 0;
+}
@@ -0,0 +1,892 @@
+#include "Tablebase.h"
+#include "MappedFile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define TB_MAGIC "CHTB"
+#define TB_VERSION 1
+#define TB_DRAWN 254
+#define TB_INVALID 255
+#define TB_MAX_PLIES 252
+
+struct TablebaseFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    char name[16];
+    uint64_t sideSize;
+};
+
+struct LoadedTable
+{
+    TablebaseTable table;
+    MappedFile file;
+    vector<uint8_t> memory[2]; // Tables still being generated live here instead of in a mapping
+};
+
+typedef map<string, unique_ptr<LoadedTable>> TableSet;
+
+static const char pieceLetters[] = " PNBRQK";
+static const int pieceValues[7] = {0, 1, 3, 3, 5, 9, 0};
+
+// White king placement: [0] a1-d1-d4 triangle for pawnless tables, [1] files a-d with pawns
+static int8_t kingSlot[2][64];
+static int8_t slotSquare[2][32];
+
+static struct TablebaseTables
+{
+    TablebaseTables()
+    {
+        int slots[2] = {0, 0};
+        for (int sq = 0; sq < 64; sq++)
+        {
+            int row = SquareRow(sq), col = SquareCol(sq);
+            kingSlot[0][sq] = kingSlot[1][sq] = -1;
+            if (col <= 3 && 7 - row <= col)
+            {
+                slotSquare[0][slots[0]] = (int8_t)sq;
+                kingSlot[0][sq] = (int8_t)slots[0]++;
+            }
+            if (col <= 3)
+            {
+                slotSquare[1][slots[1]] = (int8_t)sq;
+                kingSlot[1][sq] = (int8_t)slots[1]++;
+            }
+        }
+    }
+} tablebaseTables;
+
+// The eight board symmetries; tables with pawns may only mirror files (t = 0, 1)
+static int TransformSquare(int sq, int t)
+{
+    int row = SquareRow(sq), col = SquareCol(sq);
+    if (t & 4)
+        swap(row, col);
+    if (t & 1)
+        col = 7 - col;
+    if (t & 2)
+        row = 7 - row;
+    return row * 8 + col;
+}
+
+static int SideStrength(const vector<int> &types)
+{
+    int strength = 0;
+    for (int type : types)
+        strength += pieceValues[type] * 16 + 1;
+    return strength;
+}
+
+static string SideName(const vector<int> &types)
+{
+    string name;
+    for (int type : types)
+        name += pieceLetters[type];
+    return name;
+}
+
+// Builds the signature with the stronger side as white; flipped tells whether colours were swapped
+static bool MakeSignature(vector<int> white, vector<int> black, TablebaseSignature &signature, bool &flipped)
+{
+    sort(white.rbegin(), white.rend());
+    sort(black.rbegin(), black.rend());
+    if (white.empty() || white[0] != KING || black.empty() || black[0] != KING ||
+        count(white.begin(), white.end(), KING) != 1 || count(black.begin(), black.end(), KING) != 1 ||
+        white.size() + black.size() > TB_MAX_PIECES)
+        return false;
+
+    int whiteStrength = SideStrength(white), blackStrength = SideStrength(black);
+    flipped = blackStrength > whiteStrength || (blackStrength == whiteStrength && SideName(black) > SideName(white));
+    if (flipped)
+        swap(white, black);
+
+    memset(&signature, 0, sizeof(signature));
+    snprintf(signature.name, sizeof(signature.name), "%sv%s", SideName(white).c_str(), SideName(black).c_str());
+    for (int type : white)
+        signature.pieces[signature.count++] = (int8_t)type;
+    for (int type : black)
+        signature.pieces[signature.count++] = (int8_t)-type;
+    for (int i = 0; i < signature.count; i++)
+        signature.hasPawns |= abs(signature.pieces[i]) == PAWN;
+    return true;
+}
+
+bool ParseTablebaseSignature(const char *name, TablebaseSignature &signature)
+{
+    vector<int> sides[2];
+    int side = 0;
+    for (const char *p = name; *p; p++)
+    {
+        if (*p == 'v' || *p == 'V')
+        {
+            side++;
+            continue;
+        }
+        const char *letter = strchr(pieceLetters + 1, *p);
+        if (!letter || side > 1)
+            return false;
+        sides[side].push_back((int)(letter - pieceLetters));
+    }
+    bool flipped;
+    return side == 1 && MakeSignature(sides[0], sides[1], signature, flipped);
+}
+
+static bool SignatureOf(const Position &pos, TablebaseSignature &signature, bool &flipped)
+{
+    vector<int> sides[2];
+    for (int color = 0; color < 2; color++)
+    {
+        for (int type = PAWN; type <= KING; type++)
+        {
+            for (int i = PopCount(pos.pieces[color][type]); i > 0; i--)
+                sides[color].push_back(type);
+        }
+    }
+    return MakeSignature(sides[0], sides[1], signature, flipped);
+}
+
+static uint64_t SideSize(const TablebaseSignature &signature)
+{
+    uint64_t size = signature.hasPawns ? 32 : 10;
+    for (int i = 1; i < signature.count; i++)
+        size *= 64;
+    return size;
+}
+
+// Smallest index over every symmetry that puts the white king in its region;
+// identical pieces are sorted so each position has exactly one index
+static uint64_t EncodeIndex(const TablebaseSignature &signature, const int *squares)
+{
+    uint64_t best = UINT64_MAX;
+    int transforms = signature.hasPawns ? 2 : 8;
+    int region = signature.hasPawns ? 1 : 0;
+
+    for (int t = 0; t < transforms; t++)
+    {
+        int king = TransformSquare(squares[0], t);
+        if (kingSlot[region][king] < 0)
+            continue;
+
+        int transformed[TB_MAX_PIECES];
+        for (int i = 0; i < signature.count; i++)
+            transformed[i] = TransformSquare(squares[i], t);
+        for (int i = 1; i < signature.count;)
+        {
+            int end = i;
+            while (end < signature.count && signature.pieces[end] == signature.pieces[i])
+                end++;
+            sort(transformed + i, transformed + end);
+            i = end;
+        }
+
+        uint64_t index = (uint64_t)kingSlot[region][king];
+        for (int i = 1; i < signature.count; i++)
+            index = index * 64 + (uint64_t)transformed[i];
+        best = min(best, index);
+    }
+    return best;
+}
+
+static void DecodeIndex(const TablebaseSignature &signature, uint64_t index, int *squares)
+{
+    for (int i = signature.count - 1; i > 0; i--)
+    {
+        squares[i] = (int)(index % 64);
+        index /= 64;
+    }
+    squares[0] = slotSquare[signature.hasPawns ? 1 : 0][index];
+}
+
+// A pawn that has just made a double push which can be taken en passant is stored
+// on its own back rank (row 7 for white, row 0 for black), where no pawn can stand
+static int FindEnPassantPawn(const TablebaseSignature &signature, const int *squares)
+{
+    for (int i = 0; i < signature.count; i++)
+    {
+        if (abs(signature.pieces[i]) == PAWN && (SquareRow(squares[i]) == 0 || SquareRow(squares[i]) == 7))
+            return i;
+    }
+    return -1;
+}
+
+static int RealSquare(int piece, int sq)
+{
+    if (abs(piece) == PAWN && SquareRow(sq) == 7)
+        return 4 * 8 + SquareCol(sq);
+    if (abs(piece) == PAWN && SquareRow(sq) == 0)
+        return 3 * 8 + SquareCol(sq);
+    return sq;
+}
+
+// Squares of the signature's pieces in a position, mirroring ranks when the colours are flipped
+static void GatherSquares(const Position &pos, const TablebaseSignature &signature, bool flipped, int *squares)
+{
+    int enPassantPawn = -1;
+    if (pos.enPassant >= 0)
+        enPassantPawn = pos.whiteToMove ? pos.enPassant + 8 : pos.enPassant - 8;
+
+    for (int i = 0; i < signature.count;)
+    {
+        int piece = flipped ? -signature.pieces[i] : signature.pieces[i];
+        Bitboard bits = pos.pieces[piece > 0 ? 0 : 1][abs(piece)];
+        while (bits)
+        {
+            int sq = PopLsb(bits);
+            int mapped = flipped ? (7 - SquareRow(sq)) * 8 + SquareCol(sq) : sq;
+            if (sq == enPassantPawn)
+                mapped = (signature.pieces[i] > 0 ? 7 : 0) * 8 + SquareCol(sq);
+            squares[i++] = mapped;
+        }
+    }
+}
+
+static void BuildPosition(const TablebaseSignature &signature, const int *squares, bool whiteToMove, Position &pos)
+{
+    int board[8][8] = {};
+    int enPassantRow = -1, enPassantCol = -1;
+    for (int i = 0; i < signature.count; i++)
+    {
+        int sq = RealSquare(signature.pieces[i], squares[i]);
+        board[SquareRow(sq)][SquareCol(sq)] = signature.pieces[i];
+        if (sq != squares[i])
+        {
+            enPassantRow = signature.pieces[i] > 0 ? 5 : 2;
+            enPassantCol = SquareCol(sq);
+        }
+    }
+    SetFromBoard(pos, board, whiteToMove, 0, enPassantRow, enPassantCol);
+}
+
+static bool SquaresValid(const TablebaseSignature &signature, const int *squares)
+{
+    Bitboard seen = 0, whitePawns = 0, blackPawns = 0;
+    int enPassantPawns = 0;
+    for (int i = 0; i < signature.count; i++)
+    {
+        int piece = signature.pieces[i];
+        int row = SquareRow(squares[i]);
+        if (abs(piece) == PAWN)
+        {
+            if ((piece > 0 && row == 0) || (piece < 0 && row == 7))
+                return false;
+            if (row == 0 || row == 7)
+                enPassantPawns++;
+        }
+
+        int sq = RealSquare(piece, squares[i]);
+        if (seen & SquareBit(sq))
+            return false;
+        seen |= SquareBit(sq);
+        if (piece == PAWN)
+            whitePawns |= SquareBit(sq);
+        if (piece == -PAWN)
+            blackPawns |= SquareBit(sq);
+    }
+    if (enPassantPawns > 1)
+        return false;
+
+    int pawn = FindEnPassantPawn(signature, squares);
+    if (pawn >= 0)
+    {
+        // The squares it passed must be empty and an enemy pawn must stand beside it
+        bool white = signature.pieces[pawn] > 0;
+        int sq = RealSquare(signature.pieces[pawn], squares[pawn]);
+        int back = white ? 8 : -8;
+        Bitboard beside = (SquareCol(sq) > 0 ? SquareBit(sq - 1) : 0) | (SquareCol(sq) < 7 ? SquareBit(sq + 1) : 0);
+        if ((seen & (SquareBit(sq + back) | SquareBit(sq + 2 * back))) || !(beside & (white ? blackPawns : whitePawns)))
+            return false;
+    }
+    return true;
+}
+
+static uint8_t ReadValue(const TablebaseTable &table, const Position &pos, bool flipped)
+{
+    int squares[TB_MAX_PIECES];
+    GatherSquares(pos, table.signature, flipped, squares);
+    bool whiteToMove = flipped ? !pos.whiteToMove : pos.whiteToMove;
+    return table.data[whiteToMove ? 0 : 1][EncodeIndex(table.signature, squares)];
+}
+
+static bool ValueToResult(uint8_t value, TablebaseResult &result)
+{
+    if (value == TB_INVALID)
+        return false;
+    if (value == 0 || value == TB_DRAWN)
+    {
+        result = {0, 0};
+        return true;
+    }
+    int plies = value - 1;
+    result = {plies % 2 == 1 ? 1 : -1, plies};
+    return true;
+}
+
+static bool LoadTable(const string &path, LoadedTable &loaded)
+{
+    if (!MapFile(loaded.file, path.c_str()))
+        return false;
+
+    const TablebaseFileHeader *header = (const TablebaseFileHeader *)loaded.file.data;
+    if (loaded.file.size < sizeof(TablebaseFileHeader) || memcmp(header->magic, TB_MAGIC, 4) != 0 ||
+        header->version != TB_VERSION || !ParseTablebaseSignature(header->name, loaded.table.signature) ||
+        header->sideSize != SideSize(loaded.table.signature) ||
+        loaded.file.size != sizeof(TablebaseFileHeader) + 2 * header->sideSize)
+    {
+        UnmapFile(loaded.file);
+        return false;
+    }
+
+    loaded.table.sideSize = header->sideSize;
+    loaded.table.data[0] = loaded.file.data + sizeof(TablebaseFileHeader);
+    loaded.table.data[1] = loaded.table.data[0] + header->sideSize;
+    return true;
+}
+
+static string TablePath(const string &directory, const char *name)
+{
+    return (directory.empty() ? string(".") : directory) + "/" + name + ".ctb";
+}
+
+// Probing
+
+#define PROBE_SLOTS 1024 // Power of two, well above the number of tables up to 5 pieces
+
+// Tables looked up so far, published for probes that take no lock: a slot's
+// table (null when it is not on disk) is written before its key, and neither
+// changes until SetTablebasePath starts over
+struct ProbeSlot
+{
+    atomic<uint64_t> key{0}; // SignatureKey, 0 = free
+    atomic<const TablebaseTable *> table{nullptr};
+};
+
+static string tablebasePath;
+static mutex tablebaseMutex; // Loading only
+static TableSet probeTables;  // Owns the loaded tables; null entries remember tables that are not on disk
+static ProbeSlot probeSlots[PROBE_SLOTS];
+static int pieceLimit = 0;
+
+// 4 bits per piece of the signature, never 0
+static uint64_t SignatureKey(const TablebaseSignature &signature)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < signature.count; i++)
+        key |= (uint64_t)(signature.pieces[i] + 8) << (4 * i);
+    return key;
+}
+
+static ProbeSlot &FindProbeSlot(uint64_t key)
+{
+    size_t index = (size_t)(key * 0x9E3779B97F4A7C15ULL >> 54) & (PROBE_SLOTS - 1);
+    while (true)
+    {
+        ProbeSlot &slot = probeSlots[index];
+        uint64_t slotKey = slot.key.load(memory_order_acquire);
+        if (slotKey == key || slotKey == 0)
+            return slot;
+        index = (index + 1) & (PROBE_SLOTS - 1);
+    }
+}
+
+void SetTablebasePath(const char *directory)
+{
+    lock_guard<mutex> lock(tablebaseMutex);
+    for (auto &slot : probeSlots)
+    {
+        slot.key.store(0, memory_order_relaxed);
+        slot.table.store(nullptr, memory_order_relaxed);
+    }
+    probeTables.clear();
+    tablebasePath = directory ? directory : "";
+    pieceLimit = 0;
+
+    error_code error;
+    for (auto &entry : filesystem::directory_iterator(tablebasePath.empty() ? "." : tablebasePath, error))
+    {
+        if (entry.path().extension() != ".ctb")
+            continue;
+        TablebaseSignature signature;
+        if (ParseTablebaseSignature(entry.path().stem().string().c_str(), signature))
+            pieceLimit = max(pieceLimit, signature.count);
+    }
+}
+
+int TablebasePieceLimit()
+{
+    return pieceLimit;
+}
+
+// Lock-free once a table has been looked up; the first probe of a table maps it under the lock
+static const TablebaseTable *FindProbeTable(const TablebaseSignature &signature)
+{
+    uint64_t key = SignatureKey(signature);
+    ProbeSlot &published = FindProbeSlot(key);
+    if (published.key.load(memory_order_acquire) == key)
+        return published.table.load(memory_order_relaxed);
+
+    lock_guard<mutex> lock(tablebaseMutex);
+    ProbeSlot &slot = FindProbeSlot(key);
+    if (slot.key.load(memory_order_relaxed) == key)
+        return slot.table.load(memory_order_relaxed);
+
+    unique_ptr<LoadedTable> loaded(new LoadedTable());
+    if (!LoadTable(TablePath(tablebasePath, signature.name), *loaded))
+        loaded.reset();
+    const TablebaseTable *table = loaded ? &loaded->table : nullptr;
+    probeTables[signature.name] = move(loaded);
+
+    slot.table.store(table, memory_order_relaxed);
+    slot.key.store(key, memory_order_release);
+    return table;
+}
+
+bool ProbeTablebase(const Position &pos, TablebaseResult &result)
+{
+    if (pos.castling != 0 || PopCount(Occupied(pos)) > pieceLimit)
+        return false;
+
+    TablebaseSignature signature;
+    bool flipped;
+    if (!SignatureOf(pos, signature, flipped))
+        return false;
+    if (signature.count == 2)
+    {
+        result = {0, 0};
+        return true;
+    }
+
+    const TablebaseTable *table = FindProbeTable(signature);
+    return table && ValueToResult(ReadValue(*table, pos, flipped), result);
+}
+
+// Generation
+
+static void ParallelFor(uint64_t size, int threads, const function<void(uint64_t, uint64_t)> &work)
+{
+    const uint64_t chunk = 4096;
+    atomic<uint64_t> next(0);
+    auto worker = [&]()
+    {
+        for (uint64_t begin; (begin = next.fetch_add(chunk)) < size;)
+            work(begin, min(begin + chunk, size));
+    };
+
+    vector<thread> pool;
+    for (int i = 1; i < threads; i++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+        t.join();
+}
+
+static void AtomicMax(atomic<int> &target, int value)
+{
+    int current = target.load();
+    while (value > current && !target.compare_exchange_weak(current, value))
+    {
+    }
+}
+
+static bool SetIfUnknown(uint8_t *value, uint8_t desired)
+{
+    uint8_t expected = 0;
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static void AddUnique(uint64_t *list, int &count, uint64_t value)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (list[i] == value)
+            return;
+    }
+    list[count++] = value;
+}
+
+// Positions that reach this one with a quiet move by the side not to move. Captures and
+// promotions change the material, so they never lead back into the same table.
+static int GeneratePredecessors(const TablebaseSignature &signature, const int *squares, bool whiteToMove, uint64_t *out)
+{
+    int previous[TB_MAX_PIECES];
+    memcpy(previous, squares, sizeof(previous));
+
+    // After a capturable double push the only way in is that push
+    int enPassantPawn = FindEnPassantPawn(signature, squares);
+    if (enPassantPawn >= 0)
+    {
+        previous[enPassantPawn] = (signature.pieces[enPassantPawn] > 0 ? 6 : 1) * 8 + SquareCol(squares[enPassantPawn]);
+        out[0] = EncodeIndex(signature, previous);
+        return 1;
+    }
+
+    Bitboard occupied = 0, whitePawns = 0, blackPawns = 0;
+    for (int i = 0; i < signature.count; i++)
+    {
+        occupied |= SquareBit(squares[i]);
+        if (signature.pieces[i] == PAWN)
+            whitePawns |= SquareBit(squares[i]);
+        if (signature.pieces[i] == -PAWN)
+            blackPawns |= SquareBit(squares[i]);
+    }
+
+    int count = 0;
+    bool moverIsWhite = !whiteToMove;
+    for (int i = 0; i < signature.count; i++)
+    {
+        int piece = signature.pieces[i];
+        if ((piece > 0) != moverIsWhite)
+            continue;
+
+        int sq = squares[i];
+        Bitboard from = 0;
+        switch (abs(piece))
+        {
+        case PAWN:
+        {
+            int back = moverIsWhite ? 8 : -8;
+            int row = SquareRow(sq);
+            bool canStepBack = moverIsWhite ? row <= 5 : row >= 2;
+            if (canStepBack && !(occupied & SquareBit(sq + back)))
+            {
+                from |= SquareBit(sq + back);
+
+                // A double push next to an enemy pawn would have left an en passant right behind
+                Bitboard beside = (SquareCol(sq) > 0 ? SquareBit(sq - 1) : 0) | (SquareCol(sq) < 7 ? SquareBit(sq + 1) : 0);
+                if (row == (moverIsWhite ? 4 : 3) && !(occupied & SquareBit(sq + 2 * back)) &&
+                    !(beside & (moverIsWhite ? blackPawns : whitePawns)))
+                    from |= SquareBit(sq + 2 * back);
+            }
+            break;
+        }
+        case KNIGHT:
+            from = KnightAttacks(sq);
+            break;
+        case BISHOP:
+            from = BishopAttacks(sq, occupied);
+            break;
+        case ROOK:
+            from = RookAttacks(sq, occupied);
+            break;
+        case QUEEN:
+            from = BishopAttacks(sq, occupied) | RookAttacks(sq, occupied);
+            break;
+        case KING:
+            from = KingAttacks(sq);
+            break;
+        }
+        from &= ~occupied;
+
+        while (from)
+        {
+            previous[i] = PopLsb(from);
+            AddUnique(out, count, EncodeIndex(signature, previous));
+
+            // The earlier position may also have let the mover take a just-pushed pawn en passant
+            for (int j = 0; j < signature.count; j++)
+            {
+                int saved = previous[j];
+                if (signature.pieces[j] != (moverIsWhite ? -PAWN : PAWN) || SquareRow(saved) != (moverIsWhite ? 3 : 4))
+                    continue;
+                previous[j] = (moverIsWhite ? 0 : 7) * 8 + SquareCol(saved);
+                if (SquaresValid(signature, previous))
+                    AddUnique(out, count, EncodeIndex(signature, previous));
+                previous[j] = saved;
+            }
+        }
+        previous[i] = sq;
+    }
+    return count;
+}
+
+static void CollectDependencies(const TablebaseSignature &signature, vector<string> &names)
+{
+    vector<int> sides[2];
+    for (int i = 0; i < signature.count; i++)
+        sides[signature.pieces[i] > 0 ? 0 : 1].push_back(abs(signature.pieces[i]));
+
+    auto add = [&](const vector<int> &white, const vector<int> &black)
+    {
+        TablebaseSignature dependency;
+        bool flipped;
+        if (white.size() + black.size() > 2 && MakeSignature(white, black, dependency, flipped) &&
+            find(names.begin(), names.end(), dependency.name) == names.end())
+            names.push_back(dependency.name);
+    };
+
+    for (int side = 0; side < 2; side++)
+    {
+        for (size_t i = 1; i < sides[side].size(); i++)
+        {
+            // Captures
+            vector<int> captured[2] = {sides[0], sides[1]};
+            captured[side].erase(captured[side].begin() + i);
+            add(captured[0], captured[1]);
+
+            if (sides[side][i] != PAWN)
+                continue;
+
+            // Promotions, with or without a capture
+            for (int promotion = KNIGHT; promotion <= QUEEN; promotion++)
+            {
+                vector<int> promoted[2] = {sides[0], sides[1]};
+                promoted[side][i] = promotion;
+                add(promoted[0], promoted[1]);
+
+                for (size_t j = 1; j < sides[side ^ 1].size(); j++)
+                {
+                    vector<int> both[2] = {promoted[0], promoted[1]};
+                    both[side ^ 1].erase(both[side ^ 1].begin() + j);
+                    add(both[0], both[1]);
+                }
+            }
+        }
+    }
+}
+
+static uint8_t LookupGenerated(const TableSet &tables, const Position &pos)
+{
+    TablebaseSignature signature;
+    bool flipped;
+    if (!SignatureOf(pos, signature, flipped) || signature.count == 2)
+        return TB_DRAWN;
+    auto found = tables.find(signature.name);
+    if (found == tables.end())
+        return TB_DRAWN;
+    return ReadValue(found->second->table, pos, flipped);
+}
+
+static void BuildTable(const TablebaseSignature &signature, LoadedTable &loaded, const TableSet &tables, int threads)
+{
+    uint64_t size = SideSize(signature);
+    vector<uint8_t> counters[2], exits[2];
+    for (int side = 0; side < 2; side++)
+    {
+        loaded.memory[side].assign(size, 0);
+        counters[side].assign(size, 0);
+        exits[side].assign(size, 0);
+    }
+    loaded.table.signature = signature;
+    loaded.table.sideSize = size;
+    loaded.table.data[0] = loaded.memory[0].data();
+    loaded.table.data[1] = loaded.memory[1].data();
+    uint8_t *values[2] = {loaded.memory[0].data(), loaded.memory[1].data()};
+
+    // exits: best result through moves that leave the table (captures, promotions):
+    // odd = win in that many plies, even = loss in at least that many, TB_DRAWN = draw
+    atomic<int> maxPlies(0);
+    ParallelFor(size, threads, [&](uint64_t begin, uint64_t end)
+                {
+        for (uint64_t index = begin; index < end; index++)
+        {
+            int squares[TB_MAX_PIECES];
+            DecodeIndex(signature, index, squares);
+            bool valid = SquaresValid(signature, squares) && EncodeIndex(signature, squares) == index;
+
+            for (int side = 0; side < 2; side++)
+            {
+                if (!valid)
+                {
+                    values[side][index] = TB_INVALID;
+                    continue;
+                }
+
+                int enPassantPawn = FindEnPassantPawn(signature, squares);
+                if (enPassantPawn >= 0 && (signature.pieces[enPassantPawn] > 0) == (side == 0))
+                {
+                    values[side][index] = TB_INVALID;
+                    continue;
+                }
+
+                Position pos;
+                BuildPosition(signature, squares, side == 0, pos);
+                if (IsSquareAttacked(pos, KingSquare(pos, !pos.whiteToMove), pos.whiteToMove))
+                {
+                    values[side][index] = TB_INVALID;
+                    continue;
+                }
+
+                Move moves[MAX_MOVES];
+                int count = GenerateLegalMoves(pos, moves);
+                if (count == 0)
+                {
+                    values[side][index] = InCheck(pos) ? 1 : TB_DRAWN;
+                    continue;
+                }
+
+                uint64_t successors[MAX_MOVES];
+                int successorCount = 0;
+                int winPlies = TB_INVALID, lossPlies = 0;
+                bool drawExit = false;
+                for (int i = 0; i < count; i++)
+                {
+                    Position next = pos;
+                    DoMove(next, moves[i]);
+                    if (IsCapture(pos, moves[i]) || MovePromotion(moves[i]))
+                    {
+                        TablebaseResult result;
+                        if (!ValueToResult(LookupGenerated(tables, next), result) || result.wdl == 0)
+                            drawExit = true;
+                        else if (result.wdl < 0)
+                            winPlies = min(winPlies, result.plies + 1);
+                        else
+                            lossPlies = max(lossPlies, result.plies + 1);
+                        continue;
+                    }
+
+                    int nextSquares[TB_MAX_PIECES];
+                    GatherSquares(next, signature, false, nextSquares);
+                    AddUnique(successors, successorCount, EncodeIndex(signature, nextSquares));
+                }
+
+                uint8_t exit = winPlies != TB_INVALID ? (uint8_t)winPlies : drawExit ? TB_DRAWN : (uint8_t)lossPlies;
+                exits[side][index] = exit;
+                counters[side][index] = (uint8_t)successorCount;
+                if (exit != TB_DRAWN)
+                    AtomicMax(maxPlies, exit);
+
+                if (successorCount == 0)
+                    values[side][index] = exit == TB_DRAWN ? TB_DRAWN : (uint8_t)(exit + 1);
+            }
+        } });
+
+    // Level by level: positions lost in d-1 plies make their predecessors wins in d,
+    // positions won in d-1 plies count down the remaining moves of their predecessors
+    for (int d = 1; d <= TB_MAX_PLIES; d++)
+    {
+        atomic<bool> changed(false);
+        ParallelFor(size, threads, [&](uint64_t begin, uint64_t end)
+                    {
+            uint64_t predecessors[256];
+            for (uint64_t index = begin; index < end; index++)
+            {
+                for (int side = 0; side < 2; side++)
+                {
+                    uint8_t value = values[side][index];
+                    int other = side ^ 1;
+
+                    if (value == 0 && d % 2 == 1 && exits[side][index] == d)
+                    {
+                        if (SetIfUnknown(&values[side][index], (uint8_t)(d + 1)))
+                            changed = true;
+                        continue;
+                    }
+                    if (value != d)
+                        continue;
+
+                    int squares[TB_MAX_PIECES];
+                    DecodeIndex(signature, index, squares);
+                    int count = GeneratePredecessors(signature, squares, side == 0, predecessors);
+
+                    for (int i = 0; i < count; i++)
+                    {
+                        uint8_t *target = &values[other][predecessors[i]];
+                        if (__atomic_load_n(target, __ATOMIC_RELAXED) != 0)
+                            continue;
+
+                        if ((d - 1) % 2 == 0)
+                        {
+                            // Predecessor can move into a lost position
+                            if (SetIfUnknown(target, (uint8_t)(d + 1)))
+                            {
+                                changed = true;
+                                AtomicMax(maxPlies, d);
+                            }
+                        }
+                        else if (__atomic_sub_fetch(&counters[other][predecessors[i]], 1, __ATOMIC_RELAXED) == 0)
+                        {
+                            uint8_t exit = exits[other][predecessors[i]];
+                            if (exit % 2 == 1 && exit != TB_DRAWN)
+                                continue; // Wins later through a capture or promotion
+                            int plies = exit == TB_DRAWN ? -1 : max(d, (int)exit);
+                            if (SetIfUnknown(target, plies < 0 ? TB_DRAWN : (uint8_t)(plies + 1)))
+                            {
+                                changed = true;
+                                AtomicMax(maxPlies, plies);
+                            }
+                        }
+                    }
+                }
+            } });
+
+        if (!changed && d > maxPlies + 1)
+            break;
+    }
+}
+
+static bool WriteTable(const LoadedTable &loaded, const string &path)
+{
+    TablebaseFileHeader header = {};
+    memcpy(header.magic, TB_MAGIC, 4);
+    header.version = TB_VERSION;
+    memcpy(header.name, loaded.table.signature.name, sizeof(header.name));
+    header.sideSize = loaded.table.sideSize;
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int side = 0; side < 2 && ok; side++)
+        ok = fwrite(loaded.table.data[side], 1, loaded.table.sideSize, file) == loaded.table.sideSize;
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+static bool GenerateWithDependencies(const TablebaseSignature &signature, const string &directory, int threads, TableSet &tables)
+{
+    if (tables.count(signature.name))
+        return true;
+
+    unique_ptr<LoadedTable> loaded(new LoadedTable());
+    string path = TablePath(directory, signature.name);
+    if (LoadTable(path, *loaded))
+    {
+        tables[signature.name] = move(loaded);
+        return true;
+    }
+
+    vector<string> dependencies;
+    CollectDependencies(signature, dependencies);
+    for (auto &name : dependencies)
+    {
+        TablebaseSignature dependency;
+        if (!ParseTablebaseSignature(name.c_str(), dependency) || !GenerateWithDependencies(dependency, directory, threads, tables))
+            return false;
+    }
+
+    printf("Generating %s (%llu positions per side)...\n", signature.name, (unsigned long long)SideSize(signature));
+    BuildTable(signature, *loaded, tables, threads);
+    if (!WriteTable(*loaded, path))
+    {
+        printf("Could not write %s\n", path.c_str());
+        return false;
+    }
+    tables[signature.name] = move(loaded);
+    return true;
+}
+
+bool GenerateTablebase(const char *name, const char *directory, int threads)
+{
+    TablebaseSignature signature;
+    if (!ParseTablebaseSignature(name, signature) || signature.count < 3)
+        return false;
+
+    error_code error;
+    if (directory && *directory)
+        filesystem::create_directories(directory, error);
+
+    TableSet tables;
+    return GenerateWithDependencies(signature, directory ? directory : "", max(threads, 1), tables);
+}
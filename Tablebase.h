@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Position.h"
+#include <stdint.h>
+
+// Endgame tablebases for up to 5 pieces, built offline by retrograde analysis
+// (gentb) and probed through memory-mapped .ctb files.
+//
+// A table covers one material signature such as "KQvK" with the stronger side
+// as white; the other colour is probed by mirroring the board. Positions are
+// indexed with the white king folded into a 10-square triangle (or files a-d
+// when pawns are on the board) and every other piece on 64 squares, one byte
+// per position and side to move:
+//   0      draw
+//   1-253  distance to mate in plies + 1 (odd plies: side to move mates,
+//          even plies: side to move gets mated)
+//   254    draw
+//   255    illegal or redundant index
+// Castling rights are never part of a table. A pawn that can be taken en
+// passant is indexed on its own back rank, so those positions are exact too.
+
+#define TB_MAX_PIECES 5
+
+struct TablebaseSignature
+{
+    char name[16];
+    int count;
+    int8_t pieces[TB_MAX_PIECES]; // Index order: white king, white pieces by type, black king, black pieces
+    bool hasPawns;
+};
+
+struct TablebaseTable
+{
+    TablebaseSignature signature;
+    uint64_t sideSize;       // Positions per side to move
+    const uint8_t *data[2];  // [0 white to move / 1 black to move]
+};
+
+struct TablebaseResult
+{
+    int wdl;   // From the side to move: 1 win, 0 draw, -1 loss
+    int plies; // Distance to mate in plies, 0 for draws
+};
+
+bool ParseTablebaseSignature(const char *name, TablebaseSignature &signature);
+
+// Directory holding the .ctb files; tables are mapped lazily on first probe
+void SetTablebasePath(const char *directory);
+int TablebasePieceLimit(); // Largest piece count among the tables found, 0 if none
+bool ProbeTablebase(const Position &pos, TablebaseResult &result);
+
+// Generates the table and every smaller table it converts into, writing
+// <directory>/<name>.ctb for each. Tables that already exist are reused.
+bool GenerateTablebase(const char *name, const char *directory, int threads);
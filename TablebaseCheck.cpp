@@ -0,0 +1,148 @@
+#include "Syzygy.h"
+#include "Tablebase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Usage: tbcheck [-syzygy dir] [-tb dir] [-positions N] [-seed N] KRvK KPvK ...
+//
+// Checks Syzygy probing against our own distance-to-mate tables (gentb) on
+// random legal positions of each ending:
+//   - win/draw/loss must agree (cursed wins and blessed losses count as the
+//     win or loss they are without the 50-move rule)
+//   - DTZ must have the sign of the result
+//   - where the defending side has a bare king and there are no pawns, no
+//     zeroing move happens on the way to mate, so DTZ must be the distance
+//     to mate, give or take the one ply the format may round by
+// Prints the first mismatches with their FEN; exits with 1 if there were any.
+
+#define DEFAULT_POSITIONS 1000000
+#define SHOW_MISMATCHES 10
+
+static uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Random legal placement of the signature's pieces, either colour to move
+static void RandomPosition(const TablebaseSignature &signature, uint64_t &random, Position &pos)
+{
+    while (true)
+    {
+        int board[8][8] = {};
+        bool ok = true;
+        for (int i = 0; i < signature.count && ok; i++)
+        {
+            int sq = (int)(SplitMix64(random) & 63);
+            int row = SquareRow(sq), col = SquareCol(sq);
+            ok = board[row][col] == 0 && !(abs(signature.pieces[i]) == PAWN && (row == 0 || row == 7));
+            board[row][col] = signature.pieces[i];
+        }
+        if (!ok)
+            continue;
+        SetFromBoard(pos, board, SplitMix64(random) & 1, 0, -1, -1);
+        // The side that just moved can't be left in check
+        if (!IsSquareAttacked(pos, KingSquare(pos, !pos.whiteToMove), pos.whiteToMove))
+            return;
+    }
+}
+
+static int Sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+static bool CheckEnding(const char *name, uint64_t positions, uint64_t &random)
+{
+    TablebaseSignature signature;
+    if (!ParseTablebaseSignature(name, signature))
+    {
+        printf("%s: not an ending\n", name);
+        return false;
+    }
+    bool bareKing = !signature.hasPawns && signature.pieces[signature.count - 1] == -KING;
+
+    uint64_t compared = 0, dtzCompared = 0, mismatches = 0, missing = 0;
+    for (uint64_t n = 0; n < positions; n++)
+    {
+        Position pos;
+        RandomPosition(signature, random, pos);
+        TablebaseResult own;
+        int wdl, dtz;
+        if (!ProbeTablebase(pos, own) || !ProbeSyzygyWdl(pos, wdl))
+        {
+            missing++;
+            continue;
+        }
+        compared++;
+
+        const char *problem = nullptr;
+        bool hasDtz = ProbeSyzygyDtz(pos, dtz);
+        if (Sign(wdl) != own.wdl)
+            problem = "win/draw/loss";
+        else if (hasDtz && Sign(dtz) != Sign(wdl))
+            problem = "DTZ sign";
+        else if (hasDtz && bareKing && abs(wdl) == 2)
+        {
+            dtzCompared++;
+            if (abs(abs(dtz) - own.plies) > 1)
+                problem = "DTZ against distance to mate";
+        }
+        if (!problem)
+            continue;
+        if (mismatches++ < SHOW_MISMATCHES)
+            printf("%s: %s differs: syzygy wdl %d dtz %d, own %d in %d plies: %s\n", name, problem, wdl,
+                   hasDtz ? dtz : 0, own.wdl, own.plies, GetFen(pos).c_str());
+    }
+
+    printf("%s: %llu positions compared (%llu for DTZ against mate distance), %llu mismatches", name,
+           (unsigned long long)compared, (unsigned long long)dtzCompared, (unsigned long long)mismatches);
+    if (missing)
+        printf(", %llu not probed (missing table?)", (unsigned long long)missing);
+    printf("\n");
+    return compared > 0 && mismatches == 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *syzygyPath = "syzygy", *tablebasePath = "tablebases";
+    uint64_t positions = DEFAULT_POSITIONS, random = 1;
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-syzygy") == 0)
+            syzygyPath = argv[first + 1];
+        else if (strcmp(argv[first], "-tb") == 0)
+            tablebasePath = argv[first + 1];
+        else if (strcmp(argv[first], "-positions") == 0)
+            positions = strtoull(argv[first + 1], nullptr, 10);
+        else if (strcmp(argv[first], "-seed") == 0)
+            random = strtoull(argv[first + 1], nullptr, 10);
+        else
+            printf("Unknown option %s\n", argv[first]);
+        first += 2;
+    }
+
+    if (first >= argc)
+    {
+        printf("Usage: %s [-syzygy dir] [-tb dir] [-positions N] [-seed N] KRvK KPvK ...\n", argv[0]);
+        return 1;
+    }
+
+    SetSyzygyPath(syzygyPath);
+    SetTablebasePath(tablebasePath);
+    if (SyzygyPieceLimit() == 0 || TablebasePieceLimit() == 0)
+    {
+        printf("Need Syzygy files in %s and gentb tables in %s\n", syzygyPath, tablebasePath);
+        return 1;
+    }
+
+    bool ok = true;
+    for (int i = first; i < argc; i++)
+        ok &= CheckEnding(argv[i], positions, random);
+    return ok ? 0 : 1;
+}
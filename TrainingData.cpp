@@ -0,0 +1,162 @@
+#include "TrainingData.h"
+#include <stdlib.h>
+#include <string.h>
+
+void PackPosition(const Position &pos, int score, PackedPosition &packed)
+{
+    memset(&packed, 0, sizeof(packed));
+    packed.occupied = Occupied(pos);
+    Bitboard occupied = packed.occupied;
+    for (int i = 0; occupied; i++)
+    {
+        int piece = pos.board[PopLsb(occupied)];
+        int code = abs(piece) | (piece < 0 ? 8 : 0);
+        packed.pieces[i / 2] |= (uint8_t)(code << (i % 2 * 4));
+    }
+    score = score > 32767 ? 32767 : score < -32767 ? -32767 : score;
+    packed.score = (int16_t)(pos.whiteToMove ? score : -score);
+    packed.sideAndEp = (uint8_t)((pos.whiteToMove ? 0 : 0x80) | (pos.enPassant >= 0 ? pos.enPassant : 64));
+    packed.castling = pos.castling;
+    packed.halfmoveClock = pos.halfmoveClock;
+    packed.fullmoveNumber = pos.fullmoveNumber;
+}
+
+bool UnpackPosition(const PackedPosition &packed, Position &pos)
+{
+    if (PopCount(packed.occupied) > 32 || packed.castling > 15 || (packed.sideAndEp & 0x7F) > 64)
+        return false;
+
+    memset(&pos, 0, sizeof(pos));
+    Bitboard occupied = packed.occupied;
+    for (int i = 0; occupied; i++)
+    {
+        int sq = PopLsb(occupied);
+        int code = (packed.pieces[i / 2] >> (i % 2 * 4)) & 15;
+        int type = code & 7, color = code >> 3;
+        if (type < PAWN || type > KING)
+            return false;
+        pos.board[sq] = (int8_t)(color ? -type : type);
+        pos.pieces[color][0] |= SquareBit(sq);
+        pos.pieces[color][type] |= SquareBit(sq);
+    }
+    if (PopCount(pos.pieces[0][KING]) != 1 || PopCount(pos.pieces[1][KING]) != 1)
+        return false;
+
+    int ep = packed.sideAndEp & 0x7F;
+    pos.whiteToMove = !(packed.sideAndEp & 0x80);
+    pos.enPassant = (int8_t)(ep < 64 ? ep : -1);
+    pos.castling = packed.castling;
+    pos.halfmoveClock = packed.halfmoveClock;
+    pos.fullmoveNumber = packed.fullmoveNumber;
+    pos.key = ComputeKey(pos);
+    return true;
+}
+
+int ResultHalfPoints(GameResult result)
+{
+    switch (result)
+    {
+    case RESULT_WHITE_WINS:
+        return 2;
+    case RESULT_DRAW:
+        return 1;
+    case RESULT_BLACK_WINS:
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+bool OpenTrainingWriter(TrainingWriter &writer, const char *path)
+{
+    CloseTrainingWriter(writer);
+    writer.file = fopen(path, "ab");
+    if (!writer.file)
+        return false;
+
+    // "ab" starts at the end: an empty file is a new one
+    fseek(writer.file, 0, SEEK_END);
+    if (ftell(writer.file) == 0)
+    {
+        TrainingHeader header = {};
+        memcpy(header.magic, TRAINING_MAGIC, 4);
+        header.version = TRAINING_VERSION;
+        header.recordSize = sizeof(PackedPosition);
+        if (fwrite(&header, sizeof(header), 1, writer.file) != 1)
+        {
+            CloseTrainingWriter(writer);
+            return false;
+        }
+    }
+    return true;
+}
+
+void CloseTrainingWriter(TrainingWriter &writer)
+{
+    if (writer.file)
+        fclose(writer.file);
+    writer.file = nullptr;
+}
+
+bool WriteTrainingGame(TrainingWriter &writer, PackedPosition *positions, size_t count, GameResult result)
+{
+    int points = ResultHalfPoints(result);
+    if (!writer.file || points < 0)
+        return false;
+    for (size_t i = 0; i < count; i++)
+        positions[i].result = (uint8_t)points;
+    if (fwrite(positions, sizeof(PackedPosition), count, writer.file) != count)
+        return false;
+    writer.written += count;
+    return true;
+}
+
+bool OpenTrainingReader(TrainingReader &reader, const char *path, int shard, int shardCount)
+{
+    CloseTrainingReader(reader);
+    if (!MapFile(reader.file, path))
+        return false;
+
+    const TrainingHeader *header = (const TrainingHeader *)reader.file.data;
+    if (reader.file.size < sizeof(TrainingHeader) || memcmp(header->magic, TRAINING_MAGIC, 4) != 0 ||
+        header->version != TRAINING_VERSION || header->recordSize != sizeof(PackedPosition) || shard < 0 ||
+        shard >= shardCount)
+    {
+        CloseTrainingReader(reader);
+        return false;
+    }
+
+    // A record cut short by a writer that was stopped is left out
+    uint64_t total = (reader.file.size - sizeof(TrainingHeader)) / sizeof(PackedPosition);
+    reader.records = (const PackedPosition *)(reader.file.data + sizeof(TrainingHeader));
+    reader.first = total * shard / shardCount;
+    reader.last = total * (shard + 1) / shardCount;
+    reader.next = reader.first;
+    return true;
+}
+
+void CloseTrainingReader(TrainingReader &reader)
+{
+    UnmapFile(reader.file);
+    reader.records = nullptr;
+    reader.first = reader.last = reader.next = 0;
+}
+
+uint64_t TrainingRecordCount(const TrainingReader &reader)
+{
+    return reader.last - reader.first;
+}
+
+bool ReadTrainingPosition(TrainingReader &reader, Position &pos, int &score, int &result)
+{
+    while (reader.next < reader.last)
+    {
+        const PackedPosition &packed = reader.records[reader.next++];
+        if (packed.result > 2 || !UnpackPosition(packed, pos))
+            continue;
+        score = packed.score;
+        result = packed.result;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Pgn.h"
+#include "Position.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// Training data file (.tdat), little-endian: a TrainingHeader followed by
+// fixed-size PackedPosition records, game after game in the order they were
+// played. Fixed records keep the format trivial to append to, to map and to
+// split into shards for parallel readers.
+
+#define TRAINING_MAGIC "CHTD"
+#define TRAINING_VERSION 1
+
+struct TrainingHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize; // sizeof(PackedPosition)
+    uint32_t reserved;
+};
+
+// One position in 32 bytes. The occupied squares are listed lowest first
+// and each gets a 4-bit piece code in pieces[]: the low nibble of a byte
+// first, piece type 1-6, plus 8 for black.
+struct PackedPosition
+{
+    uint64_t occupied;
+    uint8_t pieces[16];
+    int16_t score;        // Search score in centipawns from white's side
+    uint8_t result;       // White's result in half points: 0, 1 or 2
+    uint8_t sideAndEp;    // Bit 7 set = black to move; low bits en passant square, 64 = none
+    uint8_t castling;     // CastlingRights
+    uint8_t halfmoveClock;
+    uint16_t fullmoveNumber;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+// score is the search score from the side to move, as engines report it
+void PackPosition(const Position &pos, int score, PackedPosition &packed);
+// Fills pos straight from the record, key included; false if it's malformed
+bool UnpackPosition(const PackedPosition &packed, Position &pos);
+int ResultHalfPoints(GameResult result); // -1 for RESULT_UNKNOWN
+
+// Appends records to a file, creating it with its header when it's new
+struct TrainingWriter
+{
+    FILE *file = nullptr;
+    uint64_t written = 0;
+};
+
+bool OpenTrainingWriter(TrainingWriter &writer, const char *path);
+void CloseTrainingWriter(TrainingWriter &writer);
+// A finished game's positions, stamped with its result
+bool WriteTrainingGame(TrainingWriter &writer, PackedPosition *positions, size_t count, GameResult result);
+
+// Reads one shard of a mapped file: shard i of n gets the i-th n-th of the
+// records, so n readers on n threads cover the file once between them
+struct TrainingReader
+{
+    MappedFile file;
+    const PackedPosition *records = nullptr;
+    uint64_t first = 0, last = 0, next = 0;
+};
+
+bool OpenTrainingReader(TrainingReader &reader, const char *path, int shard = 0, int shardCount = 1);
+void CloseTrainingReader(TrainingReader &reader);
+uint64_t TrainingRecordCount(const TrainingReader &reader); // In this shard
+// Next position of the shard with its score and result (half points); false at the end
+bool ReadTrainingPosition(TrainingReader &reader, Position &pos, int &score, int &result);
@@ -0,0 +1,123 @@
+#include "TranspositionTable.h"
+
+// data = move (16) | score (16) | eval (16) | depth (8) | bound (2) | generation (6)
+static uint64_t Pack(Move move, int score, int eval, int depth, int bound, int generation)
+{
+    return (uint64_t)move | (uint64_t)(uint16_t)score << 16 | (uint64_t)(uint16_t)eval << 32 |
+           (uint64_t)(uint8_t)depth << 48 | (uint64_t)bound << 56 | (uint64_t)(generation & 63) << 58;
+}
+
+static int PackedDepth(uint64_t data) { return (int8_t)(data >> 48); }
+static int PackedGeneration(uint64_t data) { return (int)(data >> 58); }
+
+void ResizeTranspositionTable(TranspositionTable &tt, size_t megabytes)
+{
+    size_t count = megabytes * 1024 * 1024 / sizeof(TTBucket);
+    if (count == 0)
+        count = 1;
+    if (count != tt.bucketCount)
+    {
+        tt.buckets.reset();
+        tt.buckets.reset(new TTBucket[count]);
+        tt.bucketCount = count;
+    }
+    ClearTranspositionTable(tt);
+}
+
+void ClearTranspositionTable(TranspositionTable &tt)
+{
+    for (size_t i = 0; i < tt.bucketCount; i++)
+    {
+        for (TTEntry &entry : tt.buckets[i].entries)
+        {
+            entry.check.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    tt.generation = 0;
+}
+
+void NewSearchGeneration(TranspositionTable &tt)
+{
+    tt.generation = (uint8_t)((tt.generation + 1) & 63);
+}
+
+static TTBucket &BucketFor(const TranspositionTable &tt, uint64_t key)
+{
+    // Multiply-shift maps the key onto any table size without a modulo
+    return tt.buckets[(size_t)(((unsigned __int128)key * tt.bucketCount) >> 64)];
+}
+
+bool ProbeTranspositionTable(const TranspositionTable &tt, uint64_t key, TTData &data)
+{
+    if (tt.bucketCount == 0)
+        return false;
+
+    TTBucket &bucket = BucketFor(tt, key);
+    for (TTEntry &entry : bucket.entries)
+    {
+        uint64_t packed = entry.data.load(std::memory_order_relaxed);
+        if ((entry.check.load(std::memory_order_relaxed) ^ packed) != key || packed == 0)
+            continue;
+
+        data.move = (Move)(packed & 0xFFFF);
+        data.score = (int16_t)(packed >> 16);
+        data.eval = (int16_t)(packed >> 32);
+        data.depth = PackedDepth(packed);
+        data.bound = (int)(packed >> 56) & 3;
+        return true;
+    }
+    return false;
+}
+
+void StoreTranspositionTable(TranspositionTable &tt, uint64_t key, Move move, int score, int eval, int depth, int bound)
+{
+    if (tt.bucketCount == 0)
+        return;
+
+    // Same position first, otherwise the shallowest entry, older searches counting as shallower
+    TTBucket &bucket = BucketFor(tt, key);
+    TTEntry *replace = &bucket.entries[0];
+    int worst = 1 << 30;
+    for (TTEntry &entry : bucket.entries)
+    {
+        uint64_t packed = entry.data.load(std::memory_order_relaxed);
+        if ((entry.check.load(std::memory_order_relaxed) ^ packed) == key)
+        {
+            replace = &entry;
+            // Keep the old best move and a deeper exact result
+            if (move == MOVE_NONE)
+                move = (Move)(packed & 0xFFFF);
+            if (bound != BOUND_EXACT && PackedDepth(packed) > depth + 3 && PackedGeneration(packed) == tt.generation)
+                return;
+            break;
+        }
+        int age = (tt.generation - PackedGeneration(packed)) & 63;
+        int value = PackedDepth(packed) - 8 * age;
+        if (value < worst)
+        {
+            worst = value;
+            replace = &entry;
+        }
+    }
+
+    uint64_t packed = Pack(move, score, eval, depth, bound, tt.generation);
+    replace->check.store(key ^ packed, std::memory_order_relaxed);
+    replace->data.store(packed, std::memory_order_relaxed);
+}
+
+int TranspositionTableFull(const TranspositionTable &tt)
+{
+    size_t samples = tt.bucketCount < 250 ? tt.bucketCount : 250;
+    int used = 0;
+    for (size_t i = 0; i < samples; i++)
+    {
+        for (TTEntry &entry : tt.buckets[i].entries)
+        {
+            uint64_t packed = entry.data.load(std::memory_order_relaxed);
+            if (packed != 0 && PackedGeneration(packed) == tt.generation)
+                used++;
+        }
+    }
+    return samples ? (int)(used * 1000 / (samples * 4)) : 0;
+}
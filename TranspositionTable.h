@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Position.h"
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared hash table of search results. Every search thread reads and writes
+// it without locks: each entry stores key ^ data next to data, so a torn
+// write from another thread shows up as a key mismatch instead of bad data.
+
+enum BoundType
+{
+    BOUND_NONE = 0,
+    BOUND_UPPER = 1,
+    BOUND_LOWER = 2,
+    BOUND_EXACT = 3
+};
+
+struct TTEntry
+{
+    std::atomic<uint64_t> check; // key ^ data
+    std::atomic<uint64_t> data;
+};
+
+// Four entries per 64-byte cache line
+struct alignas(64) TTBucket
+{
+    TTEntry entries[4];
+};
+
+struct TTData
+{
+    Move move;
+    int score;
+    int eval;
+    int depth;
+    int bound;
+};
+
+struct TranspositionTable
+{
+    std::unique_ptr<TTBucket[]> buckets;
+    size_t bucketCount = 0;
+    uint8_t generation = 0; // Bumped every search so stale entries are replaced first
+};
+
+void ResizeTranspositionTable(TranspositionTable &tt, size_t megabytes);
+void ClearTranspositionTable(TranspositionTable &tt);
+void NewSearchGeneration(TranspositionTable &tt);
+bool ProbeTranspositionTable(const TranspositionTable &tt, uint64_t key, TTData &data);
+void StoreTranspositionTable(TranspositionTable &tt, uint64_t key, Move move, int score, int eval, int depth, int bound);
+int TranspositionTableFull(const TranspositionTable &tt); // Per mille of entries from this search
@@ -0,0 +1,538 @@
+#include "Evaluate.h"
+#include "Pgn.h"
+#include "TrainingData.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+// Usage: tune [-epochs N] [-rate R] [-k K] [-threads N] [-skip N] <positions> [more positions ...] <EvalParams.h>
+//
+// Texel-style tuning of the evaluation weights: fits every weight pair in
+// EvalParams.h so that a logistic curve of the evaluation predicts the game
+// results of a large set of labelled positions, then writes the header back
+// for the engine to compile in.
+//
+// Position files are either text, one position per line with its game's
+// result anywhere after the FEN ("1-0", "0-1", "1/2-1/2" or [1.0], [0.5],
+// [0.0] from white's side), PGN games (.pgn), sampled for quiet positions:
+// past the first -skip plies (default 8), not in check, no winning capture
+// for the side to move and not followed by a capture or promotion, or
+// training data (.tdat, from selfplay -dataout), whose quiet positions are
+// read by one thread per shard.
+//
+// The evaluation is linear in its weights once the game phase is known, so
+// each position is traced once at load time into the few terms it uses:
+// term index and count, both small, kept in flat arrays shared by all
+// positions. An epoch then walks those arrays straight through on every
+// thread, each thread over its own slice with its own gradient, and Adam
+// takes one step with the summed gradient. The scaling constant K of the
+// logistic curve is fitted to the starting weights first and kept fixed.
+
+#define DEFAULT_EPOCHS 200
+#define DEFAULT_RATE 1.0 // Adam step, about the centipawns a weight can move per epoch
+#define DEFAULT_SKIP 8
+#define REPORT_EVERY 10  // Epochs between progress lines and header writes
+#define LOAD_BATCH 65536 // Lines or games handed to the threads at a time
+
+// Every position's terms live in index/count; position i owns the entries
+// from start[i] up to start[i + 1]. A count that doesn't fit an int8_t is
+// split over several entries of the same term.
+struct TuneData
+{
+    vector<size_t> start{0};
+    vector<uint16_t> index;
+    vector<int8_t> count;
+    vector<uint8_t> phase;
+    vector<uint8_t> result; // White's score in half points: 0, 1 or 2
+
+    size_t Size() const { return phase.size(); }
+};
+
+struct TuneConfig
+{
+    int epochs = DEFAULT_EPOCHS;
+    double rate = DEFAULT_RATE;
+    double k = 0; // 0 = fit it
+    int threads = 1;
+    int skip = DEFAULT_SKIP;
+};
+
+typedef double Weights[][2];
+
+static void AddPosition(TuneData &data, const Position &pos, int result, EvalTrace &trace)
+{
+    TraceEvaluate(pos, trace);
+    for (int term = 0; term < (int)trace.counts.size(); term++)
+    {
+        int count = trace.counts[term];
+        while (count != 0)
+        {
+            int part = max(min(count, 127), -127);
+            data.index.push_back((uint16_t)term);
+            data.count.push_back((int8_t)part);
+            count -= part;
+        }
+    }
+    data.start.push_back(data.index.size());
+    data.phase.push_back((uint8_t)trace.phase);
+    data.result.push_back((uint8_t)result);
+}
+
+static void Append(TuneData &data, const TuneData &part)
+{
+    size_t base = data.index.size();
+    for (size_t i = 1; i < part.start.size(); i++)
+        data.start.push_back(base + part.start[i]);
+    data.index.insert(data.index.end(), part.index.begin(), part.index.end());
+    data.count.insert(data.count.end(), part.count.begin(), part.count.end());
+    data.phase.insert(data.phase.end(), part.phase.begin(), part.phase.end());
+    data.result.insert(data.result.end(), part.result.begin(), part.result.end());
+}
+
+// Runs work(first, last, thread) over [0, total) split in one slice per thread
+static void ParallelFor(size_t total, int threads, const function<void(size_t, size_t, int)> &work)
+{
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        size_t first = total * t / threads, last = total * (t + 1) / threads;
+        workers.emplace_back(work, first, last, t);
+    }
+    for (auto &worker : workers)
+        worker.join();
+}
+
+// Half points for white from a result marker in text, or -1
+static int ParseResult(const char *text)
+{
+    static const char *markers[6] = {"1/2-1/2", "1-0", "0-1", "[1.0]", "[0.5]", "[0.0]"};
+    static const int points[6] = {1, 2, 0, 2, 1, 0};
+    for (int i = 0; i < 6; i++)
+    {
+        if (strstr(text, markers[i]))
+            return points[i];
+    }
+    return -1;
+}
+
+static void LoadLines(const vector<string> &lines, TuneData &data, int threads, size_t &skipped)
+{
+    vector<TuneData> parts(threads);
+    vector<size_t> bad(threads, 0);
+    ParallelFor(lines.size(), threads, [&](size_t first, size_t last, int t) {
+        EvalTrace trace;
+        Position pos;
+        for (size_t i = first; i < last; i++)
+        {
+            int result = ParseResult(lines[i].c_str());
+            if (result < 0 || !SetFromFen(pos, lines[i].c_str()))
+                bad[t]++;
+            else
+                AddPosition(parts[t], pos, result, trace);
+        }
+    });
+    for (int t = 0; t < threads; t++)
+    {
+        Append(data, parts[t]);
+        skipped += bad[t];
+    }
+}
+
+// A position worth learning from: nothing about to be taken back
+static bool IsQuiet(const Position &pos, Move next)
+{
+    if (InCheck(pos) || (next != MOVE_NONE && (IsCapture(pos, next) || MovePromotion(next))))
+        return false;
+    Move captures[MAX_MOVES];
+    int count = GenerateCaptures(pos, captures);
+    for (int i = 0; i < count; i++)
+    {
+        if (StaticExchange(pos, captures[i]) > 0)
+            return false;
+    }
+    return true;
+}
+
+static void LoadGames(const vector<PgnGame> &games, TuneData &data, const TuneConfig &config, size_t &skipped)
+{
+    vector<TuneData> parts(config.threads);
+    vector<size_t> bad(config.threads, 0);
+    ParallelFor(games.size(), config.threads, [&](size_t first, size_t last, int t) {
+        EvalTrace trace;
+        for (size_t i = first; i < last; i++)
+        {
+            const PgnGame &game = games[i];
+            GameResult result = ParseGameResult(game.result);
+            Position pos;
+            SetStartPosition(pos);
+            const char *fen = GetPgnTag(game, "FEN");
+            if (result == RESULT_UNKNOWN || (fen && !SetFromFen(pos, fen)))
+            {
+                bad[t]++;
+                continue;
+            }
+            int points = result == RESULT_WHITE_WINS ? 2 : result == RESULT_DRAW ? 1 : 0;
+            for (size_t ply = 0; ply < game.moves.size(); ply++)
+            {
+                Move m = ParseSanMove(pos, game.moves[ply].c_str());
+                if (m == MOVE_NONE)
+                    break;
+                if ((int)ply >= config.skip && IsQuiet(pos, m))
+                    AddPosition(parts[t], pos, points, trace);
+                DoMove(pos, m);
+            }
+        }
+    });
+    for (int t = 0; t < config.threads; t++)
+    {
+        Append(data, parts[t]);
+        skipped += bad[t];
+    }
+}
+
+static bool LoadTrainingData(const char *path, TuneData &data, int threads, size_t &skipped)
+{
+    vector<TuneData> parts(threads);
+    vector<size_t> noisy(threads, 0);
+    vector<char> opened(threads, 0);
+    ParallelFor(threads, threads, [&](size_t, size_t, int t) {
+        TrainingReader reader;
+        if (!OpenTrainingReader(reader, path, t, threads))
+            return;
+        opened[t] = 1;
+        EvalTrace trace;
+        Position pos;
+        int score, result;
+        while (ReadTrainingPosition(reader, pos, score, result))
+        {
+            if (IsQuiet(pos, MOVE_NONE))
+                AddPosition(parts[t], pos, result, trace);
+            else
+                noisy[t]++;
+        }
+        CloseTrainingReader(reader);
+    });
+    if (!opened[0])
+        return false;
+    for (int t = 0; t < threads; t++)
+    {
+        Append(data, parts[t]);
+        skipped += noisy[t];
+    }
+    return true;
+}
+
+static bool LoadFile(const char *path, TuneData &data, const TuneConfig &config)
+{
+    size_t before = data.Size(), skipped = 0;
+    size_t length = strlen(path);
+    if (length > 5 && strcmp(path + length - 5, ".tdat") == 0)
+    {
+        if (!LoadTrainingData(path, data, config.threads, skipped))
+            return false;
+        printf("%s: %zu positions, %zu not quiet skipped\n", path, data.Size() - before, skipped);
+        return true;
+    }
+    if (length > 4 && strcmp(path + length - 4, ".pgn") == 0)
+    {
+        PgnReader reader;
+        if (!OpenPgn(reader, path))
+            return false;
+        vector<PgnGame> games;
+        PgnGame game;
+        while (ReadPgnGame(reader, game))
+        {
+            games.push_back(move(game));
+            if (games.size() == LOAD_BATCH)
+            {
+                LoadGames(games, data, config, skipped);
+                games.clear();
+            }
+        }
+        LoadGames(games, data, config, skipped);
+        ClosePgn(reader);
+        printf("%s: %zu positions, %zu games without a result skipped\n", path, data.Size() - before, skipped);
+        return true;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    vector<string> lines;
+    char line[512];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '\n' || line[0] == '\r' || line[0] == '#')
+            continue;
+        lines.push_back(line);
+        if (lines.size() == LOAD_BATCH)
+        {
+            LoadLines(lines, data, config.threads, skipped);
+            lines.clear();
+        }
+    }
+    LoadLines(lines, data, config.threads, skipped);
+    fclose(file);
+    printf("%s: %zu positions, %zu unreadable lines skipped\n", path, data.Size() - before, skipped);
+    return true;
+}
+
+// Evaluation of position i from white's side
+static inline double Evaluation(const TuneData &data, size_t i, const Weights weights)
+{
+    double mg = 0, eg = 0;
+    for (size_t e = data.start[i]; e < data.start[i + 1]; e++)
+    {
+        mg += data.count[e] * weights[data.index[e]][0];
+        eg += data.count[e] * weights[data.index[e]][1];
+    }
+    return (mg * data.phase[i] + eg * (MAX_PHASE - data.phase[i])) / MAX_PHASE;
+}
+
+static inline double Sigmoid(double k, double eval)
+{
+    return 1 / (1 + exp(-k * eval));
+}
+
+// Mean squared error of the predicted results
+static double Error(const TuneData &data, const Weights weights, double k, int threads)
+{
+    vector<double> sums(threads, 0);
+    ParallelFor(data.Size(), threads, [&](size_t first, size_t last, int t) {
+        double sum = 0;
+        for (size_t i = first; i < last; i++)
+        {
+            double error = data.result[i] * 0.5 - Sigmoid(k, Evaluation(data, i, weights));
+            sum += error * error;
+        }
+        sums[t] = sum;
+    });
+    double total = 0;
+    for (double sum : sums)
+        total += sum;
+    return total / max(data.Size(), (size_t)1);
+}
+
+// Scaling constant with the least error, narrowed down digit by digit
+static double FitK(const TuneData &data, const Weights weights, int threads)
+{
+    double best = 0.004, step = 0.001;
+    double bestError = Error(data, weights, best, threads);
+    for (int digit = 0; digit < 5; digit++)
+    {
+        double centre = best;
+        for (int i = -9; i <= 9; i++)
+        {
+            double k = centre + i * step;
+            if (k <= 0 || i == 0)
+                continue;
+            double error = Error(data, weights, k, threads);
+            if (error < bestError)
+            {
+                bestError = error;
+                best = k;
+            }
+        }
+        step /= 10;
+    }
+    return best;
+}
+
+// Gradient of the mean squared error over all positions, summed from one slice per thread
+static void Gradient(const TuneData &data, const Weights weights, double k, int threads, int terms, Weights gradient)
+{
+    vector<vector<double>> parts(threads, vector<double>(terms * 2, 0));
+    ParallelFor(data.Size(), threads, [&](size_t first, size_t last, int t) {
+        double *part = parts[t].data();
+        for (size_t i = first; i < last; i++)
+        {
+            double p = Sigmoid(k, Evaluation(data, i, weights));
+            double slope = (p - data.result[i] * 0.5) * p * (1 - p);
+            double mg = slope * data.phase[i], eg = slope * (MAX_PHASE - data.phase[i]);
+            for (size_t e = data.start[i]; e < data.start[i + 1]; e++)
+            {
+                part[data.index[e] * 2] += mg * data.count[e];
+                part[data.index[e] * 2 + 1] += eg * data.count[e];
+            }
+        }
+    });
+    // The constant factors (2k / MAX_PHASE / size) don't matter to Adam
+    for (int term = 0; term < terms; term++)
+    {
+        gradient[term][0] = gradient[term][1] = 0;
+        for (int t = 0; t < threads; t++)
+        {
+            gradient[term][0] += parts[t][term * 2];
+            gradient[term][1] += parts[t][term * 2 + 1];
+        }
+    }
+}
+
+static void WriteRow(FILE *file, const Weights weights, int first, int count)
+{
+    for (int i = 0; i < count; i++)
+        fprintf(file, "%s{%ld, %ld}", i > 0 ? ", " : "", lround(weights[first + i][0]), lround(weights[first + i][1]));
+}
+
+static bool WriteParams(const char *path, const Weights weights)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+    fprintf(file, "#pragma once\n\n"
+                  "// Evaluation weights in centipawns, each as a {middlegame, endgame} pair that\n"
+                  "// Evaluate() blends by game phase. Piece-square tables are written from\n"
+                  "// white's side with rank 8 first, like the board array; black reads them\n"
+                  "// mirrored.\n");
+
+    const EvalTable *tables;
+    int count = GetEvalTables(tables);
+    int term = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const EvalTable &table = tables[i];
+        bool followsPair = i > 0 && tables[i - 1].size == 1 && table.size == 1 && !table.comment;
+        if (!followsPair)
+            fprintf(file, "\n");
+        if (table.comment)
+            fprintf(file, "// %s\n", table.comment);
+        if (table.size == 1)
+        {
+            fprintf(file, "constexpr int %s[2] = ", table.name);
+            WriteRow(file, weights, term, 1);
+            fprintf(file, ";\n");
+        }
+        else
+        {
+            fprintf(file, "constexpr int %s[%d][2] = {\n", table.name, table.size);
+            for (int row = 0; row < table.size; row += 8)
+            {
+                fprintf(file, "    ");
+                WriteRow(file, weights, term + row, min(table.size - row, 8));
+                fprintf(file, row + 8 < table.size ? ",\n" : "};\n");
+            }
+        }
+        term += table.size;
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    TuneConfig config;
+    config.threads = max((int)thread::hardware_concurrency(), 1);
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-epochs") == 0)
+            config.epochs = max(atoi(argv[first + 1]), 0);
+        else if (strcmp(argv[first], "-rate") == 0)
+            config.rate = atof(argv[first + 1]);
+        else if (strcmp(argv[first], "-k") == 0)
+            config.k = atof(argv[first + 1]);
+        else if (strcmp(argv[first], "-threads") == 0)
+            config.threads = max(atoi(argv[first + 1]), 1);
+        else if (strcmp(argv[first], "-skip") == 0)
+            config.skip = max(atoi(argv[first + 1]), 0);
+        else
+            printf("Unknown option %s\n", argv[first]);
+        first += 2;
+    }
+
+    if (argc - first < 2)
+    {
+        printf("Usage: %s [-epochs N] [-rate R] [-k K] [-threads N] [-skip N] <positions> [more positions ...] "
+               "<EvalParams.h>\n",
+               argv[0]);
+        return 1;
+    }
+
+    steady_clock::time_point start = steady_clock::now();
+    TuneData data;
+    for (int i = first; i < argc - 1; i++)
+    {
+        if (!LoadFile(argv[i], data, config))
+        {
+            printf("Could not open %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (data.Size() == 0)
+    {
+        printf("No positions to tune on\n");
+        return 1;
+    }
+    double seconds = duration_cast<milliseconds>(steady_clock::now() - start).count() / 1000.0;
+    printf("%zu positions, %zu terms (%.1f per position, %.0f MB) loaded in %.1f s\n", data.Size(), data.index.size(),
+           (double)data.index.size() / data.Size(),
+           (data.index.size() * 3 + data.Size() * (sizeof(size_t) + 2)) / 1048576.0, seconds);
+
+    // Starting point: the weights the engine was built with
+    const EvalTable *tables;
+    int tableCount = GetEvalTables(tables);
+    int terms = EvalTermCount();
+    vector<double> storage(terms * 2), gradientStorage(terms * 2), m(terms * 2, 0), v(terms * 2, 0);
+    double(*weights)[2] = (double(*)[2])storage.data();
+    double(*gradient)[2] = (double(*)[2])gradientStorage.data();
+    for (int i = 0, term = 0; i < tableCount; i++)
+    {
+        for (int j = 0; j < tables[i].size; j++, term++)
+        {
+            weights[term][0] = tables[i].weights[j][0];
+            weights[term][1] = tables[i].weights[j][1];
+        }
+    }
+
+    double k = config.k > 0 ? config.k : FitK(data, weights, config.threads);
+    double error = Error(data, weights, k, config.threads);
+    printf("K = %.6f, starting error %.6f\n", k, error);
+
+    // Adam, one step per epoch on the full gradient
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    double decay1 = 1, decay2 = 1;
+    start = steady_clock::now();
+    for (int epoch = 1; epoch <= config.epochs; epoch++)
+    {
+        Gradient(data, weights, k, config.threads, terms, gradient);
+        decay1 *= beta1;
+        decay2 *= beta2;
+        for (int i = 0; i < terms * 2; i++)
+        {
+            double g = gradientStorage[i];
+            m[i] = beta1 * m[i] + (1 - beta1) * g;
+            v[i] = beta2 * v[i] + (1 - beta2) * g * g;
+            double mHat = m[i] / (1 - decay1), vHat = v[i] / (1 - decay2);
+            storage[i] -= config.rate * mHat / (sqrt(vHat) + epsilon);
+        }
+
+        if (epoch % REPORT_EVERY == 0 || epoch == config.epochs)
+        {
+            error = Error(data, weights, k, config.threads);
+            seconds = duration_cast<milliseconds>(steady_clock::now() - start).count() / 1000.0;
+            printf("Epoch %d: error %.6f (%.2f s per epoch)\n", epoch, error, seconds / epoch);
+            fflush(stdout);
+            if (!WriteParams(argv[argc - 1], weights))
+            {
+                printf("Could not write %s\n", argv[argc - 1]);
+                return 1;
+            }
+        }
+    }
+    if (config.epochs == 0 && !WriteParams(argv[argc - 1], weights))
+    {
+        printf("Could not write %s\n", argv[argc - 1]);
+        return 1;
+    }
+    printf("Weights written to %s\n", argv[argc - 1]);
+    return 0;
+}
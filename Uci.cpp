@@ -0,0 +1,241 @@
+#include "Position.h"
+#include "Search.h"
+#include "Syzygy.h"
+#include "Tablebase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// UCI front-end: stdin is read on the main thread while the search runs on
+// its own thread, so "stop" and "ponderhit" are seen within a few
+// milliseconds. Usage: chess-uci, then talk UCI on stdin/stdout.
+
+static Engine engine;
+static Position position;
+static vector<uint64_t> positionHistory; // Keys of the game positions before the current one
+static thread searchThread;
+static mutex outputMutex;
+static int multiPv = 1;
+
+static void Send(const string &line)
+{
+    lock_guard<mutex> lock(outputMutex);
+    fputs(line.c_str(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+static string ScoreText(int score)
+{
+    if (IsMateScore(score))
+        return "mate " + to_string(MateInMoves(score));
+    return "cp " + to_string(score);
+}
+
+static void SendInfo(const SearchInfo &info)
+{
+    const SearchLine &line = *info.line;
+    string text = "info depth " + to_string(info.depth) + " seldepth " + to_string(line.selDepth) +
+                  " multipv " + to_string(info.multiPv) + " score " + ScoreText(line.score) +
+                  " nodes " + to_string(info.nodes) +
+                  " nps " + to_string(info.nodes * 1000 / (uint64_t)max<int64_t>(info.timeMs, 1)) +
+                  " hashfull " + to_string(info.hashFull) + " tbhits " + to_string(info.tbHits) +
+                  " time " + to_string(info.timeMs) + " pv";
+    for (int i = 0; i < line.length; i++)
+        text += " " + MoveToUci(line.pv[i]);
+    Send(text);
+}
+
+static void WaitForSearch()
+{
+    if (searchThread.joinable())
+        searchThread.join();
+}
+
+static void StopAndWait()
+{
+    StopSearch(engine);
+    WaitForSearch();
+}
+
+static void SetOption(istringstream &input)
+{
+    string word, name, value;
+    input >> word; // "name"
+    while (input >> word && word != "value")
+        name += (name.empty() ? "" : " ") + word;
+    while (input >> word)
+        value += (value.empty() ? "" : " ") + word;
+
+    if (name == "Hash")
+        SetEngineHash(engine, atoi(value.c_str()));
+    else if (name == "Threads")
+        SetEngineThreads(engine, atoi(value.c_str()));
+    else if (name == "MultiPV")
+        multiPv = max(1, min(atoi(value.c_str()), MAX_MULTI_PV));
+    else if (name == "Clear Hash")
+        ClearEngine(engine);
+    else if (name == "SyzygyPath")
+        SetSyzygyPath(value.c_str());
+    else if (name == "TablebasePath")
+        SetTablebasePath(value.c_str());
+}
+
+static void SetPosition(istringstream &input)
+{
+    string word;
+    input >> word;
+    if (word == "startpos")
+    {
+        SetStartPosition(position);
+        input >> word; // "moves", if any
+    }
+    else if (word == "fen")
+    {
+        string fen;
+        while (input >> word && word != "moves")
+            fen += (fen.empty() ? "" : " ") + word;
+        if (!SetFromFen(position, fen.c_str()))
+        {
+            Send("info string invalid fen");
+            SetStartPosition(position);
+        }
+    }
+
+    positionHistory.clear();
+    while (input >> word)
+    {
+        Move m = ParseUciMove(position, word.c_str());
+        if (m == MOVE_NONE)
+        {
+            Send("info string illegal move " + word);
+            break;
+        }
+        positionHistory.push_back(position.key);
+        DoMove(position, m);
+    }
+}
+
+static void Go(istringstream &input)
+{
+    SearchLimits limits;
+    limits.multiPv = multiPv;
+    string word;
+    while (input >> word)
+    {
+        if (word == "searchmoves")
+        {
+            // Runs to the end of the line or the next keyword
+            streampos mark = input.tellg();
+            while (input >> word)
+            {
+                Move m = ParseUciMove(position, word.c_str());
+                if (m == MOVE_NONE)
+                    break;
+                limits.searchMoves.push_back(m);
+                mark = input.tellg();
+            }
+            input.clear();
+            input.seekg(mark);
+        }
+        else if (word == "ponder")
+            limits.ponder = true;
+        else if (word == "infinite")
+            limits.infinite = true;
+        else if (word == "wtime")
+            input >> limits.time[0];
+        else if (word == "btime")
+            input >> limits.time[1];
+        else if (word == "winc")
+            input >> limits.increment[0];
+        else if (word == "binc")
+            input >> limits.increment[1];
+        else if (word == "movestogo")
+            input >> limits.movesToGo;
+        else if (word == "depth")
+            input >> limits.depth;
+        else if (word == "nodes")
+            input >> limits.nodes;
+        else if (word == "movetime")
+            input >> limits.moveTime;
+    }
+
+    Position root = position;
+    vector<uint64_t> history = positionHistory;
+    searchThread = thread([root, history, limits]() {
+        SearchResult result = Search(engine, root, history, limits, SendInfo);
+        string text = "bestmove " + (result.bestMove != MOVE_NONE ? MoveToUci(result.bestMove) : string("0000"));
+        if (result.ponderMove != MOVE_NONE)
+            text += " ponder " + MoveToUci(result.ponderMove);
+        Send(text);
+    });
+}
+
+int main()
+{
+    InitEngine(engine, 64, 1);
+    SetStartPosition(position);
+    SetTablebasePath("tablebases");
+    SetSyzygyPath("syzygy");
+
+    string line;
+    while (getline(cin, line))
+    {
+        istringstream input(line);
+        string command;
+        input >> command;
+
+        if (command == "uci")
+        {
+            Send("id name Chess");
+            Send("id author CoderAmbar");
+            Send("option name Hash type spin default 64 min 1 max 65536");
+            Send("option name Threads type spin default 1 min 1 max 256");
+            Send("option name MultiPV type spin default 1 min 1 max " + to_string(MAX_MULTI_PV));
+            Send("option name Ponder type check default false");
+            Send("option name Clear Hash type button");
+            Send("option name SyzygyPath type string default syzygy");
+            Send("option name TablebasePath type string default tablebases");
+            Send("uciok");
+        }
+        else if (command == "isready")
+            Send("readyok");
+        else if (command == "ucinewgame")
+        {
+            StopAndWait();
+            ClearEngine(engine);
+        }
+        else if (command == "setoption")
+        {
+            StopAndWait();
+            SetOption(input);
+        }
+        else if (command == "position")
+        {
+            StopAndWait();
+            SetPosition(input);
+        }
+        else if (command == "go")
+        {
+            StopAndWait();
+            Go(input);
+        }
+        else if (command == "stop")
+            StopAndWait();
+        else if (command == "ponderhit")
+            PonderHit(engine);
+        else if (command == "quit")
+            break;
+    }
+
+    StopAndWait();
+    return 0;
+}